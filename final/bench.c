@@ -0,0 +1,550 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parser.h"
+#include "interp.h"
+#include "lval.h"
+#include "pool.h"
+#include "lispy_gen.h"
+
+/*
+ * Micro benchmarks for the reader. Run all of them or name the ones to run:
+ *
+ *   bench [name ...]
+ */
+
+static double bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Generate roughly size bytes of typical lispy source */
+static char *bench_source(size_t size, size_t *len) {
+    static const char *forms[] = {
+        "(def {add-mul} (\\ {x y} {+ x (* x y)}))\n",
+        "; a comment line between definitions\n",
+        "(if (== n 0) {print \"zero\"} {add-mul n -12})\n",
+        "{1 2 3 {nested \"string with \\\"escapes\\\"\"} sym}\n",
+    };
+    char *buf = malloc(size + 128);
+    size_t n = 0;
+    for (int i = 0; n < size; i = (i + 1) % 4) {
+        size_t l = strlen(forms[i]);
+        memcpy(buf + n, forms[i], l);
+        n += l;
+    }
+    buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+static void bench_result(int ok, mpc_result_t *r) {
+    if (ok) {
+        lval_del(1, r->output);
+    } else {
+        mpc_err_print(r->error);
+        mpc_err_delete(r->error);
+    }
+}
+
+static void bench_row(size_t len, double secs) {
+    printf("  %9zu %9.4f %9.2f %9.1f\n", len, secs, len / secs / 1e6, secs * 1e9 / len);
+    fflush(stdout);
+}
+
+/* Write size bytes of source to a new temporary file named in path */
+static int bench_tmpfile(char *path, size_t size, size_t *len) {
+    char *src = bench_source(size, len);
+    strcpy(path, "/tmp/byol-bench-XXXXXX");
+    int fd = mkstemp(path);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (f == NULL) {
+        perror("bench");
+        free(src);
+        return 0;
+    }
+    fwrite(src, 1, *len, f);
+    fclose(f);
+    free(src);
+    return 1;
+}
+
+/* Parse time against input size, should scale linearly */
+static void bench_parse_size(void) {
+    puts("parse-size: bytes, seconds, MB/s, ns/byte");
+    for (size_t size = 64 * 1024; size <= 4 * 1024 * 1024; size *= 2) {
+        size_t len;
+        char *src = bench_source(size, &len);
+
+        mpc_result_t r;
+        double start = bench_now();
+        int ok = mpc_nparse("<bench>", src, len, Lispy, &r);
+        double secs = bench_now() - start;
+
+        bench_result(ok, &r);
+        bench_row(len, secs);
+        free(src);
+    }
+}
+
+/* Parse a file from disk, compare against the in-memory parse-size rows */
+static void bench_parse_file(void) {
+    char path[32];
+    size_t len;
+    if (!bench_tmpfile(path, 1024 * 1024, &len)) { return; }
+
+    mpc_result_t r;
+    double start = bench_now();
+    int ok = mpc_parse_contents(path, Lispy, &r);
+    double secs = bench_now() - start;
+
+    puts("parse-file: bytes, seconds, MB/s, ns/byte");
+    bench_result(ok, &r);
+    bench_row(len, secs);
+    remove(path);
+}
+
+/* Parse through a real pipe, which has to buffer for backtracking */
+static void bench_parse_pipe(void) {
+    puts("parse-pipe: bytes, seconds, MB/s, ns/byte");
+    for (size_t size = 64 * 1024; size <= 1024 * 1024; size *= 2) {
+        char path[32];
+        char cmd[64];
+        size_t len;
+        if (!bench_tmpfile(path, size, &len)) { return; }
+        snprintf(cmd, sizeof(cmd), "cat %s", path);
+
+        FILE *pipe = popen(cmd, "r");
+        mpc_result_t r;
+        double start = bench_now();
+        int ok = mpc_parse_pipe("<pipe>", pipe, Lispy, &r);
+        double secs = bench_now() - start;
+        pclose(pipe);
+
+        bench_result(ok, &r);
+        bench_row(len, secs);
+        remove(path);
+    }
+}
+
+/* One regex over a single long token, isolates the regex matcher */
+static void bench_regex(void) {
+    static const char *res[] = {
+        "[a-zA-Z0-9_+\\-*/\\\\=<>!&]+",
+        "\"(\\\\.|[^\"\\\\])*\"",
+    };
+    size_t len = 1024 * 1024;
+    char *src = malloc(len + 1);
+
+    puts("regex: bytes, seconds, MB/s, ns/byte");
+    for (int k = 0; k < 2; k++) {
+        for (size_t j = 0; j < len; j++) { src[j] = "ab+\\\"x"[j % 6]; }
+        if (k == 0) {
+            for (size_t j = 0; j < len; j++) { if (src[j] == '\\' || src[j] == '"') { src[j] = '*'; } }
+        } else {
+            src[0] = '"';
+            src[len - 1] = '"';
+        }
+        src[len] = '\0';
+
+        mpc_parser_t *re = mpc_re(res[k]);
+        mpc_result_t r;
+        double start = bench_now();
+        int ok = mpc_nparse("<bench>", src, len, re, &r);
+        double secs = bench_now() - start;
+
+        printf("  %s\n", res[k]);
+        if (ok) { free(r.output); } else { mpc_err_print(r.error); mpc_err_delete(r.error); }
+        bench_row(len, secs);
+        mpc_delete(re);
+    }
+    free(src);
+}
+
+static void bench_span(void) {
+    static const char *classes[] = {" \t\r\n", "abcdefghijklmnopqrstuvwxyz_+-*/"};
+    size_t len = 4 * 1024 * 1024;
+    char *src = malloc(len + 1);
+
+    puts("span: bytes, seconds, MB/s, ns/byte");
+    for (int k = 0; k < 2; k++) {
+        size_t n = strlen(classes[k]);
+        for (size_t j = 0; j < len; j++) { src[j] = classes[k][j % n]; }
+        src[len] = '\0';
+
+        mpc_parser_t *p = mpc_many1(mpcf_strfold, mpc_oneof(classes[k]));
+        mpc_optimise(p);
+        mpc_result_t r;
+        double start = bench_now();
+        int ok = mpc_nparse("<bench>", src, len, p, &r);
+        double secs = bench_now() - start;
+
+        printf("  many1 of oneof \"%s\"\n", k == 0 ? "whitespace" : "symbol chars");
+        if (ok) { free(r.output); } else { mpc_err_print(r.error); mpc_err_delete(r.error); }
+        bench_row(len, secs);
+        mpc_delete(p);
+    }
+    free(src);
+}
+
+/* Nested brackets make an ordered choice grammar retry every rule at every level */
+static void bench_packrat(void) {
+    static const char *lang =
+        " expr   : <term> '+' <expr> | <term> '-' <expr> | <term> ;"
+        " term   : <factor> '*' <term> | <factor> '/' <term> | <factor> ;"
+        " factor : /[0-9]+/ | '(' <expr> ')' ;";
+    static const int flags[] = {MPCA_LANG_DEFAULT, MPCA_LANG_PACKRAT};
+    /* The deep rows should grow linearly with the depth */
+    static const int depths[] = {1, 3, 5, 10, 100, 1000, 2000, 4000, 8000};
+    char *src = malloc(2 * 8000 + 2);
+
+    puts("packrat: depth or terms, seconds");
+    for (int k = 0; k < 2; k++) {
+        mpc_parser_t *expr = mpc_new("expr");
+        mpc_parser_t *term = mpc_new("term");
+        mpc_parser_t *factor = mpc_new("factor");
+        mpc_err_t *err = mpca_lang(flags[k], lang, expr, term, factor, NULL);
+        if (err) { mpc_err_print(err); mpc_err_delete(err); return; }
+
+        printf("  %s\n", k == 0 ? "default" : "packrat");
+        for (int d = 0; d < (int)(sizeof(depths) / sizeof(depths[0])); d++) {
+            /* Without the memo every level costs nine times the one inside it */
+            if (k == 0 && depths[d] > 5) { break; }
+            int n = 0;
+            for (int j = 0; j < depths[d]; j++) { src[n++] = '('; }
+            src[n++] = '1';
+            for (int j = 0; j < depths[d]; j++) { src[n++] = ')'; }
+            src[n] = '\0';
+
+            mpc_result_t r;
+            double start = bench_now();
+            int ok = mpc_parse("<bench>", src, expr, &r);
+            double secs = bench_now() - start;
+            if (ok) { mpc_ast_delete(r.output); } else { mpc_err_print(r.error); mpc_err_delete(r.error); }
+            printf("    %5d %9.4f\n", depths[d], secs);
+            fflush(stdout);
+        }
+        /* A flat sum is linear either way, and shows what the memo costs */
+        for (int len = 10; len <= 1000; len *= 10) {
+            int n = 0;
+            for (int j = 0; j < len; j++) { src[n++] = '1'; src[n++] = j % 2 ? '+' : '*'; }
+            src[n++] = '1';
+            src[n] = '\0';
+
+            mpc_result_t r;
+            double start = bench_now();
+            int ok = mpc_parse("<bench>", src, expr, &r);
+            double secs = bench_now() - start;
+            if (ok) { mpc_ast_delete(r.output); } else { mpc_err_print(r.error); mpc_err_delete(r.error); }
+            printf("    %5d %9.4f (flat)\n", len, secs);
+            fflush(stdout);
+        }
+        if (k == 1) { mpc_stats(factor); }
+        mpc_cleanup(3, expr, term, factor);
+    }
+    free(src);
+}
+
+/* Deeply nested expressions, the parse should stay linear and never run out of stack */
+static void bench_deep(void) {
+    puts("deep: depth, seconds, MB/s, ns/byte");
+    for (size_t depth = 1000; depth <= 1000000; depth *= 10) {
+        size_t len = 0;
+        char *src = malloc(2 * depth + 2);
+        for (size_t j = 0; j < depth; j++) { src[len++] = '('; }
+        src[len++] = '1';
+        for (size_t j = 0; j < depth; j++) { src[len++] = ')'; }
+        src[len] = '\0';
+
+        mpc_result_t r;
+        double start = bench_now();
+        int ok = mpc_nparse("<bench>", src, len, Lispy, &r);
+        double secs = bench_now() - start;
+
+        bench_result(ok, &r);
+        bench_row(len, secs);
+        free(src);
+    }
+}
+
+/* One line parses as the REPL does them, where setting up the input is most of the cost */
+static void bench_small(void) {
+    static const char *line = "(def {x} (+ 1 (* 2 3)))";
+    puts("small: parses, seconds, us/parse");
+    for (int n = 10000; n <= 1000000; n *= 10) {
+        double start = bench_now();
+        for (int k = 0; k < n; k++) {
+            mpc_result_t r;
+            int ok = mpc_parse("<stdin>", line, Lispy, &r);
+            bench_result(ok, &r);
+        }
+        double secs = bench_now() - start;
+        printf("  %9d %9.4f %9.3f\n", n, secs, secs * 1e6 / n);
+        fflush(stdout);
+    }
+}
+
+/* The lispy grammar interpreted by mpca_lang against the parser mpcgen generates from it, both building an AST */
+static void bench_generated(void) {
+    static const char *names[] = {"number", "symbol", "string", "comment", "sexpr", "qexpr", "expr", "lispy"};
+    mpc_parser_t *rules[8];
+    for (int j = 0; j < 8; j++) { rules[j] = mpc_new(names[j]); }
+    mpc_err_t *err = mpca_lang(MPCA_LANG_DEFAULT, lgen_grammar,
+                               rules[0], rules[1], rules[2], rules[3], rules[4], rules[5], rules[6], rules[7], NULL);
+    if (err) { mpc_err_print(err); mpc_err_delete(err); return; }
+    mpc_parser_t *parsers[] = {rules[7], mpc_native(lgen_lispy)};
+
+    puts("generated: bytes, seconds, MB/s, ns/byte");
+    for (int k = 0; k < 2; k++) {
+        printf("  %s\n", k == 0 ? "mpca_lang" : "mpcgen");
+        for (size_t size = 64 * 1024; size <= 4 * 1024 * 1024; size *= 4) {
+            size_t len;
+            char *src = bench_source(size, &len);
+
+            mpc_result_t r;
+            double start = bench_now();
+            int ok = mpc_nparse("<bench>", src, len, parsers[k], &r);
+            double secs = bench_now() - start;
+
+            if (ok) { mpc_ast_delete(r.output); } else { mpc_err_print(r.error); mpc_err_delete(r.error); }
+            bench_row(len, secs);
+            free(src);
+        }
+    }
+
+    mpc_delete(parsers[1]);
+    mpc_cleanup(8, rules[0], rules[1], rules[2], rules[3], rules[4], rules[5], rules[6], rules[7]);
+}
+
+/* The lispy grammar through mpca_lang with and without mpc_optimise, nodes per rule then parse time */
+static void bench_optimise(void) {
+    static const char *names[] = {"number", "symbol", "string", "comment", "sexpr", "qexpr", "expr", "lispy"};
+    static const int flags[] = {MPCA_LANG_NO_OPTIMISE, MPCA_LANG_DEFAULT};
+
+    puts("optimise: nodes per rule, then bytes, seconds, MB/s, ns/byte");
+    for (int k = 0; k < 2; k++) {
+        mpc_parser_t *rules[8];
+        for (int j = 0; j < 8; j++) { rules[j] = mpc_new(names[j]); }
+        mpc_err_t *err = mpca_lang(flags[k], lgen_grammar,
+                                   rules[0], rules[1], rules[2], rules[3], rules[4], rules[5], rules[6], rules[7], NULL);
+        if (err) { mpc_err_print(err); mpc_err_delete(err); return; }
+
+        printf("  %s\n   ", k == 0 ? "unoptimised" : "optimised");
+        int total = 0;
+        for (int j = 0; j < 8; j++) {
+            int n = mpc_nodecount(rules[j]);
+            printf(" %s %d", names[j], n);
+            total += n;
+        }
+        printf(", total %d\n", total);
+
+        for (size_t size = 1024 * 1024; size <= 4 * 1024 * 1024; size *= 4) {
+            size_t len;
+            char *src = bench_source(size, &len);
+
+            mpc_result_t r;
+            double start = bench_now();
+            int ok = mpc_nparse("<bench>", src, len, rules[7], &r);
+            double secs = bench_now() - start;
+
+            if (ok) { mpc_ast_delete(r.output); } else { mpc_err_print(r.error); mpc_err_delete(r.error); }
+            bench_row(len, secs);
+            free(src);
+        }
+        mpc_cleanup(8, rules[0], rules[1], rules[2], rules[3], rules[4], rules[5], rules[6], rules[7]);
+    }
+}
+
+/* Where a lispy parse spends its time rule by rule, needs a build with BYOL_MPC_PROFILE */
+static void bench_profile(void) {
+    size_t len;
+    char *src = bench_source(1024 * 1024, &len);
+
+    mpc_profile_reset(Lispy);
+    mpc_result_t r;
+    double start = bench_now();
+    int ok = mpc_nparse("<bench>", src, len, Lispy, &r);
+    double secs = bench_now() - start;
+
+    puts("profile: bytes, seconds, MB/s, ns/byte");
+    bench_result(ok, &r);
+    bench_row(len, secs);
+    mpc_stats(Lispy);
+    mpc_profile_json(Lispy, stdout);
+    free(src);
+}
+
+static mpc_val_t *bench_token_free(mpc_val_t *x) {
+    free(x);
+    return NULL;
+}
+
+static mpc_val_t *bench_token_slice(const char *s, long n) {
+    (void) s;
+    (void) n;
+    return NULL;
+}
+
+/* Words made char by char, as strings folded together or as slices of the input */
+static void bench_slice(void) {
+    size_t len = 4 * 1024 * 1024;
+    char *src = malloc(len + 1);
+    for (size_t j = 0; j < len; j++) { src[j] = "lambda x y "[j % 11]; }
+    src[len] = '\0';
+
+    puts("slice: bytes, seconds, MB/s, ns/byte");
+    for (int k = 0; k < 2; k++) {
+        mpc_parser_t *word = mpc_many1(mpcf_strfold, mpc_alpha());
+        mpc_parser_t *token = k == 0 ? mpc_apply(word, bench_token_free) : mpc_slice(word, bench_token_slice);
+        mpc_parser_t *p = mpc_many(mpcf_null, mpc_tok(token));
+        mpc_result_t r;
+        double start = bench_now();
+        int ok = mpc_nparse("<bench>", src, len, p, &r);
+        double secs = bench_now() - start;
+
+        printf("  %s\n", k == 0 ? "strings" : "slices");
+        if (!ok) { mpc_err_print(r.error); mpc_err_delete(r.error); }
+        bench_row(len, secs);
+        mpc_delete(p);
+    }
+    free(src);
+}
+
+typedef struct {
+    int rounds;
+    int errors;
+} bench_interp_job;
+
+/* One interpreter per thread, each reading and evaluating its own copy of the work */
+static void bench_interp_task(void *ctx, int i) {
+    static const char *def = "(def {fib} (\\ {n} {if (< n 2) {+ n} {+ (fib (- n 1)) (fib (- n 2))}}))";
+    static const char *call = "(fib 12)";
+    bench_interp_job *job = ctx;
+
+    linterp *in = linterp_new(Lispy);
+    int errors = linterp_eval(in, "<bench>", def, strlen(def), 0);
+    for (int k = 0; k < job->rounds; k++) {
+        errors += linterp_eval(in, "<bench>", call, strlen(call), 0);
+    }
+    linterp_del(in);
+
+    if (errors) { __atomic_add_fetch(&job->errors, errors, __ATOMIC_RELAXED); }
+    (void) i;
+}
+
+/* Interpreters on 1, 2, 4... threads doing the same work each, so throughput should grow with cores */
+static void bench_interp(void) {
+    int cores = lpool_cores();
+    int most = cores < 4 ? 4 : cores;
+    bench_interp_job job = {200, 0};
+    double base = 0;
+
+    printf("interp: threads, seconds, evals/s, speedup (%d cores)\n", cores);
+    for (int t = 1; t <= most; t *= 2) {
+        lpool *pool = lpool_new(t);
+        double start = bench_now();
+        lpool_for(pool, t, bench_interp_task, &job);
+        double secs = bench_now() - start;
+        lpool_del(pool);
+
+        double rate = t * job.rounds / secs;
+        if (t == 1) { base = rate; }
+        printf("  %9d %9.4f %9.0f %9.2f\n", t, secs, rate, rate / base);
+        fflush(stdout);
+    }
+    if (job.errors) { printf("  %d evaluations failed\n", job.errors); }
+}
+
+/* CPU bound lambdas through pmap, pfilter and preduce on 1, 2, 4... workers, time should fall near linearly */
+static void bench_parallel(void) {
+    static const char *setup = "(def {fib} (\\ {n} {if (< n 2) {+ n} {+ (fib (- n 1)) (fib (- n 2))}}))"
+                               "(def {add} (\\ {a b} {+ a b}))";
+    static const char *names[] = {"pmap", "pfilter", "preduce"};
+    static const char *exprs[] = {
+        "(pmap fib {%s})",
+        "(pfilter (\\ {n} {> (fib n) 300}) {%s})",
+        "(preduce add 0 {%s})",
+    };
+
+    /* Uneven work for the first two, so that the pool has to steal to balance it */
+    char *items[3];
+    items[0] = malloc(64 * 4);
+    for (int i = 0, n = 0; i < 64; i++) { n += sprintf(items[0] + n, "%d ", 12 + i % 5); }
+    items[1] = items[0];
+    items[2] = malloc(100000 * 7);
+    for (int i = 0, n = 0; i < 100000; i++) { n += sprintf(items[2] + n, "%d ", i); }
+
+    int cores = lpool_cores();
+    int most = cores < 4 ? 4 : cores;
+
+    printf("parallel: workers, seconds, speedup (%d cores)\n", cores);
+    for (int k = 0; k < 3; k++) {
+        size_t len = strlen(exprs[k]) + strlen(items[k]);
+        char *src = malloc(len);
+        snprintf(src, len, exprs[k], items[k]);
+        printf("  %s\n", names[k]);
+
+        double base = 0;
+        for (int t = 1; t <= most; t *= 2) {
+            linterp *in = linterp_new(Lispy);
+            in->pool = lpool_new(t);
+            linterp_eval(in, "<bench>", setup, strlen(setup), 0);
+
+            double start = bench_now();
+            int errors = linterp_eval(in, "<bench>", src, strlen(src), 0);
+            double secs = bench_now() - start;
+            linterp_del(in);
+
+            if (t == 1) { base = secs; }
+            /* More workers than cores only shows the pool's overhead, not a speedup */
+            printf("  %9d %9.4f %9.2f%s%s\n", t, secs, base / secs, t > cores ? " oversubscribed" : "",
+                   errors ? " failed" : "");
+            fflush(stdout);
+        }
+        free(src);
+    }
+    free(items[0]);
+    free(items[2]);
+}
+
+typedef struct {
+    char *name;
+    void (*run)(void);
+} bench;
+
+static bench benches[] = {
+    {"parse-size", bench_parse_size},
+    {"parse-file", bench_parse_file},
+    {"parse-pipe", bench_parse_pipe},
+    {"regex", bench_regex},
+    {"span", bench_span},
+    {"packrat", bench_packrat},
+    {"deep", bench_deep},
+    {"small", bench_small},
+    {"generated", bench_generated},
+    {"optimise", bench_optimise},
+    {"profile", bench_profile},
+    {"slice", bench_slice},
+    {"interp", bench_interp},
+    {"parallel", bench_parallel},
+};
+
+int main(int argc, char **argv) {
+    lgrammar_new();
+
+    int n = sizeof(benches) / sizeof(benches[0]);
+    for (int i = 0; i < n; i++) {
+        int selected = argc < 2;
+        for (int j = 1; j < argc; j++) {
+            if (strcmp(argv[j], benches[i].name) == 0) { selected = 1; }
+        }
+        if (selected) { benches[i].run(); }
+    }
+
+    lgrammar_del();
+    return 0;
+}
@@ -1,8 +1,9 @@
 #include <stdlib.h>
 
+#include "interp.h"
 #include "lval.h"
 #include "macros.h"
-#include "parser.h"
+#include "module.h"
 
 lval *builtin_op(lenv *e, lval *rands, char *rator) {
     LASSERT(rands, (rands->count >= 1), 0, NULL, rator, "needs at least 1 argument");
@@ -91,7 +92,8 @@ lval *builtin_eval(lenv *e, lval *v) {
 }
 
 lval *builtin_print_env(lenv *e, lval *v) {
-    lenv_print(e);
+    linterp *in = linterp_of(e);
+    if (in->write) { lenv_write(e, in->write, in->write_ctx); }
     lval_del(1, v);
     return lval_sexpr();
 }
@@ -165,6 +167,8 @@ lval *builtin_var(lenv *e, lval *a, void (*var_func)(lenv *, lval *, lval *)) {
 }
 
 lval *builtin_def(lenv *e, lval *a) {
+    /* Parallel tasks read the global environment as they run */
+    LASSERT(a, !linterp_of(e)->parallel, 0, NULL, "def", "is not allowed inside pmap, pfilter or preduce");
     return builtin_var(e, a, &lenv_def);
 }
 
@@ -172,18 +176,21 @@ lval *builtin_put(lenv *e, lval *a) {
     return builtin_var(e, a, &lenv_put);
 }
 
+/* Stops the interpreter, not the process, which may have others running */
 lval *builtin_exit(lenv *e, lval *a) {
-    exit(0);
+    linterp_of(e)->exited = 1;
+    lval_del(1, a);
     return lval_sexpr();
 }
 
 lval *builtin_print(lenv *e, lval *a) {
+    linterp *in = linterp_of(e);
     for (int i = 0; i < a->count; i++) {
-        lval_print(a->cell[i]);
-        putchar(' ');
+        linterp_print(in, a->cell[i]);
+        linterp_write(in, " ");
     }
 
-    putchar('\n');
+    linterp_write(in, "\n");
     lval_del(1, a);
 
     return lval_sexpr();
@@ -318,27 +325,36 @@ lval *builtin_if(lenv *e, lval *a) {
     return x;
 }
 
-lval *builtin_load(lenv *e, lval *a, mpc_parser_t *lispy) {
-    CASSERT(a, 1, 0, NULL, "load");
+lval *builtin_load(lenv *e, lval *a) {
+    LASSERT(a, (a->count == 1 || a->count == 2), 0, NULL, "load", "takes a file name and an optional mode");
     TASSERT(a, 0, LVAL_STR, 0, NULL, "load");
 
+    linterp *in = linterp_of(e);
+    LASSERT(a, !in->parallel, 0, NULL, "load", "is not allowed inside pmap, pfilter or preduce");
+
+    /* (load "file" "split") parses one big file on all cores, "recover" skips forms that do not parse */
+    if (a->count == 2) {
+        TASSERT(a, 1, LVAL_STR, 0, NULL, "load");
+
+        lval *x;
+        if (strcmp(a->cell[1]->str, "split") == 0) {
+            x = lmodule_load_split(in, e, a->cell[0]->str);
+        } else if (strcmp(a->cell[1]->str, "recover") == 0) {
+            x = lmodule_load_recover(in, e, a->cell[0]->str);
+        } else {
+            x = lval_err("load: unknown mode %s", a->cell[1]->str);
+        }
+        lval_del(1, a);
+        return x;
+    }
+
     /* Parser file given by string name */
     mpc_result_t r;
-    if (mpc_parse_contents(a->cell[0]->str, lispy, &r)) {
-        lval *expr = lval_read(r.output);
-        mpc_ast_delete(r.output);
-
-        /* Evaluate each epression */
-        while (expr->count) {
-            lval *v = lval_pop(expr, 0);
-            lval *x = lval_eval(e, v);
-            /* If it's an error print it */
-            if (x->type == LVAL_ERR) { lval_println(x); }
-            lval_del(1, x);
-        }
+    if (mpc_parse_contents(a->cell[0]->str, in->lispy, &r)) {
+        lval *expr = r.output;
+        lval_del(1, a);
 
-        lval_del(2, expr, a);
-        return lval_sexpr();
+        return lval_eval_forms(e, expr);
     } else {
         char *err_msg = mpc_err_string(r.error);
         mpc_err_delete(r.error);
@@ -351,3 +367,220 @@ lval *builtin_load(lenv *e, lval *a, mpc_parser_t *lispy) {
     }
 }
 
+lval *builtin_require(lenv *e, lval *a) {
+    CASSERT(a, 1, 0, NULL, "require");
+    TASSERT(a, 0, LVAL_STR, 0, NULL, "require");
+    LASSERT(a, !linterp_of(e)->parallel, 0, NULL, "require", "is not allowed inside pmap, pfilter or preduce");
+
+    lval *x = lmodule_require(linterp_of(e), e, a->cell[0]->str);
+    lval_del(1, a);
+    return x;
+}
+
+lval *builtin_reload(lenv *e, lval *a) {
+    CASSERT(a, 1, 0, NULL, "reload");
+    TASSERT(a, 0, LVAL_STR, 0, NULL, "reload");
+    LASSERT(a, !linterp_of(e)->parallel, 0, NULL, "reload", "is not allowed inside pmap, pfilter or preduce");
+
+    lval *x = lmodule_reload(linterp_of(e), e, a->cell[0]->str);
+    lval_del(1, a);
+    return x;
+}
+
+lval *builtin_module_stats(lenv *e, lval *a) {
+    lmodule_print_stats(linterp_of(e));
+    lval_del(1, a);
+    return lval_sexpr();
+}
+
+/* One pmap, pfilter or preduce call, shared by the tasks running it */
+typedef struct {
+    lenv *env;
+    lval *f;
+    lval *items;
+    /* a result per item, or per chunk for preduce */
+    lval **results;
+    int chunk;
+} lparallel;
+
+/* Call f with args in a scope of the task's own, so no task writes to an environment another reads */
+static lval *lparallel_call(lparallel *par, lval *args) {
+    lenv *local = lenv_new();
+    local->parent = par->env;
+    lval *x = lval_call(local, lval_prepend(args, lval_copy(par->f)));
+    lenv_del(local);
+    return x;
+}
+
+static lval *lparallel_call2(lparallel *par, lval *x, lval *y) {
+    return lparallel_call(par, lval_add(lval_add(lval_sexpr(), x), y));
+}
+
+/* Run n tasks on the interpreter's pool. Tasks may start more, the outermost call marks the section */
+static void lparallel_run(lenv *e, int n, lpool_task task, lparallel *par) {
+    linterp *in = linterp_of(e);
+    if (in->pool == NULL) { in->pool = lpool_new(0); }
+
+    int outer = !in->parallel;
+    in->parallel = 1;
+    lpool_for(in->pool, n, task, par);
+    if (outer) { in->parallel = 0; }
+}
+
+/* The first error among the results, in list order, or NULL. Every other result is deleted if there is one */
+static lval *lparallel_error(lval **results, int n) {
+    lval *err = NULL;
+    for (int i = 0; i < n; i++) {
+        if (err == NULL && results[i]->type == LVAL_ERR) { err = results[i]; }
+    }
+    if (err) {
+        for (int i = 0; i < n; i++) {
+            if (results[i] != err) { lval_del(1, results[i]); }
+        }
+    }
+    return err;
+}
+
+#define PASSERT(args, name)                                                                                 \
+    CASSERT(args, 2, 0, NULL, name);                                                                        \
+    LASSERT(args, (args->cell[0]->type == LVAL_LAMBDA || args->cell[0]->type == LVAL_BUILTIN), 0, NULL,     \
+            name, "takes a function");                                                                      \
+    TASSERT(args, 1, LVAL_QEXPR, 0, NULL, name);
+
+static void builtin_pmap_task(void *ctx, int i) {
+    lparallel *par = ctx;
+    par->results[i] = lparallel_call(par, lval_add(lval_sexpr(), par->items->cell[i]));
+}
+
+/* (pmap f {xs}) is {(f x0) (f x1) ...}, the calls running on all cores */
+lval *builtin_pmap(lenv *e, lval *a) {
+    PASSERT(a, "pmap");
+
+    lparallel par = {e, a->cell[0], a->cell[1], NULL, 0};
+    int n = par.items->count;
+    par.results = malloc(sizeof(lval *) * n);
+    lparallel_run(e, n, builtin_pmap_task, &par);
+
+    /* The items were handed to the calls */
+    par.items->count = 0;
+    lval_del(1, a);
+
+    lval *err = lparallel_error(par.results, n);
+    if (err) {
+        free(par.results);
+        return err;
+    }
+
+    lval *x = lval_qexpr();
+    x->cell = par.results;
+    x->count = n;
+    return x;
+}
+
+static void builtin_pfilter_task(void *ctx, int i) {
+    lparallel *par = ctx;
+    par->results[i] = lparallel_call(par, lval_add(lval_sexpr(), lval_copy(par->items->cell[i])));
+}
+
+/* (pfilter f {xs}) keeps the xs for which f is not 0, in order */
+lval *builtin_pfilter(lenv *e, lval *a) {
+    PASSERT(a, "pfilter");
+
+    lparallel par = {e, a->cell[0], a->cell[1], NULL, 0};
+    int n = par.items->count;
+    par.results = malloc(sizeof(lval *) * n);
+    lparallel_run(e, n, builtin_pfilter_task, &par);
+
+    /* The results are deleted here unless one of them failed */
+    lval *err = lparallel_error(par.results, n);
+    int failed = err != NULL;
+
+    lval *x = lval_qexpr();
+    for (int i = 0; i < n && err == NULL; i++) {
+        if (par.results[i]->type != LVAL_NUM) {
+            err = lval_err("pfilter: function returned %s, expected %s", ltype_name(par.results[i]->type),
+                           ltype_name(LVAL_NUM));
+        } else if (par.results[i]->num) {
+            lval_add(x, par.items->cell[i]);
+            par.items->cell[i] = NULL;
+        }
+    }
+    for (int i = 0; i < n && !failed; i++) {
+        lval_del(1, par.results[i]);
+    }
+    free(par.results);
+
+    /* Drop the items that were moved into the result */
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < par.items->count; i++) {
+        if (par.items->cell[i]) { par.items->cell[kept++] = par.items->cell[i]; }
+    }
+    par.items->count = kept;
+    lval_del(1, a);
+
+    if (err) {
+        lval_del(1, x);
+        return err;
+    }
+    return x;
+}
+
+static void builtin_preduce_task(void *ctx, int c) {
+    lparallel *par = ctx;
+    unsigned int lo = c * par->chunk;
+    unsigned int hi = lo + par->chunk < par->items->count ? lo + par->chunk : par->items->count;
+
+    lval *acc = par->items->cell[lo];
+    for (unsigned int i = lo + 1; i < hi; i++) {
+        if (acc->type == LVAL_ERR) {
+            lval_del(1, par->items->cell[i]);
+        } else {
+            acc = lparallel_call2(par, acc, par->items->cell[i]);
+        }
+    }
+    par->results[c] = acc;
+}
+
+/*
+ * (preduce f init {xs}) is (f (f (f init x0) x1) ...) for an associative f.
+ * Chunks of the xs are folded in parallel, then the init and the chunks.
+ */
+lval *builtin_preduce(lenv *e, lval *a) {
+    CASSERT(a, 3, 0, NULL, "preduce");
+    LASSERT(a, (a->cell[0]->type == LVAL_LAMBDA || a->cell[0]->type == LVAL_BUILTIN), 0, NULL,
+            "preduce", "takes a function");
+    TASSERT(a, 2, LVAL_QEXPR, 0, NULL, "preduce");
+
+    lparallel par = {e, a->cell[0], a->cell[2], NULL, 0};
+    int n = par.items->count;
+
+    /* A few chunks per thread, so that a slow one can be stolen around */
+    int chunks = 0;
+    if (n > 0) {
+        linterp *in = linterp_of(e);
+        int threads = (in->pool ? in->pool->workers : lpool_cores()) + 1;
+        par.chunk = (n + threads * 4 - 1) / (threads * 4);
+        chunks = (n + par.chunk - 1) / par.chunk;
+        par.results = malloc(sizeof(lval *) * chunks);
+        lparallel_run(e, chunks, builtin_preduce_task, &par);
+    }
+
+    /* Fold the chunks into the init in order, stopping at the first error */
+    lval *x = lval_pop(a, 1);
+    for (int c = 0; c < chunks; c++) {
+        if (x->type == LVAL_ERR) {
+            lval_del(1, par.results[c]);
+        } else if (par.results[c]->type == LVAL_ERR) {
+            lval_del(1, x);
+            x = par.results[c];
+        } else {
+            x = lparallel_call2(&par, x, par.results[c]);
+        }
+    }
+    free(par.results);
+
+    /* Every item went into a chunk */
+    par.items->count = 0;
+    lval_del(1, a);
+    return x;
+}
@@ -54,7 +54,19 @@ lval *builtin_neq(lenv *e, lval *a);
 
 lval *builtin_if(lenv *e, lval *a);
 
-lval *builtin_load(lenv *e, lval *a, mpc_parser_t *lispy);
+lval *builtin_load(lenv *e, lval *a);
+
+lval *builtin_require(lenv *e, lval *a);
+
+lval *builtin_reload(lenv *e, lval *a);
+
+lval *builtin_module_stats(lenv *e, lval *a);
+
+lval *builtin_pmap(lenv *e, lval *a);
+
+lval *builtin_pfilter(lenv *e, lval *a);
+
+lval *builtin_preduce(lenv *e, lval *a);
 
 
 #endif //CH12_BUILTINS_H
@@ -0,0 +1,156 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "byol.h"
+#include "interp.h"
+#include "parser.h"
+
+/* Both enums are anonymous, so compare their values as ints */
+_Static_assert((int)BYOL_NUMBER == (int)LVAL_NUM && (int)BYOL_ERROR == (int)LVAL_ERR
+               && (int)BYOL_SYMBOL == (int)LVAL_SYM && (int)BYOL_SEXPR == (int)LVAL_SEXPR
+               && (int)BYOL_QEXPR == (int)LVAL_QEXPR && (int)BYOL_LAMBDA == (int)LVAL_LAMBDA
+               && (int)BYOL_BUILTIN == (int)LVAL_BUILTIN && (int)BYOL_STRING == (int)LVAL_STR,
+               "byol types follow lval types");
+
+/* Every interpreter reads with the one grammar, built by the first and kept for the process */
+static pthread_once_t byol_grammar_once = PTHREAD_ONCE_INIT;
+
+byol *byol_new(void) {
+    pthread_once(&byol_grammar_once, lgrammar_new);
+    return linterp_new(Lispy);
+}
+
+void byol_del(byol *b) {
+    linterp_del(b);
+}
+
+byol *byol_of(byol_env *e) {
+    return linterp_of(e);
+}
+
+void byol_set_user(byol *b, void *user) {
+    b->user = user;
+}
+
+void *byol_user(byol *b) {
+    return b->user;
+}
+
+void byol_set_output(byol *b, byol_writer w, void *ctx) {
+    linterp_set_output(b, w, ctx);
+}
+
+void byol_register_builtin(byol *b, const char *name, byol_builtin f) {
+    lenv_add_builtin(b->env, (char *) name, f);
+}
+
+/* Evaluate until a form fails or exits, keeping only the last value */
+static lval *byol_eval_forms(byol *b, lval *forms) {
+    lval *x = lval_sexpr();
+    while (forms->count && x->type != LVAL_ERR && !b->exited) {
+        lval_del(1, x);
+        x = lval_eval(b->env, lval_pop(forms, 0));
+    }
+    lval_del(1, forms);
+    return x;
+}
+
+static lval *byol_parsed(byol *b, int ok, mpc_result_t *r) {
+    if (ok) { return byol_eval_forms(b, r->output); }
+
+    char *err_msg = mpc_err_string(r->error);
+    mpc_err_delete(r->error);
+    err_msg[strcspn(err_msg, "\n")] = '\0';
+    lval *x = lval_err("%s", err_msg);
+    free(err_msg);
+    return x;
+}
+
+byol_value *byol_eval_string(byol *b, const char *src) {
+    mpc_result_t r;
+    int ok = mpc_nparse("<string>", src, strlen(src), b->lispy, &r);
+    return byol_parsed(b, ok, &r);
+}
+
+byol_value *byol_eval_file(byol *b, const char *path) {
+    mpc_result_t r;
+    int ok = mpc_parse_contents(path, b->lispy, &r);
+    return byol_parsed(b, ok, &r);
+}
+
+byol_value *byol_require(byol *b, const char *path) {
+    return lmodule_require(b, b->env, (char *) path);
+}
+
+int byol_require_all(byol *b, int n, char **paths) {
+    return lmodule_require_all(b, n, paths);
+}
+
+int byol_feed_line(byol *b, const char *line) {
+    if (!lreader_feed(&b->reader, line)) { return 1; }
+
+    linterp_eval(b, "<stdin>", b->reader.buf, b->reader.len, 1);
+    lreader_reset(&b->reader);
+    return 0;
+}
+
+int byol_exited(byol *b) {
+    return b->exited;
+}
+
+int byol_value_type(const byol_value *v) {
+    return v->type;
+}
+
+long byol_value_number(const byol_value *v) {
+    return v->num;
+}
+
+const char *byol_value_text(const byol_value *v) {
+    switch (v->type) {
+        case LVAL_STR:
+            return v->str;
+        case LVAL_SYM:
+            return v->sym;
+        case LVAL_ERR:
+            return v->err;
+        default:
+            return NULL;
+    }
+}
+
+int byol_value_count(const byol_value *v) {
+    return v->count;
+}
+
+byol_value *byol_value_child(const byol_value *v, int i) {
+    return v->cell[i];
+}
+
+char *byol_value_repr(const byol_value *v) {
+    return lval_repr((lval *) v);
+}
+
+byol_value *byol_value_num(long x) {
+    return lval_num(x);
+}
+
+byol_value *byol_value_str(const char *s) {
+    return lval_str((char *) s);
+}
+
+byol_value *byol_value_err(const char *msg) {
+    return lval_err("%s", msg);
+}
+
+byol_value *byol_value_list(void) {
+    return lval_qexpr();
+}
+
+byol_value *byol_value_add(byol_value *v, byol_value *x) {
+    return lval_add(v, x);
+}
+
+void byol_value_del(byol_value *v) {
+    lval_del(1, v);
+}
@@ -0,0 +1,106 @@
+#ifndef BYOL_BYOL_H
+#define BYOL_BYOL_H
+
+#include <stddef.h>
+
+/*
+ * The interpreter as a library. A byol is one interpreter with its own
+ * environment and loaded libraries, several can run at once on different
+ * threads. Nothing is written anywhere until an output is set.
+ *
+ * Values returned by the eval functions and the value constructors belong
+ * to the caller, who frees them with byol_value_del. A child value is
+ * borrowed from its parent.
+ */
+
+typedef struct linterp byol;
+typedef struct lenv byol_env;
+typedef struct lval byol_value;
+
+/* Value types, as byol_value_type returns them */
+enum {
+    BYOL_NUMBER, BYOL_ERROR, BYOL_SYMBOL, BYOL_SEXPR, BYOL_QEXPR, BYOL_LAMBDA, BYOL_BUILTIN, BYOL_STRING
+};
+
+/*
+ * A builtin function. args is an S-expression of the evaluated arguments,
+ * which the builtin frees. It returns a new value, or an error value to fail.
+ */
+typedef byol_value *(*byol_builtin)(byol_env *e, byol_value *args);
+
+/* Takes output a piece at a time, s holds n bytes and is not null terminated */
+typedef void (*byol_writer)(void *ctx, const char *s, size_t n);
+
+byol *byol_new(void);
+
+void byol_del(byol *b);
+
+/* The interpreter a builtin runs in */
+byol *byol_of(byol_env *e);
+
+/* A pointer kept for the embedder, for builtins to find through byol_of */
+void byol_set_user(byol *b, void *user);
+
+void *byol_user(byol *b);
+
+/* Where print, print-env and the REPL write */
+void byol_set_output(byol *b, byol_writer w, void *ctx);
+
+/* Define name as a builtin in the global environment */
+void byol_register_builtin(byol *b, const char *name, byol_builtin f);
+
+/*
+ * Parse src and evaluate its forms in order. Returns the value of the last
+ * form, or the first error, which stops the evaluation. If src does not
+ * parse nothing is evaluated and the parse error is returned.
+ */
+byol_value *byol_eval_string(byol *b, const char *src);
+
+/* As byol_eval_string, for the contents of the file at path */
+byol_value *byol_eval_file(byol *b, const char *path);
+
+/* Load a library unless the same file was already loaded, as require does */
+byol_value *byol_require(byol *b, const char *path);
+
+/* Require several libraries, parsed in parallel. Errors are written, returns how many failed */
+int byol_require_all(byol *b, int n, char **paths);
+
+/*
+ * Feed a line of REPL input. Once every form is closed the input is
+ * evaluated and each result written. Returns 1 while a form is still open.
+ */
+int byol_feed_line(byol *b, const char *line);
+
+/* True once exit has been evaluated */
+int byol_exited(byol *b);
+
+int byol_value_type(const byol_value *v);
+
+long byol_value_number(const byol_value *v);
+
+/* Text of a string, symbol or error, NULL for other types */
+const char *byol_value_text(const byol_value *v);
+
+/* Number of children of an S-expression or Q-expression */
+int byol_value_count(const byol_value *v);
+
+byol_value *byol_value_child(const byol_value *v, int i);
+
+/* The value as the REPL prints it, in a new string to free */
+char *byol_value_repr(const byol_value *v);
+
+byol_value *byol_value_num(long x);
+
+byol_value *byol_value_str(const char *s);
+
+byol_value *byol_value_err(const char *msg);
+
+/* An empty Q-expression, to fill with byol_value_add */
+byol_value *byol_value_list(void);
+
+/* Append x to the list v, which takes it over. Returns v */
+byol_value *byol_value_add(byol_value *v, byol_value *x);
+
+void byol_value_del(byol_value *v);
+
+#endif //BYOL_BYOL_H
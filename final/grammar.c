@@ -0,0 +1,102 @@
+#include "parser.h"
+#include "lval.h"
+
+#ifdef BYOL_GENERATED_PARSER
+#include "lispy_gen.h"
+#endif
+
+mpc_parser_t* Number;
+mpc_parser_t* Symbol;
+mpc_parser_t* String;
+mpc_parser_t* Comment;
+mpc_parser_t* Sexpr;
+mpc_parser_t* Qexpr;
+mpc_parser_t* Expr;
+mpc_parser_t* Lispy;
+
+#ifdef BYOL_GENERATED_PARSER
+/* Read the AST of a rule into lvals, tagged as a reference to the rule would tag it */
+static mpc_val_t *lgrammar_read(mpc_val_t *x, void *rule) {
+    if (rule) { x = mpc_ast_add_tag(x, rule); }
+    lval *v = lval_read(x);
+    mpc_ast_delete(x);
+    return v;
+}
+#else
+/* Every token eats the whitespace behind it, as mpca_lang would do */
+static mpc_parser_t *lgrammar_list(char open, char close, mpc_fold_t f) {
+    return mpc_and(3, f,
+                   mpc_tok(mpc_char(open)),
+                   mpc_many(lval_fold_exprs, Expr),
+                   mpc_tok(mpc_char(close)),
+                   free, lval_fold_del);
+}
+#endif
+
+/*
+ * Same language as
+ *
+ *   number: /-?[0-9]+/ ;
+ *   symbol: /[a-zA-Z0-9_+\-*\/\\=<>!&]+/ ;
+ *   string: /"(\\.|[^"])*"/ ;
+ *   comment: /;[^\r\n]*\/ ;
+ *   sexpr: '(' <expr>* ')' ;
+ *   qexpr: '{' <expr>* '}' ;
+ *   expr: <number> | <symbol> | <sexpr> | <qexpr> | <string> | <comment> ;
+ *   lispy: /^/ <expr>* /$/ ;
+ *
+ * but the parsers fold straight into lvals, so no AST is built and walked.
+ * Tokens are sliced, so their lvals are made from the source text in place.
+ * Parsing with Lispy yields an sexpr holding every top level form.
+ *
+ * Built with BYOL_GENERATED_PARSER the rules are instead the C parsers
+ * mpcgen generates from lispy.mpc, whose AST is then read into lvals.
+ */
+void lgrammar_new(void) {
+    Number = mpc_new("number");
+    Symbol = mpc_new("symbol");
+    String = mpc_new("string");
+    Comment = mpc_new("comment");
+    Sexpr = mpc_new("sexpr");
+    Qexpr = mpc_new("qexpr");
+    Expr = mpc_new("expr");
+    Lispy = mpc_new("lispy");
+
+#ifdef BYOL_GENERATED_PARSER
+    mpc_define(Number, mpc_apply_to(mpc_native(lgen_number), lgrammar_read, "number"));
+    mpc_define(Symbol, mpc_apply_to(mpc_native(lgen_symbol), lgrammar_read, "symbol"));
+    mpc_define(String, mpc_apply_to(mpc_native(lgen_string), lgrammar_read, "string"));
+    mpc_define(Comment, mpc_apply_to(mpc_native(lgen_comment), lgrammar_read, "comment"));
+    mpc_define(Sexpr, mpc_apply_to(mpc_native(lgen_sexpr), lgrammar_read, "sexpr"));
+    mpc_define(Qexpr, mpc_apply_to(mpc_native(lgen_qexpr), lgrammar_read, "qexpr"));
+    mpc_define(Expr, mpc_apply_to(mpc_native(lgen_expr), lgrammar_read, "expr"));
+    mpc_define(Lispy, mpc_apply_to(mpc_native(lgen_lispy), lgrammar_read, NULL));
+#else
+    mpc_define(Number, mpc_tok(mpc_slice(mpc_re("-?[0-9]+"), lval_slice_num)));
+    mpc_define(Symbol, mpc_tok(mpc_slice(mpc_re("[a-zA-Z0-9_+\\-*/\\\\=<>!&]+"), lval_slice_sym)));
+    /* [^"\\] instead of [^"] keeps the choice LL(1), so the regex compiles to a DFA */
+    mpc_define(String, mpc_tok(mpc_slice(mpc_re("\"(\\\\.|[^\"\\\\])*\""), lval_slice_str)));
+    mpc_define(Comment, mpc_tok(mpc_slice(mpc_re(";[^\\r\\n]*"), lval_slice_comment)));
+    mpc_define(Sexpr, lgrammar_list('(', ')', lval_fold_sexpr));
+    mpc_define(Qexpr, lgrammar_list('{', '}', lval_fold_qexpr));
+    mpc_define(Expr, mpc_or(6, Number, Symbol, Sexpr, Qexpr, String, Comment));
+    mpc_define(Lispy, mpc_and(3, lval_fold_sexpr,
+                              mpc_tok(mpc_re("^")),
+                              mpc_many(lval_fold_exprs, Expr),
+                              mpc_tok(mpc_re("$")),
+                              free, lval_fold_del));
+#endif
+
+    mpc_optimise(Number);
+    mpc_optimise(Symbol);
+    mpc_optimise(String);
+    mpc_optimise(Comment);
+    mpc_optimise(Sexpr);
+    mpc_optimise(Qexpr);
+    mpc_optimise(Expr);
+    mpc_optimise(Lispy);
+}
+
+void lgrammar_del(void) {
+    mpc_cleanup(8, Number, Symbol, String, Comment, Sexpr, Qexpr, Expr, Lispy);
+}
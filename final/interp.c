@@ -0,0 +1,78 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "interp.h"
+
+linterp *linterp_new(mpc_parser_t *lispy) {
+    linterp *in = calloc(1, sizeof(linterp));
+    in->lispy = lispy;
+    in->env = lenv_new();
+    in->env->interp = in;
+    lenv_add_builtins(in->env);
+    lreader_init(&in->reader);
+    return in;
+}
+
+void linterp_del(linterp *in) {
+    lenv_del(in->env);
+    lreader_free(&in->reader);
+    lmodule_registry_free(&in->modules);
+    if (in->pool) { lpool_del(in->pool); }
+    free(in);
+}
+
+linterp *linterp_of(lenv *e) {
+    while (e->parent) { e = e->parent; }
+    return e->interp;
+}
+
+void linterp_set_output(linterp *in, lwriter w, void *ctx) {
+    in->write = w;
+    in->write_ctx = ctx;
+}
+
+void linterp_write(linterp *in, const char *s) {
+    if (in->write) { in->write(in->write_ctx, s, strlen(s)); }
+}
+
+void linterp_printf(linterp *in, const char *fmt, ...) {
+    char buf[512];
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, va);
+    va_end(va);
+    linterp_write(in, buf);
+}
+
+void linterp_print(linterp *in, lval *v) {
+    if (in->write) { lval_write(v, in->write, in->write_ctx); }
+}
+
+void linterp_println(linterp *in, lval *v) {
+    linterp_print(in, v);
+    linterp_write(in, "\n");
+}
+
+int linterp_eval(linterp *in, const char *name, const char *src, size_t len, int print) {
+    mpc_result_t r;
+    if (!mpc_nparse(name, src, len, in->lispy, &r)) {
+        char *err_msg = mpc_err_string(r.error);
+        mpc_err_delete(r.error);
+        linterp_write(in, err_msg);
+        free(err_msg);
+        return 1;
+    }
+
+    int errors = 0;
+    lval *forms = r.output;
+    while (forms->count && !in->exited) {
+        lval *x = lval_eval(in->env, lval_pop(forms, 0));
+        if (x->type == LVAL_ERR) { errors++; }
+        if (print || x->type == LVAL_ERR) { linterp_println(in, x); }
+        lval_del(1, x);
+    }
+
+    lval_del(1, forms);
+    return errors;
+}
@@ -0,0 +1,64 @@
+#ifndef BYOL_INTERP_H
+#define BYOL_INTERP_H
+
+#include "lval.h"
+#include "module.h"
+#include "pool.h"
+#include "reader.h"
+
+/*
+ * An interpreter and all the state evaluating in it touches. Interpreters
+ * share only the grammar, which is read only once built, so several can
+ * run at once, each on its own thread.
+ */
+struct linterp {
+    /* global environment, its interp points back here */
+    lenv *env;
+    /* parses a whole input into an sexpr of the top-level forms */
+    mpc_parser_t *lispy;
+    /* REPL lines of a form that is not closed yet */
+    lreader reader;
+    /* libraries loaded into env */
+    lmodule_registry modules;
+
+    /* where print and diagnostics go, nowhere while write is NULL */
+    lwriter write;
+    void *write_ctx;
+    /* set by exit, no further top-level forms are evaluated */
+    int exited;
+    /* for whoever embeds the interpreter */
+    void *user;
+
+    /* runs pmap, pfilter and preduce, made on first use with a worker per core */
+    lpool *pool;
+    /* set while their tasks run, the global environment must not change meanwhile */
+    int parallel;
+};
+
+/* Create an interpreter reading with lispy, with the builtins defined */
+linterp *linterp_new(mpc_parser_t *lispy);
+
+void linterp_del(linterp *in);
+
+/* The interpreter e belongs to, found through its global environment */
+linterp *linterp_of(lenv *e);
+
+/* Send output to w, a new interpreter has none and drops it */
+void linterp_set_output(linterp *in, lwriter w, void *ctx);
+
+void linterp_write(linterp *in, const char *s);
+
+void linterp_printf(linterp *in, const char *fmt, ...);
+
+void linterp_print(linterp *in, lval *v);
+
+void linterp_println(linterp *in, lval *v);
+
+/*
+ * Parse src and evaluate its forms in order, until one exits. Results are
+ * printed if print is set, errors always are. Returns how many forms gave
+ * an error, a source that does not parse counts as one.
+ */
+int linterp_eval(linterp *in, const char *name, const char *src, size_t len, int print);
+
+#endif //BYOL_INTERP_H
@@ -1,7 +1,10 @@
+#include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 
 #include "builtins.h"
+#include "interp.h"
 #include "lval.h"
 #include "macros.h"
 
@@ -106,38 +109,45 @@ void lval_del(int n, ...) {
     for (int i = 0; i < n; i++) {
         lval *v = va_arg(list, lval*);
 
-        switch (v->type) {
-            /* Do nothing special for number and lbuiltin type*/
-            case LVAL_NUM:
-                break;
-            case LVAL_BUILTIN:
-                break;
-            case LVAL_LAMBDA:
-                lenv_del(v->env);
-                lval_del(2, v->formals, v->body);
-                break;
-                /* For Err or Sym free the string data*/
-            case LVAL_STR:
-                free(v->str);
-                break;
-            case LVAL_ERR:
-                free(v->err);
-                break;
-            case LVAL_SYM:
-                free(v->sym);
-                break;
-                /* If Sexpr then delete all elements inside*/
-            case LVAL_SEXPR:
-            case LVAL_QEXPR:
-                for (int j = 0; j < v->count; j++) {
-                    lval_del(1, v->cell[j]);
-                }
-                /* Also free the memory allocated to contain the pointers*/
-                free(v->cell);
-                break;
+        /* The last child of a list is freed by looping, so deeply nested lists do not recurse */
+        while (v != NULL) {
+            lval *next = NULL;
+
+            switch (v->type) {
+                /* Do nothing special for number and lbuiltin type*/
+                case LVAL_NUM:
+                    break;
+                case LVAL_BUILTIN:
+                    break;
+                case LVAL_LAMBDA:
+                    lenv_del(v->env);
+                    lval_del(2, v->formals, v->body);
+                    break;
+                    /* For Err or Sym free the string data*/
+                case LVAL_STR:
+                    free(v->str);
+                    break;
+                case LVAL_ERR:
+                    free(v->err);
+                    break;
+                case LVAL_SYM:
+                    free(v->sym);
+                    break;
+                    /* If Sexpr then delete all elements inside*/
+                case LVAL_SEXPR:
+                case LVAL_QEXPR:
+                    for (unsigned int j = 0; j + 1 < v->count; j++) {
+                        lval_del(1, v->cell[j]);
+                    }
+                    if (v->count > 0) { next = v->cell[v->count - 1]; }
+                    /* Also free the memory allocated to contain the pointers*/
+                    free(v->cell);
+                    break;
+            }
+            /* Free the memory allocated for the "lval" struct itself*/
+            free(v);
+            v = next;
         }
-        /* Free the memory allocated for the "lval" struct itself*/
-        free(v);
     }
 
     va_end(list);
@@ -149,6 +159,7 @@ lenv *lenv_new(void) {
     e->symbols = NULL;
     e->lvals = NULL;
     e->parent = NULL;
+    e->interp = NULL;
     return e;
 }
 
@@ -177,65 +188,91 @@ lenv *lenv_copy(lenv *e) {
     return env;
 }
 
-void lval_print_expr(lval *v, char open, char close) {
-    putchar(open);
+static void lval_write_cstr(const char *s, lwriter w, void *ctx) {
+    w(ctx, s, strlen(s));
+}
+
+static void lval_write_expr(lval *v, char open, char close, lwriter w, void *ctx) {
+    w(ctx, &open, 1);
     for (int i = 0; i < v->count; i++) {
-        lval_print(v->cell[i]);
+        lval_write(v->cell[i], w, ctx);
 
         if (i != v->count - 1) {
-            putchar(' ');
+            w(ctx, " ", 1);
         }
     }
-    putchar(close);
+    w(ctx, &close, 1);
 }
 
-void lval_print_str(lval *v) {
+static void lval_write_str(lval *v, lwriter w, void *ctx) {
     char *escaped = malloc(strlen(v->str) + 1);
     strcpy(escaped, v->str);
     escaped = mpcf_escape(escaped);
-    printf("\"%s\"", escaped);
+    w(ctx, "\"", 1);
+    lval_write_cstr(escaped, w, ctx);
+    w(ctx, "\"", 1);
     free(escaped);
 }
 
-/* Print an "lval"*/
-void lval_print(lval *v) {
+/* Write an "lval" as the REPL prints it*/
+void lval_write(lval *v, lwriter w, void *ctx) {
+    char num[32];
     switch (v->type) {
         /* In the case the type is a number print it*/
         case LVAL_NUM:
-            printf("%li", v->num);
+            snprintf(num, sizeof(num), "%li", v->num);
+            lval_write_cstr(num, w, ctx);
             break;
         case LVAL_SYM:
-            printf("%s", v->sym);
+            lval_write_cstr(v->sym, w, ctx);
             break;
         case LVAL_STR:
-            lval_print_str(v);
+            lval_write_str(v, w, ctx);
             break;
         case LVAL_ERR:
-            printf("Error: %s", v->err);
+            lval_write_cstr("Error: ", w, ctx);
+            lval_write_cstr(v->err, w, ctx);
             break;
         case LVAL_SEXPR:
-            lval_print_expr(v, '(', ')');
+            lval_write_expr(v, '(', ')', w, ctx);
             break;
         case LVAL_QEXPR:
-            lval_print_expr(v, '{', '}');
+            lval_write_expr(v, '{', '}', w, ctx);
             break;
         case LVAL_BUILTIN:
-            printf("<builtin function>");
+            lval_write_cstr("<builtin function>", w, ctx);
             break;
         case LVAL_LAMBDA:
-            printf("(\\ ");
-            lval_print(v->formals);
-            putchar(' ');
-            lval_print(v->body);
-            putchar(')');
+            lval_write_cstr("(\\ ", w, ctx);
+            lval_write(v->formals, w, ctx);
+            w(ctx, " ", 1);
+            lval_write(v->body, w, ctx);
+            w(ctx, ")", 1);
             break;
     }
 }
 
-/* Print an "lval" followed by a newline*/
-void lval_println(lval *v) {
-    lval_print(v);
-    putchar('\n');
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t slots;
+} lval_repr_buf;
+
+static void lval_repr_append(void *ctx, const char *s, size_t n) {
+    lval_repr_buf *b = ctx;
+    if (b->len + n + 1 > b->slots) {
+        while (b->len + n + 1 > b->slots) { b->slots *= 2; }
+        b->buf = realloc(b->buf, b->slots);
+    }
+    memcpy(b->buf + b->len, s, n);
+    b->len += n;
+}
+
+char *lval_repr(lval *v) {
+    lval_repr_buf b = {malloc(64), 0, 64};
+    lval_write(v, lval_repr_append, &b);
+    b.buf[b.len] = '\0';
+    return b.buf;
 }
 
 /* Change to return null and set errno on error */
@@ -334,10 +371,13 @@ void lenv_def(lenv *e, lval *k, lval *v) {
     lenv_put(e, k, v);
 }
 
-void lenv_print(lenv *e) {
+void lenv_write(lenv *e, lwriter w, void *ctx) {
     for (int i = 0; i < e->count; i++) {
-        printf("Name: %s, Value: ", e->symbols[i]);
-        lval_println(e->lvals[i]);
+        lval_write_cstr("Name: ", w, ctx);
+        lval_write_cstr(e->symbols[i], w, ctx);
+        lval_write_cstr(", Value: ", w, ctx);
+        lval_write(e->lvals[i], w, ctx);
+        w(ctx, "\n", 1);
     }
 }
 
@@ -466,6 +506,19 @@ lval *lval_eval_sexpr(lenv *e, lval *v) {
     return lval_call(e, v);
 }
 
+/* Evaluate each expression of a loaded file, printing errors as we go */
+lval *lval_eval_forms(lenv *e, lval *forms) {
+    linterp *in = linterp_of(e);
+    while (forms->count && !in->exited) {
+        lval *x = lval_eval(e, lval_pop(forms, 0));
+        if (x->type == LVAL_ERR) { linterp_println(in, x); }
+        lval_del(1, x);
+    }
+
+    lval_del(1, forms);
+    return lval_sexpr();
+}
+
 /* Eval lval */
 lval *lval_eval(lenv *e, lval *v) {
     if (v->type == LVAL_SYM) {
@@ -496,28 +549,48 @@ lval *lval_read_str(mpc_ast_t *t) {
     return str;
 }
 
+/* Tag ids lval_read tests nodes against, interned once by whichever thread reads first */
+static pthread_once_t lval_tags_once = PTHREAD_ONCE_INIT;
+
+static struct {
+    int number, symbol, string, comment, sexpr, qexpr, regex, root;
+} lval_tags;
+
+static void lval_tags_init(void) {
+    lval_tags.number = mpc_tag_intern("number");
+    lval_tags.symbol = mpc_tag_intern("symbol");
+    lval_tags.string = mpc_tag_intern("string");
+    lval_tags.comment = mpc_tag_intern("comment");
+    lval_tags.sexpr = mpc_tag_intern("sexpr");
+    lval_tags.qexpr = mpc_tag_intern("qexpr");
+    lval_tags.regex = mpc_tag_intern("regex");
+    lval_tags.root = mpc_tag_intern(">");
+}
+
 /* todo: merge numbers and symbols, so that each symbol can have a value and function slot */
 lval *lval_read(mpc_ast_t *t) {
 
+    pthread_once(&lval_tags_once, lval_tags_init);
+
     /* If number or symbol convert node to that type*/
-    if (strstr(t->tag, "number")) { return lval_read_num(t); }
-    if (strstr(t->tag, "symbol")) { return lval_sym(t->contents); }
-    if (strstr(t->tag, "string")) { return lval_read_str(t); }
+    if (mpc_ast_is(t, lval_tags.number)) { return lval_read_num(t); }
+    if (mpc_ast_is(t, lval_tags.symbol)) { return lval_sym(t->contents); }
+    if (mpc_ast_is(t, lval_tags.string)) { return lval_read_str(t); }
 
     lval *x = NULL;
 
     /* todo allow for several expressions at top level. We prob need a (begin ...) construct for that  */
-    if (strcmp(t->tag, ">") == 0) {
+    if (t->tag_id == lval_tags.root) {
         lval *sexpr = lval_sexpr();
         for (int i = 1; i < t->children_num - 1; i++) {
-            if (strstr(t->children[i]->tag, "comment")) { continue; }
+            if (mpc_ast_is(t->children[i], lval_tags.comment)) { continue; }
             lval_add(sexpr, lval_read(t->children[i]));
         }
         return sexpr;
     }
     /* if it's a sexpr create an empty list of sub lvals*/
-    if (strstr(t->tag, "sexpr")) { x = lval_sexpr(); }
-    else if (strstr(t->tag, "qexpr")) { x = lval_qexpr(); }
+    if (mpc_ast_is(t, lval_tags.sexpr)) { x = lval_sexpr(); }
+    else if (mpc_ast_is(t, lval_tags.qexpr)) { x = lval_qexpr(); }
 
     /* Fill the list with any subexpression*/
     for (int i = 0; i < t->children_num; i++) {
@@ -525,8 +598,8 @@ lval *lval_read(mpc_ast_t *t) {
         else if (strcmp(t->children[i]->contents, ")") == 0) { continue; }
         else if (strcmp(t->children[i]->contents, "{") == 0) { continue; }
         else if (strcmp(t->children[i]->contents, "}") == 0) { continue; }
-        else if (strstr(t->children[i]->tag, "comment")) { continue; }
-        else if (strcmp(t->children[i]->tag, "regex") == 0) { continue; }
+        else if (mpc_ast_is(t->children[i], lval_tags.comment)) { continue; }
+        else if (t->children[i]->tag_id == lval_tags.regex) { continue; }
         x = lval_add(x, lval_read(t->children[i]));
     }
 
@@ -534,6 +607,75 @@ lval *lval_read(mpc_ast_t *t) {
 }
 
 
+/* Fold callbacks for the combinator grammar, they build lvals while parsing */
+static lval *lval_fold_list(int n, mpc_val_t **xs) {
+    (void) n;
+    lval *x = xs[1];
+    free(xs[0]);
+    free(xs[2]);
+    return x;
+}
+
+void lval_fold_del(mpc_val_t *x) {
+    if (x) { lval_del(1, x); }
+}
+
+/* Slice callbacks, reading tokens straight out of the source text, which is not null terminated */
+mpc_val_t *lval_slice_num(const char *s, long n) {
+    int neg = n > 0 && s[0] == '-';
+    unsigned long max = neg ? (unsigned long) LONG_MAX + 1 : LONG_MAX;
+    unsigned long x = 0;
+    for (long k = neg; k < n; k++) {
+        unsigned long d = (unsigned long) (s[k] - '0');
+        if (x > (max - d) / 10) { return lval_err("invalid number"); }
+        x = x * 10 + d;
+    }
+    return lval_num(neg && x ? -(long) (x - 1) - 1 : (long) x);
+}
+
+mpc_val_t *lval_slice_sym(const char *s, long n) {
+    lval *v = calloc(1, sizeof(lval));
+    v->type = LVAL_SYM;
+    v->sym = malloc(n + 1);
+    memcpy(v->sym, s, n);
+    v->sym[n] = '\0';
+    return v;
+}
+
+mpc_val_t *lval_slice_str(const char *s, long n) {
+    /* Drop the quotes, then unescape */
+    char *x = mpcf_unescape(mpcf_slice_str(s + 1, n - 2));
+    lval *str = lval_str(x);
+    free(x);
+    return str;
+}
+
+mpc_val_t *lval_slice_comment(const char *s, long n) {
+    (void) s;
+    (void) n;
+    return NULL;
+}
+
+/* Collect the expressions of a list, comments fold to NULL and are dropped */
+mpc_val_t *lval_fold_exprs(int n, mpc_val_t **xs) {
+    lval *x = lval_sexpr();
+    x->cell = n ? malloc(sizeof(lval *) * n) : NULL;
+    for (int i = 0; i < n; i++) {
+        if (xs[i]) { x->cell[x->count++] = xs[i]; }
+    }
+    return x;
+}
+
+mpc_val_t *lval_fold_sexpr(int n, mpc_val_t **xs) {
+    return lval_fold_list(n, xs);
+}
+
+mpc_val_t *lval_fold_qexpr(int n, mpc_val_t **xs) {
+    lval *x = lval_fold_list(n, xs);
+    x->type = LVAL_QEXPR;
+    return x;
+}
+
 void lenv_add_builtin(lenv *e, char *name, lbuiltin func) {
     lval *n = lval_sym(name);
     lval *f = lval_builtin(func);
@@ -563,6 +705,13 @@ void lenv_add_builtins(lenv *e) {
     lenv_add_builtin(e, "=", builtin_put);
     lenv_add_builtin(e, "if", builtin_if);
     lenv_add_builtin(e, "load", builtin_load);
+    lenv_add_builtin(e, "require", builtin_require);
+    lenv_add_builtin(e, "reload", builtin_reload);
+    lenv_add_builtin(e, "module-stats", builtin_module_stats);
+
+    lenv_add_builtin(e, "pmap", builtin_pmap);
+    lenv_add_builtin(e, "pfilter", builtin_pfilter);
+    lenv_add_builtin(e, "preduce", builtin_preduce);
 
     lenv_add_builtin(e, "<", builtin_lt);
     lenv_add_builtin(e, ">", builtin_gt);
@@ -571,18 +720,3 @@ void lenv_add_builtins(lenv *e) {
     lenv_add_builtin(e, "==", builtin_eq);
     lenv_add_builtin(e, "!=", builtin_neq);
 }
-
-void lenv_load_lib(lenv *e, char *lib, mpc_parser_t *lispy) {
-    lval *args = lval_add(lval_sexpr(), lval_str(lib));
-    lval *x = builtin_load(e, args, lispy);
-
-    if (x->type == LVAL_ERR) {
-        lval_print(x);
-    }
-
-    lval_del(1, x);
-}
-
-void lenv_load_stdlib(lenv *e, mpc_parser_t *lispy) {
-    lenv_load_lib(e, "../stdlib.txt", lispy);
-}
@@ -5,8 +5,10 @@
 
 struct lval;
 struct lenv;
+struct linterp;
 typedef struct lval lval;
 typedef struct lenv lenv;
+typedef struct linterp linterp;
 
 /* Declare enum for possible lval types*/
 enum {
@@ -17,6 +19,9 @@ char *ltype_name(int t);
 
 typedef lval *(*lbuiltin)(lenv *, lval *);
 
+/* Takes output a piece at a time, s holds n bytes and is not null terminated */
+typedef void (*lwriter)(void *ctx, const char *s, size_t n);
+
 /* Declare new Lisp Value struct*/
 struct lval {
     unsigned int type;
@@ -39,6 +44,8 @@ struct lval {
 struct lenv {
     int count;
     lenv *parent;
+    /* only set on the global environment of an interpreter */
+    linterp *interp;
     char **symbols;
     lval **lvals;
 };
@@ -70,12 +77,11 @@ lval *lval_copy(lval *);
 
 lenv *lenv_copy(lenv *e);
 
-void lval_print(lval *v);
-
-void lval_print_expr(lval *v, char open, char close);
+/* Write an "lval" as the REPL prints it */
+void lval_write(lval *v, lwriter w, void *ctx);
 
-/* Print an "lval" followed by a newline*/
-void lval_println(lval *v);
+/* The printed form of an "lval" in a new string */
+char *lval_repr(lval *v);
 
 lval *lval_read_num(mpc_ast_t *t);
 
@@ -90,7 +96,7 @@ void lenv_put(lenv *env, lval *s, lval *v);
 
 void lenv_def(lenv *e, lval *k, lval *v);
 
-void lenv_print(lenv *e);
+void lenv_write(lenv *e, lwriter w, void *ctx);
 
 /* Transform AST to lval   */
 lval *lval_add(lval *v, lval *w);
@@ -106,15 +112,31 @@ lval *lval_eval_sexpr(lenv *e, lval *v);
 /* Eval lval */
 lval *lval_eval(lenv *e, lval *v);
 
+/* Evaluate and delete every expression in forms */
+lval *lval_eval_forms(lenv *e, lval *forms);
+
 /* todo: merge numbers and symbols, so that each symbol can have a valu and function slot */
 lval *lval_read(mpc_ast_t *t);
 
-void lenv_add_builtin(lenv *e, char *name, lbuiltin func);
+/* Fold and slice callbacks that build lvals directly from the grammar in grammar.c */
+void lval_fold_del(mpc_val_t *x);
 
-void lenv_add_builtins(lenv *e);
+mpc_val_t *lval_slice_num(const char *s, long n);
+
+mpc_val_t *lval_slice_sym(const char *s, long n);
+
+mpc_val_t *lval_slice_str(const char *s, long n);
 
-void lenv_load_stdlib(lenv *e, mpc_parser_t *lispy);
+mpc_val_t *lval_slice_comment(const char *s, long n);
 
-void lenv_load_lib(lenv *e, char *lib, mpc_parser_t *lispy);
+mpc_val_t *lval_fold_exprs(int n, mpc_val_t **xs);
+
+mpc_val_t *lval_fold_sexpr(int n, mpc_val_t **xs);
+
+mpc_val_t *lval_fold_qexpr(int n, mpc_val_t **xs);
+
+void lenv_add_builtin(lenv *e, char *name, lbuiltin func);
+
+void lenv_add_builtins(lenv *e);
 
 #endif //CH12_LVAL_H
\ No newline at end of file
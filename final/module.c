@@ -0,0 +1,417 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "interp.h"
+#include "module.h"
+#include "pool.h"
+#include "reader.h"
+
+static uint64_t lmodule_hash(const char *buf, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) buf[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* Read the whole file into a NUL terminated buffer, NULL on failure */
+static char *lmodule_read(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) { return NULL; }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return NULL;
+    }
+
+    char *buf = malloc(size + 1);
+    *len = fread(buf, 1, size, f);
+    buf[*len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+static lmodule *lmodule_find(lmodule_registry *registry, char *path) {
+    for (int i = 0; i < registry->count; i++) {
+        if (strcmp(registry->modules[i].path, path) == 0) {
+            return &registry->modules[i];
+        }
+    }
+    return NULL;
+}
+
+static void lmodule_parsed(lmodule_job *job, int ok, mpc_result_t *r) {
+    if (ok) {
+        job->forms = r->output;
+    } else {
+        char *err_msg = mpc_err_string(r->error);
+        mpc_err_delete(r->error);
+        job->err = lval_err("Could not load library %s", err_msg);
+        free(err_msg);
+    }
+}
+
+/* Resolve, read and hash lib, leaving the contents in the job. Touches no interpreter state */
+static void lmodule_resolve(lmodule_job *job) {
+    job->buf = NULL;
+    job->forms = NULL;
+    job->err = NULL;
+
+    /* Standard input is streamed through the parser and has no path */
+    if (strcmp(job->lib, LMODULE_STDIN) == 0) {
+        job->path[0] = '\0';
+        job->hash = 0;
+        return;
+    }
+
+    if (realpath(job->lib, job->path) == NULL) {
+        job->err = lval_err("Could not load library %s: no such file", job->lib);
+        return;
+    }
+
+    job->buf = lmodule_read(job->path, &job->len);
+    if (job->buf == NULL) {
+        job->err = lval_err("Could not load library %s: unable to read file", job->lib);
+        return;
+    }
+
+    job->hash = lmodule_hash(job->buf, job->len);
+}
+
+/* Parse a resolved lib and release its contents. Touches no interpreter state */
+static void lmodule_parse(lmodule_job *job, mpc_parser_t *lispy) {
+    mpc_result_t r;
+
+    if (job->path[0] == '\0') {
+        lmodule_parsed(job, mpc_parse_pipe("<stdin>", stdin, lispy, &r), &r);
+        return;
+    }
+
+    lmodule_parsed(job, mpc_nparse(job->lib, job->buf, job->len, lispy, &r), &r);
+    free(job->buf);
+    job->buf = NULL;
+}
+
+/* Whether a resolved lib is already loaded with the same contents */
+static int lmodule_cached(lmodule_registry *registry, lmodule_job *job) {
+    lmodule *m = lmodule_find(registry, job->path);
+    return m && m->hash == job->hash;
+}
+
+/*
+ * Register and evaluate a resolved lib, consuming the job. A lib that is
+ * already loaded is answered from the registry without being parsed,
+ * anything else is parsed here unless the caller already did.
+ */
+static lval *lmodule_eval(linterp *in, lenv *e, lmodule_job *job, int force) {
+    lmodule_registry *registry = &in->modules;
+
+    if (job->err) { return job->err; }
+
+    /* Standard input can be read only once, so it is never registered */
+    if (job->path[0] == '\0') {
+        if (job->forms == NULL) { lmodule_parse(job, in->lispy); }
+        if (job->err) { return job->err; }
+        return lval_eval_forms(e, job->forms);
+    }
+
+    if (!force && lmodule_cached(registry, job)) {
+        registry->hits++;
+        free(job->buf);
+        if (job->forms) { lval_del(1, job->forms); }
+        return lval_sexpr();
+    }
+
+    if (job->forms == NULL) { lmodule_parse(job, in->lispy); }
+
+    /* A file that does not parse is not considered loaded */
+    if (job->err) { return job->err; }
+
+    if (force) { registry->reloads++; } else { registry->misses++; }
+
+    /* Register before evaluating so that cyclic requires terminate */
+    lmodule *m = lmodule_find(registry, job->path);
+    if (m == NULL) {
+        registry->count++;
+        registry->modules = realloc(registry->modules, sizeof(lmodule) * registry->count);
+        m = &registry->modules[registry->count - 1];
+        m->path = malloc(strlen(job->path) + 1);
+        strcpy(m->path, job->path);
+    }
+    m->hash = job->hash;
+
+    return lval_eval_forms(e, job->forms);
+}
+
+static lval *lmodule_load(linterp *in, lenv *e, char *lib, int force) {
+    lmodule_job job;
+    job.lib = lib;
+    lmodule_resolve(&job);
+    return lmodule_eval(in, e, &job, force);
+}
+
+typedef struct {
+    lmodule_job *jobs;
+    mpc_parser_t *lispy;
+    /* indices of the jobs that have to be parsed */
+    int *todo;
+} lmodule_batch;
+
+static void lmodule_resolve_task(void *ctx, int i) {
+    lmodule_batch *batch = ctx;
+    lmodule_resolve(&batch->jobs[i]);
+}
+
+static void lmodule_parse_task(void *ctx, int i) {
+    lmodule_batch *batch = ctx;
+    lmodule_parse(&batch->jobs[batch->todo[i]], batch->lispy);
+}
+
+lval *lmodule_require(linterp *in, lenv *e, char *lib) {
+    return lmodule_load(in, e, lib, 0);
+}
+
+lval *lmodule_reload(linterp *in, lenv *e, char *lib) {
+    return lmodule_load(in, e, lib, 1);
+}
+
+int lmodule_require_all(linterp *in, int n, char **libs) {
+    lmodule_batch batch;
+    batch.jobs = malloc(sizeof(lmodule_job) * n);
+    batch.lispy = in->lispy;
+    batch.todo = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) {
+        batch.jobs[i].lib = libs[i];
+    }
+
+    lpool *pool = n > 1 ? lpool_new(n < lpool_cores() ? n : 0) : NULL;
+
+    if (pool) {
+        lpool_for(pool, n, lmodule_resolve_task, &batch);
+    } else if (n == 1) {
+        lmodule_resolve(&batch.jobs[0]);
+    }
+
+    /*
+     * Only files the registry does not already hold are parsed up front. A
+     * file named twice is parsed once; the later one is a hit when evaluated.
+     * Standard input is left to the evaluation, which streams it.
+     */
+    int todo = 0;
+    for (int i = 0; i < n; i++) {
+        lmodule_job *job = &batch.jobs[i];
+        if (job->err || job->path[0] == '\0' || lmodule_cached(&in->modules, job)) { continue; }
+        int seen = 0;
+        for (int j = 0; j < i && !seen; j++) {
+            seen = batch.jobs[j].err == NULL && strcmp(batch.jobs[j].path, job->path) == 0;
+        }
+        if (!seen) { batch.todo[todo++] = i; }
+    }
+
+    /* Parse the misses together, then evaluate in command line order */
+    if (pool && todo > 1) {
+        lpool_for(pool, todo, lmodule_parse_task, &batch);
+    } else if (todo == 1) {
+        lmodule_parse_task(&batch, 0);
+    }
+    if (pool) { lpool_del(pool); }
+
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        lval *x = lmodule_eval(in, in->env, &batch.jobs[i], 0);
+        if (x->type == LVAL_ERR) {
+            linterp_println(in, x);
+            failed++;
+        }
+        lval_del(1, x);
+    }
+
+    free(batch.todo);
+    free(batch.jobs);
+    return failed;
+}
+
+typedef struct {
+    char *lib;
+    const char *buf;
+    lreader_chunk *chunks;
+    mpc_parser_t *lispy;
+    /* chunk index of the current wave's first slot */
+    int first;
+    lval **forms;
+    mpc_err_t **errs;
+} lmodule_split;
+
+static void lmodule_split_task(void *ctx, int i) {
+    lmodule_split *sp = ctx;
+    lreader_chunk *c = &sp->chunks[sp->first + i];
+
+    mpc_result_t r;
+    sp->forms[i] = NULL;
+    sp->errs[i] = NULL;
+
+    if (mpc_nparse(sp->lib, sp->buf + c->start, c->end - c->start, sp->lispy, &r)) {
+        sp->forms[i] = r.output;
+    } else {
+        /* Error positions are relative to the chunk */
+        if (r.error->state.row == 0) { r.error->state.col += c->col; }
+        r.error->state.row += c->row;
+        sp->errs[i] = r.error;
+    }
+}
+
+lval *lmodule_load_split(linterp *in, lenv *e, char *lib) {
+    size_t len;
+    char *buf = lmodule_read(lib, &len);
+    if (buf == NULL) {
+        return lval_err("Could not load library %s: unable to read file", lib);
+    }
+
+    lpool *pool = lpool_new(0);
+
+    /* A few chunks per worker, but small files stay in one piece */
+    size_t target = len / (pool->workers * 4);
+    if (target < LMODULE_SPLIT_MIN) { target = LMODULE_SPLIT_MIN; }
+
+    lmodule_split sp;
+    sp.lib = lib;
+    sp.buf = buf;
+    sp.lispy = in->lispy;
+    int n = lreader_split(buf, len, target, &sp.chunks);
+
+    /* Parse a wave of chunks in parallel, then evaluate it in order */
+    int wave = pool->workers * 2;
+    sp.forms = malloc(sizeof(lval *) * wave);
+    sp.errs = malloc(sizeof(mpc_err_t *) * wave);
+
+    lval *result = NULL;
+    for (sp.first = 0; sp.first < n && result == NULL; sp.first += wave) {
+        int m = n - sp.first < wave ? n - sp.first : wave;
+        lpool_for(pool, m, lmodule_split_task, &sp);
+
+        for (int i = 0; i < m; i++) {
+            if (sp.errs[i] && result == NULL) {
+                char *err_msg = mpc_err_string(sp.errs[i]);
+                result = lval_err("Could not load library %s", err_msg);
+                free(err_msg);
+            }
+            if (sp.errs[i]) {
+                mpc_err_delete(sp.errs[i]);
+            } else if (result) {
+                lval_del(1, sp.forms[i]);
+            } else {
+                lval_del(1, lval_eval_forms(e, sp.forms[i]));
+            }
+        }
+    }
+
+    lpool_del(pool);
+    free(sp.forms);
+    free(sp.errs);
+    free(sp.chunks);
+    free(buf);
+
+    return result ? result : lval_sexpr();
+}
+
+static double lmodule_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Parse buf[from, to), adding the forms to parts or the error, placed in the file, to errs */
+static int lmodule_recover_parse(char *lib, const char *buf, size_t from, size_t to, long row, long col,
+                                 mpc_parser_t *lispy, lval *parts, lval *errs, size_t *fail) {
+    mpc_result_t r;
+    if (mpc_nparse(lib, buf + from, to - from, lispy, &r)) {
+        lval_add(parts, r.output);
+        return 1;
+    }
+
+    if (r.error->state.row == 0) { r.error->state.col += col; }
+    r.error->state.row += row;
+    *fail = from + r.error->state.pos;
+
+    char *err_msg = mpc_err_string(r.error);
+    err_msg[strcspn(err_msg, "\n")] = '\0';
+    lval_add(errs, lval_err("%s", err_msg));
+    free(err_msg);
+    mpc_err_delete(r.error);
+    return 0;
+}
+
+lval *lmodule_load_recover(linterp *in, lenv *e, char *lib) {
+    size_t len;
+    char *buf = lmodule_read(lib, &len);
+    if (buf == NULL) {
+        return lval_err("Could not load library %s: unable to read file", lib);
+    }
+
+    double start = lmodule_now();
+    lval *parts = lval_sexpr();
+    lval *errs = lval_sexpr();
+
+    /* Parse what is left, and on an error keep the forms before it and resync after it */
+    size_t pos = 0;
+    long row = 0, col = 0;
+    while (pos < len) {
+        size_t fail;
+        unsigned int at = errs->count;
+        if (lmodule_recover_parse(lib, buf, pos, len, row, col, in->lispy, parts, errs, &fail)) { break; }
+
+        size_t begin = lreader_form_start(buf, pos, fail);
+        if (begin > pos) {
+            size_t ignored;
+            lmodule_recover_parse(lib, buf, pos, begin, row, col, in->lispy, parts, errs, &ignored);
+        }
+
+        size_t next = lreader_resync(buf, len, begin, fail);
+        for (; pos < next; pos++) {
+            /* A form that never closes fails at the end of the file, report it where it opens */
+            if (pos == begin && fail == len) {
+                lval_del(1, errs->cell[at]);
+                errs->cell[at] = lval_err("%s:%ld:%ld: error: unterminated form", lib, row + 1, col + 1);
+            }
+            if (buf[pos] == '\n') { row++; col = 0; } else { col++; }
+        }
+    }
+
+    double secs = lmodule_now() - start;
+    free(buf);
+
+    unsigned int forms = 0;
+    for (unsigned int i = 0; i < parts->count; i++) { forms += parts->cell[i]->count; }
+    while (parts->count) {
+        lval_del(1, lval_eval_forms(e, lval_pop(parts, 0)));
+    }
+    lval_del(1, parts);
+
+    for (unsigned int i = 0; i < errs->count; i++) { linterp_println(in, errs->cell[i]); }
+    linterp_printf(in, "Loaded %u forms from %s with %u parse errors, parsed in %.3f ms\n", forms, lib, errs->count, secs * 1e3);
+
+    lval *x = errs->count ? lval_err("Could not load library %s: %u forms did not parse", lib, errs->count)
+                          : lval_sexpr();
+    lval_del(1, errs);
+    return x;
+}
+
+void lmodule_print_stats(linterp *in) {
+    lmodule_registry *registry = &in->modules;
+    linterp_printf(in, "Modules loaded: %i\n", registry->count);
+    linterp_printf(in, "Cache hits: %lu\n", registry->hits);
+    linterp_printf(in, "Cache misses: %lu\n", registry->misses);
+    linterp_printf(in, "Reloads: %lu\n", registry->reloads);
+}
+
+void lmodule_registry_free(lmodule_registry *registry) {
+    for (int i = 0; i < registry->count; i++) {
+        free(registry->modules[i].path);
+    }
+    free(registry->modules);
+}
@@ -0,0 +1,86 @@
+#ifndef BYOL_MODULE_H
+#define BYOL_MODULE_H
+
+#include <limits.h>
+#include <stdint.h>
+
+#include "lval.h"
+
+/* Library name that reads a script from standard input */
+#define LMODULE_STDIN "-"
+
+/* Smallest chunk a split load hands to a single thread */
+#define LMODULE_SPLIT_MIN (64 * 1024)
+
+/* A library that has been loaded into the interpreter */
+typedef struct {
+    /* canonical path as returned by realpath */
+    char *path;
+    /* FNV-1a hash of the file contents at load time */
+    uint64_t hash;
+} lmodule;
+
+typedef struct {
+    int count;
+    lmodule *modules;
+
+    /* require calls answered from the registry */
+    unsigned long hits;
+    /* require calls that had to parse and evaluate the file */
+    unsigned long misses;
+    /* explicit reloads */
+    unsigned long reloads;
+} lmodule_registry;
+
+/* One library travelling through the resolve, parse and evaluate phases */
+typedef struct {
+    char *lib;
+    char path[PATH_MAX];
+    uint64_t hash;
+    /* file contents between resolving and parsing */
+    char *buf;
+    size_t len;
+    /* exactly one of these is set once parsed */
+    lval *forms;
+    lval *err;
+} lmodule_job;
+
+/*
+ * Each interpreter has its own registry. The functions below parse with the
+ * interpreter's grammar and evaluate into e, a scope of that interpreter.
+ */
+
+/* Load lib unless the same file with the same contents was already loaded */
+lval *lmodule_require(linterp *in, lenv *e, char *lib);
+
+/* Load lib even if it is already in the registry */
+lval *lmodule_reload(linterp *in, lenv *e, char *lib);
+
+/*
+ * Require several libs into the global environment. They are read and
+ * hashed concurrently on a thread pool, the ones not already loaded are
+ * parsed there too, and all are evaluated in the given order. Errors are
+ * printed, returns how many failed.
+ */
+int lmodule_require_all(linterp *in, int n, char **libs);
+
+/*
+ * Load one large file by splitting it on top-level form boundaries and
+ * parsing the pieces in parallel. Forms are evaluated in file order; a
+ * parse error stops the load after the forms before it have run.
+ */
+lval *lmodule_load_split(linterp *in, lenv *e, char *lib);
+
+/*
+ * Load a file even if some of its top-level forms do not parse. After an
+ * error the parse resynchronises at the next top-level form, so one pass
+ * finds every error. The forms that parsed are evaluated in file order,
+ * then the errors are printed with their positions and the parse time.
+ */
+lval *lmodule_load_recover(linterp *in, lenv *e, char *lib);
+
+void lmodule_print_stats(linterp *in);
+
+void lmodule_registry_free(lmodule_registry *registry);
+
+#endif //BYOL_MODULE_H
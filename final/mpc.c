@@ -1,3842 +1,6520 @@
-#include "mpc.h"
-
-/*
-** State Type
-*/
-
-static mpc_state_t mpc_state_invalid(void) {
-  mpc_state_t s;
-  s.pos = -1;
-  s.row = -1;
-  s.col = -1;
-  return s;
-}
-
-static mpc_state_t mpc_state_new(void) {
-  mpc_state_t s;
-  s.pos = 0;
-  s.row = 0;
-  s.col = 0;
-  return s;
-}
-
-/*
-** Input Type
-*/
-
-/*
-** In mpc the input type has three modes of 
-** operation: String, File and Pipe.
-**
-** String is easy. The whole contents are 
-** loaded into a buffer and scanned through.
-** The cursor can jump around at will making 
-** backtracking easy.
-**
-** The second is a File which is also somewhat
-** easy. The contents are never loaded into 
-** memory but backtracking can still be achieved
-** by seeking in the file at different positions.
-**
-** The final mode is Pipe. This is the difficult
-** one. As we assume pipes cannot be seeked - and 
-** only support a single character lookahead at 
-** any point, when the input is marked for a 
-** potential backtracking we start buffering any 
-** input.
-**
-** This means that if we are requested to seek
-** back we can simply start reading from the
-** buffer instead of the input.
-**
-** Of course using `mpc_predictive` will disable
-** backtracking and make LL(1) grammars easy
-** to parse for all input methods.
-**
-*/
-
-enum {
-  MPC_INPUT_STRING = 0,
-  MPC_INPUT_FILE   = 1,
-  MPC_INPUT_PIPE   = 2
-};
-
-enum {
-  MPC_INPUT_MARKS_MIN = 32
-};
-
-enum {
-  MPC_INPUT_MEM_NUM = 512
-};
-
-typedef struct {
-  char mem[64];
-} mpc_mem_t;
-
-typedef struct {
-
-  int type;
-  char *filename;  
-  mpc_state_t state;
-  
-  char *string;
-  char *buffer;
-  FILE *file;
-  
-  int suppress;
-  int backtrack;
-  int marks_slots;
-  int marks_num;
-  mpc_state_t *marks;
-  
-  char *lasts;
-  char last;
-  
-  size_t mem_index;
-  char mem_full[MPC_INPUT_MEM_NUM];
-  mpc_mem_t mem[MPC_INPUT_MEM_NUM];
-  
-} mpc_input_t;
-
-static mpc_input_t *mpc_input_new_string(const char *filename, const char *string) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-  
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  i->type = MPC_INPUT_STRING;
-  
-  i->state = mpc_state_new();
-  
-  i->string = malloc(strlen(string) + 1);
-  strcpy(i->string, string);
-  i->buffer = NULL;
-  i->file = NULL;
-  
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-  
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-  
-  return i;
-}
-
-static mpc_input_t *mpc_input_new_nstring(const char *filename, const char *string, size_t length) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-  
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  i->type = MPC_INPUT_STRING;
-  
-  i->state = mpc_state_new();
-  
-  i->string = malloc(length + 1);
-  strncpy(i->string, string, length);
-  i->string[length] = '\0';
-  i->buffer = NULL;
-  i->file = NULL;
-  
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-  
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-  
-  return i;
-
-}
-
-static mpc_input_t *mpc_input_new_pipe(const char *filename, FILE *pipe) {
-
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-  
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  
-  i->type = MPC_INPUT_PIPE;
-  i->state = mpc_state_new();
-  
-  i->string = NULL;
-  i->buffer = NULL;
-  i->file = pipe;
-  
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-  
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-  
-  return i;
-  
-}
-
-static mpc_input_t *mpc_input_new_file(const char *filename, FILE *file) {
-  
-  mpc_input_t *i = malloc(sizeof(mpc_input_t));
-  
-  i->filename = malloc(strlen(filename) + 1);
-  strcpy(i->filename, filename);
-  i->type = MPC_INPUT_FILE;
-  i->state = mpc_state_new();
-  
-  i->string = NULL;
-  i->buffer = NULL;
-  i->file = file;
-  
-  i->suppress = 0;
-  i->backtrack = 1;
-  i->marks_num = 0;
-  i->marks_slots = MPC_INPUT_MARKS_MIN;
-  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
-  i->lasts = malloc(sizeof(char) * i->marks_slots);
-  i->last = '\0';
-  
-  i->mem_index = 0;
-  memset(i->mem_full, 0, sizeof(char) * MPC_INPUT_MEM_NUM);
-  
-  return i;
-}
-
-static void mpc_input_delete(mpc_input_t *i) {
-  
-  free(i->filename);
-  
-  if (i->type == MPC_INPUT_STRING) { free(i->string); }
-  if (i->type == MPC_INPUT_PIPE) { free(i->buffer); }
-  
-  free(i->marks);
-  free(i->lasts);
-  free(i);
-}
-
-static int mpc_mem_ptr(mpc_input_t *i, void *p) {
-  return
-    (char*)p >= (char*)(i->mem) &&
-    (char*)p <  (char*)(i->mem) + (MPC_INPUT_MEM_NUM * sizeof(mpc_mem_t));
-}
-
-static void *mpc_malloc(mpc_input_t *i, size_t n) {
-  size_t j;
-  char *p;
-  
-  if (n > sizeof(mpc_mem_t)) { return malloc(n); }
-  
-  j = i->mem_index;
-  do {
-    if (!i->mem_full[i->mem_index]) {
-      p = (void*)(i->mem + i->mem_index);
-      i->mem_full[i->mem_index] = 1;
-      i->mem_index = (i->mem_index+1) % MPC_INPUT_MEM_NUM;
-      return p;
-    }
-    i->mem_index = (i->mem_index+1) % MPC_INPUT_MEM_NUM;
-  } while (j != i->mem_index);
-  
-  return malloc(n);
-}
-
-static void *mpc_calloc(mpc_input_t *i, size_t n, size_t m) {
-  char *x = mpc_malloc(i, n * m);
-  memset(x, 0, n * m);
-  return x;
-}
-
-static void mpc_free(mpc_input_t *i, void *p) {
-  size_t j;
-  if (!mpc_mem_ptr(i, p)) { free(p); return; }
-  j = ((size_t)(((char*)p) - ((char*)i->mem))) / sizeof(mpc_mem_t);
-  i->mem_full[j] = 0;
-}
-
-static void *mpc_realloc(mpc_input_t *i, void *p, size_t n) {
-  
-  char *q = NULL;
-  
-  if (!mpc_mem_ptr(i, p)) { return realloc(p, n); }
-  
-  if (n > sizeof(mpc_mem_t)) {
-    q = malloc(n);
-    memcpy(q, p, sizeof(mpc_mem_t));
-    mpc_free(i, p);
-    return q;
-  }
-  
-  return p;
-}
-
-static void *mpc_export(mpc_input_t *i, void *p) {
-  char *q = NULL;
-  if (!mpc_mem_ptr(i, p)) { return p; }
-  q = malloc(sizeof(mpc_mem_t));
-  memcpy(q, p, sizeof(mpc_mem_t));
-  mpc_free(i, p);
-  return q; 
-}
-
-static void mpc_input_backtrack_disable(mpc_input_t *i) { i->backtrack--; }
-static void mpc_input_backtrack_enable(mpc_input_t *i) { i->backtrack++; }
-
-static void mpc_input_suppress_disable(mpc_input_t *i) { i->suppress--; }
-static void mpc_input_suppress_enable(mpc_input_t *i) { i->suppress++; }
-
-static void mpc_input_mark(mpc_input_t *i) {
-  
-  if (i->backtrack < 1) { return; }
-  
-  i->marks_num++;
-  
-  if (i->marks_num > i->marks_slots) {
-    i->marks_slots = i->marks_num + i->marks_num / 2;
-    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
-    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);
-  }
-
-  i->marks[i->marks_num-1] = i->state;
-  i->lasts[i->marks_num-1] = i->last;
-  
-  if (i->type == MPC_INPUT_PIPE && i->marks_num == 1) {
-    i->buffer = calloc(1, 1);
-  }
-  
-}
-
-static void mpc_input_unmark(mpc_input_t *i) {
-  
-  if (i->backtrack < 1) { return; }
-  
-  i->marks_num--;
-  
-  if (i->marks_slots > i->marks_num + i->marks_num / 2
-  &&  i->marks_slots > MPC_INPUT_MARKS_MIN) {
-    i->marks_slots = 
-      i->marks_num > MPC_INPUT_MARKS_MIN ?
-      i->marks_num : MPC_INPUT_MARKS_MIN;
-    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
-    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);      
-  }
-  
-  if (i->type == MPC_INPUT_PIPE && i->marks_num == 0) {
-    free(i->buffer);
-    i->buffer = NULL;
-  }
-  
-}
-
-static void mpc_input_rewind(mpc_input_t *i) {
-  
-  if (i->backtrack < 1) { return; }
-  
-  i->state = i->marks[i->marks_num-1];
-  i->last  = i->lasts[i->marks_num-1];
-  
-  if (i->type == MPC_INPUT_FILE) {
-    fseek(i->file, i->state.pos, SEEK_SET);
-  }
-  
-  mpc_input_unmark(i);
-}
-
-static int mpc_input_buffer_in_range(mpc_input_t *i) {
-  return i->state.pos < (long)(strlen(i->buffer) + i->marks[0].pos);
-}
-
-static char mpc_input_buffer_get(mpc_input_t *i) {
-  return i->buffer[i->state.pos - i->marks[0].pos];
-}
-
-static int mpc_input_terminated(mpc_input_t *i) {
-  if (i->type == MPC_INPUT_STRING && i->state.pos == (long)strlen(i->string)) { return 1; }
-  if (i->type == MPC_INPUT_FILE && feof(i->file)) { return 1; }
-  if (i->type == MPC_INPUT_PIPE && feof(i->file)) { return 1; }
-  return 0;
-}
-
-static char mpc_input_getc(mpc_input_t *i) {
-  
-  char c = '\0';
-  
-  switch (i->type) {
-    
-    case MPC_INPUT_STRING: return i->string[i->state.pos];
-    case MPC_INPUT_FILE: c = fgetc(i->file); return c;
-    case MPC_INPUT_PIPE:
-    
-      if (!i->buffer) { c = getc(i->file); return c; }
-      
-      if (i->buffer && mpc_input_buffer_in_range(i)) {
-        c = mpc_input_buffer_get(i);
-        return c;
-      } else {
-        c = getc(i->file);
-        return c;
-      }
-    
-    default: return c;
-  }
-}
-
-static char mpc_input_peekc(mpc_input_t *i) {
-  
-  char c = '\0';
-  
-  switch (i->type) {
-    case MPC_INPUT_STRING: return i->string[i->state.pos];
-    case MPC_INPUT_FILE: 
-      
-      c = fgetc(i->file);
-      if (feof(i->file)) { return '\0'; }
-      
-      fseek(i->file, -1, SEEK_CUR);
-      return c;
-    
-    case MPC_INPUT_PIPE:
-      
-      if (!i->buffer) {
-        c = getc(i->file);
-        if (feof(i->file)) { return '\0'; }
-        ungetc(c, i->file);
-        return c;
-      }
-      
-      if (i->buffer && mpc_input_buffer_in_range(i)) {
-        return mpc_input_buffer_get(i);
-      } else {
-        c = getc(i->file);
-        if (feof(i->file)) { return '\0'; }
-        ungetc(c, i->file);
-        return c;
-      }
-    
-    default: return c;
-  }
-  
-}
-
-static int mpc_input_failure(mpc_input_t *i, char c) {
-
-  switch (i->type) {
-    case MPC_INPUT_STRING: { break; }
-    case MPC_INPUT_FILE: fseek(i->file, -1, SEEK_CUR); { break; }
-    case MPC_INPUT_PIPE: {
-      
-      if (!i->buffer) { ungetc(c, i->file); break; }
-      
-      if (i->buffer && mpc_input_buffer_in_range(i)) {
-        break;
-      } else {
-        ungetc(c, i->file); 
-      }
-    }
-    default: { break; }
-  }
-  return 0;
-}
-
-static int mpc_input_success(mpc_input_t *i, char c, char **o) {
-  
-  if (i->type == MPC_INPUT_PIPE
-  &&  i->buffer && !mpc_input_buffer_in_range(i)) {
-    i->buffer = realloc(i->buffer, strlen(i->buffer) + 2);
-    i->buffer[strlen(i->buffer) + 1] = '\0';
-    i->buffer[strlen(i->buffer) + 0] = c;
-  }
-  
-  i->last = c;
-  i->state.pos++;
-  i->state.col++;
-  
-  if (c == '\n') {
-    i->state.col = 0;
-    i->state.row++;
-  }
-  
-  if (o) {
-    (*o) = mpc_malloc(i, 2);
-    (*o)[0] = c;
-    (*o)[1] = '\0';
-  }
-  
-  return 1;
-}
-
-static int mpc_input_any(mpc_input_t *i, char **o) {
-  char x = mpc_input_getc(i);
-  if (mpc_input_terminated(i)) { return 0; }
-  return mpc_input_success(i, x, o);
-}
-
-static int mpc_input_char(mpc_input_t *i, char c, char **o) {
-  char x = mpc_input_getc(i);
-  if (mpc_input_terminated(i)) { return 0; }
-  return x == c ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
-}
-
-static int mpc_input_range(mpc_input_t *i, char c, char d, char **o) {
-  char x = mpc_input_getc(i);
-  if (mpc_input_terminated(i)) { return 0; }
-  return x >= c && x <= d ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);  
-}
-
-static int mpc_input_oneof(mpc_input_t *i, const char *c, char **o) {
-  char x = mpc_input_getc(i);
-  if (mpc_input_terminated(i)) { return 0; }
-  return strchr(c, x) != 0 ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);  
-}
-
-static int mpc_input_noneof(mpc_input_t *i, const char *c, char **o) {
-  char x = mpc_input_getc(i);
-  if (mpc_input_terminated(i)) { return 0; }
-  return strchr(c, x) == 0 ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);  
-}
-
-static int mpc_input_satisfy(mpc_input_t *i, int(*cond)(char), char **o) {
-  char x = mpc_input_getc(i);
-  if (mpc_input_terminated(i)) { return 0; }
-  return cond(x) ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);  
-}
-
-static int mpc_input_string(mpc_input_t *i, const char *c, char **o) {
-  
-  const char *x = c;
-
-  mpc_input_mark(i);
-  while (*x) {
-    if (!mpc_input_char(i, *x, NULL)) {
-      mpc_input_rewind(i);
-      return 0;
-    }
-    x++;
-  }
-  mpc_input_unmark(i);
-  
-  *o = mpc_malloc(i, strlen(c) + 1);
-  strcpy(*o, c);
-  return 1;
-}
-
-static int mpc_input_anchor(mpc_input_t* i, int(*f)(char,char), char **o) {
-  *o = NULL;
-  return f(i->last, mpc_input_peekc(i));
-}
-
-static mpc_state_t *mpc_input_state_copy(mpc_input_t *i) {
-  mpc_state_t *r = mpc_malloc(i, sizeof(mpc_state_t));
-  memcpy(r, &i->state, sizeof(mpc_state_t));
-  return r;
-}
-
-/*
-** Error Type
-*/
-
-void mpc_err_delete(mpc_err_t *x) {
-  int i;
-  for (i = 0; i < x->expected_num; i++) { free(x->expected[i]); }
-  free(x->expected);
-  free(x->filename);
-  free(x->failure);
-  free(x);
-}
-
-void mpc_err_print(mpc_err_t *x) {
-  mpc_err_print_to(x, stdout);
-}
-
-void mpc_err_print_to(mpc_err_t *x, FILE *f) {
-  char *str = mpc_err_string(x);
-  fprintf(f, "%s", str);
-  free(str);
-}
-
-static void mpc_err_string_cat(char *buffer, int *pos, int *max, char const *fmt, ...) {
-  /* TODO: Error Checking on Length */
-  int left = ((*max) - (*pos));
-  va_list va;
-  va_start(va, fmt);
-  if (left < 0) { left = 0;}
-  (*pos) += vsprintf(buffer + (*pos), fmt, va);
-  va_end(va);
-}
-
-static char char_unescape_buffer[4];
-
-static const char *mpc_err_char_unescape(char c) {
-  
-  char_unescape_buffer[0] = '\'';
-  char_unescape_buffer[1] = ' ';
-  char_unescape_buffer[2] = '\'';
-  char_unescape_buffer[3] = '\0';
-  
-  switch (c) {
-    case '\a': return "bell";
-    case '\b': return "backspace";
-    case '\f': return "formfeed";
-    case '\r': return "carriage return";
-    case '\v': return "vertical tab";
-    case '\0': return "end of input";
-    case '\n': return "newline";
-    case '\t': return "tab";
-    case ' ' : return "space";
-    default:
-      char_unescape_buffer[1] = c;
-      return char_unescape_buffer;
-  }
-  
-}
-
-char *mpc_err_string(mpc_err_t *x) {
-
-  int i;  
-  int pos = 0; 
-  int max = 1023;
-  char *buffer = calloc(1, 1024);
-  
-  if (x->failure) {
-    mpc_err_string_cat(buffer, &pos, &max,
-    "%s: error: %s\n", x->filename, x->failure);
-    return buffer;
-  }
-  
-  mpc_err_string_cat(buffer, &pos, &max, 
-    "%s:%i:%i: error: expected ", x->filename, x->state.row+1, x->state.col+1);
-  
-  if (x->expected_num == 0) { mpc_err_string_cat(buffer, &pos, &max, "ERROR: NOTHING EXPECTED"); }
-  if (x->expected_num == 1) { mpc_err_string_cat(buffer, &pos, &max, "%s", x->expected[0]); }
-  if (x->expected_num >= 2) {
-  
-    for (i = 0; i < x->expected_num-2; i++) {
-      mpc_err_string_cat(buffer, &pos, &max, "%s, ", x->expected[i]);
-    } 
-    
-    mpc_err_string_cat(buffer, &pos, &max, "%s or %s", 
-      x->expected[x->expected_num-2], 
-      x->expected[x->expected_num-1]);
-  }
-  
-  mpc_err_string_cat(buffer, &pos, &max, " at ");
-  mpc_err_string_cat(buffer, &pos, &max, mpc_err_char_unescape(x->recieved));
-  mpc_err_string_cat(buffer, &pos, &max, "\n");
-  
-  return realloc(buffer, strlen(buffer) + 1);
-}
-
-static mpc_err_t *mpc_err_new(mpc_input_t *i, const char *expected) {
-  mpc_err_t *x;
-  if (i->suppress) { return NULL; }
-  x = mpc_malloc(i, sizeof(mpc_err_t));
-  x->filename = mpc_malloc(i, strlen(i->filename) + 1);
-  strcpy(x->filename, i->filename);
-  x->state = i->state;
-  x->expected_num = 1;
-  x->expected = mpc_malloc(i, sizeof(char*));
-  x->expected[0] = mpc_malloc(i, strlen(expected) + 1);
-  strcpy(x->expected[0], expected);
-  x->failure = NULL;
-  x->recieved = mpc_input_peekc(i);
-  return x;
-}
-
-static mpc_err_t *mpc_err_fail(mpc_input_t *i, const char *failure) {
-  mpc_err_t *x;
-  if (i->suppress) { return NULL; }
-  x = mpc_malloc(i, sizeof(mpc_err_t));
-  x->filename = mpc_malloc(i, strlen(i->filename) + 1);
-  strcpy(x->filename, i->filename);
-  x->state = i->state;
-  x->expected_num = 0;
-  x->expected = NULL;
-  x->failure = mpc_malloc(i, strlen(failure) + 1);
-  strcpy(x->failure, failure);
-  x->recieved = ' ';
-  return x;
-}
-
-static mpc_err_t *mpc_err_file(const char *filename, const char *failure) {
-  mpc_err_t *x;
-  x = malloc(sizeof(mpc_err_t));
-  x->filename = malloc(strlen(filename) + 1);
-  strcpy(x->filename, filename);
-  x->state = mpc_state_new();
-  x->expected_num = 0;
-  x->expected = NULL;
-  x->failure = malloc(strlen(failure) + 1);
-  strcpy(x->failure, failure);
-  x->recieved = ' ';
-  return x;
-}
-
-static void mpc_err_delete_internal(mpc_input_t *i, mpc_err_t *x) {
-  int j;
-  if (x == NULL) { return; }
-  for (j = 0; j < x->expected_num; j++) { mpc_free(i, x->expected[j]); }
-  mpc_free(i, x->expected);
-  mpc_free(i, x->filename);
-  mpc_free(i, x->failure);
-  mpc_free(i, x);
-}
-
-static mpc_err_t *mpc_err_export(mpc_input_t *i, mpc_err_t *x) {
-  int j;
-  for (j = 0; j < x->expected_num; j++) {
-    x->expected[j] = mpc_export(i, x->expected[j]);
-  }
-  x->expected = mpc_export(i, x->expected);
-  x->filename = mpc_export(i, x->filename);
-  x->failure = mpc_export(i, x->failure);
-  return mpc_export(i, x);
-}
-
-static int mpc_err_contains_expected(mpc_input_t *i, mpc_err_t *x, char *expected) {
-  int j;
-  (void)i;
-  for (j = 0; j < x->expected_num; j++) {
-    if (strcmp(x->expected[j], expected) == 0) { return 1; }
-  }
-  return 0;
-}
-
-static void mpc_err_add_expected(mpc_input_t *i, mpc_err_t *x, char *expected) {
-  (void)i;
-  x->expected_num++;
-  x->expected = mpc_realloc(i, x->expected, sizeof(char*) * x->expected_num);
-  x->expected[x->expected_num-1] = mpc_malloc(i, strlen(expected) + 1);
-  strcpy(x->expected[x->expected_num-1], expected);
-}
-
-static mpc_err_t *mpc_err_or(mpc_input_t *i, mpc_err_t** x, int n) {
-  
-  int j, k, fst;
-  mpc_err_t *e;
-  
-  fst = -1;
-  for (j = 0; j < n; j++) {
-    if (x[j] != NULL) { fst = j; }
-  }
-  
-  if (fst == -1) { return NULL; }
-  
-  e = mpc_malloc(i, sizeof(mpc_err_t));
-  e->state = mpc_state_invalid();
-  e->expected_num = 0;
-  e->expected = NULL;
-  e->failure = NULL;
-  e->filename = mpc_malloc(i, strlen(x[fst]->filename)+1);
-  strcpy(e->filename, x[fst]->filename);
-  
-  for (j = 0; j < n; j++) {
-    if (x[j] == NULL) { continue; }
-    if (x[j]->state.pos > e->state.pos) { e->state = x[j]->state; }
-  }
-  
-  for (j = 0; j < n; j++) {
-    if (x[j] == NULL) { continue; }
-    if (x[j]->state.pos < e->state.pos) { continue; }
-    
-    if (x[j]->failure) {
-      e->failure = mpc_malloc(i, strlen(x[j]->failure)+1);
-      strcpy(e->failure, x[j]->failure);
-      break;
-    }
-    
-    e->recieved = x[j]->recieved;
-    
-    for (k = 0; k < x[j]->expected_num; k++) {
-      if (!mpc_err_contains_expected(i, e, x[j]->expected[k])) {
-        mpc_err_add_expected(i, e, x[j]->expected[k]);
-      }
-    }
-  }
-  
-  for (j = 0; j < n; j++) {
-    if (x[j] == NULL) { continue; }
-    mpc_err_delete_internal(i, x[j]);
-  }
-  
-  return e;
-}
-
-static mpc_err_t *mpc_err_repeat(mpc_input_t *i, mpc_err_t *x, const char *prefix) {
-
-  int j = 0;
-  size_t l = 0;
-  char *expect = NULL;
-  
-  if (x == NULL) { return NULL; }
-  
-  if (x->expected_num == 0) {
-    expect = mpc_calloc(i, 1, 1);
-    x->expected_num = 1;
-    x->expected = mpc_realloc(i, x->expected, sizeof(char*) * x->expected_num);
-    x->expected[0] = expect;
-    return x;
-  }
-  
-  else if (x->expected_num == 1) {
-    expect = mpc_malloc(i, strlen(prefix) + strlen(x->expected[0]) + 1);
-    strcpy(expect, prefix);
-    strcat(expect, x->expected[0]);
-    mpc_free(i, x->expected[0]);
-    x->expected[0] = expect;
-    return x;
-  }
-  
-  else if (x->expected_num > 1) {
-    
-    l += strlen(prefix);
-    for (j = 0; j < x->expected_num-2; j++) {
-      l += strlen(x->expected[j]) + strlen(", ");
-    }
-    l += strlen(x->expected[x->expected_num-2]);
-    l += strlen(" or ");
-    l += strlen(x->expected[x->expected_num-1]);
-    
-    expect = mpc_malloc(i, l + 1);
-    
-    strcpy(expect, prefix);
-    for (j = 0; j < x->expected_num-2; j++) {
-      strcat(expect, x->expected[j]); strcat(expect, ", ");
-    }
-    strcat(expect, x->expected[x->expected_num-2]);
-    strcat(expect, " or ");
-    strcat(expect, x->expected[x->expected_num-1]);
-
-    for (j = 0; j < x->expected_num; j++) { mpc_free(i, x->expected[j]); }
-    
-    x->expected_num = 1;
-    x->expected = mpc_realloc(i, x->expected, sizeof(char*) * x->expected_num);
-    x->expected[0] = expect;
-    return x;
-  }
-  
-  return NULL;
-}
-
-static mpc_err_t *mpc_err_many1(mpc_input_t *i, mpc_err_t *x) {
-  return mpc_err_repeat(i, x, "one or more of ");
-}
-
-static mpc_err_t *mpc_err_count(mpc_input_t *i, mpc_err_t *x, int n) {
-  mpc_err_t *y;
-  int digits = n/10 + 1;
-  char *prefix;
-  prefix = mpc_malloc(i, digits + strlen(" of ") + 1);
-  sprintf(prefix, "%i of ", n);
-  y = mpc_err_repeat(i, x, prefix);
-  mpc_free(i, prefix);
-  return y;
-}
-
-static mpc_err_t *mpc_err_merge(mpc_input_t *i, mpc_err_t *x, mpc_err_t *y) {
-  mpc_err_t *errs[2];
-  errs[0] = x;
-  errs[1] = y;
-  return mpc_err_or(i, errs, 2);
-}
-
-/*
-** Parser Type
-*/
-
-enum {
-  MPC_TYPE_UNDEFINED = 0,
-  MPC_TYPE_PASS      = 1,
-  MPC_TYPE_FAIL      = 2,
-  MPC_TYPE_LIFT      = 3,
-  MPC_TYPE_LIFT_VAL  = 4,
-  MPC_TYPE_EXPECT    = 5,
-  MPC_TYPE_ANCHOR    = 6,
-  MPC_TYPE_STATE     = 7,
-  
-  MPC_TYPE_ANY       = 8,
-  MPC_TYPE_SINGLE    = 9,
-  MPC_TYPE_ONEOF     = 10,
-  MPC_TYPE_NONEOF    = 11,
-  MPC_TYPE_RANGE     = 12,
-  MPC_TYPE_SATISFY   = 13,
-  MPC_TYPE_STRING    = 14,
-  
-  MPC_TYPE_APPLY     = 15,
-  MPC_TYPE_APPLY_TO  = 16,
-  MPC_TYPE_PREDICT   = 17,
-  MPC_TYPE_NOT       = 18,
-  MPC_TYPE_MAYBE     = 19,
-  MPC_TYPE_MANY      = 20,
-  MPC_TYPE_MANY1     = 21,
-  MPC_TYPE_COUNT     = 22,
-  
-  MPC_TYPE_OR        = 23,
-  MPC_TYPE_AND       = 24
-};
-
-typedef struct { char *m; } mpc_pdata_fail_t;
-typedef struct { mpc_ctor_t lf; void *x; } mpc_pdata_lift_t;
-typedef struct { mpc_parser_t *x; char *m; } mpc_pdata_expect_t;
-typedef struct { int(*f)(char,char); } mpc_pdata_anchor_t;
-typedef struct { char x; } mpc_pdata_single_t;
-typedef struct { char x; char y; } mpc_pdata_range_t;
-typedef struct { int(*f)(char); } mpc_pdata_satisfy_t;
-typedef struct { char *x; } mpc_pdata_string_t;
-typedef struct { mpc_parser_t *x; mpc_apply_t f; } mpc_pdata_apply_t;
-typedef struct { mpc_parser_t *x; mpc_apply_to_t f; void *d; } mpc_pdata_apply_to_t;
-typedef struct { mpc_parser_t *x; } mpc_pdata_predict_t;
-typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_ctor_t lf; } mpc_pdata_not_t;
-typedef struct { int n; mpc_fold_t f; mpc_parser_t *x; mpc_dtor_t dx; } mpc_pdata_repeat_t;
-typedef struct { int n; mpc_parser_t **xs; } mpc_pdata_or_t;
-typedef struct { int n; mpc_fold_t f; mpc_parser_t **xs; mpc_dtor_t *dxs;  } mpc_pdata_and_t;
-
-typedef union {
-  mpc_pdata_fail_t fail;
-  mpc_pdata_lift_t lift;
-  mpc_pdata_expect_t expect;
-  mpc_pdata_anchor_t anchor;
-  mpc_pdata_single_t single;
-  mpc_pdata_range_t range;
-  mpc_pdata_satisfy_t satisfy;
-  mpc_pdata_string_t string;
-  mpc_pdata_apply_t apply;
-  mpc_pdata_apply_to_t apply_to;
-  mpc_pdata_predict_t predict;
-  mpc_pdata_not_t not;
-  mpc_pdata_repeat_t repeat;
-  mpc_pdata_and_t and;
-  mpc_pdata_or_t or;
-} mpc_pdata_t;
-
-struct mpc_parser_t {
-  char *name;
-  mpc_pdata_t data;
-  char type;
-  char retained;
-};
-
-static mpc_val_t *mpcf_input_nth_free(mpc_input_t *i, int n, mpc_val_t **xs, int x) {
-  int j;
-  for (j = 0; j < n; j++) { if (j != x) { mpc_free(i, xs[j]); } }
-  return xs[x];
-}
- 
-static mpc_val_t *mpcf_input_fst_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 0); }
-static mpc_val_t *mpcf_input_snd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 1); }
-static mpc_val_t *mpcf_input_trd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 2); }
-
-static mpc_val_t *mpcf_input_strfold(mpc_input_t *i, int n, mpc_val_t **xs) {
-  int j;
-  size_t l = 0;
-  if (n == 0) { return mpc_calloc(i, 1, 1); }
-  for (j = 0; j < n; j++) { l += strlen(xs[j]); }
-  xs[0] = mpc_realloc(i, xs[0], l + 1);
-  for (j = 1; j < n; j++) { strcat(xs[0], xs[j]); mpc_free(i, xs[j]); }
-  return xs[0];
-}
-
-static mpc_val_t *mpcf_input_state_ast(mpc_input_t *i, int n, mpc_val_t **xs) {
-  mpc_state_t *s = ((mpc_state_t**)xs)[0];
-  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
-  a = mpc_ast_state(a, *s);
-  mpc_free(i, s);
-  (void) n;
-  return a;
-}
-
-static mpc_val_t *mpc_parse_fold(mpc_input_t *i, mpc_fold_t f, int n, mpc_val_t **xs) {
-  int j;
-  if (f == mpcf_null)      { return mpcf_null(n, xs); }
-  if (f == mpcf_fst)       { return mpcf_fst(n, xs); }
-  if (f == mpcf_snd)       { return mpcf_snd(n, xs); }
-  if (f == mpcf_trd)       { return mpcf_trd(n, xs); }
-  if (f == mpcf_fst_free)  { return mpcf_input_fst_free(i, n, xs); }
-  if (f == mpcf_snd_free)  { return mpcf_input_snd_free(i, n, xs); }
-  if (f == mpcf_trd_free)  { return mpcf_input_trd_free(i, n, xs); }
-  if (f == mpcf_strfold)   { return mpcf_input_strfold(i, n, xs); }
-  if (f == mpcf_state_ast) { return mpcf_input_state_ast(i, n, xs); }
-  for (j = 0; j < n; j++) { xs[j] = mpc_export(i, xs[j]); }
-  return f(j, xs);
-}
-
-static mpc_val_t *mpcf_input_free(mpc_input_t *i, mpc_val_t *x) {
-  mpc_free(i, x);
-  return NULL;
-}
-
-static mpc_val_t *mpcf_input_str_ast(mpc_input_t *i, mpc_val_t *c) {
-  mpc_ast_t *a = mpc_ast_new("", c);
-  mpc_free(i, c);
-  return a;
-}
-
-static mpc_val_t *mpc_parse_apply(mpc_input_t *i, mpc_apply_t f, mpc_val_t *x) {
-  if (f == mpcf_free)     { return mpcf_input_free(i, x); }
-  if (f == mpcf_str_ast)  { return mpcf_input_str_ast(i, x); }
-  return f(mpc_export(i, x));
-}
-
-static mpc_val_t *mpc_parse_apply_to(mpc_input_t *i, mpc_apply_to_t f, mpc_val_t *x, mpc_val_t *d) {
-  return f(mpc_export(i, x), d);
-}
-
-static void mpc_parse_dtor(mpc_input_t *i, mpc_dtor_t d, mpc_val_t *x) {
-  if (d == free) { mpc_free(i, x); return; }
-  d(mpc_export(i, x));
-}
-
-enum {
-  MPC_PARSE_STACK_MIN = 4
-};
-
-#define MPC_SUCCESS(x) r->output = x; return 1
-#define MPC_FAILURE(x) r->error = x; return 0
-#define MPC_PRIMITIVE(x) \
-  if (x) { MPC_SUCCESS(r->output); } \
-  else { MPC_FAILURE(NULL); }
-
-static int mpc_parse_run(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r, mpc_err_t **e) {
-  
-  int j = 0, k = 0;
-  mpc_result_t results_stk[MPC_PARSE_STACK_MIN];
-  mpc_result_t *results;
-  int results_slots = MPC_PARSE_STACK_MIN;
-  
-  switch (p->type) {
-      
-    /* Basic Parsers */
-
-    case MPC_TYPE_ANY:     MPC_PRIMITIVE(mpc_input_any(i, (char**)&r->output));
-    case MPC_TYPE_SINGLE:  MPC_PRIMITIVE(mpc_input_char(i, p->data.single.x, (char**)&r->output));
-    case MPC_TYPE_RANGE:   MPC_PRIMITIVE(mpc_input_range(i, p->data.range.x, p->data.range.y, (char**)&r->output));
-    case MPC_TYPE_ONEOF:   MPC_PRIMITIVE(mpc_input_oneof(i, p->data.string.x, (char**)&r->output));
-    case MPC_TYPE_NONEOF:  MPC_PRIMITIVE(mpc_input_noneof(i, p->data.string.x, (char**)&r->output));
-    case MPC_TYPE_SATISFY: MPC_PRIMITIVE(mpc_input_satisfy(i, p->data.satisfy.f, (char**)&r->output));
-    case MPC_TYPE_STRING:  MPC_PRIMITIVE(mpc_input_string(i, p->data.string.x, (char**)&r->output));
-    case MPC_TYPE_ANCHOR:  MPC_PRIMITIVE(mpc_input_anchor(i, p->data.anchor.f, (char**)&r->output));
-    
-    /* Other parsers */
-    
-    case MPC_TYPE_UNDEFINED: MPC_FAILURE(mpc_err_fail(i, "Parser Undefined!"));
-    case MPC_TYPE_PASS:      MPC_SUCCESS(NULL);
-    case MPC_TYPE_FAIL:      MPC_FAILURE(mpc_err_fail(i, p->data.fail.m));
-    case MPC_TYPE_LIFT:      MPC_SUCCESS(p->data.lift.lf());
-    case MPC_TYPE_LIFT_VAL:  MPC_SUCCESS(p->data.lift.x);
-    case MPC_TYPE_STATE:     MPC_SUCCESS(mpc_input_state_copy(i));
-    
-    /* Application Parsers */
-    
-    case MPC_TYPE_APPLY:
-      if (mpc_parse_run(i, p->data.apply.x, r, e)) {
-        MPC_SUCCESS(mpc_parse_apply(i, p->data.apply.f, r->output));
-      } else {
-        MPC_FAILURE(r->output);
-      }
-    
-    case MPC_TYPE_APPLY_TO:
-      if (mpc_parse_run(i, p->data.apply_to.x, r, e)) {
-        MPC_SUCCESS(mpc_parse_apply_to(i, p->data.apply_to.f, r->output, p->data.apply_to.d));
-      } else {
-        MPC_FAILURE(r->error);
-      }
-    
-    case MPC_TYPE_EXPECT:
-      mpc_input_suppress_enable(i);
-      if (mpc_parse_run(i, p->data.expect.x, r, e)) {
-        mpc_input_suppress_disable(i);
-        MPC_SUCCESS(r->output);
-      } else {
-        mpc_input_suppress_disable(i);
-        MPC_FAILURE(mpc_err_new(i, p->data.expect.m));
-      }
-    
-    case MPC_TYPE_PREDICT:
-      mpc_input_backtrack_disable(i);
-      if (mpc_parse_run(i, p->data.predict.x, r, e)) {      
-        mpc_input_backtrack_enable(i);
-        MPC_SUCCESS(r->output);
-      } else {
-        mpc_input_backtrack_enable(i);
-        MPC_FAILURE(r->error);
-      }
-    
-    /* Optional Parsers */
-    
-    /* TODO: Update Not Error Message */
-    
-    case MPC_TYPE_NOT:
-      mpc_input_mark(i);
-      mpc_input_suppress_enable(i);
-      if (mpc_parse_run(i, p->data.not.x, r, e)) {
-        mpc_input_rewind(i);
-        mpc_input_suppress_disable(i);
-        mpc_parse_dtor(i, p->data.not.dx, r->output);
-        MPC_FAILURE(mpc_err_new(i, "opposite"));
-      } else {
-        mpc_input_unmark(i);
-        mpc_input_suppress_disable(i);
-        MPC_SUCCESS(p->data.not.lf());
-      }
-    
-    case MPC_TYPE_MAYBE:
-      if (mpc_parse_run(i, p->data.not.x, r, e)) {
-        MPC_SUCCESS(r->output);
-      } else {
-        *e = mpc_err_merge(i, *e, r->error);
-        MPC_SUCCESS(p->data.not.lf());
-      }
-    
-    /* Repeat Parsers */
-    
-    case MPC_TYPE_MANY:
-      
-      results = results_stk;
-      
-      while (mpc_parse_run(i, p->data.repeat.x, &results[j], e)) {
-        j++;
-        if (j == MPC_PARSE_STACK_MIN) {
-          results_slots = j + j / 2;
-          results = mpc_malloc(i, sizeof(mpc_result_t) * results_slots);
-          memcpy(results, results_stk, sizeof(mpc_result_t) * MPC_PARSE_STACK_MIN);
-        } else if (j >= results_slots) {
-          results_slots = j + j / 2;
-          results = mpc_realloc(i, results, sizeof(mpc_result_t) * results_slots);
-        }
-      }
-      
-      *e = mpc_err_merge(i, *e, results[j].error);
-      MPC_SUCCESS(
-        mpc_parse_fold(i, p->data.repeat.f, j, (mpc_val_t**)results);
-        if (j >= MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-    
-    case MPC_TYPE_MANY1:
-      
-      results = results_stk;
-      
-      while (mpc_parse_run(i, p->data.repeat.x, &results[j], e)) {
-        j++;
-        if (j == MPC_PARSE_STACK_MIN) {
-          results_slots = j + j / 2;
-          results = mpc_malloc(i, sizeof(mpc_result_t) * results_slots);
-          memcpy(results, results_stk, sizeof(mpc_result_t) * MPC_PARSE_STACK_MIN);
-        } else if (j >= results_slots) {
-          results_slots = j + j / 2;
-          results = mpc_realloc(i, results, sizeof(mpc_result_t) * results_slots);
-        }
-      }
-      
-      if (j == 0) {
-        MPC_FAILURE(
-          mpc_err_many1(i, results[j].error);
-          if (j >= MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      } else {
-        *e = mpc_err_merge(i, *e, results[j].error);
-        MPC_SUCCESS(
-          mpc_parse_fold(i, p->data.repeat.f, j, (mpc_val_t**)results);
-          if (j >= MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      }
-    
-    case MPC_TYPE_COUNT:
-      
-      results = p->data.repeat.n > MPC_PARSE_STACK_MIN
-        ? mpc_malloc(i, sizeof(mpc_result_t) * p->data.repeat.n)
-        : results_stk;
-      
-      while (mpc_parse_run(i, p->data.repeat.x, &results[j], e)) {
-        j++;
-        if (j == p->data.repeat.n) { break; }
-      }
-      
-      if (j == p->data.repeat.n) {
-        MPC_SUCCESS(
-          mpc_parse_fold(i, p->data.repeat.f, j, (mpc_val_t**)results);
-          if (p->data.repeat.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-      } else {
-        for (k = 0; k < j; k++) {
-          mpc_parse_dtor(i, p->data.repeat.dx, results[k].output);
-        }
-        MPC_FAILURE(
-          mpc_err_count(i, results[j].error, p->data.repeat.n);
-          if (p->data.repeat.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });  
-      }
-      
-    /* Combinatory Parsers */
-    
-    case MPC_TYPE_OR:
-      
-      if (p->data.or.n == 0) { MPC_SUCCESS(NULL); }
-      
-      results = p->data.or.n > MPC_PARSE_STACK_MIN
-        ? mpc_malloc(i, sizeof(mpc_result_t) * p->data.or.n)
-        : results_stk;
-      
-      for (j = 0; j < p->data.or.n; j++) {
-        if (mpc_parse_run(i, p->data.or.xs[j], &results[j], e)) {
-          MPC_SUCCESS(results[j].output;
-            if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-        } else {
-          *e = mpc_err_merge(i, *e, results[j].error);
-        } 
-      }
-      
-      MPC_FAILURE(NULL;
-        if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-    
-    case MPC_TYPE_AND:
-      
-      if (p->data.and.n == 0) { MPC_SUCCESS(NULL); }
-      
-      results = p->data.or.n > MPC_PARSE_STACK_MIN
-        ? mpc_malloc(i, sizeof(mpc_result_t) * p->data.or.n)
-        : results_stk;
-      
-      mpc_input_mark(i);
-      for (j = 0; j < p->data.and.n; j++) {
-        if (!mpc_parse_run(i, p->data.and.xs[j], &results[j], e)) {
-          mpc_input_rewind(i);
-          for (k = 0; k < j; k++) {
-            mpc_parse_dtor(i, p->data.and.dxs[k], results[k].output);
-          }
-          MPC_FAILURE(results[j].error;
-            if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-        }
-      }
-      mpc_input_unmark(i); 
-      MPC_SUCCESS(
-        mpc_parse_fold(i, p->data.and.f, j, (mpc_val_t**)results);
-        if (p->data.or.n > MPC_PARSE_STACK_MIN) { mpc_free(i, results); });
-    
-    /* End */
-    
-    default:
-      
-      MPC_FAILURE(mpc_err_fail(i, "Unknown Parser Type Id!"));
-  }
-  
-  return 0;
-  
-}
-
-#undef MPC_SUCCESS
-#undef MPC_FAILURE
-#undef MPC_PRIMITIVE
-
-int mpc_parse_input(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_err_t *e = mpc_err_fail(i, "Unknown Error");
-  e->state = mpc_state_invalid();
-  x = mpc_parse_run(i, p, r, &e);
-  if (x) {
-    mpc_err_delete_internal(i, e);
-    r->output = mpc_export(i, r->output);
-  } else {
-    r->error = mpc_err_export(i, mpc_err_merge(i, e, r->error));
-  }
-  return x;
-}
-
-int mpc_parse(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_string(filename, string);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_nparse(const char *filename, const char *string, size_t length, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_nstring(filename, string, length);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_file(filename, file);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r) {
-  int x;
-  mpc_input_t *i = mpc_input_new_pipe(filename, pipe);
-  x = mpc_parse_input(i, p, r);
-  mpc_input_delete(i);
-  return x;
-}
-
-int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
-  
-  FILE *f = fopen(filename, "rb");
-  int res;
-  
-  if (f == NULL) {
-    r->output = NULL;
-    r->error = mpc_err_file(filename, "Unable to open file!");
-    return 0;
-  }
-  
-  res = mpc_parse_file(filename, f, p, r);
-  fclose(f);
-  return res;
-}
-
-/*
-** Building a Parser
-*/
-
-static void mpc_undefine_unretained(mpc_parser_t *p, int force);
-
-static void mpc_undefine_or(mpc_parser_t *p) {
-  
-  int i;
-  for (i = 0; i < p->data.or.n; i++) {
-    mpc_undefine_unretained(p->data.or.xs[i], 0);
-  }
-  free(p->data.or.xs);
-  
-}
-
-static void mpc_undefine_and(mpc_parser_t *p) {
-  
-  int i;
-  for (i = 0; i < p->data.and.n; i++) {
-    mpc_undefine_unretained(p->data.and.xs[i], 0);
-  }
-  free(p->data.and.xs);
-  free(p->data.and.dxs);
-  
-}
-
-static void mpc_undefine_unretained(mpc_parser_t *p, int force) {
-  
-  if (p->retained && !force) { return; }
-  
-  switch (p->type) {
-    
-    case MPC_TYPE_FAIL: free(p->data.fail.m); break;
-    
-    case MPC_TYPE_ONEOF: 
-    case MPC_TYPE_NONEOF:
-    case MPC_TYPE_STRING:
-      free(p->data.string.x); 
-      break;
-    
-    case MPC_TYPE_APPLY:    mpc_undefine_unretained(p->data.apply.x, 0);    break;
-    case MPC_TYPE_APPLY_TO: mpc_undefine_unretained(p->data.apply_to.x, 0); break;
-    case MPC_TYPE_PREDICT:  mpc_undefine_unretained(p->data.predict.x, 0);  break;
-    
-    case MPC_TYPE_MAYBE:
-    case MPC_TYPE_NOT:
-      mpc_undefine_unretained(p->data.not.x, 0);
-      break;
-    
-    case MPC_TYPE_EXPECT:
-      mpc_undefine_unretained(p->data.expect.x, 0);
-      free(p->data.expect.m);
-      break;
-      
-    case MPC_TYPE_MANY:
-    case MPC_TYPE_MANY1:
-    case MPC_TYPE_COUNT:
-      mpc_undefine_unretained(p->data.repeat.x, 0);
-      break;
-    
-    case MPC_TYPE_OR:  mpc_undefine_or(p);  break;
-    case MPC_TYPE_AND: mpc_undefine_and(p); break;
-    
-    default: break;
-  }
-  
-  if (!force) {
-    free(p->name);
-    free(p);
-  }
-  
-}
-
-void mpc_delete(mpc_parser_t *p) {
-  if (p->retained) {
-
-    if (p->type != MPC_TYPE_UNDEFINED) {
-      mpc_undefine_unretained(p, 0);
-    } 
-    
-    free(p->name);
-    free(p);
-  
-  } else {
-    mpc_undefine_unretained(p, 0);  
-  }
-}
-
-static void mpc_soft_delete(mpc_val_t *x) {
-  mpc_undefine_unretained(x, 0);
-}
-
-static mpc_parser_t *mpc_undefined(void) {
-  mpc_parser_t *p = calloc(1, sizeof(mpc_parser_t));
-  p->retained = 0;
-  p->type = MPC_TYPE_UNDEFINED;
-  p->name = NULL;
-  return p;
-}
-
-mpc_parser_t *mpc_new(const char *name) {
-  mpc_parser_t *p = mpc_undefined();
-  p->retained = 1;
-  p->name = realloc(p->name, strlen(name) + 1);
-  strcpy(p->name, name);
-  return p;
-}
-
-mpc_parser_t *mpc_copy(mpc_parser_t *a) {
-  int i = 0;
-  mpc_parser_t *p;
-  
-  if (a->retained) { return a; }
-  
-  p = mpc_undefined();
-  p->retained = a->retained;
-  p->type = a->type;
-  p->data = a->data;
-  
-  if (a->name) {
-    p->name = malloc(strlen(a->name)+1);
-    strcpy(p->name, a->name);
-  }
-  
-  switch (a->type) {
-    
-    case MPC_TYPE_FAIL:
-      p->data.fail.m = malloc(strlen(a->data.fail.m)+1);
-      strcpy(p->data.fail.m, a->data.fail.m);
-    break;
-    
-    case MPC_TYPE_ONEOF: 
-    case MPC_TYPE_NONEOF:
-    case MPC_TYPE_STRING:
-      p->data.string.x = malloc(strlen(a->data.string.x)+1);
-      strcpy(p->data.string.x, a->data.string.x);
-      break;
-    
-    case MPC_TYPE_APPLY:    p->data.apply.x    = mpc_copy(a->data.apply.x);    break;
-    case MPC_TYPE_APPLY_TO: p->data.apply_to.x = mpc_copy(a->data.apply_to.x); break;
-    case MPC_TYPE_PREDICT:  p->data.predict.x  = mpc_copy(a->data.predict.x);  break;
-    
-    case MPC_TYPE_MAYBE:
-    case MPC_TYPE_NOT:
-      p->data.not.x = mpc_copy(a->data.not.x);
-      break;
-    
-    case MPC_TYPE_EXPECT:
-      p->data.expect.x = mpc_copy(a->data.expect.x);
-      p->data.expect.m = malloc(strlen(a->data.expect.m)+1);
-      strcpy(p->data.expect.m, a->data.expect.m);
-      break;
-      
-    case MPC_TYPE_MANY:
-    case MPC_TYPE_MANY1:
-    case MPC_TYPE_COUNT:
-      p->data.repeat.x = mpc_copy(a->data.repeat.x);
-      break;
-    
-    case MPC_TYPE_OR:
-      p->data.or.xs = malloc(a->data.or.n * sizeof(mpc_parser_t*));
-      for (i = 0; i < a->data.or.n; i++) {
-        p->data.or.xs[i] = mpc_copy(a->data.or.xs[i]);
-      }
-    break;
-    case MPC_TYPE_AND:
-      p->data.and.xs = malloc(a->data.and.n * sizeof(mpc_parser_t*));
-      for (i = 0; i < a->data.and.n; i++) {
-        p->data.and.xs[i] = mpc_copy(a->data.and.xs[i]);
-      }
-      p->data.and.dxs = malloc((a->data.and.n-1) * sizeof(mpc_dtor_t));
-      for (i = 0; i < a->data.and.n-1; i++) {
-        p->data.and.dxs[i] = a->data.and.dxs[i];
-      }
-    break;
-    
-    default: break;
-  }
-
-  
-  return p;
-}
-
-mpc_parser_t *mpc_undefine(mpc_parser_t *p) {
-  mpc_undefine_unretained(p, 1);
-  p->type = MPC_TYPE_UNDEFINED;
-  return p;
-}
-
-mpc_parser_t *mpc_define(mpc_parser_t *p, mpc_parser_t *a) {
-  
-  if (p->retained) {
-    p->type = a->type;
-    p->data = a->data;
-  } else {
-    mpc_parser_t *a2 = mpc_failf("Attempt to assign to Unretained Parser!");
-    p->type = a2->type;
-    p->data = a2->data;
-    free(a2);
-  }
-  
-  free(a);
-  return p;  
-}
-
-void mpc_cleanup(int n, ...) {
-  int i;
-  mpc_parser_t **list = malloc(sizeof(mpc_parser_t*) * n);
-  
-  va_list va;
-  va_start(va, n);
-  for (i = 0; i < n; i++) { list[i] = va_arg(va, mpc_parser_t*); }
-  for (i = 0; i < n; i++) { mpc_undefine(list[i]); }
-  for (i = 0; i < n; i++) { mpc_delete(list[i]); }  
-  va_end(va);  
-
-  free(list);
-}
-
-mpc_parser_t *mpc_pass(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_PASS;
-  return p;
-}
-
-mpc_parser_t *mpc_fail(const char *m) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_FAIL;
-  p->data.fail.m = malloc(strlen(m) + 1);
-  strcpy(p->data.fail.m, m);
-  return p;
-}
-
-/*
-** As `snprintf` is not ANSI standard this 
-** function `mpc_failf` should be considered
-** unsafe.
-**
-** You have a few options if this is going to be
-** trouble.
-**
-** - Ensure the format string does not exceed
-**   the buffer length using precision specifiers
-**   such as `%.512s`.
-**
-** - Patch this function in your code base to 
-**   use `snprintf` or whatever variant your
-**   system supports.
-**
-** - Avoid it altogether.
-**
-*/
-
-mpc_parser_t *mpc_failf(const char *fmt, ...) {
-  
-  va_list va;
-  char *buffer;
-
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_FAIL;
-  
-  va_start(va, fmt);
-  buffer = malloc(2048);
-  vsprintf(buffer, fmt, va);
-  va_end(va);
-  
-  buffer = realloc(buffer, strlen(buffer) + 1);
-  p->data.fail.m = buffer;
-  return p;
-
-}
-
-mpc_parser_t *mpc_lift_val(mpc_val_t *x) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_LIFT_VAL;
-  p->data.lift.x = x;
-  return p;
-}
-
-mpc_parser_t *mpc_lift(mpc_ctor_t lf) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_LIFT;
-  p->data.lift.lf = lf;
-  return p;
-}
-
-mpc_parser_t *mpc_anchor(int(*f)(char,char)) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_ANCHOR;
-  p->data.anchor.f = f;
-  return mpc_expect(p, "anchor");
-}
-
-mpc_parser_t *mpc_state(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_STATE;
-  return p;
-}
-
-mpc_parser_t *mpc_expect(mpc_parser_t *a, const char *expected) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_EXPECT;
-  p->data.expect.x = a;
-  p->data.expect.m = malloc(strlen(expected) + 1);
-  strcpy(p->data.expect.m, expected);
-  return p;
-}
-
-/*
-** As `snprintf` is not ANSI standard this 
-** function `mpc_expectf` should be considered
-** unsafe.
-**
-** You have a few options if this is going to be
-** trouble.
-**
-** - Ensure the format string does not exceed
-**   the buffer length using precision specifiers
-**   such as `%.512s`.
-**
-** - Patch this function in your code base to 
-**   use `snprintf` or whatever variant your
-**   system supports.
-**
-** - Avoid it altogether.
-**
-*/
-
-mpc_parser_t *mpc_expectf(mpc_parser_t *a, const char *fmt, ...) {
-  va_list va;
-  char *buffer;
-
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_EXPECT;
-  
-  va_start(va, fmt);
-  buffer = malloc(2048);
-  vsprintf(buffer, fmt, va);
-  va_end(va);
-  
-  buffer = realloc(buffer, strlen(buffer) + 1);
-  p->data.expect.x = a;
-  p->data.expect.m = buffer;
-  return p;
-}
-
-/*
-** Basic Parsers
-*/
-
-mpc_parser_t *mpc_any(void) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_ANY;
-  return mpc_expect(p, "any character");
-}
-
-mpc_parser_t *mpc_char(char c) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_SINGLE;
-  p->data.single.x = c;
-  return mpc_expectf(p, "'%c'", c);
-}
-
-mpc_parser_t *mpc_range(char s, char e) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_RANGE;
-  p->data.range.x = s;
-  p->data.range.y = e;
-  return mpc_expectf(p, "character between '%c' and '%c'", s, e);
-}
-
-mpc_parser_t *mpc_oneof(const char *s) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_ONEOF;
-  p->data.string.x = malloc(strlen(s) + 1);
-  strcpy(p->data.string.x, s);
-  return mpc_expectf(p, "one of '%s'", s);
-}
-
-mpc_parser_t *mpc_noneof(const char *s) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_NONEOF;
-  p->data.string.x = malloc(strlen(s) + 1);
-  strcpy(p->data.string.x, s);
-  return mpc_expectf(p, "none of '%s'", s);
-
-}
-
-mpc_parser_t *mpc_satisfy(int(*f)(char)) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_SATISFY;
-  p->data.satisfy.f = f;
-  return mpc_expectf(p, "character satisfying function %p", f);
-}
-
-mpc_parser_t *mpc_string(const char *s) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_STRING;
-  p->data.string.x = malloc(strlen(s) + 1);
-  strcpy(p->data.string.x, s);
-  return mpc_expectf(p, "\"%s\"", s);
-}
-
-/*
-** Core Parsers
-*/
-
-mpc_parser_t *mpc_apply(mpc_parser_t *a, mpc_apply_t f) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_APPLY;
-  p->data.apply.x = a;
-  p->data.apply.f = f;
-  return p;
-}
-
-mpc_parser_t *mpc_apply_to(mpc_parser_t *a, mpc_apply_to_t f, void *x) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_APPLY_TO;
-  p->data.apply_to.x = a;
-  p->data.apply_to.f = f;
-  p->data.apply_to.d = x;
-  return p;
-}
-
-mpc_parser_t *mpc_predictive(mpc_parser_t *a) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_PREDICT;
-  p->data.predict.x = a;
-  return p;
-}
-
-mpc_parser_t *mpc_not_lift(mpc_parser_t *a, mpc_dtor_t da, mpc_ctor_t lf) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_NOT;
-  p->data.not.x = a;
-  p->data.not.dx = da;
-  p->data.not.lf = lf;
-  return p;
-}
-
-mpc_parser_t *mpc_not(mpc_parser_t *a, mpc_dtor_t da) {
-  return mpc_not_lift(a, da, mpcf_ctor_null);
-}
-
-mpc_parser_t *mpc_maybe_lift(mpc_parser_t *a, mpc_ctor_t lf) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_MAYBE;
-  p->data.not.x = a;
-  p->data.not.lf = lf;
-  return p;
-}
-
-mpc_parser_t *mpc_maybe(mpc_parser_t *a) {
-  return mpc_maybe_lift(a, mpcf_ctor_null);
-}
-
-mpc_parser_t *mpc_many(mpc_fold_t f, mpc_parser_t *a) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_MANY;
-  p->data.repeat.x = a;
-  p->data.repeat.f = f;
-  return p;
-}
-
-mpc_parser_t *mpc_many1(mpc_fold_t f, mpc_parser_t *a) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_MANY1;
-  p->data.repeat.x = a;
-  p->data.repeat.f = f;
-  return p;
-}
-
-mpc_parser_t *mpc_count(int n, mpc_fold_t f, mpc_parser_t *a, mpc_dtor_t da) {
-  mpc_parser_t *p = mpc_undefined();
-  p->type = MPC_TYPE_COUNT;
-  p->data.repeat.n = n;
-  p->data.repeat.f = f;
-  p->data.repeat.x = a;
-  p->data.repeat.dx = da;
-  return p;
-}
-
-mpc_parser_t *mpc_or(int n, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-  
-  p->type = MPC_TYPE_OR;
-  p->data.or.n = n;
-  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
-  
-  va_start(va, n);  
-  for (i = 0; i < n; i++) {
-    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  va_end(va);
-  
-  return p;
-}
-
-mpc_parser_t *mpc_and(int n, mpc_fold_t f, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-  
-  p->type = MPC_TYPE_AND;
-  p->data.and.n = n;
-  p->data.and.f = f;
-  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
-  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
-
-  va_start(va, f);  
-  for (i = 0; i < n; i++) {
-    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  for (i = 0; i < (n-1); i++) {
-    p->data.and.dxs[i] = va_arg(va, mpc_dtor_t);
-  }  
-  va_end(va);
-  
-  return p;
-}
-
-/*
-** Common Parsers
-*/
-
-static int mpc_soi_anchor(char prev, char next) { (void) next; return (prev == '\0'); }
-static int mpc_eoi_anchor(char prev, char next) { (void) prev; return (next == '\0'); }
-
-mpc_parser_t *mpc_soi(void) { return mpc_expect(mpc_anchor(mpc_soi_anchor), "start of input"); }
-mpc_parser_t *mpc_eoi(void) { return mpc_expect(mpc_anchor(mpc_eoi_anchor), "end of input"); }
-
-static int mpc_boundary_anchor(char prev, char next) {
-  const char* word = "abcdefghijklmnopqrstuvwxyz"
-                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                     "0123456789_";
-  if ( strchr(word, next) &&  prev == '\0') { return 1; }
-  if ( strchr(word, prev) &&  next == '\0') { return 1; }
-  if ( strchr(word, next) && !strchr(word, prev)) { return 1; }
-  if (!strchr(word, next) &&  strchr(word, prev)) { return 1; }
-  return 0;
-}
-
-mpc_parser_t *mpc_boundary(void) { return mpc_expect(mpc_anchor(mpc_boundary_anchor), "boundary"); }
-
-mpc_parser_t *mpc_whitespace(void) { return mpc_expect(mpc_oneof(" \f\n\r\t\v"), "whitespace"); }
-mpc_parser_t *mpc_whitespaces(void) { return mpc_expect(mpc_many(mpcf_strfold, mpc_whitespace()), "spaces"); }
-mpc_parser_t *mpc_blank(void) { return mpc_expect(mpc_apply(mpc_whitespaces(), mpcf_free), "whitespace"); }
-
-mpc_parser_t *mpc_newline(void) { return mpc_expect(mpc_char('\n'), "newline"); }
-mpc_parser_t *mpc_tab(void) { return mpc_expect(mpc_char('\t'), "tab"); }
-mpc_parser_t *mpc_escape(void) { return mpc_and(2, mpcf_strfold, mpc_char('\\'), mpc_any(), free); }
-
-mpc_parser_t *mpc_digit(void) { return mpc_expect(mpc_oneof("0123456789"), "digit"); }
-mpc_parser_t *mpc_hexdigit(void) { return mpc_expect(mpc_oneof("0123456789ABCDEFabcdef"), "hex digit"); }
-mpc_parser_t *mpc_octdigit(void) { return mpc_expect(mpc_oneof("01234567"), "oct digit"); }
-mpc_parser_t *mpc_digits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_digit()), "digits"); }
-mpc_parser_t *mpc_hexdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_hexdigit()), "hex digits"); }
-mpc_parser_t *mpc_octdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_octdigit()), "oct digits"); }
-
-mpc_parser_t *mpc_lower(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyz"), "lowercase letter"); }
-mpc_parser_t *mpc_upper(void) { return mpc_expect(mpc_oneof("ABCDEFGHIJKLMNOPQRSTUVWXYZ"), "uppercase letter"); }
-mpc_parser_t *mpc_alpha(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"), "letter"); }
-mpc_parser_t *mpc_underscore(void) { return mpc_expect(mpc_char('_'), "underscore"); }
-mpc_parser_t *mpc_alphanum(void) { return mpc_expect(mpc_or(3, mpc_alpha(), mpc_digit(), mpc_underscore()), "alphanumeric"); }
-
-mpc_parser_t *mpc_int(void) { return mpc_expect(mpc_apply(mpc_digits(), mpcf_int), "integer"); }
-mpc_parser_t *mpc_hex(void) { return mpc_expect(mpc_apply(mpc_hexdigits(), mpcf_hex), "hexadecimal"); }
-mpc_parser_t *mpc_oct(void) { return mpc_expect(mpc_apply(mpc_octdigits(), mpcf_oct), "octadecimal"); }
-mpc_parser_t *mpc_number(void) { return mpc_expect(mpc_or(3, mpc_int(), mpc_hex(), mpc_oct()), "number"); }
-
-mpc_parser_t *mpc_real(void) {
-
-  /* [+-]?\d+(\.\d+)?([eE][+-]?[0-9]+)? */
-  
-  mpc_parser_t *p0, *p1, *p2, *p30, *p31, *p32, *p3;
-  
-  p0 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
-  p1 = mpc_digits();
-  p2 = mpc_maybe_lift(mpc_and(2, mpcf_strfold, mpc_char('.'), mpc_digits(), free), mpcf_ctor_str);
-  p30 = mpc_oneof("eE");
-  p31 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
-  p32 = mpc_digits();
-  p3 = mpc_maybe_lift(mpc_and(3, mpcf_strfold, p30, p31, p32, free, free), mpcf_ctor_str);
-  
-  return mpc_expect(mpc_and(4, mpcf_strfold, p0, p1, p2, p3, free, free, free), "real");
-
-}
-
-mpc_parser_t *mpc_float(void) {
-  return mpc_expect(mpc_apply(mpc_real(), mpcf_float), "float");
-}
-
-mpc_parser_t *mpc_char_lit(void) {
-  return mpc_expect(mpc_between(mpc_or(2, mpc_escape(), mpc_any()), free, "'", "'"), "char");
-}
-
-mpc_parser_t *mpc_string_lit(void) {
-  mpc_parser_t *strchar = mpc_or(2, mpc_escape(), mpc_noneof("\""));
-  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, strchar), free, "\"", "\""), "string");
-}
-
-mpc_parser_t *mpc_regex_lit(void) {  
-  mpc_parser_t *regexchar = mpc_or(2, mpc_escape(), mpc_noneof("/"));
-  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, regexchar), free, "/", "/"), "regex");
-}
-
-mpc_parser_t *mpc_ident(void) {
-  mpc_parser_t *p0, *p1; 
-  p0 = mpc_or(2, mpc_alpha(), mpc_underscore());
-  p1 = mpc_many(mpcf_strfold, mpc_alphanum()); 
-  return mpc_and(2, mpcf_strfold, p0, p1, free);
-}
-
-/*
-** Useful Parsers
-*/
-
-mpc_parser_t *mpc_startwith(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_soi(), a, mpcf_dtor_null); }
-mpc_parser_t *mpc_endwith(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(2, mpcf_fst, a, mpc_eoi(), da); }
-mpc_parser_t *mpc_whole(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(3, mpcf_snd, mpc_soi(), a, mpc_eoi(), mpcf_dtor_null, da); }
-
-mpc_parser_t *mpc_stripl(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_blank(), a, mpcf_dtor_null); }
-mpc_parser_t *mpc_stripr(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
-mpc_parser_t *mpc_strip(mpc_parser_t *a) { return mpc_and(3, mpcf_snd, mpc_blank(), a, mpc_blank(), mpcf_dtor_null, mpcf_dtor_null); }
-mpc_parser_t *mpc_tok(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
-mpc_parser_t *mpc_sym(const char *s) { return mpc_tok(mpc_string(s)); }
-
-mpc_parser_t *mpc_total(mpc_parser_t *a, mpc_dtor_t da) { return mpc_whole(mpc_strip(a), da); }
-
-mpc_parser_t *mpc_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
-  return mpc_and(3, mpcf_snd_free,
-    mpc_string(o), a, mpc_string(c),
-    free, ad);
-}
-
-mpc_parser_t *mpc_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "(", ")"); }
-mpc_parser_t *mpc_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "<", ">"); }
-mpc_parser_t *mpc_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_between(a, ad, "{", "}"); }
-mpc_parser_t *mpc_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_between(a, ad, "[", "]"); }
-
-mpc_parser_t *mpc_tok_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
-  return mpc_and(3, mpcf_snd_free,
-    mpc_sym(o), mpc_tok(a), mpc_sym(c),
-    free, ad);
-}
-
-mpc_parser_t *mpc_tok_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "(", ")"); }
-mpc_parser_t *mpc_tok_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "<", ">"); }
-mpc_parser_t *mpc_tok_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_tok_between(a, ad, "{", "}"); }
-mpc_parser_t *mpc_tok_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_tok_between(a, ad, "[", "]"); }
-
-/*
-** Regular Expression Parsers
-*/
-
-/*
-** So here is a cute bootstrapping.
-**
-** I'm using the previously defined
-** mpc constructs and functions to
-** parse the user regex string and
-** construct a parser from it.
-**
-** As it turns out lots of the standard
-** mpc functions look a lot like `fold`
-** functions and so can be used indirectly
-** by many of the parsing functions to build
-** a parser directly - as we are parsing.
-**
-** This is certainly something that
-** would be less elegant/interesting 
-** in a two-phase parser which first
-** builds an AST and then traverses it
-** to generate the object.
-**
-** This whole thing acts as a great
-** case study for how trivial it can be
-** to write a great parser in a few
-** lines of code using mpc.
-*/
-
-/*
-**
-**  ### Regular Expression Grammar
-**
-**      <regex> : <term> | (<term> "|" <regex>)
-**     
-**      <term> : <factor>*
-**
-**      <factor> : <base>
-**               | <base> "*"
-**               | <base> "+"
-**               | <base> "?"
-**               | <base> "{" <digits> "}"
-**           
-**      <base> : <char>
-**             | "\" <char>
-**             | "(" <regex> ")"
-**             | "[" <range> "]"
-*/
-
-static mpc_val_t *mpcf_re_or(int n, mpc_val_t **xs) {
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  else { return mpc_or(2, xs[0], xs[1]); }
-}
-
-static mpc_val_t *mpcf_re_and(int n, mpc_val_t **xs) {
-  int i;
-  mpc_parser_t *p = mpc_lift(mpcf_ctor_str);
-  for (i = 0; i < n; i++) {
-    p = mpc_and(2, mpcf_strfold, p, xs[i], free);
-  }
-  return p;
-}
-
-static mpc_val_t *mpcf_re_repeat(int n, mpc_val_t **xs) {
-  int num;
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  switch(((char*)xs[1])[0])
-  {
-    case '*': { free(xs[1]); return mpc_many(mpcf_strfold, xs[0]); }; break;
-    case '+': { free(xs[1]); return mpc_many1(mpcf_strfold, xs[0]); }; break;
-    case '?': { free(xs[1]); return mpc_maybe_lift(xs[0], mpcf_ctor_str); }; break;
-    default:
-      num = *(int*)xs[1];
-      free(xs[1]);
-  }
-  
-  return mpc_count(num, mpcf_strfold, xs[0], free);
-}
-
-static mpc_parser_t *mpc_re_escape_char(char c) {
-  switch (c) {
-    case 'a': return mpc_char('\a');
-    case 'f': return mpc_char('\f');
-    case 'n': return mpc_char('\n');
-    case 'r': return mpc_char('\r');
-    case 't': return mpc_char('\t');
-    case 'v': return mpc_char('\v');
-    case 'b': return mpc_and(2, mpcf_snd, mpc_boundary(), mpc_lift(mpcf_ctor_str), free);
-    case 'B': return mpc_not_lift(mpc_boundary(), free, mpcf_ctor_str);
-    case 'A': return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free);
-    case 'Z': return mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free);
-    case 'd': return mpc_digit();
-    case 'D': return mpc_not_lift(mpc_digit(), free, mpcf_ctor_str);
-    case 's': return mpc_whitespace();
-    case 'S': return mpc_not_lift(mpc_whitespace(), free, mpcf_ctor_str);
-    case 'w': return mpc_alphanum();
-    case 'W': return mpc_not_lift(mpc_alphanum(), free, mpcf_ctor_str);
-    default: return NULL;
-  }
-}
-
-static mpc_val_t *mpcf_re_escape(mpc_val_t *x) {
-  
-  char *s = x;
-  mpc_parser_t *p;
-  
-  /* Regex Special Characters */
-  if (s[0] == '.') { free(s); return mpc_any(); }
-  if (s[0] == '^') { free(s); return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free); }
-  if (s[0] == '$') { free(s); return mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free); }
-  
-  /* Regex Escape */
-  if (s[0] == '\\') {
-    p = mpc_re_escape_char(s[1]);
-    p = (p == NULL) ? mpc_char(s[1]) : p;
-    free(s);
-    return p;
-  }
-  
-  /* Regex Standard */
-  p = mpc_char(s[0]);
-  free(s);
-  return p;
-}
-
-static const char *mpc_re_range_escape_char(char c) {
-  switch (c) {
-    case '-': return "-";
-    case 'a': return "\a";
-    case 'f': return "\f";
-    case 'n': return "\n";
-    case 'r': return "\r";
-    case 't': return "\t";
-    case 'v': return "\v";
-    case 'b': return "\b";
-    case 'd': return "0123456789";
-    case 's': return " \f\n\r\t\v";
-    case 'w': return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
-    default: return NULL;
-  }
-}
-
-static mpc_val_t *mpcf_re_range(mpc_val_t *x) {
-  
-  mpc_parser_t *out;
-  size_t i, j;
-  size_t start, end;
-  const char *tmp = NULL;
-  const char *s = x;
-  int comp = s[0] == '^' ? 1 : 0;
-  char *range = calloc(1,1);
-  
-  if (s[0] == '\0') { free(x); return mpc_fail("Invalid Regex Range Expression"); } 
-  if (s[0] == '^' && 
-      s[1] == '\0') { free(x); return mpc_fail("Invalid Regex Range Expression"); }
-  
-  for (i = comp; i < strlen(s); i++){
-    
-    /* Regex Range Escape */
-    if (s[i] == '\\') {
-      tmp = mpc_re_range_escape_char(s[i+1]);
-      if (tmp != NULL) {
-        range = realloc(range, strlen(range) + strlen(tmp) + 1);
-        strcat(range, tmp);
-      } else {
-        range = realloc(range, strlen(range) + 1 + 1);
-        range[strlen(range) + 1] = '\0';
-        range[strlen(range) + 0] = s[i+1];      
-      }
-      i++;
-    }
-    
-    /* Regex Range...Range */
-    else if (s[i] == '-') {
-      if (s[i+1] == '\0' || i == 0) {
-          range = realloc(range, strlen(range) + strlen("-") + 1);
-          strcat(range, "-");
-      } else {
-        start = s[i-1]+1;
-        end = s[i+1]-1;
-        for (j = start; j <= end; j++) {
-          range = realloc(range, strlen(range) + 1 + 1 + 1);
-          range[strlen(range) + 1] = '\0';
-          range[strlen(range) + 0] = (char)j;
-        }        
-      }
-    }
-    
-    /* Regex Range Normal */
-    else {
-      range = realloc(range, strlen(range) + 1 + 1);
-      range[strlen(range) + 1] = '\0';
-      range[strlen(range) + 0] = s[i];
-    }
-  
-  }
-  
-  out = comp == 1 ? mpc_noneof(range) : mpc_oneof(range);
-  
-  free(x);
-  free(range);
-  
-  return out;
-}
-
-mpc_parser_t *mpc_re(const char *re) {
-  
-  char *err_msg;
-  mpc_parser_t *err_out;
-  mpc_result_t r;
-  mpc_parser_t *Regex, *Term, *Factor, *Base, *Range, *RegexEnclose; 
-  
-  Regex  = mpc_new("regex");
-  Term   = mpc_new("term");
-  Factor = mpc_new("factor");
-  Base   = mpc_new("base");
-  Range  = mpc_new("range");
-  
-  mpc_define(Regex, mpc_and(2, mpcf_re_or,
-    Term, 
-    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_char('|'), Regex, free)),
-    (mpc_dtor_t)mpc_delete
-  ));
-  
-  mpc_define(Term, mpc_many(mpcf_re_and, Factor));
-  
-  mpc_define(Factor, mpc_and(2, mpcf_re_repeat,
-    Base,
-    mpc_or(5,
-      mpc_char('*'), mpc_char('+'), mpc_char('?'),
-      mpc_brackets(mpc_int(), free),
-      mpc_pass()),
-    (mpc_dtor_t)mpc_delete
-  ));
-  
-  mpc_define(Base, mpc_or(4,
-    mpc_parens(Regex, (mpc_dtor_t)mpc_delete),
-    mpc_squares(Range, (mpc_dtor_t)mpc_delete),
-    mpc_apply(mpc_escape(), mpcf_re_escape),
-    mpc_apply(mpc_noneof(")|"), mpcf_re_escape)
-  ));
-  
-  mpc_define(Range, mpc_apply(
-    mpc_many(mpcf_strfold, mpc_or(2, mpc_escape(), mpc_noneof("]"))),
-    mpcf_re_range
-  ));
-  
-  RegexEnclose = mpc_whole(mpc_predictive(Regex), (mpc_dtor_t)mpc_delete);
-  
-  mpc_optimise(RegexEnclose);
-  mpc_optimise(Regex);
-  mpc_optimise(Term);
-  mpc_optimise(Factor);
-  mpc_optimise(Base);
-  mpc_optimise(Range);
-  
-  if(!mpc_parse("<mpc_re_compiler>", re, RegexEnclose, &r)) {
-    err_msg = mpc_err_string(r.error);
-    err_out = mpc_failf("Invalid Regex: %s", err_msg);
-    mpc_err_delete(r.error);  
-    free(err_msg);
-    r.output = err_out;
-  }
-  
-  mpc_cleanup(6, RegexEnclose, Regex, Term, Factor, Base, Range);
-  
-  mpc_optimise(r.output);
-  
-  return r.output;
-  
-}
-
-/*
-** Common Fold Functions
-*/
-
-void mpcf_dtor_null(mpc_val_t *x) { (void) x; return; }
-
-mpc_val_t *mpcf_ctor_null(void) { return NULL; }
-mpc_val_t *mpcf_ctor_str(void) { return calloc(1, 1); }
-mpc_val_t *mpcf_free(mpc_val_t *x) { free(x); return NULL; }
-
-mpc_val_t *mpcf_int(mpc_val_t *x) {
-  int *y = malloc(sizeof(int));
-  *y = strtol(x, NULL, 10);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_hex(mpc_val_t *x) {
-  int *y = malloc(sizeof(int));
-  *y = strtol(x, NULL, 16);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_oct(mpc_val_t *x) {
-  int *y = malloc(sizeof(int));
-  *y = strtol(x, NULL, 8);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_float(mpc_val_t *x) {
-  float *y = malloc(sizeof(float));
-  *y = strtod(x, NULL);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_strtriml(mpc_val_t *x) {
-  char *s = x;
-  while (isspace(*s)) {
-    memmove(s, s+1, strlen(s));
-  }
-  return s;
-}
-
-mpc_val_t *mpcf_strtrimr(mpc_val_t *x) {
-  char *s = x;
-  size_t l = strlen(s);
-  while (isspace(s[l-1])) {
-    s[l-1] = '\0'; l--;
-  }
-  return s;
-}
-
-mpc_val_t *mpcf_strtrim(mpc_val_t *x) {
-  return mpcf_strtriml(mpcf_strtrimr(x));
-}
-
-static const char mpc_escape_input_c[]  = {
-  '\a', '\b', '\f', '\n', '\r',
-  '\t', '\v', '\\', '\'', '\"', '\0'};
-    
-static const char *mpc_escape_output_c[] = {
-  "\\a", "\\b", "\\f", "\\n", "\\r", "\\t", 
-  "\\v", "\\\\", "\\'", "\\\"", "\\0", NULL};
-
-static const char mpc_escape_input_raw_re[] = { '/' };
-static const char *mpc_escape_output_raw_re[] = { "\\/", NULL };
-
-static const char mpc_escape_input_raw_cstr[] = { '"' };
-static const char *mpc_escape_output_raw_cstr[] = { "\\\"", NULL };
-
-static const char mpc_escape_input_raw_cchar[] = { '\'' };
-static const char *mpc_escape_output_raw_cchar[] = { "\\'", NULL };
-
-static mpc_val_t *mpcf_escape_new(mpc_val_t *x, const char *input, const char **output) {
-  
-  int i;
-  int found;
-  char buff[2];
-  char *s = x;
-  char *y = calloc(1, 1);
-  
-  while (*s) {
-    
-    i = 0;
-    found = 0;
-
-    while (output[i]) {
-      if (*s == input[i]) {
-        y = realloc(y, strlen(y) + strlen(output[i]) + 1);
-        strcat(y, output[i]);
-        found = 1;
-        break;
-      }
-      i++;
-    }
-    
-    if (!found) {
-      y = realloc(y, strlen(y) + 2);
-      buff[0] = *s; buff[1] = '\0';
-      strcat(y, buff);
-    }
-    
-    s++;
-  }
-  
-  
-  return y;
-}
-
-static mpc_val_t *mpcf_unescape_new(mpc_val_t *x, const char *input, const char **output) {
-  
-  int i;
-  int found = 0;
-  char buff[2];
-  char *s = x;
-  char *y = calloc(1, 1);
-  
-  while (*s) {
-    
-    i = 0;
-    found = 0;
-    
-    while (output[i]) {
-      if ((*(s+0)) == output[i][0] &&
-          (*(s+1)) == output[i][1]) {
-        y = realloc(y, strlen(y) + 1 + 1);
-        buff[0] = input[i]; buff[1] = '\0';
-        strcat(y, buff);
-        found = 1;
-        s++;
-        break;
-      }
-      i++;
-    }
-    
-    if (!found) {
-      y = realloc(y, strlen(y) + 1 + 1);
-      buff[0] = *s; buff[1] = '\0';
-      strcat(y, buff);
-    }
-    
-    if (*s == '\0') { break; }
-    else { s++; }
-  }
-  
-  return y;
-  
-}
-
-mpc_val_t *mpcf_escape(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_c, mpc_escape_output_c);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_c, mpc_escape_output_c);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_escape_regex(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
-  free(x);
-  return y;  
-}
-
-mpc_val_t *mpcf_unescape_regex(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
-  free(x);
-  return y;  
-}
-
-mpc_val_t *mpcf_escape_string_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape_string_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_escape_char_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_unescape_char_raw(mpc_val_t *x) {
-  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
-  free(x);
-  return y;
-}
-
-mpc_val_t *mpcf_null(int n, mpc_val_t** xs) { (void) n; (void) xs; return NULL; }
-mpc_val_t *mpcf_fst(int n, mpc_val_t **xs) { (void) n; return xs[0]; }
-mpc_val_t *mpcf_snd(int n, mpc_val_t **xs) { (void) n; return xs[1]; }
-mpc_val_t *mpcf_trd(int n, mpc_val_t **xs) { (void) n; return xs[2]; }
-
-static mpc_val_t *mpcf_nth_free(int n, mpc_val_t **xs, int x) {
-  int i;
-  for (i = 0; i < n; i++) {
-    if (i != x) { free(xs[i]); }
-  }
-  return xs[x];
-}
- 
-mpc_val_t *mpcf_fst_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 0); }
-mpc_val_t *mpcf_snd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 1); }
-mpc_val_t *mpcf_trd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 2); }
-
-mpc_val_t *mpcf_strfold(int n, mpc_val_t **xs) {
-  int i;
-  size_t l = 0;
-  
-  if (n == 0) { return calloc(1, 1); }
-  
-  for (i = 0; i < n; i++) { l += strlen(xs[i]); }
-  
-  xs[0] = realloc(xs[0], l + 1);
-  
-  for (i = 1; i < n; i++) {
-    strcat(xs[0], xs[i]); free(xs[i]);
-  }
-  
-  return xs[0];
-}
-
-mpc_val_t *mpcf_maths(int n, mpc_val_t **xs) {
-  int **vs = (int**)xs;
-  (void) n;
-  
-  switch(((char*)xs[1])[0])
-  {
-    case '*': { *vs[0] *= *vs[2]; }; break;
-    case '/': { *vs[0] /= *vs[2]; }; break;
-    case '%': { *vs[0] %= *vs[2]; }; break;
-    case '+': { *vs[0] += *vs[2]; }; break;
-    case '-': { *vs[0] -= *vs[2]; }; break;
-    default: break;
-  }
-  
-  free(xs[1]); free(xs[2]);
-  
-  return xs[0];
-}
-
-/*
-** Printing
-*/
-
-static void mpc_print_unretained(mpc_parser_t *p, int force) {
-  
-  /* TODO: Print Everything Escaped */
-  
-  int i;
-  char *s, *e;
-  char buff[2];
-  
-  if (p->retained && !force) {;
-    if (p->name) { printf("<%s>", p->name); }
-    else { printf("<anon>"); }
-    return;
-  }
-  
-  if (p->type == MPC_TYPE_UNDEFINED) { printf("<?>"); }
-  if (p->type == MPC_TYPE_PASS)   { printf("<:>"); }
-  if (p->type == MPC_TYPE_FAIL)   { printf("<!>"); }
-  if (p->type == MPC_TYPE_LIFT)   { printf("<#>"); }
-  if (p->type == MPC_TYPE_STATE)  { printf("<S>"); }
-  if (p->type == MPC_TYPE_ANCHOR) { printf("<@>"); }
-  if (p->type == MPC_TYPE_EXPECT) {
-    printf("%s", p->data.expect.m);
-    /*mpc_print_unretained(p->data.expect.x, 0);*/
-  }
-  
-  if (p->type == MPC_TYPE_ANY) { printf("<.>"); }
-  if (p->type == MPC_TYPE_SATISFY) { printf("<f>"); }
-
-  if (p->type == MPC_TYPE_SINGLE) {
-    buff[0] = p->data.single.x; buff[1] = '\0';
-    s = mpcf_escape_new(
-      buff,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("'%s'", s);
-    free(s);
-  }
-  
-  if (p->type == MPC_TYPE_RANGE) {
-    buff[0] = p->data.range.x; buff[1] = '\0';
-    s = mpcf_escape_new(
-      buff,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    buff[0] = p->data.range.y; buff[1] = '\0';
-    e = mpcf_escape_new(
-      buff,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("[%s-%s]", s, e);
-    free(s);
-    free(e);
-  }
-  
-  if (p->type == MPC_TYPE_ONEOF) {
-    s = mpcf_escape_new(
-      p->data.string.x,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("[%s]", s);
-    free(s);
-  }
-  
-  if (p->type == MPC_TYPE_NONEOF) {
-    s = mpcf_escape_new(
-      p->data.string.x,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("[^%s]", s);
-    free(s);
-  }
-  
-  if (p->type == MPC_TYPE_STRING) {
-    s = mpcf_escape_new(
-      p->data.string.x,
-      mpc_escape_input_c,
-      mpc_escape_output_c);
-    printf("\"%s\"", s);
-    free(s);
-  }
-  
-  if (p->type == MPC_TYPE_APPLY)    { mpc_print_unretained(p->data.apply.x, 0); }
-  if (p->type == MPC_TYPE_APPLY_TO) { mpc_print_unretained(p->data.apply_to.x, 0); }
-  if (p->type == MPC_TYPE_PREDICT)  { mpc_print_unretained(p->data.predict.x, 0); }
-
-  if (p->type == MPC_TYPE_NOT)   { mpc_print_unretained(p->data.not.x, 0); printf("!"); }
-  if (p->type == MPC_TYPE_MAYBE) { mpc_print_unretained(p->data.not.x, 0); printf("?"); }
-
-  if (p->type == MPC_TYPE_MANY)  { mpc_print_unretained(p->data.repeat.x, 0); printf("*"); }
-  if (p->type == MPC_TYPE_MANY1) { mpc_print_unretained(p->data.repeat.x, 0); printf("+"); }
-  if (p->type == MPC_TYPE_COUNT) { mpc_print_unretained(p->data.repeat.x, 0); printf("{%i}", p->data.repeat.n); }
-  
-  if (p->type == MPC_TYPE_OR) {
-    printf("(");
-    for(i = 0; i < p->data.or.n-1; i++) {
-      mpc_print_unretained(p->data.or.xs[i], 0);
-      printf(" | ");
-    }
-    mpc_print_unretained(p->data.or.xs[p->data.or.n-1], 0);
-    printf(")");
-  }
-  
-  if (p->type == MPC_TYPE_AND) {
-    printf("(");
-    for(i = 0; i < p->data.and.n-1; i++) {
-      mpc_print_unretained(p->data.and.xs[i], 0);
-      printf(" ");
-    }
-    mpc_print_unretained(p->data.and.xs[p->data.and.n-1], 0);
-    printf(")");
-  }
-  
-}
-
-void mpc_print(mpc_parser_t *p) {
-  mpc_print_unretained(p, 1);
-  printf("\n");
-}
-
-/*
-** Testing
-*/
-
-/*
-** These functions are slightly unwieldy and
-** also the whole of the testing suite for mpc
-** mpc is pretty shaky.
-**
-** It could do with a lot more tests and more
-** precision. Currently I am only really testing
-** changes off of the examples.
-**
-*/
-
-int mpc_test_fail(mpc_parser_t *p, const char *s, const void *d,
-  int(*tester)(const void*, const void*),
-  mpc_dtor_t destructor,
-  void(*printer)(const void*)) {
-  mpc_result_t r;
-  (void) printer;
-  if (mpc_parse("<test>", s, p, &r)) {
-
-    if (tester(r.output, d)) {
-      destructor(r.output);
-      return 0;
-    } else {
-      destructor(r.output);
-      return 1;
-    }
-  
-  } else {
-    mpc_err_delete(r.error);
-    return 1;
-  }
-  
-}
-
-int mpc_test_pass(mpc_parser_t *p, const char *s, const void *d,
-  int(*tester)(const void*, const void*), 
-  mpc_dtor_t destructor, 
-  void(*printer)(const void*)) {
-
-  mpc_result_t r;  
-  if (mpc_parse("<test>", s, p, &r)) {
-    
-    if (tester(r.output, d)) {
-      destructor(r.output);
-      return 1;
-    } else {
-      printf("Got "); printer(r.output); printf("\n");
-      printf("Expected "); printer(d); printf("\n");
-      destructor(r.output);
-      return 0;
-    }
-    
-  } else {    
-    mpc_err_print(r.error);
-    mpc_err_delete(r.error);
-    return 0;
-    
-  }
-  
-}
-
-
-/*
-** AST
-*/
-
-void mpc_ast_delete(mpc_ast_t *a) {
-  
-  int i;
-  
-  if (a == NULL) { return; }
-  
-  for (i = 0; i < a->children_num; i++) {
-    mpc_ast_delete(a->children[i]);
-  }
-  
-  free(a->children);
-  free(a->tag);
-  free(a->contents);
-  free(a);
-  
-}
-
-static void mpc_ast_delete_no_children(mpc_ast_t *a) {
-  free(a->children);
-  free(a->tag);
-  free(a->contents);
-  free(a);
-}
-
-mpc_ast_t *mpc_ast_new(const char *tag, const char *contents) {
-  
-  mpc_ast_t *a = malloc(sizeof(mpc_ast_t));
-  
-  a->tag = malloc(strlen(tag) + 1);
-  strcpy(a->tag, tag);
-  
-  a->contents = malloc(strlen(contents) + 1);
-  strcpy(a->contents, contents);
-  
-  a->state = mpc_state_new();
-  
-  a->children_num = 0;
-  a->children = NULL;
-  return a;
-  
-}
-
-mpc_ast_t *mpc_ast_build(int n, const char *tag, ...) {
-  
-  mpc_ast_t *a = mpc_ast_new(tag, "");
-  
-  int i;
-  va_list va;
-  va_start(va, tag);
-  
-  for (i = 0; i < n; i++) {
-    mpc_ast_add_child(a, va_arg(va, mpc_ast_t*));
-  }
-  
-  va_end(va);
-  
-  return a;
-  
-}
-
-mpc_ast_t *mpc_ast_add_root(mpc_ast_t *a) {
-
-  mpc_ast_t *r;
-
-  if (a == NULL) { return a; }
-  if (a->children_num == 0) { return a; }
-  if (a->children_num == 1) { return a; }
-
-  r = mpc_ast_new(">", "");
-  mpc_ast_add_child(r, a);
-  return r;
-}
-
-int mpc_ast_eq(mpc_ast_t *a, mpc_ast_t *b) {
-  
-  int i;
-
-  if (strcmp(a->tag, b->tag) != 0) { return 0; }
-  if (strcmp(a->contents, b->contents) != 0) { return 0; }
-  if (a->children_num != b->children_num) { return 0; }
-  
-  for (i = 0; i < a->children_num; i++) {
-    if (!mpc_ast_eq(a->children[i], b->children[i])) { return 0; }
-  }
-  
-  return 1;
-}
-
-mpc_ast_t *mpc_ast_add_child(mpc_ast_t *r, mpc_ast_t *a) {
-  r->children_num++;
-  r->children = realloc(r->children, sizeof(mpc_ast_t*) * r->children_num);
-  r->children[r->children_num-1] = a;
-  return r;
-}
-
-mpc_ast_t *mpc_ast_add_tag(mpc_ast_t *a, const char *t) {
-  if (a == NULL) { return a; }
-  a->tag = realloc(a->tag, strlen(t) + 1 + strlen(a->tag) + 1);
-  memmove(a->tag + strlen(t) + 1, a->tag, strlen(a->tag)+1);
-  memmove(a->tag, t, strlen(t));
-  memmove(a->tag + strlen(t), "|", 1);
-  return a;
-}
-
-mpc_ast_t *mpc_ast_add_root_tag(mpc_ast_t *a, const char *t) {
-  if (a == NULL) { return a; }
-  a->tag = realloc(a->tag, (strlen(t)-1) + strlen(a->tag) + 1);
-  memmove(a->tag + (strlen(t)-1), a->tag, strlen(a->tag)+1);
-  memmove(a->tag, t, (strlen(t)-1));
-  return a;
-}
-
-mpc_ast_t *mpc_ast_tag(mpc_ast_t *a, const char *t) {
-  a->tag = realloc(a->tag, strlen(t) + 1);
-  strcpy(a->tag, t);
-  return a;
-}
-
-mpc_ast_t *mpc_ast_state(mpc_ast_t *a, mpc_state_t s) {
-  if (a == NULL) { return a; }
-  a->state = s;
-  return a;
-}
-
-static void mpc_ast_print_depth(mpc_ast_t *a, int d, FILE *fp) {
-  
-  int i;
-  
-  if (a == NULL) {
-    fprintf(fp, "NULL\n");
-    return;
-  }
-  
-  for (i = 0; i < d; i++) { fprintf(fp, "  "); }
-  
-  if (strlen(a->contents)) {
-    fprintf(fp, "%s:%lu:%lu '%s'\n", a->tag, 
-      (long unsigned int)(a->state.row+1),
-      (long unsigned int)(a->state.col+1),
-      a->contents);
-  } else {
-    fprintf(fp, "%s \n", a->tag);
-  }
-  
-  for (i = 0; i < a->children_num; i++) {
-    mpc_ast_print_depth(a->children[i], d+1, fp);
-  }
-  
-}
-
-void mpc_ast_print(mpc_ast_t *a) {
-  mpc_ast_print_depth(a, 0, stdout);
-}
-
-void mpc_ast_print_to(mpc_ast_t *a, FILE *fp) {
-  mpc_ast_print_depth(a, 0, fp);
-}
-
-int mpc_ast_get_index(mpc_ast_t *ast, const char *tag) {
-  return mpc_ast_get_index_lb(ast, tag, 0);
-}
-
-int mpc_ast_get_index_lb(mpc_ast_t *ast, const char *tag, int lb) {
-  int i;
-
-  for(i=lb; i<ast->children_num; i++) {
-    if(strcmp(ast->children[i]->tag, tag) == 0) {
-      return i;
-    }
-  }
-
-  return -1;
-}
-
-mpc_ast_t *mpc_ast_get_child(mpc_ast_t *ast, const char *tag) {
-  return mpc_ast_get_child_lb(ast, tag, 0);
-}
-
-mpc_ast_t *mpc_ast_get_child_lb(mpc_ast_t *ast, const char *tag, int lb) {
-  int i;
-
-  for(i=lb; i<ast->children_num; i++) {
-    if(strcmp(ast->children[i]->tag, tag) == 0) {
-      return ast->children[i];
-    }
-  }
-
-  return NULL;
-}
-
-mpc_ast_trav_t *mpc_ast_traverse_start(mpc_ast_t *ast,
-                                       mpc_ast_trav_order_t order)
-{
-  mpc_ast_trav_t *trav, *n_trav;
-  mpc_ast_t *cnode = ast;
-
-  /* Create the traversal structure */
-  trav = malloc(sizeof(mpc_ast_trav_t));
-  trav->curr_node = cnode;
-  trav->parent = NULL;
-  trav->curr_child = 0;
-  trav->order = order;
-
-  /* Get start node */
-  switch(order) {
-    case mpc_ast_trav_order_pre:
-      /* Nothing else is needed for pre order start */
-      break;
-
-    case mpc_ast_trav_order_post:
-      while(cnode->children_num > 0) {
-        cnode = cnode->children[0];
-
-        n_trav = malloc(sizeof(mpc_ast_trav_t));
-        n_trav->curr_node = cnode;
-        n_trav->parent = trav;
-        n_trav->curr_child = 0;
-        n_trav->order = order;
-
-        trav = n_trav;
-      }
-
-      break;
-
-    default:
-      /* Unreachable, but compiler complaints */
-      break;
-  }
-
-  return trav;
-}
-
-mpc_ast_t *mpc_ast_traverse_next(mpc_ast_trav_t **trav) {
-  mpc_ast_trav_t *n_trav, *to_free;
-  mpc_ast_t *ret = NULL;
-  int cchild;
-
-  /* The end of traversal was reached */
-  if(*trav == NULL) return NULL;
-
-  switch((*trav)->order) {
-    case mpc_ast_trav_order_pre:
-      ret = (*trav)->curr_node;
-
-      /* If there aren't any more children, go up */
-      while(*trav != NULL &&
-        (*trav)->curr_child >= (*trav)->curr_node->children_num)
-      {
-        to_free = *trav;
-        *trav = (*trav)->parent;
-        free(to_free);
-      }
-
-      /* If trav is NULL, the end was reached */
-      if(*trav == NULL) {
-        break;
-      }
-
-      /* Go to next child */
-      n_trav = malloc(sizeof(mpc_ast_trav_t));
-
-      cchild = (*trav)->curr_child;
-      n_trav->curr_node = (*trav)->curr_node->children[cchild];
-      n_trav->parent = *trav;
-      n_trav->curr_child = 0;
-      n_trav->order = (*trav)->order;
-
-      (*trav)->curr_child++;
-      *trav = n_trav;
-
-      break;
-
-    case mpc_ast_trav_order_post:
-      ret = (*trav)->curr_node;
-
-      /* Move up tree to the parent If the parent doesn't have any more nodes,
-       * then this is the current node. If it does, move down to its left most
-       * child. Also, free the previous traversal node */
-      to_free = *trav;
-      *trav = (*trav)->parent;
-      free(to_free);
-
-      if(*trav == NULL)
-        break;
-
-      /* Next child */
-      (*trav)->curr_child++;
-
-      /* If there aren't any more children, this is the next node */
-      if((*trav)->curr_child >= (*trav)->curr_node->children_num) {
-        break;
-      }
-
-      /* If there are still more children, find the leftmost child from this
-       * node */
-      while((*trav)->curr_node->children_num > 0) {
-        n_trav = malloc(sizeof(mpc_ast_trav_t));
-
-        cchild = (*trav)->curr_child;
-        n_trav->curr_node = (*trav)->curr_node->children[cchild];
-        n_trav->parent = *trav;
-        n_trav->curr_child = 0;
-        n_trav->order = (*trav)->order;
-
-        *trav = n_trav;
-      }
-
-    default:
-      /* Unreachable, but compiler complaints */
-      break;
-  }
-
-  return ret;
-}
-
-void mpc_ast_traverse_free(mpc_ast_trav_t **trav) {
-  mpc_ast_trav_t *n_trav;
-
-  /* Go through parents until all are free */
-  while(*trav != NULL) {
-      n_trav = (*trav)->parent;
-      free(*trav);
-      *trav = n_trav;
-  }
-}
-
-mpc_val_t *mpcf_fold_ast(int n, mpc_val_t **xs) {
-  
-  int i, j;
-  mpc_ast_t** as = (mpc_ast_t**)xs;
-  mpc_ast_t *r;
-  
-  if (n == 0) { return NULL; }
-  if (n == 1) { return xs[0]; }
-  if (n == 2 && xs[1] == NULL) { return xs[0]; }
-  if (n == 2 && xs[0] == NULL) { return xs[1]; }
-  
-  r = mpc_ast_new(">", "");
-  
-  for (i = 0; i < n; i++) {
-    
-    if (as[i] == NULL) { continue; }
-    
-    if        (as[i] && as[i]->children_num == 0) {
-      mpc_ast_add_child(r, as[i]);
-    } else if (as[i] && as[i]->children_num == 1) {
-      mpc_ast_add_child(r, mpc_ast_add_root_tag(as[i]->children[0], as[i]->tag));
-      mpc_ast_delete_no_children(as[i]);
-    } else if (as[i] && as[i]->children_num >= 2) {
-      for (j = 0; j < as[i]->children_num; j++) {
-        mpc_ast_add_child(r, as[i]->children[j]);
-      }
-      mpc_ast_delete_no_children(as[i]);
-    }
-  
-  }
-  
-  if (r->children_num) {
-    r->state = r->children[0]->state;
-  }
-  
-  return r;
-}
-
-mpc_val_t *mpcf_str_ast(mpc_val_t *c) {
-  mpc_ast_t *a = mpc_ast_new("", c);
-  free(c);
-  return a;
-}
-
-mpc_val_t *mpcf_state_ast(int n, mpc_val_t **xs) {
-  mpc_state_t *s = ((mpc_state_t**)xs)[0];
-  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
-  (void)n;
-  a = mpc_ast_state(a, *s);
-  free(s);
-  return a;
-}
-
-mpc_parser_t *mpca_state(mpc_parser_t *a) {
-  return mpc_and(2, mpcf_state_ast, mpc_state(), a, free);
-}
-
-mpc_parser_t *mpca_tag(mpc_parser_t *a, const char *t) {
-  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_tag, (void*)t);
-}
-
-mpc_parser_t *mpca_add_tag(mpc_parser_t *a, const char *t) {
-  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_add_tag, (void*)t);
-}
-
-mpc_parser_t *mpca_root(mpc_parser_t *a) {
-  return mpc_apply(a, (mpc_apply_t)mpc_ast_add_root);
-}
-
-mpc_parser_t *mpca_not(mpc_parser_t *a) { return mpc_not(a, (mpc_dtor_t)mpc_ast_delete); }
-mpc_parser_t *mpca_maybe(mpc_parser_t *a) { return mpc_maybe(a); }
-mpc_parser_t *mpca_many(mpc_parser_t *a) { return mpc_many(mpcf_fold_ast, a); }
-mpc_parser_t *mpca_many1(mpc_parser_t *a) { return mpc_many1(mpcf_fold_ast, a); }
-mpc_parser_t *mpca_count(int n, mpc_parser_t *a) { return mpc_count(n, mpcf_fold_ast, a, (mpc_dtor_t)mpc_ast_delete); }
-
-mpc_parser_t *mpca_or(int n, ...) {
-
-  int i;
-  va_list va;
-
-  mpc_parser_t *p = mpc_undefined();
-  
-  p->type = MPC_TYPE_OR;
-  p->data.or.n = n;
-  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
-  
-  va_start(va, n);  
-  for (i = 0; i < n; i++) {
-    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  va_end(va);
-  
-  return p;
-  
-}
-
-mpc_parser_t *mpca_and(int n, ...) {
-  
-  int i;
-  va_list va;
-  
-  mpc_parser_t *p = mpc_undefined();
-  
-  p->type = MPC_TYPE_AND;
-  p->data.and.n = n;
-  p->data.and.f = mpcf_fold_ast;
-  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
-  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
-  
-  va_start(va, n);
-  for (i = 0; i < n; i++) {
-    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
-  }
-  for (i = 0; i < (n-1); i++) {
-    p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete;
-  }    
-  va_end(va);
-  
-  return p;  
-}
-
-mpc_parser_t *mpca_total(mpc_parser_t *a) { return mpc_total(a, (mpc_dtor_t)mpc_ast_delete); }
-
-/*
-** Grammar Parser
-*/
-
-/*
-** This is another interesting bootstrapping.
-**
-** Having a general purpose AST type allows
-** users to specify the grammar alone and
-** let all fold rules be automatically taken
-** care of by existing functions.
-**
-** You don't get to control the type spat
-** out but this means you can make a nice
-** parser to take in some grammar in nice
-** syntax and spit out a parser that works.
-**
-** The grammar for this looks surprisingly
-** like regex but the main difference is that
-** it is now whitespace insensitive and the
-** base type takes literals of some form.
-*/
-
-/*
-**
-**  ### Grammar Grammar
-**
-**      <grammar> : (<term> "|" <grammar>) | <term>
-**     
-**      <term> : <factor>*
-**
-**      <factor> : <base>
-**               | <base> "*"
-**               | <base> "+"
-**               | <base> "?"
-**               | <base> "{" <digits> "}"
-**           
-**      <base> : "<" (<digits> | <ident>) ">"
-**             | <string_lit>
-**             | <char_lit>
-**             | <regex_lit>
-**             | "(" <grammar> ")"
-*/
-
-typedef struct {
-  va_list *va;
-  int parsers_num;
-  mpc_parser_t **parsers;
-  int flags;
-} mpca_grammar_st_t;
-
-static mpc_val_t *mpcaf_grammar_or(int n, mpc_val_t **xs) {
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  else { return mpca_or(2, xs[0], xs[1]); }
-}
-
-static mpc_val_t *mpcaf_grammar_and(int n, mpc_val_t **xs) {
-  int i;
-  mpc_parser_t *p = mpc_pass();  
-  for (i = 0; i < n; i++) {
-    if (xs[i] != NULL) { p = mpca_and(2, p, xs[i]); }
-  }
-  return p;
-}
-
-static mpc_val_t *mpcaf_grammar_repeat(int n, mpc_val_t **xs) { 
-  int num;
-  (void) n;
-  if (xs[1] == NULL) { return xs[0]; }
-  switch(((char*)xs[1])[0])
-  {
-    case '*': { free(xs[1]); return mpca_many(xs[0]); }; break;
-    case '+': { free(xs[1]); return mpca_many1(xs[0]); }; break;
-    case '?': { free(xs[1]); return mpca_maybe(xs[0]); }; break;
-    case '!': { free(xs[1]); return mpca_not(xs[0]); }; break;
-    default:
-      num = *((int*)xs[1]);
-      free(xs[1]);
-  }
-  return mpca_count(num, xs[0]);
-}
-
-static mpc_val_t *mpcaf_grammar_string(mpc_val_t *x, void *s) {
-  mpca_grammar_st_t *st = s;
-  char *y = mpcf_unescape(x);
-  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_string(y) : mpc_tok(mpc_string(y));
-  free(y);
-  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "string"));
-}
-
-static mpc_val_t *mpcaf_grammar_char(mpc_val_t *x, void *s) {
-  mpca_grammar_st_t *st = s;
-  char *y = mpcf_unescape(x);
-  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_char(y[0]) : mpc_tok(mpc_char(y[0]));
-  free(y);
-  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "char"));
-}
-
-static mpc_val_t *mpcaf_grammar_regex(mpc_val_t *x, void *s) {
-  mpca_grammar_st_t *st = s;
-  char *y = mpcf_unescape_regex(x);
-  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_re(y) : mpc_tok(mpc_re(y));
-  free(y);
-  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "regex"));
-}
-
-/* Should this just use `isdigit` instead? */
-static int is_number(const char* s) {
-  size_t i;
-  for (i = 0; i < strlen(s); i++) { if (!strchr("0123456789", s[i])) { return 0; } }
-  return 1;
-}
-
-static mpc_parser_t *mpca_grammar_find_parser(char *x, mpca_grammar_st_t *st) {
-  
-  int i;
-  mpc_parser_t *p;
-  
-  /* Case of Number */
-  if (is_number(x)) {
-
-    i = strtol(x, NULL, 10);
-    
-    while (st->parsers_num <= i) {
-      st->parsers_num++;
-      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
-      st->parsers[st->parsers_num-1] = va_arg(*st->va, mpc_parser_t*);
-      if (st->parsers[st->parsers_num-1] == NULL) {
-        return mpc_failf("No Parser in position %i! Only supplied %i Parsers!", i, st->parsers_num);
-      }
-    }
-    
-    return st->parsers[st->parsers_num-1];
-  
-  /* Case of Identifier */
-  } else {
-    
-    /* Search Existing Parsers */
-    for (i = 0; i < st->parsers_num; i++) {
-      mpc_parser_t *q = st->parsers[i];
-      if (q == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
-      if (q->name && strcmp(q->name, x) == 0) { return q; }
-    }
-    
-    /* Search New Parsers */
-    while (1) {
-    
-      p = va_arg(*st->va, mpc_parser_t*);
-      
-      st->parsers_num++;
-      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
-      st->parsers[st->parsers_num-1] = p;
-      
-      if (p == NULL || p->name == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
-      if (p->name && strcmp(p->name, x) == 0) { return p; }
-      
-    }
-  
-  }  
-  
-}
-
-static mpc_val_t *mpcaf_grammar_id(mpc_val_t *x, void *s) {
-  
-  mpca_grammar_st_t *st = s;
-  mpc_parser_t *p = mpca_grammar_find_parser(x, st);
-  free(x);
-
-  if (p->name) {
-    return mpca_state(mpca_root(mpca_add_tag(p, p->name)));
-  } else {
-    return mpca_state(mpca_root(p));
-  }
-}
-
-mpc_parser_t *mpca_grammar_st(const char *grammar, mpca_grammar_st_t *st) {
-  
-  char *err_msg;
-  mpc_parser_t *err_out;
-  mpc_result_t r;
-  mpc_parser_t *GrammarTotal, *Grammar, *Term, *Factor, *Base;
-  
-  GrammarTotal = mpc_new("grammar_total");
-  Grammar = mpc_new("grammar");
-  Term = mpc_new("term");
-  Factor = mpc_new("factor");
-  Base = mpc_new("base");
-  
-  mpc_define(GrammarTotal,
-    mpc_predictive(mpc_total(Grammar, mpc_soft_delete))
-  );
-  
-  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
-    Term,
-    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
-    mpc_soft_delete
-  ));
-  
-  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
-  
-  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
-    Base,
-      mpc_or(6,
-        mpc_sym("*"),
-        mpc_sym("+"),
-        mpc_sym("?"),
-        mpc_sym("!"),
-        mpc_tok_brackets(mpc_int(), free),
-        mpc_pass()),
-    mpc_soft_delete
-  ));
-  
-  mpc_define(Base, mpc_or(5,
-    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
-    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
-    mpc_apply_to(mpc_tok(mpc_regex_lit()),  mpcaf_grammar_regex, st),
-    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
-    mpc_tok_parens(Grammar, mpc_soft_delete)
-  ));
-  
-  mpc_optimise(GrammarTotal);
-  mpc_optimise(Grammar);
-  mpc_optimise(Factor);
-  mpc_optimise(Term);
-  mpc_optimise(Base);
-  
-  if(!mpc_parse("<mpc_grammar_compiler>", grammar, GrammarTotal, &r)) {
-    err_msg = mpc_err_string(r.error);
-    err_out = mpc_failf("Invalid Grammar: %s", err_msg);
-    mpc_err_delete(r.error);
-    free(err_msg);
-    r.output = err_out;
-  }
-  
-  mpc_cleanup(5, GrammarTotal, Grammar, Term, Factor, Base);
-  
-  mpc_optimise(r.output);
-  
-  return (st->flags & MPCA_LANG_PREDICTIVE) ? mpc_predictive(r.output) : r.output;
-  
-}
-
-mpc_parser_t *mpca_grammar(int flags, const char *grammar, ...) {
-  mpca_grammar_st_t st;
-  mpc_parser_t *res;
-  va_list va;
-  va_start(va, grammar);
-  
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-  
-  res = mpca_grammar_st(grammar, &st);  
-  free(st.parsers);
-  va_end(va);
-  return res;
-}
-
-typedef struct {
-  char *ident;
-  char *name;
-  mpc_parser_t *grammar;
-} mpca_stmt_t;
-
-static mpc_val_t *mpca_stmt_afold(int n, mpc_val_t **xs) {
-  mpca_stmt_t *stmt = malloc(sizeof(mpca_stmt_t));
-  stmt->ident = ((char**)xs)[0];
-  stmt->name = ((char**)xs)[1];
-  stmt->grammar = ((mpc_parser_t**)xs)[3];
-  (void) n;
-  free(((char**)xs)[2]);
-  free(((char**)xs)[4]);
-  
-  return stmt;
-}
-
-static mpc_val_t *mpca_stmt_fold(int n, mpc_val_t **xs) {
-  
-  int i;
-  mpca_stmt_t **stmts = malloc(sizeof(mpca_stmt_t*) * (n+1));
-  
-  for (i = 0; i < n; i++) {
-    stmts[i] = xs[i];
-  }
-  stmts[n] = NULL;  
-  
-  return stmts;
-}
-
-static void mpca_stmt_list_delete(mpc_val_t *x) {
-
-  mpca_stmt_t **stmts = x;
-
-  while(*stmts) {
-    mpca_stmt_t *stmt = *stmts; 
-    free(stmt->ident);
-    free(stmt->name);
-    mpc_soft_delete(stmt->grammar);
-    free(stmt);  
-    stmts++;
-  }
-  free(x);
-
-}
-
-static mpc_val_t *mpca_stmt_list_apply_to(mpc_val_t *x, void *s) {
-
-  mpca_grammar_st_t *st = s;
-  mpca_stmt_t *stmt;
-  mpca_stmt_t **stmts = x;
-  mpc_parser_t *left;
-
-  while(*stmts) {
-    stmt = *stmts;
-    left = mpca_grammar_find_parser(stmt->ident, st);
-    if (st->flags & MPCA_LANG_PREDICTIVE) { stmt->grammar = mpc_predictive(stmt->grammar); }
-    if (stmt->name) { stmt->grammar = mpc_expect(stmt->grammar, stmt->name); }
-    mpc_optimise(stmt->grammar);
-    mpc_define(left, stmt->grammar);
-    free(stmt->ident);
-    free(stmt->name);
-    free(stmt);
-    stmts++;
-  }
-  
-  free(x);
-  
-  return NULL;
-}
-
-static mpc_err_t *mpca_lang_st(mpc_input_t *i, mpca_grammar_st_t *st) {
-  
-  mpc_result_t r;
-  mpc_err_t *e;
-  mpc_parser_t *Lang, *Stmt, *Grammar, *Term, *Factor, *Base; 
-  
-  Lang    = mpc_new("lang");
-  Stmt    = mpc_new("stmt");
-  Grammar = mpc_new("grammar");
-  Term    = mpc_new("term");
-  Factor  = mpc_new("factor");
-  Base    = mpc_new("base");
-  
-  mpc_define(Lang, mpc_apply_to(
-    mpc_total(mpc_predictive(mpc_many(mpca_stmt_fold, Stmt)), mpca_stmt_list_delete),
-    mpca_stmt_list_apply_to, st
-  ));
-  
-  mpc_define(Stmt, mpc_and(5, mpca_stmt_afold,
-    mpc_tok(mpc_ident()), mpc_maybe(mpc_tok(mpc_string_lit())), mpc_sym(":"), Grammar, mpc_sym(";"),
-    free, free, free, mpc_soft_delete
-  ));
-  
-  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
-      Term,
-      mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
-      mpc_soft_delete
-  ));
-  
-  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
-  
-  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
-    Base,
-      mpc_or(6,
-        mpc_sym("*"),
-        mpc_sym("+"),
-        mpc_sym("?"),
-        mpc_sym("!"),
-        mpc_tok_brackets(mpc_int(), free),
-        mpc_pass()),
-    mpc_soft_delete
-  ));
-  
-  mpc_define(Base, mpc_or(5,
-    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
-    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
-    mpc_apply_to(mpc_tok(mpc_regex_lit()),  mpcaf_grammar_regex, st),
-    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
-    mpc_tok_parens(Grammar, mpc_soft_delete)
-  ));
-  
-  mpc_optimise(Lang);
-  mpc_optimise(Stmt);
-  mpc_optimise(Grammar);
-  mpc_optimise(Term);
-  mpc_optimise(Factor);
-  mpc_optimise(Base);
-  
-  if (!mpc_parse_input(i, Lang, &r)) {
-    e = r.error;
-  } else {
-    e = NULL;
-  }
-  
-  mpc_cleanup(6, Lang, Stmt, Grammar, Term, Factor, Base);
-  
-  return e;
-}
-
-mpc_err_t *mpca_lang_file(int flags, FILE *f, ...) {
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-
-  va_list va;  
-  va_start(va, f);
-  
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-  
-  i = mpc_input_new_file("<mpca_lang_file>", f);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-  
-  free(st.parsers);
-  va_end(va);
-  return err;
-}
-
-mpc_err_t *mpca_lang_pipe(int flags, FILE *p, ...) {
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-
-  va_list va;  
-  va_start(va, p);
-  
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-  
-  i = mpc_input_new_pipe("<mpca_lang_pipe>", p);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-  
-  free(st.parsers);
-  va_end(va);
-  return err;
-}
-
-mpc_err_t *mpca_lang(int flags, const char *language, ...) {
-  
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-  
-  va_list va;  
-  va_start(va, language);
-  
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-  
-  i = mpc_input_new_string("<mpca_lang>", language);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-  
-  free(st.parsers);
-  va_end(va);
-  return err;
-}
-
-mpc_err_t *mpca_lang_contents(int flags, const char *filename, ...) {
-  
-  mpca_grammar_st_t st;
-  mpc_input_t *i;
-  mpc_err_t *err;
-  
-  va_list va;
-
-  FILE *f = fopen(filename, "rb");
-  
-  if (f == NULL) {
-    err = mpc_err_file(filename, "Unable to open file!");
-    return err;
-  }
-  
-  va_start(va, filename);
-  
-  st.va = &va;
-  st.parsers_num = 0;
-  st.parsers = NULL;
-  st.flags = flags;
-  
-  i = mpc_input_new_file(filename, f);
-  err = mpca_lang_st(i, &st);
-  mpc_input_delete(i);
-  
-  free(st.parsers);
-  va_end(va);  
-  
-  fclose(f);
-  
-  return err;
-}
-
-static int mpc_nodecount_unretained(mpc_parser_t* p, int force) {
-
-  int i, total;
-
-  if (p->retained && !force) { return 0; }
-
-  if (p->type == MPC_TYPE_EXPECT) { return 1 + mpc_nodecount_unretained(p->data.expect.x, 0); }
-
-  if (p->type == MPC_TYPE_APPLY)    { return 1 + mpc_nodecount_unretained(p->data.apply.x, 0); }
-  if (p->type == MPC_TYPE_APPLY_TO) { return 1 + mpc_nodecount_unretained(p->data.apply_to.x, 0); }
-  if (p->type == MPC_TYPE_PREDICT)  { return 1 + mpc_nodecount_unretained(p->data.predict.x, 0); }
-
-  if (p->type == MPC_TYPE_NOT)   { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
-  if (p->type == MPC_TYPE_MAYBE) { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
-
-  if (p->type == MPC_TYPE_MANY)  { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_MANY1) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_COUNT) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
-
-  if (p->type == MPC_TYPE_OR) { 
-    total = 0;
-    for(i = 0; i < p->data.or.n; i++) {
-      total += mpc_nodecount_unretained(p->data.or.xs[i], 0);
-    }
-    return total;
-  }
-  
-  if (p->type == MPC_TYPE_AND) {
-    total = 0;
-    for(i = 0; i < p->data.and.n; i++) {
-      total += mpc_nodecount_unretained(p->data.and.xs[i], 0);
-    }
-    return total;
-  }
-
-  return 1;
-  
-}
-
-void mpc_stats(mpc_parser_t* p) {
-  printf("Stats\n");
-  printf("=====\n");
-  printf("Node Count: %i\n", mpc_nodecount_unretained(p, 1));
-}
-
-static void mpc_optimise_unretained(mpc_parser_t *p, int force) {
-  
-  int i, n, m;
-  mpc_parser_t *t;
-  
-  if (p->retained && !force) { return; }
-  
-  /* Optimise Subexpressions */
-  
-  if (p->type == MPC_TYPE_EXPECT)   { mpc_optimise_unretained(p->data.expect.x, 0); }
-  if (p->type == MPC_TYPE_APPLY)    { mpc_optimise_unretained(p->data.apply.x, 0); }
-  if (p->type == MPC_TYPE_APPLY_TO) { mpc_optimise_unretained(p->data.apply_to.x, 0); }
-  if (p->type == MPC_TYPE_PREDICT)  { mpc_optimise_unretained(p->data.predict.x, 0); }
-  if (p->type == MPC_TYPE_NOT)      { mpc_optimise_unretained(p->data.not.x, 0); }
-  if (p->type == MPC_TYPE_MAYBE)    { mpc_optimise_unretained(p->data.not.x, 0); }
-  if (p->type == MPC_TYPE_MANY)     { mpc_optimise_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_MANY1)    { mpc_optimise_unretained(p->data.repeat.x, 0); }
-  if (p->type == MPC_TYPE_COUNT)    { mpc_optimise_unretained(p->data.repeat.x, 0); }
-  
-  if (p->type == MPC_TYPE_OR) { 
-    for(i = 0; i < p->data.or.n; i++) {
-      mpc_optimise_unretained(p->data.or.xs[i], 0);
-    }
-  }
-  
-  if (p->type == MPC_TYPE_AND) {
-    for(i = 0; i < p->data.and.n; i++) {
-      mpc_optimise_unretained(p->data.and.xs[i], 0);
-    }
-  }  
-  
-  /* Perform optimisations */
-  
-  while (1) {
-    
-    /* Merge rhs `or` */
-    if (p->type == MPC_TYPE_OR
-    &&  p->data.or.xs[p->data.or.n-1]->type == MPC_TYPE_OR
-    && !p->data.or.xs[p->data.or.n-1]->retained) {
-      t = p->data.or.xs[p->data.or.n-1];
-      n = p->data.or.n; m = t->data.or.n;
-      p->data.or.n = n + m - 1;
-      p->data.or.xs = realloc(p->data.or.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      memmove(p->data.or.xs + n - 1, t->data.or.xs, m * sizeof(mpc_parser_t*));
-      free(t->data.or.xs); free(t->name); free(t);
-      continue;
-    }
-
-    /* Merge lhs `or` */
-    if (p->type == MPC_TYPE_OR
-    &&  p->data.or.xs[0]->type == MPC_TYPE_OR
-    && !p->data.or.xs[0]->retained) {
-      t = p->data.or.xs[0];
-      n = p->data.or.n; m = t->data.or.n;
-      p->data.or.n = n + m - 1;
-      p->data.or.xs = realloc(p->data.or.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      memmove(p->data.or.xs + m, t->data.or.xs + 1, n * sizeof(mpc_parser_t*));
-      memmove(p->data.or.xs, t->data.or.xs, m * sizeof(mpc_parser_t*));
-      free(t->data.or.xs); free(t->name); free(t);
-      continue;
-    }
-    
-    /* Remove ast `pass` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.n == 2
-    &&  p->data.and.xs[0]->type == MPC_TYPE_PASS
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.f == mpcf_fold_ast) {
-      t = p->data.and.xs[1];
-      mpc_delete(p->data.and.xs[0]);
-      free(p->data.and.xs); free(p->data.and.dxs); free(p->name);
-      memcpy(p, t, sizeof(mpc_parser_t));
-      free(t);
-      continue;
-    }
-    
-    /* Merge ast lhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_fold_ast
-    &&  p->data.and.xs[0]->type == MPC_TYPE_AND
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.xs[0]->data.and.f == mpcf_fold_ast) {
-      t = p->data.and.xs[0];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m - 1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + m, p->data.and.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
-      memmove(p->data.and.xs, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t); 
-      continue;
-    }
-    
-    /* Merge ast rhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_fold_ast
-    &&  p->data.and.xs[p->data.and.n-1]->type == MPC_TYPE_AND
-    && !p->data.and.xs[p->data.and.n-1]->retained
-    &&  p->data.and.xs[p->data.and.n-1]->data.and.f == mpcf_fold_ast) {
-      t = p->data.and.xs[p->data.and.n-1];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + n - 1, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t); 
-      continue;
-    }
-
-    /* Remove re `lift` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.n == 2
-    &&  p->data.and.xs[0]->type == MPC_TYPE_LIFT
-    &&  p->data.and.xs[0]->data.lift.lf == mpcf_ctor_str
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.f == mpcf_strfold) {
-      t = p->data.and.xs[1];
-      mpc_delete(p->data.and.xs[0]);
-      free(p->data.and.xs); free(p->data.and.dxs); free(p->name);
-      memcpy(p, t, sizeof(mpc_parser_t));
-      free(t);
-      continue;
-    }
-
-    /* Merge re lhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_strfold
-    &&  p->data.and.xs[0]->type == MPC_TYPE_AND
-    && !p->data.and.xs[0]->retained
-    &&  p->data.and.xs[0]->data.and.f == mpcf_strfold) {
-      t = p->data.and.xs[0];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m - 1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + m, p->data.and.xs + 1, (n - 1) * sizeof(mpc_parser_t*));
-      memmove(p->data.and.xs, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = free; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t); 
-      continue;
-    }
-    
-    /* Merge re rhs `and` */
-    if (p->type == MPC_TYPE_AND
-    &&  p->data.and.f == mpcf_strfold
-    &&  p->data.and.xs[p->data.and.n-1]->type == MPC_TYPE_AND
-    && !p->data.and.xs[p->data.and.n-1]->retained
-    &&  p->data.and.xs[p->data.and.n-1]->data.and.f == mpcf_strfold) {
-      t = p->data.and.xs[p->data.and.n-1];
-      n = p->data.and.n; m = t->data.and.n;
-      p->data.and.n = n + m - 1;
-      p->data.and.xs = realloc(p->data.and.xs, sizeof(mpc_parser_t*) * (n + m -1));
-      p->data.and.dxs = realloc(p->data.and.dxs, sizeof(mpc_dtor_t) * (n + m - 1 - 1));
-      memmove(p->data.and.xs + n - 1, t->data.and.xs, m * sizeof(mpc_parser_t*));
-      for (i = 0; i < p->data.and.n-1; i++) { p->data.and.dxs[i] = free; }
-      free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t); 
-      continue;
-    }
-    
-    return;
-    
-  }
-  
-}
-
-void mpc_optimise(mpc_parser_t *p) {
-  mpc_optimise_unretained(p, 1);
-}
-
+#include "mpc.h"
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(MPC_NO_MMAP)
+#define MPC_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(MPC_NO_SIMD)
+#define MPC_USE_SIMD
+#include <immintrin.h>
+#endif
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(MPC_NO_THREADS)
+#define MPC_USE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define MPC_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define MPC_THREAD_LOCAL __thread
+#else
+#define MPC_THREAD_LOCAL
+#endif
+
+#ifdef MPC_PROFILE
+#include <time.h>
+#endif
+
+/*
+** State Type
+*/
+
+static mpc_state_t mpc_state_invalid(void) {
+  mpc_state_t s;
+  s.pos = -1;
+  s.row = -1;
+  s.col = -1;
+  return s;
+}
+
+static mpc_state_t mpc_state_new(void) {
+  mpc_state_t s;
+  s.pos = 0;
+  s.row = 0;
+  s.col = 0;
+  return s;
+}
+
+/*
+** Input Type
+*/
+
+/*
+** In mpc the input type has three modes of 
+** operation: String, File and Pipe.
+**
+** String is easy. The whole contents are 
+** loaded into a buffer and scanned through.
+** The cursor can jump around at will making 
+** backtracking easy.
+**
+** The second is a File which is also somewhat
+** easy. The contents are never loaded into 
+** memory but backtracking can still be achieved
+** by seeking in the file at different positions.
+**
+** The final mode is Pipe. This is the difficult
+** one. As we assume pipes cannot be seeked - and 
+** only support a single character lookahead at 
+** any point, when the input is marked for a 
+** potential backtracking we start buffering any 
+** input.
+**
+** This means that if we are requested to seek
+** back we can simply start reading from the
+** buffer instead of the input.
+**
+** Of course using `mpc_predictive` will disable
+** backtracking and make LL(1) grammars easy
+** to parse for all input methods.
+**
+** Where the platform allows it regular files
+** are not read as a File at all but mapped
+** into memory with Mmap. From then on they
+** are scanned exactly like a String.
+**
+*/
+
+enum {
+  MPC_INPUT_STRING = 0,
+  MPC_INPUT_FILE   = 1,
+  MPC_INPUT_PIPE   = 2,
+  MPC_INPUT_MMAP   = 3
+};
+
+enum {
+  MPC_INPUT_MARKS_MIN = 32,
+  MPC_INPUT_BUFFER_MIN = 256
+};
+
+enum {
+  MPC_INPUT_MEM_MIN = 32,
+  MPC_INPUT_MEM_MAX = 65536,
+  MPC_INPUT_MEMO_NUM = 4096,
+  MPC_INPUT_MEMO_BYTES = 4194304
+};
+
+/*
+** A failure is kept as where it happened and
+** what was expected there, pointing at the
+** parser's own strings rather than copying
+** them. Only the farthest failures can end up
+** in the error, so those are all the input
+** keeps, and a full `mpc_err_t` is only built
+** from them if the whole parse fails.
+*/
+
+typedef struct {
+  mpc_state_t state;
+  char recieved;
+  const char *expected;
+  const char *failure;
+} mpc_fail_t;
+
+typedef struct {
+  mpc_state_t state;
+  char recieved;
+  const char *failure;
+  int expected_num;
+  int expected_slots;
+  const char **expected;
+} mpc_farthest_t;
+
+/*
+** One slot of the packrat table used by
+** `mpc_memo` parsers. It is direct mapped on
+** parser and position, so a collision simply
+** evicts the older result. The failures and
+** expectations the slots hold are also capped
+** in bytes, so memory stays bounded whatever
+** the length of the input.
+*/
+
+typedef struct {
+  mpc_parser_t *p;
+  long pos;
+  int backtrack;
+  int ok;
+  mpc_val_t *output;
+  mpc_fail_t *error;
+  mpc_farthest_t *merged;
+  mpc_state_t state;
+  char last;
+  size_t bytes;
+} mpc_memo_t;
+
+/*
+** What a named parser did, counted when built
+** with MPC_PROFILE, see `mpc_stats`.
+*/
+
+#ifdef MPC_PROFILE
+typedef struct {
+  long calls;
+  long passes;
+  long fails;
+  long consumed;
+  long rewinds;
+  double time;
+  int active;
+} mpc_profile_t;
+#endif
+
+/*
+** A parser in progress on the parse stack, see
+** `mpc_parse_run`.
+*/
+
+typedef struct {
+  mpc_parser_t *p;
+  int j;
+  int base;
+  int errs;
+  long pos;
+  mpc_val_t *output;
+  mpc_farthest_t *merged;
+#ifdef MPC_PROFILE
+  int profiled;
+  double start;
+  mpc_profile_t *named;
+#endif
+} mpc_frame_t;
+
+typedef union mpc_mem_t {
+  char mem[64];
+  union mpc_mem_t *next;
+} mpc_mem_t;
+
+typedef struct mpc_mem_chunk_t {
+  struct mpc_mem_chunk_t *next;
+  mpc_mem_t *mem;
+  size_t num;
+} mpc_mem_chunk_t;
+
+typedef struct mpc_ast_arena_t mpc_ast_arena_t;
+
+typedef struct {
+
+  int type;
+  char *filename;  
+  mpc_state_t state;
+  
+  char *string;
+  size_t length;
+  char *buffer;
+  size_t buffer_len;
+  size_t buffer_cap;
+  FILE *file;
+  
+  int suppress;
+  int backtrack;
+  int predict;
+  long skipped;
+  int slicing;
+  char *slice;
+  long slice_pos;
+  long slice_slots;
+  int marks_slots;
+  int marks_num;
+  mpc_state_t *marks;
+  
+  char *lasts;
+  char last;
+  
+  mpc_allocator_t alloc;
+  mpc_mem_chunk_t *chunks;
+  mpc_mem_t *mem_free;
+  mpc_mem_t *mem_next;
+  size_t mem_left;
+  long mem_small;
+  long mem_large;
+  
+  /* Counted on the input rather than the shared parser, so parsing on several threads does not race */
+  long memo_hits;
+  long memo_misses;
+  mpc_memo_t *memo;
+  size_t memo_bytes;
+  mpc_ast_arena_t *arena;
+  
+  mpc_farthest_t farthest;
+  int strings_num;
+  int strings_slots;
+  char **strings;
+  
+  int frames_num;
+  int frames_slots;
+  mpc_frame_t *frames;
+  int values_num;
+  int values_slots;
+  mpc_val_t **values;
+  
+#ifdef MPC_PROFILE
+  mpc_profile_t *named;
+#endif
+  
+} mpc_input_t;
+
+/*
+** Small blocks - errors, states, single chars
+** - come from chunks owned by the input. Freed
+** blocks go on a free list and are handed out
+** again first, otherwise the newest chunk is
+** carved up in order. Chunks double in size as
+** more are needed, so a small parse allocates
+** little and a big one never has to search.
+*/
+
+static void *mpc_mem_default_alloc(void *data, size_t n) { (void)data; return malloc(n); }
+static void mpc_mem_default_release(void *data, void *p) { (void)data; free(p); }
+
+static mpc_allocator_t mpc_allocator_default = { mpc_mem_default_alloc, mpc_mem_default_release, NULL };
+
+void mpc_allocator_set(const mpc_allocator_t *a) {
+  mpc_allocator_t d = { mpc_mem_default_alloc, mpc_mem_default_release, NULL };
+  mpc_allocator_default = a ? *a : d;
+}
+
+/* Totals over the inputs deleted on this thread, printed by `mpc_stats` */
+typedef struct {
+  long inputs;
+  long small;
+  long large;
+  long chunks;
+  long peak;
+  long memo_hits;
+  long memo_misses;
+} mpc_mem_stats_t;
+
+static MPC_THREAD_LOCAL mpc_mem_stats_t mpc_mem_stats;
+
+static void mpc_mem_init(mpc_input_t *i) {
+  i->alloc = mpc_allocator_default;
+  i->chunks = NULL;
+  i->mem_free = NULL;
+  i->mem_next = NULL;
+  i->mem_left = 0;
+  i->mem_small = 0;
+  i->mem_large = 0;
+  i->memo_hits = 0;
+  i->memo_misses = 0;
+}
+
+static void mpc_mem_delete(mpc_input_t *i) {
+  
+  mpc_mem_chunk_t *c, *n;
+  long peak = -(long)i->mem_left;
+  
+  for (c = i->chunks; c; c = n) {
+    n = c->next;
+    /* Freed blocks are always reused first, so the blocks carved out are the most ever live */
+    peak += c->num;
+    mpc_mem_stats.chunks++;
+    i->alloc.release(i->alloc.data, c);
+  }
+  
+  mpc_mem_stats.inputs++;
+  mpc_mem_stats.small += i->mem_small;
+  mpc_mem_stats.large += i->mem_large;
+  mpc_mem_stats.memo_hits += i->memo_hits;
+  mpc_mem_stats.memo_misses += i->memo_misses;
+  if (peak > mpc_mem_stats.peak) { mpc_mem_stats.peak = peak; }
+}
+
+static mpc_input_t *mpc_input_new_nstring(const char *filename, const char *string, size_t length) {
+
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+  
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+  i->type = MPC_INPUT_STRING;
+  
+  i->state = mpc_state_new();
+  
+  i->string = malloc(length + 1);
+  memcpy(i->string, string, length);
+  i->string[length] = '\0';
+  i->length = length;
+  i->buffer = NULL;
+  i->buffer_len = 0;
+  i->buffer_cap = 0;
+  i->file = NULL;
+  
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->predict = 0;
+  i->skipped = 0;
+  i->slicing = 0;
+  i->slice = NULL;
+  i->slice_pos = 0;
+  i->slice_slots = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+  
+  mpc_mem_init(i);
+  i->memo = NULL;
+  i->memo_bytes = 0;
+  i->arena = NULL;
+  
+  i->farthest.expected_slots = 0;
+  i->farthest.expected = NULL;
+  i->strings_num = 0;
+  i->strings_slots = 0;
+  i->strings = NULL;
+  
+  i->frames_num = 0;
+  i->frames_slots = 0;
+  i->frames = NULL;
+  i->values_num = 0;
+  i->values_slots = 0;
+  i->values = NULL;
+#ifdef MPC_PROFILE
+  i->named = NULL;
+#endif
+  
+  return i;
+
+}
+
+static mpc_input_t *mpc_input_new_string(const char *filename, const char *string) {
+  return mpc_input_new_nstring(filename, string, strlen(string));
+}
+
+static mpc_input_t *mpc_input_new_pipe(const char *filename, FILE *pipe) {
+
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+  
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+  
+  i->type = MPC_INPUT_PIPE;
+  i->state = mpc_state_new();
+  
+  i->string = NULL;
+  i->length = 0;
+  i->buffer = NULL;
+  i->buffer_len = 0;
+  i->buffer_cap = 0;
+  i->file = pipe;
+  
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->predict = 0;
+  i->skipped = 0;
+  i->slicing = 0;
+  i->slice = NULL;
+  i->slice_pos = 0;
+  i->slice_slots = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+  
+  mpc_mem_init(i);
+  i->memo = NULL;
+  i->memo_bytes = 0;
+  i->arena = NULL;
+  
+  i->farthest.expected_slots = 0;
+  i->farthest.expected = NULL;
+  i->strings_num = 0;
+  i->strings_slots = 0;
+  i->strings = NULL;
+  
+  i->frames_num = 0;
+  i->frames_slots = 0;
+  i->frames = NULL;
+  i->values_num = 0;
+  i->values_slots = 0;
+  i->values = NULL;
+#ifdef MPC_PROFILE
+  i->named = NULL;
+#endif
+  
+  return i;
+  
+}
+
+static mpc_input_t *mpc_input_new_file(const char *filename, FILE *file) {
+  
+  mpc_input_t *i = malloc(sizeof(mpc_input_t));
+  
+  i->filename = malloc(strlen(filename) + 1);
+  strcpy(i->filename, filename);
+  i->type = MPC_INPUT_FILE;
+  i->state = mpc_state_new();
+  
+  i->string = NULL;
+  i->length = 0;
+  i->buffer = NULL;
+  i->buffer_len = 0;
+  i->buffer_cap = 0;
+  i->file = file;
+  
+  i->suppress = 0;
+  i->backtrack = 1;
+  i->predict = 0;
+  i->skipped = 0;
+  i->slicing = 0;
+  i->slice = NULL;
+  i->slice_pos = 0;
+  i->slice_slots = 0;
+  i->marks_num = 0;
+  i->marks_slots = MPC_INPUT_MARKS_MIN;
+  i->marks = malloc(sizeof(mpc_state_t) * i->marks_slots);
+  i->lasts = malloc(sizeof(char) * i->marks_slots);
+  i->last = '\0';
+  
+  mpc_mem_init(i);
+  i->memo = NULL;
+  i->memo_bytes = 0;
+  i->arena = NULL;
+  
+  i->farthest.expected_slots = 0;
+  i->farthest.expected = NULL;
+  i->strings_num = 0;
+  i->strings_slots = 0;
+  i->strings = NULL;
+  
+  i->frames_num = 0;
+  i->frames_slots = 0;
+  i->frames = NULL;
+  i->values_num = 0;
+  i->values_slots = 0;
+  i->values = NULL;
+#ifdef MPC_PROFILE
+  i->named = NULL;
+#endif
+  
+  return i;
+}
+
+#ifdef MPC_USE_MMAP
+
+/* Returns NULL if the file is not a regular file at its start */
+static mpc_input_t *mpc_input_new_mmap(const char *filename, FILE *file) {
+  
+  mpc_input_t *i;
+  struct stat st;
+  void *map;
+  
+  if (fstat(fileno(file), &st) != 0
+  ||  !S_ISREG(st.st_mode)
+  ||  st.st_size == 0
+  ||  ftell(file) != 0) { return NULL; }
+  
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+  if (map == MAP_FAILED) { return NULL; }
+  
+  i = mpc_input_new_file(filename, file);
+  i->type = MPC_INPUT_MMAP;
+  i->string = map;
+  i->length = st.st_size;
+  
+  return i;
+}
+
+#endif
+
+/* String and Mmap inputs have all their contents in memory */
+static int mpc_input_buffered(mpc_input_t *i) {
+  return i->type == MPC_INPUT_STRING || i->type == MPC_INPUT_MMAP;
+}
+
+/*
+** AST Arena
+**
+** The AST nodes built during a parse, their
+** contents and their children arrays are all
+** allocated from an arena on the input. The
+** arena counts the nodes still alive in it.
+** Deleting a node only takes it off the count,
+** and the blocks are freed together once the
+** count is zero and the arena is closed, which
+** happens when a parse returns one of its nodes
+** or when the input is deleted. A subtree taken
+** out of a result therefore keeps the blocks
+** alive until it is deleted itself.
+**
+** Nodes dropped while the parse backtracks stay
+** in the blocks until then too. If every node
+** of an open arena has been deleted its blocks
+** are reused from the start.
+*/
+
+enum {
+  MPC_AST_BLOCK_MIN = 4096,
+  MPC_AST_BLOCK_MAX = 1048576
+};
+
+typedef union {
+  void *p;
+  long l;
+  double d;
+} mpc_ast_align_t;
+
+typedef struct mpc_ast_block_t {
+  struct mpc_ast_block_t *next;
+  size_t size;
+  size_t used;
+} mpc_ast_block_t;
+
+struct mpc_ast_arena_t {
+  mpc_ast_block_t *blocks;
+  long live;
+  int closed;
+};
+
+/* The input being parsed on this thread, new nodes go in its arena */
+static MPC_THREAD_LOCAL mpc_input_t *mpc_ast_input = NULL;
+
+static size_t mpc_ast_round(size_t n) {
+  return (n + sizeof(mpc_ast_align_t) - 1) / sizeof(mpc_ast_align_t) * sizeof(mpc_ast_align_t);
+}
+
+static void *mpc_ast_arena_alloc(mpc_ast_arena_t *a, size_t n) {
+  
+  size_t head = mpc_ast_round(sizeof(mpc_ast_block_t));
+  mpc_ast_block_t *b = a->blocks;
+  
+  n = mpc_ast_round(n);
+  
+  if (b == NULL || b->used + n > b->size) {
+    size_t size = b == NULL ? MPC_AST_BLOCK_MIN : b->size * 2;
+    if (size > MPC_AST_BLOCK_MAX) { size = MPC_AST_BLOCK_MAX; }
+    if (size < n) { size = n; }
+    b = malloc(head + size);
+    b->next = a->blocks;
+    b->size = size;
+    b->used = 0;
+    a->blocks = b;
+  }
+  
+  b->used += n;
+  return (char*)b + head + b->used - n;
+}
+
+static int mpc_ast_arena_owns(mpc_ast_arena_t *a, void *x) {
+  mpc_ast_block_t *b;
+  for (b = a->blocks; b; b = b->next) {
+    if ((char*)x >= (char*)b && (char*)x < (char*)b + mpc_ast_round(sizeof(mpc_ast_block_t)) + b->used) { return 1; }
+  }
+  return 0;
+}
+
+static void mpc_ast_arena_free(mpc_ast_arena_t *a) {
+  mpc_ast_block_t *b, *n;
+  for (b = a->blocks; b; b = n) {
+    n = b->next;
+    free(b);
+  }
+  free(a);
+}
+
+/* Take a deleted node off the count */
+static void mpc_ast_arena_release(mpc_ast_arena_t *a) {
+  
+  mpc_ast_block_t *b, *n;
+  
+  if (--a->live > 0) { return; }
+  if (a->closed) { mpc_ast_arena_free(a); return; }
+  
+  /* Nothing built so far is wanted, start again in the newest block */
+  for (b = a->blocks->next; b; b = n) {
+    n = b->next;
+    free(b);
+  }
+  a->blocks->next = NULL;
+  a->blocks->used = 0;
+}
+
+/* No more nodes will be built in the arena, free it once the last one is deleted */
+static void mpc_ast_arena_close(mpc_ast_arena_t *a) {
+  a->closed = 1;
+  if (a->live == 0) { mpc_ast_arena_free(a); }
+}
+
+/* Arena of the parse running on this thread, if any */
+static mpc_ast_arena_t *mpc_ast_arena(void) {
+  if (mpc_ast_input == NULL) { return NULL; }
+  if (mpc_ast_input->arena == NULL) { mpc_ast_input->arena = calloc(1, sizeof(mpc_ast_arena_t)); }
+  return mpc_ast_input->arena;
+}
+
+static void mpc_memo_delete(mpc_input_t *i);
+
+static void mpc_input_delete(mpc_input_t *i) {
+  
+  int j;
+  
+  mpc_memo_delete(i);
+  free(i->farthest.expected);
+  for (j = 0; j < i->strings_num; j++) { free(i->strings[j]); }
+  free(i->strings);
+  if (i->arena) { mpc_ast_arena_close(i->arena); }
+  mpc_mem_delete(i);
+  free(i->filename);
+  
+  if (i->type == MPC_INPUT_STRING) { free(i->string); }
+#ifdef MPC_USE_MMAP
+  if (i->type == MPC_INPUT_MMAP) { munmap(i->string, i->length); }
+#endif
+  if (i->type == MPC_INPUT_PIPE) { free(i->buffer); }
+  
+  free(i->slice);
+  free(i->marks);
+  free(i->lasts);
+  free(i->frames);
+  free(i->values);
+  free(i);
+}
+
+static int mpc_mem_ptr(mpc_input_t *i, void *p) {
+  mpc_mem_chunk_t *c;
+  for (c = i->chunks; c; c = c->next) {
+    if ((char*)p >= (char*)c->mem && (char*)p < (char*)(c->mem + c->num)) { return 1; }
+  }
+  return 0;
+}
+
+static void mpc_mem_grow(mpc_input_t *i) {
+  
+  size_t num = i->chunks ? i->chunks->num * 2 : MPC_INPUT_MEM_MIN;
+  mpc_mem_chunk_t *c;
+  
+  if (num > MPC_INPUT_MEM_MAX) { num = MPC_INPUT_MEM_MAX; }
+  
+  /* The blocks follow the header, which is a multiple of their alignment */
+  c = i->alloc.alloc(i->alloc.data, sizeof(mpc_mem_chunk_t) + num * sizeof(mpc_mem_t));
+  c->next = i->chunks;
+  c->mem = (mpc_mem_t*)(c + 1);
+  c->num = num;
+  i->chunks = c;
+  i->mem_next = c->mem;
+  i->mem_left = num;
+}
+
+static void *mpc_malloc(mpc_input_t *i, size_t n) {
+  
+  mpc_mem_t *p;
+  
+  if (n > sizeof(mpc_mem_t)) {
+    i->mem_large++;
+    return malloc(n);
+  }
+  
+  if (i->mem_free) {
+    p = i->mem_free;
+    i->mem_free = p->next;
+  } else {
+    if (i->mem_left == 0) { mpc_mem_grow(i); }
+    p = i->mem_next++;
+    i->mem_left--;
+  }
+  
+  i->mem_small++;
+  return p;
+}
+
+static void *mpc_calloc(mpc_input_t *i, size_t n, size_t m) {
+  char *x = mpc_malloc(i, n * m);
+  memset(x, 0, n * m);
+  return x;
+}
+
+static void mpc_free(mpc_input_t *i, void *p) {
+  mpc_mem_t *m = p;
+  if (!mpc_mem_ptr(i, p)) { free(p); return; }
+  m->next = i->mem_free;
+  i->mem_free = m;
+}
+
+static void *mpc_realloc(mpc_input_t *i, void *p, size_t n) {
+  
+  char *q = NULL;
+  
+  if (!mpc_mem_ptr(i, p)) { return realloc(p, n); }
+  
+  if (n > sizeof(mpc_mem_t)) {
+    q = malloc(n);
+    memcpy(q, p, sizeof(mpc_mem_t));
+    mpc_free(i, p);
+    return q;
+  }
+  
+  return p;
+}
+
+static void *mpc_export(mpc_input_t *i, void *p) {
+  char *q = NULL;
+  if (!mpc_mem_ptr(i, p)) { return p; }
+  q = malloc(sizeof(mpc_mem_t));
+  memcpy(q, p, sizeof(mpc_mem_t));
+  mpc_free(i, p);
+  return q; 
+}
+
+static void mpc_input_backtrack_disable(mpc_input_t *i) { i->backtrack--; }
+static void mpc_input_backtrack_enable(mpc_input_t *i) { i->backtrack++; }
+
+static void mpc_input_suppress_disable(mpc_input_t *i) { i->suppress--; }
+static void mpc_input_suppress_enable(mpc_input_t *i) { i->suppress++; }
+
+static void mpc_input_mark(mpc_input_t *i) {
+  
+  if (i->backtrack < 1) { return; }
+  
+  i->marks_num++;
+  
+  if (i->marks_num > i->marks_slots) {
+    i->marks_slots = i->marks_num + i->marks_num / 2;
+    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
+    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);
+  }
+
+  i->marks[i->marks_num-1] = i->state;
+  i->lasts[i->marks_num-1] = i->last;
+  
+  if (i->type == MPC_INPUT_PIPE && i->marks_num == 1) {
+    i->buffer_len = 0;
+  }
+  
+}
+
+static void mpc_input_unmark(mpc_input_t *i) {
+  
+  if (i->backtrack < 1) { return; }
+  
+  i->marks_num--;
+  
+  if (i->marks_slots > i->marks_num + i->marks_num / 2
+  &&  i->marks_slots > MPC_INPUT_MARKS_MIN) {
+    i->marks_slots = 
+      i->marks_num > MPC_INPUT_MARKS_MIN ?
+      i->marks_num : MPC_INPUT_MARKS_MIN;
+    i->marks = realloc(i->marks, sizeof(mpc_state_t) * i->marks_slots);
+    i->lasts = realloc(i->lasts, sizeof(char) * i->marks_slots);      
+  }
+  
+  /* Keep the allocation, the next mark starts filling it again */
+  if (i->type == MPC_INPUT_PIPE && i->marks_num == 0) {
+    i->buffer_len = 0;
+  }
+  
+}
+
+static void mpc_input_rewind(mpc_input_t *i) {
+  
+  if (i->backtrack < 1) { return; }
+  
+  i->state = i->marks[i->marks_num-1];
+  i->last  = i->lasts[i->marks_num-1];
+  
+#ifdef MPC_PROFILE
+  if (i->named) { i->named->rewinds++; }
+#endif
+  
+  if (i->type == MPC_INPUT_FILE) {
+    fseek(i->file, i->state.pos, SEEK_SET);
+  }
+  
+  mpc_input_unmark(i);
+}
+
+/*
+** While the Pipe is marked every consumed char
+** is kept in the buffer, which holds the input
+** from the position of the first mark onwards.
+*/
+
+static int mpc_input_buffer_active(mpc_input_t *i) {
+  return i->marks_num > 0;
+}
+
+static int mpc_input_buffer_in_range(mpc_input_t *i) {
+  return i->state.pos < (long)i->buffer_len + i->marks[0].pos;
+}
+
+static void mpc_input_buffer_push(mpc_input_t *i, char c) {
+  if (i->buffer_len == i->buffer_cap) {
+    i->buffer_cap = i->buffer_cap ? i->buffer_cap * 2 : MPC_INPUT_BUFFER_MIN;
+    i->buffer = realloc(i->buffer, i->buffer_cap);
+  }
+  i->buffer[i->buffer_len++] = c;
+}
+
+static char mpc_input_buffer_get(mpc_input_t *i) {
+  return i->buffer[i->state.pos - i->marks[0].pos];
+}
+
+static int mpc_input_terminated(mpc_input_t *i) {
+  if (mpc_input_buffered(i) && i->state.pos >= (long)i->length) { return 1; }
+  if (i->type == MPC_INPUT_FILE && feof(i->file)) { return 1; }
+  if (i->type == MPC_INPUT_PIPE && feof(i->file)) {
+    /* Chars read before the end was hit can still be read again from the buffer */
+    return !mpc_input_buffer_active(i) || !mpc_input_buffer_in_range(i);
+  }
+  return 0;
+}
+
+static char mpc_input_getc(mpc_input_t *i) {
+  
+  char c = '\0';
+  
+  switch (i->type) {
+    
+    case MPC_INPUT_STRING:
+    case MPC_INPUT_MMAP: return i->state.pos < (long)i->length ? i->string[i->state.pos] : '\0';
+    case MPC_INPUT_FILE: c = fgetc(i->file); return c;
+    case MPC_INPUT_PIPE:
+    
+      if (!mpc_input_buffer_active(i)) { c = getc(i->file); return c; }
+      
+      if (mpc_input_buffer_in_range(i)) {
+        c = mpc_input_buffer_get(i);
+        return c;
+      } else {
+        c = getc(i->file);
+        return c;
+      }
+    
+    default: return c;
+  }
+}
+
+static char mpc_input_peekc(mpc_input_t *i) {
+  
+  char c = '\0';
+  
+  switch (i->type) {
+    case MPC_INPUT_STRING:
+    case MPC_INPUT_MMAP: return i->state.pos < (long)i->length ? i->string[i->state.pos] : '\0';
+    case MPC_INPUT_FILE: 
+      
+      c = fgetc(i->file);
+      if (feof(i->file)) { return '\0'; }
+      
+      fseek(i->file, -1, SEEK_CUR);
+      return c;
+    
+    case MPC_INPUT_PIPE:
+      
+      if (!mpc_input_buffer_active(i)) {
+        c = getc(i->file);
+        if (feof(i->file)) { return '\0'; }
+        ungetc(c, i->file);
+        return c;
+      }
+      
+      if (mpc_input_buffer_in_range(i)) {
+        return mpc_input_buffer_get(i);
+      } else {
+        c = getc(i->file);
+        if (feof(i->file)) { return '\0'; }
+        ungetc(c, i->file);
+        return c;
+      }
+    
+    default: return c;
+  }
+  
+}
+
+static int mpc_input_failure(mpc_input_t *i, char c) {
+
+  switch (i->type) {
+    case MPC_INPUT_STRING:
+    case MPC_INPUT_MMAP: { break; }
+    case MPC_INPUT_FILE: fseek(i->file, -1, SEEK_CUR); { break; }
+    case MPC_INPUT_PIPE: {
+      
+      if (!mpc_input_buffer_active(i)) { ungetc(c, i->file); break; }
+      
+      if (mpc_input_buffer_in_range(i)) {
+        break;
+      } else {
+        ungetc(c, i->file); 
+      }
+    }
+    default: { break; }
+  }
+  return 0;
+}
+
+/*
+** A slice over a stream has nowhere to point
+** so the chars it passes are kept, at their
+** offset from where the outermost slice began.
+** Rewinding and reading again overwrites them.
+*/
+
+static void mpc_input_slice_push(mpc_input_t *i, char c) {
+  long n = i->state.pos - i->slice_pos;
+  if (n >= i->slice_slots) {
+    i->slice_slots = i->slice_slots ? i->slice_slots * 2 : MPC_INPUT_BUFFER_MIN;
+    i->slice = realloc(i->slice, i->slice_slots);
+  }
+  i->slice[n] = c;
+}
+
+static int mpc_input_success(mpc_input_t *i, char c, char **o) {
+  
+  if (i->type == MPC_INPUT_PIPE
+  &&  mpc_input_buffer_active(i) && !mpc_input_buffer_in_range(i)) {
+    mpc_input_buffer_push(i, c);
+  }
+  
+  if (i->slicing && !mpc_input_buffered(i)) { mpc_input_slice_push(i, c); }
+  
+  i->last = c;
+  i->state.pos++;
+  i->state.col++;
+  
+  if (c == '\n') {
+    i->state.col = 0;
+    i->state.row++;
+  }
+  
+  if (o) {
+    (*o) = mpc_malloc(i, 2);
+    (*o)[0] = c;
+    (*o)[1] = '\0';
+  }
+  
+  return 1;
+}
+
+/*
+** Character classes - `oneof`, `noneof` and
+** `range` - are stored as a bitmap with one bit
+** for each of the 256 byte values.
+*/
+
+typedef unsigned char mpc_charset_t[32];
+
+static void mpc_charset_add(unsigned char *s, int c) { s[c >> 3] |= 1 << (c & 7); }
+static int mpc_charset_has(const unsigned char *s, int c) { return s[c >> 3] & (1 << (c & 7)); }
+
+static void mpc_charset_union(unsigned char *s, const unsigned char *t) {
+  int j;
+  for (j = 0; j < 32; j++) { s[j] |= t[j]; }
+}
+
+static int mpc_charset_disjoint(const unsigned char *s, const unsigned char *t) {
+  int j;
+  for (j = 0; j < 32; j++) { if (s[j] & t[j]) { return 0; } }
+  return 1;
+}
+
+static int mpc_input_any(mpc_input_t *i, char **o) {
+  char x = mpc_input_getc(i);
+  if (mpc_input_terminated(i)) { return 0; }
+  return mpc_input_success(i, x, o);
+}
+
+static int mpc_input_char(mpc_input_t *i, char c, char **o) {
+  char x = mpc_input_getc(i);
+  if (mpc_input_terminated(i)) { return 0; }
+  return x == c ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
+}
+
+static int mpc_input_class(mpc_input_t *i, const unsigned char *set, char **o) {
+  char x = mpc_input_getc(i);
+  if (mpc_input_terminated(i)) { return 0; }
+  return mpc_charset_has(set, (unsigned char)x) ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);
+}
+
+static int mpc_input_satisfy(mpc_input_t *i, int(*cond)(char), char **o) {
+  char x = mpc_input_getc(i);
+  if (mpc_input_terminated(i)) { return 0; }
+  return cond(x) ? mpc_input_success(i, x, o) : mpc_input_failure(i, x);  
+}
+
+/* Moves a buffered input forward to `end` and returns the chars passed over, if `o` is given */
+static void mpc_input_consume(mpc_input_t *i, long end, char **o) {
+  
+  long start = i->state.pos;
+  const char *s = i->string + start, *e = i->string + end, *nl;
+  
+  while ((nl = memchr(s, '\n', e - s))) {
+    i->state.col = 0;
+    i->state.row++;
+    s = nl + 1;
+  }
+  i->state.col += e - s;
+  if (end > start) { i->last = i->string[end - 1]; }
+  i->state.pos = end;
+  
+  if (o == NULL) { return; }
+  *o = mpc_malloc(i, end - start + 1);
+  memcpy(*o, i->string + start, end - start);
+  (*o)[end - start] = '\0';
+}
+
+/*
+** Literals on inputs held in memory are
+** compared in one go against the rest of
+** the buffer, which saves a call per char
+** and the mark needed to undo a partial
+** match. Streams still go char by char.
+**
+** Without backtracking the char by char path
+** cannot undo a partial match, it stops just
+** before the first char that differs. The
+** buffered path leaves the input there too,
+** so every kind of input gives the same parse.
+*/
+
+static int mpc_input_string(mpc_input_t *i, const char *c, char **o) {
+  
+  const char *x = c;
+  size_t n, k, left;
+  
+  if (mpc_input_buffered(i)) {
+    n = strlen(c);
+    left = i->length - i->state.pos;
+    if (n <= left && memcmp(i->string + i->state.pos, c, n) == 0) {
+      mpc_input_consume(i, i->state.pos + n, o);
+      return 1;
+    }
+    if (i->backtrack < 1) {
+      for (k = 0; k < n && k < left && i->string[i->state.pos + k] == c[k]; k++);
+      mpc_input_consume(i, i->state.pos + k, NULL);
+    }
+    return 0;
+  }
+  
+  mpc_input_mark(i);
+  while (*x) {
+    if (!mpc_input_char(i, *x, NULL)) {
+      mpc_input_rewind(i);
+      return 0;
+    }
+    x++;
+  }
+  mpc_input_unmark(i);
+  
+  if (o == NULL) { return 1; }
+  *o = mpc_malloc(i, strlen(c) + 1);
+  strcpy(*o, c);
+  return 1;
+}
+
+static int mpc_input_anchor(mpc_input_t* i, int(*f)(char,char), char **o) {
+  if (o) { *o = NULL; }
+  return f(i->last, mpc_input_peekc(i));
+}
+
+static mpc_state_t *mpc_input_state_copy(mpc_input_t *i) {
+  mpc_state_t *r = mpc_malloc(i, sizeof(mpc_state_t));
+  memcpy(r, &i->state, sizeof(mpc_state_t));
+  return r;
+}
+
+/*
+** Error Type
+*/
+
+void mpc_err_delete(mpc_err_t *x) {
+  int i;
+  for (i = 0; i < x->expected_num; i++) { free(x->expected[i]); }
+  free(x->expected);
+  free(x->filename);
+  free(x->failure);
+  free(x);
+}
+
+void mpc_err_print(mpc_err_t *x) {
+  mpc_err_print_to(x, stdout);
+}
+
+void mpc_err_print_to(mpc_err_t *x, FILE *f) {
+  char *str = mpc_err_string(x);
+  fprintf(f, "%s", str);
+  free(str);
+}
+
+static void mpc_err_string_cat(char *buffer, int *pos, int *max, char const *fmt, ...) {
+  /* TODO: Error Checking on Length */
+  int left = ((*max) - (*pos));
+  va_list va;
+  va_start(va, fmt);
+  if (left < 0) { left = 0;}
+  (*pos) += vsprintf(buffer + (*pos), fmt, va);
+  va_end(va);
+}
+
+/*
+** The buffer is supplied by the caller so that
+** error strings can be built from several
+** threads at once.
+*/
+
+static const char *mpc_err_char_unescape(char c, char *char_unescape_buffer) {
+  
+  char_unescape_buffer[0] = '\'';
+  char_unescape_buffer[1] = ' ';
+  char_unescape_buffer[2] = '\'';
+  char_unescape_buffer[3] = '\0';
+  
+  switch (c) {
+    case '\a': return "bell";
+    case '\b': return "backspace";
+    case '\f': return "formfeed";
+    case '\r': return "carriage return";
+    case '\v': return "vertical tab";
+    case '\0': return "end of input";
+    case '\n': return "newline";
+    case '\t': return "tab";
+    case ' ' : return "space";
+    default:
+      char_unescape_buffer[1] = c;
+      return char_unescape_buffer;
+  }
+  
+}
+
+char *mpc_err_string(mpc_err_t *x) {
+
+  int i;  
+  int pos = 0; 
+  int max = 1023;
+  char unescape[4];
+  char *buffer = calloc(1, 1024);
+  
+  if (x->failure) {
+    mpc_err_string_cat(buffer, &pos, &max,
+    "%s: error: %s\n", x->filename, x->failure);
+    return buffer;
+  }
+  
+  mpc_err_string_cat(buffer, &pos, &max, 
+    "%s:%i:%i: error: expected ", x->filename, x->state.row+1, x->state.col+1);
+  
+  if (x->expected_num == 0) { mpc_err_string_cat(buffer, &pos, &max, "ERROR: NOTHING EXPECTED"); }
+  if (x->expected_num == 1) { mpc_err_string_cat(buffer, &pos, &max, "%s", x->expected[0]); }
+  if (x->expected_num >= 2) {
+  
+    for (i = 0; i < x->expected_num-2; i++) {
+      mpc_err_string_cat(buffer, &pos, &max, "%s, ", x->expected[i]);
+    } 
+    
+    mpc_err_string_cat(buffer, &pos, &max, "%s or %s", 
+      x->expected[x->expected_num-2], 
+      x->expected[x->expected_num-1]);
+  }
+  
+  mpc_err_string_cat(buffer, &pos, &max, " at ");
+  mpc_err_string_cat(buffer, &pos, &max, mpc_err_char_unescape(x->recieved, unescape));
+  mpc_err_string_cat(buffer, &pos, &max, "\n");
+  
+  return realloc(buffer, strlen(buffer) + 1);
+}
+
+static mpc_err_t *mpc_err_file(const char *filename, const char *failure) {
+  mpc_err_t *x;
+  x = malloc(sizeof(mpc_err_t));
+  x->filename = malloc(strlen(filename) + 1);
+  strcpy(x->filename, filename);
+  x->state = mpc_state_new();
+  x->expected_num = 0;
+  x->expected = NULL;
+  x->failure = malloc(strlen(failure) + 1);
+  strcpy(x->failure, failure);
+  x->recieved = ' ';
+  return x;
+}
+
+/*
+** Failures
+*/
+
+static mpc_fail_t *mpc_fail_new(mpc_input_t *i, const char *expected, const char *failure) {
+  mpc_fail_t *x;
+  if (i->suppress) { return NULL; }
+  x = mpc_malloc(i, sizeof(mpc_fail_t));
+  x->state = i->state;
+  x->expected = expected;
+  x->failure = failure;
+  x->recieved = failure ? ' ' : mpc_input_peekc(i);
+  return x;
+}
+
+static mpc_fail_t *mpc_fail_copy(mpc_input_t *i, mpc_fail_t *x) {
+  mpc_fail_t *y;
+  if (x == NULL) { return NULL; }
+  y = mpc_malloc(i, sizeof(mpc_fail_t));
+  memcpy(y, x, sizeof(mpc_fail_t));
+  return y;
+}
+
+/* Expectations built during the parse belong to the input, so failures can share them */
+static const char *mpc_fail_string(mpc_input_t *i, char *s) {
+  if (i->strings_num == i->strings_slots) {
+    i->strings_slots = i->strings_slots ? i->strings_slots * 2 : 8;
+    i->strings = realloc(i->strings, sizeof(char*) * i->strings_slots);
+  }
+  i->strings[i->strings_num++] = s;
+  return s;
+}
+
+static mpc_fail_t *mpc_fail_repeat(mpc_input_t *i, mpc_fail_t *x, const char *prefix) {
+  
+  char *expect;
+  
+  if (x == NULL) { return NULL; }
+  
+  /* Only the failure message is ever shown */
+  if (x->failure) {
+    x->expected = "";
+    return x;
+  }
+  
+  expect = malloc(strlen(prefix) + strlen(x->expected) + 1);
+  strcpy(expect, prefix);
+  strcat(expect, x->expected);
+  x->expected = mpc_fail_string(i, expect);
+  return x;
+}
+
+static mpc_fail_t *mpc_fail_many1(mpc_input_t *i, mpc_fail_t *x) {
+  return mpc_fail_repeat(i, x, "one or more of ");
+}
+
+static mpc_fail_t *mpc_fail_count(mpc_input_t *i, mpc_fail_t *x, int n) {
+  char prefix[32];
+  sprintf(prefix, "%i of ", n);
+  return mpc_fail_repeat(i, x, prefix);
+}
+
+/*
+** The farthest failures merge the same way
+** the errors built from them would - the ones
+** at the farthest position are kept, in the
+** order they happened and without repeats,
+** and a failure message there takes over from
+** anything expected.
+*/
+
+static mpc_farthest_t *mpc_farthest_new(void) {
+  mpc_farthest_t *e = malloc(sizeof(mpc_farthest_t));
+  e->state = mpc_state_invalid();
+  e->recieved = ' ';
+  e->failure = NULL;
+  e->expected_num = 0;
+  e->expected_slots = 0;
+  e->expected = NULL;
+  return e;
+}
+
+static void mpc_farthest_delete(mpc_farthest_t *e) {
+  if (e == NULL) { return; }
+  free(e->expected);
+  free(e);
+}
+
+static void mpc_farthest_reset(mpc_farthest_t *e, mpc_state_t s, const char *failure) {
+  e->state = s;
+  e->recieved = ' ';
+  e->failure = failure;
+  e->expected_num = 0;
+}
+
+static void mpc_farthest_add(mpc_farthest_t *e, const mpc_state_t *s, char recieved,
+  const char *failure, const char **expected, int n) {
+  
+  int j, k;
+  
+  if (s->pos < e->state.pos) { return; }
+  if (s->pos > e->state.pos) { mpc_farthest_reset(e, *s, NULL); }
+  if (e->failure) { return; }
+  if (failure) { e->failure = failure; return; }
+  
+  e->recieved = recieved;
+  
+  for (j = 0; j < n; j++) {
+    for (k = 0; k < e->expected_num; k++) {
+      if (e->expected[k] == expected[j] || strcmp(e->expected[k], expected[j]) == 0) { break; }
+    }
+    if (k < e->expected_num) { continue; }
+    if (e->expected_num == e->expected_slots) {
+      e->expected_slots = e->expected_slots ? e->expected_slots * 2 : 4;
+      e->expected = realloc(e->expected, sizeof(char*) * e->expected_slots);
+    }
+    e->expected[e->expected_num++] = expected[j];
+  }
+}
+
+static void mpc_farthest_fail(mpc_farthest_t *e, mpc_fail_t *x) {
+  mpc_farthest_add(e, &x->state, x->recieved, x->failure, &x->expected, 1);
+}
+
+static void mpc_farthest_merge(mpc_farthest_t *e, mpc_farthest_t *x) {
+  mpc_farthest_add(e, &x->state, x->recieved, x->failure, x->expected, x->expected_num);
+}
+
+/* Only now, with the parse failed, are the strings copied out */
+static mpc_err_t *mpc_farthest_err(mpc_input_t *i, mpc_farthest_t *e) {
+  
+  int j;
+  mpc_err_t *x = malloc(sizeof(mpc_err_t));
+  
+  x->filename = malloc(strlen(i->filename) + 1);
+  strcpy(x->filename, i->filename);
+  x->state = e->state;
+  x->expected_num = e->expected_num;
+  x->expected = e->expected_num ? malloc(sizeof(char*) * e->expected_num) : NULL;
+  for (j = 0; j < e->expected_num; j++) {
+    x->expected[j] = malloc(strlen(e->expected[j]) + 1);
+    strcpy(x->expected[j], e->expected[j]);
+  }
+  x->failure = NULL;
+  if (e->failure) {
+    x->failure = malloc(strlen(e->failure) + 1);
+    strcpy(x->failure, e->failure);
+  }
+  x->recieved = e->recieved;
+  return x;
+}
+
+/*
+** Parser Type
+*/
+
+enum {
+  MPC_TYPE_UNDEFINED = 0,
+  MPC_TYPE_PASS      = 1,
+  MPC_TYPE_FAIL      = 2,
+  MPC_TYPE_LIFT      = 3,
+  MPC_TYPE_LIFT_VAL  = 4,
+  MPC_TYPE_EXPECT    = 5,
+  MPC_TYPE_ANCHOR    = 6,
+  MPC_TYPE_STATE     = 7,
+  
+  MPC_TYPE_ANY       = 8,
+  MPC_TYPE_SINGLE    = 9,
+  MPC_TYPE_ONEOF     = 10,
+  MPC_TYPE_NONEOF    = 11,
+  MPC_TYPE_RANGE     = 12,
+  MPC_TYPE_SATISFY   = 13,
+  MPC_TYPE_STRING    = 14,
+  
+  MPC_TYPE_APPLY     = 15,
+  MPC_TYPE_APPLY_TO  = 16,
+  MPC_TYPE_PREDICT   = 17,
+  MPC_TYPE_NOT       = 18,
+  MPC_TYPE_MAYBE     = 19,
+  MPC_TYPE_MANY      = 20,
+  MPC_TYPE_MANY1     = 21,
+  MPC_TYPE_COUNT     = 22,
+  
+  MPC_TYPE_OR        = 23,
+  MPC_TYPE_AND       = 24,
+  
+  MPC_TYPE_DFA       = 25,
+  MPC_TYPE_SPAN      = 26,
+  MPC_TYPE_MEMO      = 27,
+  MPC_TYPE_NATIVE    = 28,
+  MPC_TYPE_SLICE     = 29
+};
+
+typedef struct { char *m; } mpc_pdata_fail_t;
+typedef struct { mpc_ctor_t lf; void *x; } mpc_pdata_lift_t;
+typedef struct { mpc_parser_t *x; char *m; } mpc_pdata_expect_t;
+typedef struct { int(*f)(char,char); } mpc_pdata_anchor_t;
+typedef struct { char x; } mpc_pdata_single_t;
+typedef struct { char x; char y; unsigned char *set; } mpc_pdata_range_t;
+typedef struct { int(*f)(char); } mpc_pdata_satisfy_t;
+typedef struct { char *x; unsigned char *set; } mpc_pdata_string_t;
+typedef struct { mpc_parser_t *x; mpc_apply_t f; } mpc_pdata_apply_t;
+typedef struct { mpc_parser_t *x; mpc_apply_to_t f; void *d; } mpc_pdata_apply_to_t;
+typedef struct { mpc_parser_t *x; } mpc_pdata_predict_t;
+typedef struct { mpc_parser_t *x; mpc_dtor_t dx; mpc_ctor_t lf; } mpc_pdata_not_t;
+typedef struct { int n; mpc_fold_t f; mpc_parser_t *x; mpc_dtor_t dx; } mpc_pdata_repeat_t;
+typedef struct { int n; mpc_parser_t **xs; unsigned char *first; char *nullable; int *dispatch; } mpc_pdata_or_t;
+typedef struct { int n; mpc_fold_t f; mpc_parser_t **xs; mpc_dtor_t *dxs;  } mpc_pdata_and_t;
+typedef struct { mpc_parser_t *x; int n; int *trans; char *accept; } mpc_pdata_dfa_t;
+typedef struct { mpc_parser_t *x; int min; const unsigned char *set; int nranges; unsigned char ranges[16]; } mpc_pdata_span_t;
+typedef struct { mpc_parser_t *x; mpc_apply_t copy; mpc_dtor_t dx; } mpc_pdata_memo_t;
+typedef struct { mpc_native_t f; } mpc_pdata_native_t;
+typedef struct { mpc_parser_t *x; mpc_slice_t f; } mpc_pdata_slice_t;
+
+typedef union {
+  mpc_pdata_fail_t fail;
+  mpc_pdata_lift_t lift;
+  mpc_pdata_expect_t expect;
+  mpc_pdata_anchor_t anchor;
+  mpc_pdata_single_t single;
+  mpc_pdata_range_t range;
+  mpc_pdata_satisfy_t satisfy;
+  mpc_pdata_string_t string;
+  mpc_pdata_apply_t apply;
+  mpc_pdata_apply_to_t apply_to;
+  mpc_pdata_predict_t predict;
+  mpc_pdata_not_t not;
+  mpc_pdata_repeat_t repeat;
+  mpc_pdata_and_t and;
+  mpc_pdata_or_t or;
+  mpc_pdata_dfa_t dfa;
+  mpc_pdata_span_t span;
+  mpc_pdata_memo_t memo;
+  mpc_pdata_native_t native;
+  mpc_pdata_slice_t slice;
+} mpc_pdata_t;
+
+struct mpc_parser_t {
+  char *name;
+  mpc_pdata_t data;
+  char type;
+  char retained;
+#ifdef MPC_PROFILE
+  mpc_profile_t profile;
+#endif
+};
+
+static mpc_val_t *mpcf_input_nth_free(mpc_input_t *i, int n, mpc_val_t **xs, int x) {
+  int j;
+  for (j = 0; j < n; j++) { if (j != x) { mpc_free(i, xs[j]); } }
+  return xs[x];
+}
+ 
+static mpc_val_t *mpcf_input_fst_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 0); }
+static mpc_val_t *mpcf_input_snd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 1); }
+static mpc_val_t *mpcf_input_trd_free(mpc_input_t *i, int n, mpc_val_t **xs) { return mpcf_input_nth_free(i, n, xs, 2); }
+
+static mpc_val_t *mpcf_input_strfold(mpc_input_t *i, int n, mpc_val_t **xs) {
+  int j;
+  size_t l = 0;
+  if (n == 0) { return mpc_calloc(i, 1, 1); }
+  for (j = 0; j < n; j++) { l += strlen(xs[j]); }
+  xs[0] = mpc_realloc(i, xs[0], l + 1);
+  for (j = 1; j < n; j++) { strcat(xs[0], xs[j]); mpc_free(i, xs[j]); }
+  return xs[0];
+}
+
+static mpc_val_t *mpcf_input_state_ast(mpc_input_t *i, int n, mpc_val_t **xs) {
+  mpc_state_t *s = ((mpc_state_t**)xs)[0];
+  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
+  a = mpc_ast_state(a, *s);
+  mpc_free(i, s);
+  (void) n;
+  return a;
+}
+
+static mpc_val_t *mpc_parse_fold(mpc_input_t *i, mpc_fold_t f, int n, mpc_val_t **xs) {
+  int j;
+  if (i->slicing)          { return NULL; }
+  if (f == mpcf_null)      { return mpcf_null(n, xs); }
+  if (f == mpcf_fst)       { return mpcf_fst(n, xs); }
+  if (f == mpcf_snd)       { return mpcf_snd(n, xs); }
+  if (f == mpcf_trd)       { return mpcf_trd(n, xs); }
+  if (f == mpcf_fst_free)  { return mpcf_input_fst_free(i, n, xs); }
+  if (f == mpcf_snd_free)  { return mpcf_input_snd_free(i, n, xs); }
+  if (f == mpcf_trd_free)  { return mpcf_input_trd_free(i, n, xs); }
+  if (f == mpcf_strfold)   { return mpcf_input_strfold(i, n, xs); }
+  if (f == mpcf_state_ast) { return mpcf_input_state_ast(i, n, xs); }
+  for (j = 0; j < n; j++) { xs[j] = mpc_export(i, xs[j]); }
+  return f(j, xs);
+}
+
+static mpc_val_t *mpcf_input_free(mpc_input_t *i, mpc_val_t *x) {
+  mpc_free(i, x);
+  return NULL;
+}
+
+static mpc_val_t *mpcf_input_str_ast(mpc_input_t *i, mpc_val_t *c) {
+  mpc_ast_t *a = mpc_ast_new("", c);
+  mpc_free(i, c);
+  return a;
+}
+
+static mpc_val_t *mpc_parse_apply(mpc_input_t *i, mpc_apply_t f, mpc_val_t *x) {
+  if (i->slicing)         { return NULL; }
+  if (f == mpcf_free)     { return mpcf_input_free(i, x); }
+  if (f == mpcf_str_ast)  { return mpcf_input_str_ast(i, x); }
+  return f(mpc_export(i, x));
+}
+
+static mpc_val_t *mpc_parse_apply_to(mpc_input_t *i, mpc_apply_to_t f, mpc_val_t *x, mpc_val_t *d) {
+  if (i->slicing) { return NULL; }
+  return f(mpc_export(i, x), d);
+}
+
+static void mpc_parse_dtor(mpc_input_t *i, mpc_dtor_t d, mpc_val_t *x) {
+  if (i->slicing) { return; }
+  if (d == free) { mpc_free(i, x); return; }
+  d(mpc_export(i, x));
+}
+
+/*
+** Inside a slice every result is NULL, so
+** nothing is built and no callback is run.
+** Only the outermost slice hands on its text,
+** from the input itself when it is in memory.
+*/
+
+static mpc_val_t *mpc_parse_slice(mpc_input_t *i, mpc_slice_t f, long start) {
+  long n = i->state.pos - start;
+  if (mpc_input_buffered(i)) { return f(i->string + start, n); }
+  return f(n ? i->slice : "", n);
+}
+
+/*
+** A DFA runs only on inputs held in memory.
+** It steps through the table until no state
+** is left and keeps the longest prefix that
+** reached an accepting state. Like prediction
+** it leaves out the expectations the original
+** parser records where it stops, so it is off
+** when a failed parse is run again.
+*/
+
+static int mpc_parse_dfa(mpc_input_t *i, mpc_pdata_dfa_t *d, char **o) {
+  
+  const unsigned char *s = (const unsigned char*)i->string;
+  long start = i->state.pos;
+  long last = d->accept[0] ? start : -1;
+  long j;
+  int q = 0;
+  
+  for (j = start; j < (long)i->length; j++) {
+    q = d->trans[q * 256 + s[j]];
+    if (q < 0) { break; }
+    if (d->accept[q]) { last = j + 1; }
+  }
+  
+  if (last < 0) { return 0; }
+  
+  mpc_input_consume(i, last, o);
+  return 1;
+}
+
+/*
+** A span is a string folded `many` or `many1`
+** of a single class. On buffered inputs the run
+** is measured in one pass, with SSE4.2 or AVX2
+** when the class is a handful of byte ranges
+** and the CPU has them.
+*/
+
+static size_t mpc_span_scalar(const unsigned char *s, size_t n, const unsigned char *set) {
+  size_t j = 0;
+  while (j < n && mpc_charset_has(set, s[j])) { j++; }
+  return j;
+}
+
+#ifdef MPC_USE_SIMD
+
+__attribute__((target("sse4.2")))
+static size_t mpc_span_sse42(const unsigned char *s, size_t n, const mpc_pdata_span_t *d) {
+  
+  __m128i ranges = _mm_loadu_si128((const __m128i*)d->ranges);
+  size_t j = 0;
+  int k;
+  
+  while (j + 16 <= n) {
+    k = _mm_cmpestri(ranges, d->nranges * 2, _mm_loadu_si128((const __m128i*)(s + j)), 16,
+      _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+    if (k < 16) { return j + k; }
+    j += 16;
+  }
+  
+  return j + mpc_span_scalar(s + j, n - j, d->set);
+}
+
+__attribute__((target("avx2")))
+static size_t mpc_span_avx2(const unsigned char *s, size_t n, const mpc_pdata_span_t *d) {
+  
+  __m256i lo[8], width[8], v, t, in;
+  unsigned int mask;
+  size_t j = 0;
+  int k;
+  
+  for (k = 0; k < d->nranges; k++) {
+    lo[k] = _mm256_set1_epi8((char)d->ranges[k * 2]);
+    width[k] = _mm256_set1_epi8((char)(d->ranges[k * 2 + 1] - d->ranges[k * 2]));
+  }
+  
+  /* A byte is in a range when its unsigned offset from the low end is at most the width */
+  while (j + 32 <= n) {
+    v = _mm256_loadu_si256((const __m256i*)(s + j));
+    in = _mm256_setzero_si256();
+    for (k = 0; k < d->nranges; k++) {
+      t = _mm256_sub_epi8(v, lo[k]);
+      in = _mm256_or_si256(in, _mm256_cmpeq_epi8(_mm256_min_epu8(t, width[k]), t));
+    }
+    mask = (unsigned int)_mm256_movemask_epi8(in);
+    if (mask != 0xFFFFFFFFu) { return j + __builtin_ctz(~mask); }
+    j += 32;
+  }
+  
+  return j + mpc_span_sse42(s + j, n - j, d);
+}
+
+#endif
+
+static size_t mpc_span_scan(const unsigned char *s, size_t n, const mpc_pdata_span_t *d) {
+#ifdef MPC_USE_SIMD
+  /* Most runs, such as the blanks between tokens, are over before a vector is loaded */
+  size_t j = 0;
+  while (j < n && j < 16 && mpc_charset_has(d->set, s[j])) { j++; }
+  if (j < 16) { return j; }
+  if (d->nranges > 0 && __builtin_cpu_supports("avx2")) { return j + mpc_span_avx2(s + j, n - j, d); }
+  if (d->nranges > 0 && __builtin_cpu_supports("sse4.2")) { return j + mpc_span_sse42(s + j, n - j, d); }
+  return j + mpc_span_scalar(s + j, n - j, d->set);
+#else
+  return mpc_span_scalar(s, n, d->set);
+#endif
+}
+
+static int mpc_parse_span(mpc_input_t *i, mpc_pdata_span_t *d, char **o) {
+  long start = i->state.pos;
+  size_t n = mpc_span_scan((const unsigned char*)i->string + start, i->length - start, d);
+  if ((long)n < d->min) { return 0; }
+  mpc_input_consume(i, start + n, o);
+  return 1;
+}
+
+/* The bitmap of a class parser, looking through unretained `expect`s */
+static const unsigned char *mpc_span_class(mpc_parser_t *p) {
+  while (p->type == MPC_TYPE_EXPECT && !p->retained) { p = p->data.expect.x; }
+  if (p->retained) { return NULL; }
+  switch (p->type) {
+    case MPC_TYPE_RANGE: return p->data.range.set;
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF: return p->data.string.set;
+    default: return NULL;
+  }
+}
+
+/* The class as inclusive byte ranges for the vector scans, if there are few enough */
+static void mpc_span_ranges(mpc_pdata_span_t *d) {
+  int c = 0, lo;
+  d->nranges = 0;
+  while (c < 256) {
+    if (!mpc_charset_has(d->set, c)) { c++; continue; }
+    lo = c;
+    while (c < 256 && mpc_charset_has(d->set, c)) { c++; }
+    if (d->nranges == 8) { d->nranges = 0; return; }
+    d->ranges[d->nranges * 2 + 0] = (unsigned char)lo;
+    d->ranges[d->nranges * 2 + 1] = (unsigned char)(c - 1);
+    d->nranges++;
+  }
+}
+
+enum {
+  MPC_PARSE_FRAMES_MIN = 64,
+  MPC_PARSE_VALUES_MIN = 64
+};
+
+/* The result of a parser inside the engine, its error is kept as a cheap failure */
+typedef union {
+  mpc_fail_t *error;
+  mpc_val_t *output;
+} mpc_step_t;
+
+/*
+** Packrat parsing. A memo parser stores its
+** result at each position, along with the
+** errors it merged on the way, so trying the
+** same rule at the same place again costs a
+** call to its `copy` rather than a parse.
+**
+** `copy` should share the value rather than
+** duplicate it, as `mpca_lang` does with a
+** reference on the AST. A deep copy would
+** make each hit cost as much as the subtree,
+** and a deep input quadratic.
+*/
+
+static void mpc_memo_clear(mpc_memo_t *m) {
+  if (m->p == NULL) { return; }
+  if (m->ok) { m->p->data.memo.dx(m->output); }
+  free(m->error);
+  mpc_farthest_delete(m->merged);
+  m->p = NULL;
+}
+
+static void mpc_memo_delete(mpc_input_t *i) {
+  int j;
+  if (i->memo == NULL) { return; }
+  for (j = 0; j < MPC_INPUT_MEMO_NUM; j++) { mpc_memo_clear(&i->memo[j]); }
+  free(i->memo);
+  i->memo_bytes = 0;
+}
+
+static mpc_memo_t *mpc_memo_slot(mpc_input_t *i, mpc_parser_t *p, long pos) {
+  size_t h = ((size_t)p >> 4) * 31 + (size_t)pos * 2654435761u;
+  if (i->memo == NULL) { i->memo = calloc(MPC_INPUT_MEMO_NUM, sizeof(mpc_memo_t)); }
+  return &i->memo[(h ^ (h >> 16)) % MPC_INPUT_MEMO_NUM];
+}
+
+static mpc_memo_t *mpc_memo_find(mpc_input_t *i, mpc_parser_t *p) {
+  mpc_memo_t *m = mpc_memo_slot(i, p, i->state.pos);
+  return m->p == p && m->pos == i->state.pos && m->backtrack == i->backtrack ? m : NULL;
+}
+
+/* Returns 0 if the result was not stored, the frame's merged expectations are then still its own */
+static int mpc_memo_store(mpc_input_t *i, mpc_frame_t *f, int x, mpc_step_t *r) {
+
+  mpc_pdata_memo_t *d = &f->p->data.memo;
+  mpc_memo_t *m = mpc_memo_slot(i, f->p, f->pos);
+  size_t bytes = 0;
+
+  i->memo_bytes -= m->p ? m->bytes : 0;
+  mpc_memo_clear(m);
+
+  if (!x && r->error) { bytes += sizeof(mpc_fail_t); }
+  if (f->merged) { bytes += sizeof(mpc_farthest_t) + sizeof(char*) * f->merged->expected_slots; }
+  if (i->memo_bytes + bytes > MPC_INPUT_MEMO_BYTES) { return 0; }
+  i->memo_bytes += bytes;
+
+  m->p = f->p;
+  m->pos = f->pos;
+  m->backtrack = i->backtrack;
+  m->ok = x;
+  m->output = x ? d->copy(r->output) : NULL;
+  m->error = NULL;
+  /* Stored failures live on the heap so they do not crowd out the input's small blocks */
+  if (!x && r->error) {
+    m->error = malloc(sizeof(mpc_fail_t));
+    memcpy(m->error, r->error, sizeof(mpc_fail_t));
+  }
+  m->merged = f->merged;
+  m->state = i->state;
+  m->last = i->last;
+  m->bytes = bytes;
+  return 1;
+}
+
+/*
+** With prediction on, an `or` only tries the
+** alternatives that can start with the next
+** char, going straight to the one alternative
+** when they are disjoint. The ones skipped
+** would have failed, so the result is the same,
+** but their expectations are missing from the
+** errors - a failed parse is run again without
+** prediction to report them.
+*/
+
+static int mpc_parse_or_next(mpc_input_t *i, mpc_pdata_or_t *d, int j) {
+
+  int c;
+
+  if (!i->predict || d->first == NULL) { return j + 1 < d->n ? j + 1 : -1; }
+
+  c = i->state.pos < (long)i->length ? (unsigned char)i->string[i->state.pos] : -1;
+
+  if (d->dispatch) {
+    if (j >= 0) { return -1; }
+    j = c < 0 ? -1 : d->dispatch[c];
+    i->skipped += d->n - (j >= 0);
+    return j;
+  }
+
+  for (j = j + 1; j < d->n; j++) {
+    if (d->nullable[j] || (c >= 0 && mpc_charset_has(d->first + j * sizeof(mpc_charset_t), c))) { return j; }
+    i->skipped++;
+  }
+  return -1;
+}
+
+/*
+** The parse engine. Rather than recursing in C
+** it keeps a stack of frames on the input, one
+** for each parser in progress, so how deeply
+** the input can nest is limited only by memory.
+** Results collected along the way - by `and`,
+** `many` and `count` - go on a second stack
+** until they are folded.
+**
+** Calling a parser pushes its frame and moves
+** on to its first child. When a parser is done
+** its frame is popped and the result is handed
+** back to the frame below. Primitives, and
+** parsers that only pass their child's result
+** on, do not need a frame at all.
+*/
+
+static void mpc_parse_grow(mpc_input_t *i) {
+  if (i->frames_num == i->frames_slots) {
+    i->frames_slots = i->frames_slots ? i->frames_slots * 2 : MPC_PARSE_FRAMES_MIN;
+    i->frames = realloc(i->frames, sizeof(mpc_frame_t) * i->frames_slots);
+  }
+  if (i->values_num == i->values_slots) {
+    i->values_slots = i->values_slots ? i->values_slots * 2 : MPC_PARSE_VALUES_MIN;
+    i->values = realloc(i->values, sizeof(mpc_val_t*) * i->values_slots);
+  }
+}
+
+static mpc_frame_t *mpc_parse_push(mpc_input_t *i, mpc_parser_t *p) {
+  mpc_frame_t *f;
+  if (i->frames_num == i->frames_slots) { mpc_parse_grow(i); }
+  f = &i->frames[i->frames_num++];
+  f->p = p;
+  f->j = 0;
+  f->base = i->values_num;
+#ifdef MPC_PROFILE
+  f->profiled = 0;
+#endif
+  return f;
+}
+
+#ifdef MPC_PROFILE
+
+static double mpc_profile_now(void) {
+#if defined(__unix__) || defined(__APPLE__)
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*
+** A named parser gets a frame of its own
+** under the one it runs in, which sees its
+** result first and counts it.
+*/
+
+static void mpc_profile_enter(mpc_input_t *i, mpc_parser_t *p) {
+  mpc_frame_t *f = mpc_parse_push(i, p);
+  f->profiled = 1;
+  f->pos = i->state.pos;
+  f->named = i->named;
+  f->start = p->profile.active++ ? 0.0 : mpc_profile_now();
+  p->profile.calls++;
+  i->named = &p->profile;
+}
+
+static void mpc_profile_leave(mpc_input_t *i, mpc_frame_t *f, int x) {
+  mpc_profile_t *s = &f->p->profile;
+  if (x) {
+    s->passes++;
+    s->consumed += i->state.pos - f->pos;
+  } else {
+    s->fails++;
+  }
+  if (--s->active == 0) { s->time += mpc_profile_now() - f->start; }
+  i->named = f->named;
+}
+
+#endif
+
+static void mpc_parse_value(mpc_input_t *i, mpc_val_t *x) {
+  if (i->values_num == i->values_slots) { mpc_parse_grow(i); }
+  i->values[i->values_num++] = x;
+}
+
+/*
+** A native parser runs over the input in
+** memory. A stream is read to its end first,
+** then read again up to where the parser got,
+** with a mark held so a pipe keeps the chars.
+*/
+
+static int mpc_parse_native(mpc_input_t *i, mpc_native_t f, mpc_farthest_t *e, mpc_val_t **o) {
+  
+  int x, j;
+  char *buf = NULL;
+  long n = 0, slots = 0, k, row, col;
+  mpc_native_input_t in;
+  mpc_state_t s;
+  
+  in.state = i->state;
+  in.last = i->last;
+  in.fail = -1;
+  in.failure = NULL;
+  in.expected_num = 0;
+  
+  if (mpc_input_buffered(i)) {
+    in.string = i->string;
+    in.length = i->length;
+    in.pos = i->state.pos;
+  } else {
+    mpc_input_mark(i);
+    mpc_input_mark(i);
+    while (1) {
+      if (n + 1 >= slots) {
+        slots = slots ? slots * 2 : MPC_INPUT_BUFFER_MIN;
+        buf = realloc(buf, slots);
+      }
+      if (!mpc_input_any(i, NULL)) { break; }
+      buf[n++] = i->last;
+    }
+    buf[n] = '\0';
+    mpc_input_rewind(i);
+    in.string = buf;
+    in.length = n;
+    in.pos = 0;
+  }
+  
+  k = in.pos;
+  x = f(&in, o);
+  
+  if (in.fail >= k && !i->suppress) {
+    /* Rows and columns are only worked out for the failure actually reported */
+    row = i->state.row;
+    col = i->state.col;
+    for (; k < in.fail; k++) {
+      if (in.string[k] == '\n') { row++; col = 0; } else { col++; }
+    }
+    s.pos = mpc_input_buffered(i) ? in.fail : i->state.pos + in.fail;
+    s.row = row;
+    s.col = col;
+    if (in.failure) {
+      mpc_farthest_add(e, &s, ' ', in.failure, NULL, 0);
+    } else {
+      for (j = 0; j < in.expected_num; j++) {
+        mpc_farthest_add(e, &s, in.fail < in.length ? in.string[in.fail] : '\0', NULL, &in.expected[j], 1);
+      }
+    }
+  }
+  
+  if (mpc_input_buffered(i)) {
+    if (x) { mpc_input_consume(i, in.pos, NULL); }
+    return x;
+  }
+  
+  if (x) { for (k = 0; k < in.pos; k++) { mpc_input_any(i, NULL); } }
+  mpc_input_unmark(i);
+  free(buf);
+  return x;
+}
+
+/* Failures go to the innermost memo frame collecting them, or else the input's farthest */
+static mpc_farthest_t *mpc_parse_farthest(mpc_input_t *i, int errs) {
+  if (errs < 0) { return &i->farthest; }
+  if (i->frames[errs].merged == NULL) { i->frames[errs].merged = mpc_farthest_new(); }
+  return i->frames[errs].merged;
+}
+
+static void mpc_parse_merge(mpc_input_t *i, int errs, mpc_fail_t *x) {
+  if (x == NULL) { return; }
+  mpc_farthest_fail(mpc_parse_farthest(i, errs), x);
+  mpc_free(i, x);
+}
+
+static int mpc_parse_run(mpc_input_t *i, mpc_parser_t *p, mpc_step_t *r) {
+
+  int k, x = 0, errs = -1, base = i->frames_num;
+  char **o;
+  mpc_frame_t *f;
+  mpc_memo_t *m;
+  mpc_step_t y;
+
+call:
+
+#ifdef MPC_PROFILE
+  if (p->name) { mpc_profile_enter(i, p); }
+#endif
+
+  o = (char**)&y.output;
+  if (i->slicing) { o = NULL; y.output = NULL; }
+
+  switch (p->type) {
+
+    /* Basic Parsers */
+
+    case MPC_TYPE_ANY:     x = mpc_input_any(i, o); goto primitive;
+    case MPC_TYPE_SINGLE:  x = mpc_input_char(i, p->data.single.x, o); goto primitive;
+    case MPC_TYPE_RANGE:   x = mpc_input_class(i, p->data.range.set, o); goto primitive;
+    case MPC_TYPE_ONEOF:   x = mpc_input_class(i, p->data.string.set, o); goto primitive;
+    case MPC_TYPE_NONEOF:  x = mpc_input_class(i, p->data.string.set, o); goto primitive;
+    case MPC_TYPE_SATISFY: x = mpc_input_satisfy(i, p->data.satisfy.f, o); goto primitive;
+    case MPC_TYPE_STRING:  x = mpc_input_string(i, p->data.string.x, o); goto primitive;
+    case MPC_TYPE_ANCHOR:  x = mpc_input_anchor(i, p->data.anchor.f, o); goto primitive;
+
+    /* Other parsers */
+
+    case MPC_TYPE_UNDEFINED: x = 0; y.error = mpc_fail_new(i, NULL, "Parser Undefined!"); goto resume;
+    case MPC_TYPE_PASS:      x = 1; y.output = NULL; goto resume;
+    case MPC_TYPE_FAIL:      x = 0; y.error = mpc_fail_new(i, NULL, p->data.fail.m); goto resume;
+    case MPC_TYPE_LIFT:      x = 1; y.output = o ? p->data.lift.lf() : NULL; goto resume;
+    case MPC_TYPE_LIFT_VAL:  x = 1; y.output = p->data.lift.x; goto resume;
+    case MPC_TYPE_STATE:     x = 1; y.output = o ? mpc_input_state_copy(i) : NULL; goto resume;
+
+    /* Application Parsers */
+
+    case MPC_TYPE_APPLY:    mpc_parse_push(i, p); p = p->data.apply.x; goto call;
+    case MPC_TYPE_APPLY_TO: mpc_parse_push(i, p); p = p->data.apply_to.x; goto call;
+
+    case MPC_TYPE_EXPECT:
+      mpc_parse_push(i, p);
+      mpc_input_suppress_enable(i);
+      p = p->data.expect.x;
+      goto call;
+
+    case MPC_TYPE_PREDICT:
+      mpc_parse_push(i, p);
+      mpc_input_backtrack_disable(i);
+      p = p->data.predict.x;
+      goto call;
+
+    /* Optional Parsers */
+
+    case MPC_TYPE_NOT:
+      mpc_parse_push(i, p);
+      mpc_input_mark(i);
+      mpc_input_suppress_enable(i);
+      p = p->data.not.x;
+      goto call;
+
+    case MPC_TYPE_MAYBE: mpc_parse_push(i, p); p = p->data.not.x; goto call;
+
+    /* Repeat Parsers */
+
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      mpc_parse_push(i, p);
+      p = p->data.repeat.x;
+      goto call;
+
+    /* Combinatory Parsers */
+
+    case MPC_TYPE_OR:
+      if (p->data.or.n == 0) { x = 1; y.output = NULL; goto resume; }
+      f = mpc_parse_push(i, p);
+      f->j = mpc_parse_or_next(i, &p->data.or, -1);
+      if (f->j < 0) { x = 0; y.error = NULL; goto pop; }
+      p = p->data.or.xs[f->j];
+      goto call;
+
+    case MPC_TYPE_AND:
+      if (p->data.and.n == 0) { x = 1; y.output = NULL; goto resume; }
+      mpc_parse_push(i, p);
+      mpc_input_mark(i);
+      p = p->data.and.xs[0];
+      goto call;
+
+    /* Compiled Regex */
+
+    case MPC_TYPE_DFA:
+      if (i->predict && mpc_parse_dfa(i, &p->data.dfa, o)) {
+        /* The expectations of the stop char are missing, as with a skipped alternative */
+        i->skipped++;
+        x = 1;
+        goto resume;
+      }
+      /* Streams, and failures that need the error message, use the original parser */
+      p = p->data.dfa.x;
+      goto call;
+
+    case MPC_TYPE_SPAN:
+      if (mpc_input_buffered(i) && mpc_parse_span(i, &p->data.span, o)) {
+        /* The class fails on the char after the run, giving the same error `many` leaves */
+        f = mpc_parse_push(i, p);
+        f->output = y.output;
+        p = p->data.span.x->data.repeat.x;
+        goto call;
+      }
+      p = p->data.span.x;
+      goto call;
+
+    case MPC_TYPE_MEMO:
+      /* Only random access inputs, and only when errors are being kept */
+      if (!mpc_input_buffered(i) || i->suppress || i->slicing) { p = p->data.memo.x; goto call; }
+
+      m = mpc_memo_find(i, p);
+      if (m) {
+        i->memo_hits++;
+        i->state = m->state;
+        i->last = m->last;
+        if (m->merged) { mpc_farthest_merge(mpc_parse_farthest(i, errs), m->merged); }
+        x = m->ok;
+        if (x) { y.output = p->data.memo.copy(m->output); }
+        else   { y.error = mpc_fail_copy(i, m->error); }
+        goto resume;
+      }
+
+      i->memo_misses++;
+      f = mpc_parse_push(i, p);
+      f->pos = i->state.pos;
+      f->errs = errs;
+      f->merged = NULL;
+      errs = i->frames_num - 1;
+      p = p->data.memo.x;
+      goto call;
+
+    case MPC_TYPE_NATIVE:
+      x = mpc_parse_native(i, p->data.native.f, mpc_parse_farthest(i, errs), (mpc_val_t**)o);
+      if (!x) { y.error = NULL; }
+      goto resume;
+
+    case MPC_TYPE_SLICE:
+      f = mpc_parse_push(i, p);
+      f->pos = i->state.pos;
+      if (i->slicing++ == 0) { i->slice_pos = i->state.pos; }
+      p = p->data.slice.x;
+      goto call;
+
+    default:
+      x = 0;
+      y.error = mpc_fail_new(i, NULL, "Unknown Parser Type Id!");
+      goto resume;
+  }
+
+primitive:
+
+  if (!x) { y.error = NULL; }
+
+resume:
+
+  /* Hand the result `x`, `y` to the parser on top of the stack */
+
+  if (i->frames_num == base) {
+    *r = y;
+    return x;
+  }
+
+  f = &i->frames[i->frames_num - 1];
+  p = f->p;
+
+#ifdef MPC_PROFILE
+  if (f->profiled) { mpc_profile_leave(i, f, x); goto pop; }
+#endif
+
+  switch (p->type) {
+
+    case MPC_TYPE_APPLY:
+      if (x) { y.output = mpc_parse_apply(i, p->data.apply.f, y.output); }
+      goto pop;
+
+    case MPC_TYPE_APPLY_TO:
+      if (x) { y.output = mpc_parse_apply_to(i, p->data.apply_to.f, y.output, p->data.apply_to.d); }
+      goto pop;
+
+    case MPC_TYPE_EXPECT:
+      mpc_input_suppress_disable(i);
+      if (!x) { y.error = mpc_fail_new(i, p->data.expect.m, NULL); }
+      goto pop;
+
+    case MPC_TYPE_PREDICT:
+      mpc_input_backtrack_enable(i);
+      goto pop;
+
+    /* TODO: Update Not Error Message */
+
+    case MPC_TYPE_NOT:
+      if (x) {
+        mpc_input_rewind(i);
+        mpc_input_suppress_disable(i);
+        mpc_parse_dtor(i, p->data.not.dx, y.output);
+        x = 0;
+        y.error = mpc_fail_new(i, "opposite", NULL);
+      } else {
+        mpc_input_unmark(i);
+        mpc_input_suppress_disable(i);
+        x = 1;
+        y.output = i->slicing ? NULL : p->data.not.lf();
+      }
+      goto pop;
+
+    case MPC_TYPE_MAYBE:
+      if (!x) {
+        mpc_parse_merge(i, errs, y.error);
+        x = 1;
+        y.output = i->slicing ? NULL : p->data.not.lf();
+      }
+      goto pop;
+
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+
+      if (x) {
+        mpc_parse_value(i, y.output);
+        f = &i->frames[i->frames_num - 1];
+        f->j++;
+        if (p->type != MPC_TYPE_COUNT || f->j != p->data.repeat.n) {
+          p = p->data.repeat.x;
+          goto call;
+        }
+        y.output = mpc_parse_fold(i, p->data.repeat.f, f->j, i->values + f->base);
+        goto pop;
+      }
+
+      if (p->type == MPC_TYPE_COUNT) {
+        for (k = 0; k < f->j; k++) { mpc_parse_dtor(i, p->data.repeat.dx, i->values[f->base + k]); }
+        y.error = mpc_fail_count(i, y.error, p->data.repeat.n);
+        goto pop;
+      }
+
+      if (p->type == MPC_TYPE_MANY1 && f->j == 0) {
+        y.error = mpc_fail_many1(i, y.error);
+        goto pop;
+      }
+
+      mpc_parse_merge(i, errs, y.error);
+      x = 1;
+      y.output = mpc_parse_fold(i, p->data.repeat.f, f->j, i->values + f->base);
+      goto pop;
+
+    case MPC_TYPE_OR:
+      if (x) { goto pop; }
+      mpc_parse_merge(i, errs, y.error);
+      f->j = mpc_parse_or_next(i, &p->data.or, f->j);
+      if (f->j < 0) { y.error = NULL; goto pop; }
+      p = p->data.or.xs[f->j];
+      goto call;
+
+    case MPC_TYPE_AND:
+
+      if (!x) {
+        mpc_input_rewind(i);
+        for (k = 0; k < f->j; k++) { mpc_parse_dtor(i, p->data.and.dxs[k], i->values[f->base + k]); }
+        goto pop;
+      }
+
+      mpc_parse_value(i, y.output);
+      f = &i->frames[i->frames_num - 1];
+      f->j++;
+      if (f->j != p->data.and.n) {
+        p = p->data.and.xs[f->j];
+        goto call;
+      }
+      mpc_input_unmark(i);
+      y.output = mpc_parse_fold(i, p->data.and.f, f->j, i->values + f->base);
+      goto pop;
+
+    case MPC_TYPE_SPAN:
+      mpc_parse_merge(i, errs, y.error);
+      x = 1;
+      y.output = f->output;
+      goto pop;
+
+    case MPC_TYPE_SLICE:
+      if (--i->slicing == 0 && x) { y.output = mpc_parse_slice(i, p->data.slice.f, f->pos); }
+      goto pop;
+
+    case MPC_TYPE_MEMO:
+      errs = f->errs;
+      if (f->merged) { mpc_farthest_merge(mpc_parse_farthest(i, errs), f->merged); }
+      if (!mpc_memo_store(i, f, x, &y)) { mpc_farthest_delete(f->merged); }
+      goto pop;
+
+    default: break;
+  }
+
+pop:
+
+  f = &i->frames[--i->frames_num];
+  i->values_num = f->base;
+  goto resume;
+
+}
+
+
+int mpc_parse_input(mpc_input_t *i, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_step_t y;
+  mpc_state_t start = i->state;
+  char last = i->last;
+  mpc_input_t *outer = mpc_ast_input;
+  
+  mpc_farthest_reset(&i->farthest, mpc_state_invalid(), "Unknown Error");
+  
+  mpc_ast_input = i;
+  
+  i->predict = mpc_input_buffered(i);
+  i->skipped = 0;
+  x = mpc_parse_run(i, p, &y);
+  i->predict = 0;
+  
+  if (!x && i->skipped) {
+    mpc_free(i, y.error);
+    mpc_memo_delete(i);
+    i->memo = NULL;
+    i->state = start;
+    i->last = last;
+    mpc_farthest_reset(&i->farthest, mpc_state_invalid(), "Unknown Error");
+    x = mpc_parse_run(i, p, &y);
+  }
+  
+  mpc_ast_input = outer;
+  
+  if (x) {
+    r->output = mpc_export(i, y.output);
+    /* A tree returned goes with its arena, the next parse starts a new one */
+    if (i->arena && r->output && mpc_ast_arena_owns(i->arena, r->output)) {
+      mpc_ast_arena_close(i->arena);
+      i->arena = NULL;
+    }
+  } else {
+    mpc_parse_merge(i, -1, y.error);
+    r->error = mpc_farthest_err(i, &i->farthest);
+  }
+  return x;
+}
+
+int mpc_parse(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_string(filename, string);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_nparse(const char *filename, const char *string, size_t length, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_nstring(filename, string, length);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = NULL;
+  
+#ifdef MPC_USE_MMAP
+  i = mpc_input_new_mmap(filename, file);
+  if (i) {
+    x = mpc_parse_input(i, p, r);
+    /* Leave the stream where a File input would have left it */
+    fseek(file, i->state.pos, SEEK_SET);
+    mpc_input_delete(i);
+    return x;
+  }
+#endif
+  
+  i = mpc_input_new_file(filename, file);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_pipe(filename, pipe);
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
+  
+  FILE *f = fopen(filename, "rb");
+  int res;
+  
+  if (f == NULL) {
+    r->output = NULL;
+    r->error = mpc_err_file(filename, "Unable to open file!");
+    return 0;
+  }
+  
+  res = mpc_parse_file(filename, f, p, r);
+  fclose(f);
+  return res;
+}
+
+/*
+** Building a Parser
+*/
+
+static void mpc_undefine_unretained(mpc_parser_t *p, int force);
+
+static void mpc_undefine_or(mpc_parser_t *p) {
+  
+  int i;
+  for (i = 0; i < p->data.or.n; i++) {
+    mpc_undefine_unretained(p->data.or.xs[i], 0);
+  }
+  free(p->data.or.xs);
+  free(p->data.or.first);
+  free(p->data.or.nullable);
+  free(p->data.or.dispatch);
+  
+}
+
+static void mpc_undefine_and(mpc_parser_t *p) {
+  
+  int i;
+  for (i = 0; i < p->data.and.n; i++) {
+    mpc_undefine_unretained(p->data.and.xs[i], 0);
+  }
+  free(p->data.and.xs);
+  free(p->data.and.dxs);
+  
+}
+
+static void mpc_undefine_unretained(mpc_parser_t *p, int force) {
+  
+  if (p->retained && !force) { return; }
+  
+  switch (p->type) {
+    
+    case MPC_TYPE_FAIL: free(p->data.fail.m); break;
+    
+    case MPC_TYPE_ONEOF: 
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_STRING:
+      free(p->data.string.x); 
+      free(p->data.string.set);
+      break;
+    
+    case MPC_TYPE_RANGE: free(p->data.range.set); break;
+    
+    case MPC_TYPE_APPLY:    mpc_undefine_unretained(p->data.apply.x, 0);    break;
+    case MPC_TYPE_APPLY_TO: mpc_undefine_unretained(p->data.apply_to.x, 0); break;
+    case MPC_TYPE_PREDICT:  mpc_undefine_unretained(p->data.predict.x, 0);  break;
+    
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_NOT:
+      mpc_undefine_unretained(p->data.not.x, 0);
+      break;
+    
+    case MPC_TYPE_EXPECT:
+      mpc_undefine_unretained(p->data.expect.x, 0);
+      free(p->data.expect.m);
+      break;
+      
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      mpc_undefine_unretained(p->data.repeat.x, 0);
+      break;
+    
+    case MPC_TYPE_OR:  mpc_undefine_or(p);  break;
+    case MPC_TYPE_AND: mpc_undefine_and(p); break;
+    
+    case MPC_TYPE_DFA:
+      mpc_undefine_unretained(p->data.dfa.x, 0);
+      free(p->data.dfa.trans);
+      free(p->data.dfa.accept);
+      break;
+    
+    case MPC_TYPE_SPAN: mpc_undefine_unretained(p->data.span.x, 0); break;
+    case MPC_TYPE_MEMO: mpc_undefine_unretained(p->data.memo.x, 0); break;
+    case MPC_TYPE_SLICE: mpc_undefine_unretained(p->data.slice.x, 0); break;
+    
+    default: break;
+  }
+  
+  if (!force) {
+    free(p->name);
+    free(p);
+  }
+  
+}
+
+void mpc_delete(mpc_parser_t *p) {
+  if (p->retained) {
+
+    if (p->type != MPC_TYPE_UNDEFINED) {
+      mpc_undefine_unretained(p, 0);
+    } 
+    
+    free(p->name);
+    free(p);
+  
+  } else {
+    mpc_undefine_unretained(p, 0);  
+  }
+}
+
+static void mpc_soft_delete(mpc_val_t *x) {
+  mpc_undefine_unretained(x, 0);
+}
+
+static mpc_parser_t *mpc_undefined(void) {
+  mpc_parser_t *p = calloc(1, sizeof(mpc_parser_t));
+  p->retained = 0;
+  p->type = MPC_TYPE_UNDEFINED;
+  p->name = NULL;
+  return p;
+}
+
+mpc_parser_t *mpc_new(const char *name) {
+  mpc_parser_t *p = mpc_undefined();
+  p->retained = 1;
+  p->name = realloc(p->name, strlen(name) + 1);
+  strcpy(p->name, name);
+  return p;
+}
+
+mpc_parser_t *mpc_copy(mpc_parser_t *a) {
+  int i = 0;
+  mpc_parser_t *p;
+  
+  if (a->retained) { return a; }
+  
+  p = mpc_undefined();
+  p->retained = a->retained;
+  p->type = a->type;
+  p->data = a->data;
+  
+  if (a->name) {
+    p->name = malloc(strlen(a->name)+1);
+    strcpy(p->name, a->name);
+  }
+  
+  switch (a->type) {
+    
+    case MPC_TYPE_FAIL:
+      p->data.fail.m = malloc(strlen(a->data.fail.m)+1);
+      strcpy(p->data.fail.m, a->data.fail.m);
+    break;
+    
+    case MPC_TYPE_ONEOF: 
+    case MPC_TYPE_NONEOF:
+    case MPC_TYPE_STRING:
+      p->data.string.x = malloc(strlen(a->data.string.x)+1);
+      strcpy(p->data.string.x, a->data.string.x);
+      if (a->data.string.set) {
+        p->data.string.set = malloc(sizeof(mpc_charset_t));
+        memcpy(p->data.string.set, a->data.string.set, sizeof(mpc_charset_t));
+      }
+      break;
+    
+    case MPC_TYPE_RANGE:
+      p->data.range.set = malloc(sizeof(mpc_charset_t));
+      memcpy(p->data.range.set, a->data.range.set, sizeof(mpc_charset_t));
+      break;
+    
+    case MPC_TYPE_APPLY:    p->data.apply.x    = mpc_copy(a->data.apply.x);    break;
+    case MPC_TYPE_APPLY_TO: p->data.apply_to.x = mpc_copy(a->data.apply_to.x); break;
+    case MPC_TYPE_PREDICT:  p->data.predict.x  = mpc_copy(a->data.predict.x);  break;
+    
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_NOT:
+      p->data.not.x = mpc_copy(a->data.not.x);
+      break;
+    
+    case MPC_TYPE_EXPECT:
+      p->data.expect.x = mpc_copy(a->data.expect.x);
+      p->data.expect.m = malloc(strlen(a->data.expect.m)+1);
+      strcpy(p->data.expect.m, a->data.expect.m);
+      break;
+      
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      p->data.repeat.x = mpc_copy(a->data.repeat.x);
+      break;
+    
+    case MPC_TYPE_OR:
+      p->data.or.xs = malloc(a->data.or.n * sizeof(mpc_parser_t*));
+      for (i = 0; i < a->data.or.n; i++) {
+        p->data.or.xs[i] = mpc_copy(a->data.or.xs[i]);
+      }
+      /* Prediction tables are rebuilt by `mpc_optimise` */
+      p->data.or.first = NULL;
+      p->data.or.nullable = NULL;
+      p->data.or.dispatch = NULL;
+    break;
+    case MPC_TYPE_AND:
+      p->data.and.xs = malloc(a->data.and.n * sizeof(mpc_parser_t*));
+      for (i = 0; i < a->data.and.n; i++) {
+        p->data.and.xs[i] = mpc_copy(a->data.and.xs[i]);
+      }
+      p->data.and.dxs = malloc((a->data.and.n-1) * sizeof(mpc_dtor_t));
+      for (i = 0; i < a->data.and.n-1; i++) {
+        p->data.and.dxs[i] = a->data.and.dxs[i];
+      }
+    break;
+    case MPC_TYPE_DFA:
+      p->data.dfa.x = mpc_copy(a->data.dfa.x);
+      p->data.dfa.trans = malloc(a->data.dfa.n * 256 * sizeof(int));
+      memcpy(p->data.dfa.trans, a->data.dfa.trans, a->data.dfa.n * 256 * sizeof(int));
+      p->data.dfa.accept = malloc(a->data.dfa.n);
+      memcpy(p->data.dfa.accept, a->data.dfa.accept, a->data.dfa.n);
+    break;
+    case MPC_TYPE_SPAN:
+      p->data.span.x = mpc_copy(a->data.span.x);
+      p->data.span.set = mpc_span_class(p->data.span.x->data.repeat.x);
+    break;
+    case MPC_TYPE_MEMO:
+      p->data.memo.x = mpc_copy(a->data.memo.x);
+    break;
+    case MPC_TYPE_SLICE: p->data.slice.x = mpc_copy(a->data.slice.x); break;
+    
+    default: break;
+  }
+
+  
+  return p;
+}
+
+mpc_parser_t *mpc_undefine(mpc_parser_t *p) {
+  mpc_undefine_unretained(p, 1);
+  p->type = MPC_TYPE_UNDEFINED;
+  return p;
+}
+
+mpc_parser_t *mpc_define(mpc_parser_t *p, mpc_parser_t *a) {
+  
+  if (p->retained) {
+    p->type = a->type;
+    p->data = a->data;
+  } else {
+    mpc_parser_t *a2 = mpc_failf("Attempt to assign to Unretained Parser!");
+    p->type = a2->type;
+    p->data = a2->data;
+    free(a2);
+  }
+  
+  free(a);
+  return p;  
+}
+
+void mpc_cleanup(int n, ...) {
+  int i;
+  mpc_parser_t **list = malloc(sizeof(mpc_parser_t*) * n);
+  
+  va_list va;
+  va_start(va, n);
+  for (i = 0; i < n; i++) { list[i] = va_arg(va, mpc_parser_t*); }
+  for (i = 0; i < n; i++) { mpc_undefine(list[i]); }
+  for (i = 0; i < n; i++) { mpc_delete(list[i]); }  
+  va_end(va);  
+
+  free(list);
+}
+
+mpc_parser_t *mpc_pass(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_PASS;
+  return p;
+}
+
+mpc_parser_t *mpc_fail(const char *m) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_FAIL;
+  p->data.fail.m = malloc(strlen(m) + 1);
+  strcpy(p->data.fail.m, m);
+  return p;
+}
+
+/*
+** As `snprintf` is not ANSI standard this 
+** function `mpc_failf` should be considered
+** unsafe.
+**
+** You have a few options if this is going to be
+** trouble.
+**
+** - Ensure the format string does not exceed
+**   the buffer length using precision specifiers
+**   such as `%.512s`.
+**
+** - Patch this function in your code base to 
+**   use `snprintf` or whatever variant your
+**   system supports.
+**
+** - Avoid it altogether.
+**
+*/
+
+mpc_parser_t *mpc_failf(const char *fmt, ...) {
+  
+  va_list va;
+  char *buffer;
+
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_FAIL;
+  
+  va_start(va, fmt);
+  buffer = malloc(2048);
+  vsprintf(buffer, fmt, va);
+  va_end(va);
+  
+  buffer = realloc(buffer, strlen(buffer) + 1);
+  p->data.fail.m = buffer;
+  return p;
+
+}
+
+mpc_parser_t *mpc_lift_val(mpc_val_t *x) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_LIFT_VAL;
+  p->data.lift.x = x;
+  return p;
+}
+
+mpc_parser_t *mpc_lift(mpc_ctor_t lf) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_LIFT;
+  p->data.lift.lf = lf;
+  return p;
+}
+
+mpc_parser_t *mpc_anchor(int(*f)(char,char)) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_ANCHOR;
+  p->data.anchor.f = f;
+  return mpc_expect(p, "anchor");
+}
+
+mpc_parser_t *mpc_state(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_STATE;
+  return p;
+}
+
+mpc_parser_t *mpc_native(mpc_native_t f) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_NATIVE;
+  p->data.native.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_expect(mpc_parser_t *a, const char *expected) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_EXPECT;
+  p->data.expect.x = a;
+  p->data.expect.m = malloc(strlen(expected) + 1);
+  strcpy(p->data.expect.m, expected);
+  return p;
+}
+
+/*
+** As `snprintf` is not ANSI standard this 
+** function `mpc_expectf` should be considered
+** unsafe.
+**
+** You have a few options if this is going to be
+** trouble.
+**
+** - Ensure the format string does not exceed
+**   the buffer length using precision specifiers
+**   such as `%.512s`.
+**
+** - Patch this function in your code base to 
+**   use `snprintf` or whatever variant your
+**   system supports.
+**
+** - Avoid it altogether.
+**
+*/
+
+mpc_parser_t *mpc_expectf(mpc_parser_t *a, const char *fmt, ...) {
+  va_list va;
+  char *buffer;
+
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_EXPECT;
+  
+  va_start(va, fmt);
+  buffer = malloc(2048);
+  vsprintf(buffer, fmt, va);
+  va_end(va);
+  
+  buffer = realloc(buffer, strlen(buffer) + 1);
+  p->data.expect.x = a;
+  p->data.expect.m = buffer;
+  return p;
+}
+
+/*
+** Basic Parsers
+*/
+
+mpc_parser_t *mpc_any(void) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_ANY;
+  return mpc_expect(p, "any character");
+}
+
+mpc_parser_t *mpc_char(char c) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_SINGLE;
+  p->data.single.x = c;
+  return mpc_expectf(p, "'%c'", c);
+}
+
+/* Bitmap of a class, with the same char comparisons and `strchr` as before */
+static unsigned char *mpc_class_set(int type, const char *s, char lo, char hi) {
+  int c;
+  char x;
+  unsigned char *set = calloc(1, sizeof(mpc_charset_t));
+  for (c = 0; c < 256; c++) {
+    x = (char)c;
+    if (type == MPC_TYPE_RANGE && (x < lo || x > hi)) { continue; }
+    if (type == MPC_TYPE_ONEOF && strchr(s, x) == 0) { continue; }
+    if (type == MPC_TYPE_NONEOF && strchr(s, x) != 0) { continue; }
+    mpc_charset_add(set, c);
+  }
+  return set;
+}
+
+mpc_parser_t *mpc_range(char s, char e) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_RANGE;
+  p->data.range.x = s;
+  p->data.range.y = e;
+  p->data.range.set = mpc_class_set(MPC_TYPE_RANGE, NULL, s, e);
+  return mpc_expectf(p, "character between '%c' and '%c'", s, e);
+}
+
+mpc_parser_t *mpc_oneof(const char *s) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_ONEOF;
+  p->data.string.x = malloc(strlen(s) + 1);
+  strcpy(p->data.string.x, s);
+  p->data.string.set = mpc_class_set(MPC_TYPE_ONEOF, s, 0, 0);
+  return mpc_expectf(p, "one of '%s'", s);
+}
+
+mpc_parser_t *mpc_noneof(const char *s) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_NONEOF;
+  p->data.string.x = malloc(strlen(s) + 1);
+  strcpy(p->data.string.x, s);
+  p->data.string.set = mpc_class_set(MPC_TYPE_NONEOF, s, 0, 0);
+  return mpc_expectf(p, "none of '%s'", s);
+
+}
+
+mpc_parser_t *mpc_satisfy(int(*f)(char)) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_SATISFY;
+  p->data.satisfy.f = f;
+  return mpc_expectf(p, "character satisfying function %p", f);
+}
+
+mpc_parser_t *mpc_string(const char *s) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_STRING;
+  p->data.string.x = malloc(strlen(s) + 1);
+  strcpy(p->data.string.x, s);
+  return mpc_expectf(p, "\"%s\"", s);
+}
+
+/*
+** Core Parsers
+*/
+
+mpc_parser_t *mpc_apply(mpc_parser_t *a, mpc_apply_t f) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_APPLY;
+  p->data.apply.x = a;
+  p->data.apply.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_apply_to(mpc_parser_t *a, mpc_apply_to_t f, void *x) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_APPLY_TO;
+  p->data.apply_to.x = a;
+  p->data.apply_to.f = f;
+  p->data.apply_to.d = x;
+  return p;
+}
+
+mpc_parser_t *mpc_predictive(mpc_parser_t *a) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_PREDICT;
+  p->data.predict.x = a;
+  return p;
+}
+
+mpc_parser_t *mpc_memo(mpc_parser_t *a, mpc_apply_t copy, mpc_dtor_t da) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MEMO;
+  p->data.memo.x = a;
+  p->data.memo.copy = copy;
+  p->data.memo.dx = da;
+  return p;
+}
+
+mpc_parser_t *mpc_slice(mpc_parser_t *a, mpc_slice_t f) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_SLICE;
+  p->data.slice.x = a;
+  p->data.slice.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_not_lift(mpc_parser_t *a, mpc_dtor_t da, mpc_ctor_t lf) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_NOT;
+  p->data.not.x = a;
+  p->data.not.dx = da;
+  p->data.not.lf = lf;
+  return p;
+}
+
+mpc_parser_t *mpc_not(mpc_parser_t *a, mpc_dtor_t da) {
+  return mpc_not_lift(a, da, mpcf_ctor_null);
+}
+
+mpc_parser_t *mpc_maybe_lift(mpc_parser_t *a, mpc_ctor_t lf) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MAYBE;
+  p->data.not.x = a;
+  p->data.not.lf = lf;
+  return p;
+}
+
+mpc_parser_t *mpc_maybe(mpc_parser_t *a) {
+  return mpc_maybe_lift(a, mpcf_ctor_null);
+}
+
+mpc_parser_t *mpc_many(mpc_fold_t f, mpc_parser_t *a) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MANY;
+  p->data.repeat.x = a;
+  p->data.repeat.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_many1(mpc_fold_t f, mpc_parser_t *a) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_MANY1;
+  p->data.repeat.x = a;
+  p->data.repeat.f = f;
+  return p;
+}
+
+mpc_parser_t *mpc_count(int n, mpc_fold_t f, mpc_parser_t *a, mpc_dtor_t da) {
+  mpc_parser_t *p = mpc_undefined();
+  p->type = MPC_TYPE_COUNT;
+  p->data.repeat.n = n;
+  p->data.repeat.f = f;
+  p->data.repeat.x = a;
+  p->data.repeat.dx = da;
+  return p;
+}
+
+mpc_parser_t *mpc_or(int n, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+  
+  p->type = MPC_TYPE_OR;
+  p->data.or.n = n;
+  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
+  
+  va_start(va, n);  
+  for (i = 0; i < n; i++) {
+    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  va_end(va);
+  
+  return p;
+}
+
+mpc_parser_t *mpc_and(int n, mpc_fold_t f, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+  
+  p->type = MPC_TYPE_AND;
+  p->data.and.n = n;
+  p->data.and.f = f;
+  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
+  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
+
+  va_start(va, f);  
+  for (i = 0; i < n; i++) {
+    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  for (i = 0; i < (n-1); i++) {
+    p->data.and.dxs[i] = va_arg(va, mpc_dtor_t);
+  }  
+  va_end(va);
+  
+  return p;
+}
+
+/*
+** Common Parsers
+*/
+
+static int mpc_soi_anchor(char prev, char next) { (void) next; return (prev == '\0'); }
+static int mpc_eoi_anchor(char prev, char next) { (void) prev; return (next == '\0'); }
+
+mpc_parser_t *mpc_soi(void) { return mpc_expect(mpc_anchor(mpc_soi_anchor), "start of input"); }
+mpc_parser_t *mpc_eoi(void) { return mpc_expect(mpc_anchor(mpc_eoi_anchor), "end of input"); }
+
+static int mpc_boundary_anchor(char prev, char next) {
+  const char* word = "abcdefghijklmnopqrstuvwxyz"
+                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                     "0123456789_";
+  if ( strchr(word, next) &&  prev == '\0') { return 1; }
+  if ( strchr(word, prev) &&  next == '\0') { return 1; }
+  if ( strchr(word, next) && !strchr(word, prev)) { return 1; }
+  if (!strchr(word, next) &&  strchr(word, prev)) { return 1; }
+  return 0;
+}
+
+mpc_parser_t *mpc_boundary(void) { return mpc_expect(mpc_anchor(mpc_boundary_anchor), "boundary"); }
+
+mpc_parser_t *mpc_whitespace(void) { return mpc_expect(mpc_oneof(" \f\n\r\t\v"), "whitespace"); }
+mpc_parser_t *mpc_whitespaces(void) { return mpc_expect(mpc_many(mpcf_strfold, mpc_whitespace()), "spaces"); }
+mpc_parser_t *mpc_blank(void) { return mpc_expect(mpc_apply(mpc_whitespaces(), mpcf_free), "whitespace"); }
+
+mpc_parser_t *mpc_newline(void) { return mpc_expect(mpc_char('\n'), "newline"); }
+mpc_parser_t *mpc_tab(void) { return mpc_expect(mpc_char('\t'), "tab"); }
+mpc_parser_t *mpc_escape(void) { return mpc_and(2, mpcf_strfold, mpc_char('\\'), mpc_any(), free); }
+
+mpc_parser_t *mpc_digit(void) { return mpc_expect(mpc_oneof("0123456789"), "digit"); }
+mpc_parser_t *mpc_hexdigit(void) { return mpc_expect(mpc_oneof("0123456789ABCDEFabcdef"), "hex digit"); }
+mpc_parser_t *mpc_octdigit(void) { return mpc_expect(mpc_oneof("01234567"), "oct digit"); }
+mpc_parser_t *mpc_digits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_digit()), "digits"); }
+mpc_parser_t *mpc_hexdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_hexdigit()), "hex digits"); }
+mpc_parser_t *mpc_octdigits(void) { return mpc_expect(mpc_many1(mpcf_strfold, mpc_octdigit()), "oct digits"); }
+
+mpc_parser_t *mpc_lower(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyz"), "lowercase letter"); }
+mpc_parser_t *mpc_upper(void) { return mpc_expect(mpc_oneof("ABCDEFGHIJKLMNOPQRSTUVWXYZ"), "uppercase letter"); }
+mpc_parser_t *mpc_alpha(void) { return mpc_expect(mpc_oneof("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"), "letter"); }
+mpc_parser_t *mpc_underscore(void) { return mpc_expect(mpc_char('_'), "underscore"); }
+mpc_parser_t *mpc_alphanum(void) { return mpc_expect(mpc_or(3, mpc_alpha(), mpc_digit(), mpc_underscore()), "alphanumeric"); }
+
+mpc_parser_t *mpc_int(void) { return mpc_expect(mpc_apply(mpc_digits(), mpcf_int), "integer"); }
+mpc_parser_t *mpc_hex(void) { return mpc_expect(mpc_apply(mpc_hexdigits(), mpcf_hex), "hexadecimal"); }
+mpc_parser_t *mpc_oct(void) { return mpc_expect(mpc_apply(mpc_octdigits(), mpcf_oct), "octadecimal"); }
+mpc_parser_t *mpc_number(void) { return mpc_expect(mpc_or(3, mpc_int(), mpc_hex(), mpc_oct()), "number"); }
+
+mpc_parser_t *mpc_real(void) {
+
+  /* [+-]?\d+(\.\d+)?([eE][+-]?[0-9]+)? */
+  
+  mpc_parser_t *p0, *p1, *p2, *p30, *p31, *p32, *p3;
+  
+  p0 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
+  p1 = mpc_digits();
+  p2 = mpc_maybe_lift(mpc_and(2, mpcf_strfold, mpc_char('.'), mpc_digits(), free), mpcf_ctor_str);
+  p30 = mpc_oneof("eE");
+  p31 = mpc_maybe_lift(mpc_oneof("+-"), mpcf_ctor_str);
+  p32 = mpc_digits();
+  p3 = mpc_maybe_lift(mpc_and(3, mpcf_strfold, p30, p31, p32, free, free), mpcf_ctor_str);
+  
+  return mpc_expect(mpc_and(4, mpcf_strfold, p0, p1, p2, p3, free, free, free), "real");
+
+}
+
+mpc_parser_t *mpc_float(void) {
+  return mpc_expect(mpc_apply(mpc_real(), mpcf_float), "float");
+}
+
+mpc_parser_t *mpc_char_lit(void) {
+  return mpc_expect(mpc_between(mpc_or(2, mpc_escape(), mpc_any()), free, "'", "'"), "char");
+}
+
+mpc_parser_t *mpc_string_lit(void) {
+  mpc_parser_t *strchar = mpc_or(2, mpc_escape(), mpc_noneof("\""));
+  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, strchar), free, "\"", "\""), "string");
+}
+
+mpc_parser_t *mpc_regex_lit(void) {  
+  mpc_parser_t *regexchar = mpc_or(2, mpc_escape(), mpc_noneof("/"));
+  return mpc_expect(mpc_between(mpc_many(mpcf_strfold, regexchar), free, "/", "/"), "regex");
+}
+
+mpc_parser_t *mpc_ident(void) {
+  mpc_parser_t *p0, *p1; 
+  p0 = mpc_or(2, mpc_alpha(), mpc_underscore());
+  p1 = mpc_many(mpcf_strfold, mpc_alphanum()); 
+  return mpc_and(2, mpcf_strfold, p0, p1, free);
+}
+
+/*
+** Useful Parsers
+*/
+
+mpc_parser_t *mpc_startwith(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_soi(), a, mpcf_dtor_null); }
+mpc_parser_t *mpc_endwith(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(2, mpcf_fst, a, mpc_eoi(), da); }
+mpc_parser_t *mpc_whole(mpc_parser_t *a, mpc_dtor_t da) { return mpc_and(3, mpcf_snd, mpc_soi(), a, mpc_eoi(), mpcf_dtor_null, da); }
+
+mpc_parser_t *mpc_stripl(mpc_parser_t *a) { return mpc_and(2, mpcf_snd, mpc_blank(), a, mpcf_dtor_null); }
+mpc_parser_t *mpc_stripr(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
+mpc_parser_t *mpc_strip(mpc_parser_t *a) { return mpc_and(3, mpcf_snd, mpc_blank(), a, mpc_blank(), mpcf_dtor_null, mpcf_dtor_null); }
+mpc_parser_t *mpc_tok(mpc_parser_t *a) { return mpc_and(2, mpcf_fst, a, mpc_blank(), mpcf_dtor_null); }
+mpc_parser_t *mpc_sym(const char *s) { return mpc_tok(mpc_string(s)); }
+
+mpc_parser_t *mpc_total(mpc_parser_t *a, mpc_dtor_t da) { return mpc_whole(mpc_strip(a), da); }
+
+mpc_parser_t *mpc_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
+  return mpc_and(3, mpcf_snd_free,
+    mpc_string(o), a, mpc_string(c),
+    free, ad);
+}
+
+mpc_parser_t *mpc_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "(", ")"); }
+mpc_parser_t *mpc_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_between(a, ad, "<", ">"); }
+mpc_parser_t *mpc_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_between(a, ad, "{", "}"); }
+mpc_parser_t *mpc_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_between(a, ad, "[", "]"); }
+
+mpc_parser_t *mpc_tok_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c) {
+  return mpc_and(3, mpcf_snd_free,
+    mpc_sym(o), mpc_tok(a), mpc_sym(c),
+    free, ad);
+}
+
+mpc_parser_t *mpc_tok_parens(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "(", ")"); }
+mpc_parser_t *mpc_tok_braces(mpc_parser_t *a, mpc_dtor_t ad)   { return mpc_tok_between(a, ad, "<", ">"); }
+mpc_parser_t *mpc_tok_brackets(mpc_parser_t *a, mpc_dtor_t ad) { return mpc_tok_between(a, ad, "{", "}"); }
+mpc_parser_t *mpc_tok_squares(mpc_parser_t *a, mpc_dtor_t ad)  { return mpc_tok_between(a, ad, "[", "]"); }
+
+/*
+** Regular Expression Parsers
+*/
+
+/*
+** So here is a cute bootstrapping.
+**
+** I'm using the previously defined
+** mpc constructs and functions to
+** parse the user regex string and
+** construct a parser from it.
+**
+** As it turns out lots of the standard
+** mpc functions look a lot like `fold`
+** functions and so can be used indirectly
+** by many of the parsing functions to build
+** a parser directly - as we are parsing.
+**
+** This is certainly something that
+** would be less elegant/interesting 
+** in a two-phase parser which first
+** builds an AST and then traverses it
+** to generate the object.
+**
+** This whole thing acts as a great
+** case study for how trivial it can be
+** to write a great parser in a few
+** lines of code using mpc.
+*/
+
+/*
+**
+**  ### Regular Expression Grammar
+**
+**      <regex> : <term> | (<term> "|" <regex>)
+**     
+**      <term> : <factor>*
+**
+**      <factor> : <base>
+**               | <base> "*"
+**               | <base> "+"
+**               | <base> "?"
+**               | <base> "{" <digits> "}"
+**           
+**      <base> : <char>
+**             | "\" <char>
+**             | "(" <regex> ")"
+**             | "[" <range> "]"
+*/
+
+static mpc_val_t *mpcf_re_or(int n, mpc_val_t **xs) {
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  else { return mpc_or(2, xs[0], xs[1]); }
+}
+
+static mpc_val_t *mpcf_re_and(int n, mpc_val_t **xs) {
+  int i;
+  mpc_parser_t *p = mpc_lift(mpcf_ctor_str);
+  for (i = 0; i < n; i++) {
+    p = mpc_and(2, mpcf_strfold, p, xs[i], free);
+  }
+  return p;
+}
+
+static mpc_val_t *mpcf_re_repeat(int n, mpc_val_t **xs) {
+  int num;
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  switch(((char*)xs[1])[0])
+  {
+    case '*': { free(xs[1]); return mpc_many(mpcf_strfold, xs[0]); }; break;
+    case '+': { free(xs[1]); return mpc_many1(mpcf_strfold, xs[0]); }; break;
+    case '?': { free(xs[1]); return mpc_maybe_lift(xs[0], mpcf_ctor_str); }; break;
+    default:
+      num = *(int*)xs[1];
+      free(xs[1]);
+  }
+  
+  return mpc_count(num, mpcf_strfold, xs[0], free);
+}
+
+static mpc_parser_t *mpc_re_escape_char(char c) {
+  switch (c) {
+    case 'a': return mpc_char('\a');
+    case 'f': return mpc_char('\f');
+    case 'n': return mpc_char('\n');
+    case 'r': return mpc_char('\r');
+    case 't': return mpc_char('\t');
+    case 'v': return mpc_char('\v');
+    case 'b': return mpc_and(2, mpcf_snd, mpc_boundary(), mpc_lift(mpcf_ctor_str), free);
+    case 'B': return mpc_not_lift(mpc_boundary(), free, mpcf_ctor_str);
+    case 'A': return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free);
+    case 'Z': return mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free);
+    case 'd': return mpc_digit();
+    case 'D': return mpc_not_lift(mpc_digit(), free, mpcf_ctor_str);
+    case 's': return mpc_whitespace();
+    case 'S': return mpc_not_lift(mpc_whitespace(), free, mpcf_ctor_str);
+    case 'w': return mpc_alphanum();
+    case 'W': return mpc_not_lift(mpc_alphanum(), free, mpcf_ctor_str);
+    default: return NULL;
+  }
+}
+
+static mpc_val_t *mpcf_re_escape(mpc_val_t *x) {
+  
+  char *s = x;
+  mpc_parser_t *p;
+  
+  /* Regex Special Characters */
+  if (s[0] == '.') { free(s); return mpc_any(); }
+  if (s[0] == '^') { free(s); return mpc_and(2, mpcf_snd, mpc_soi(), mpc_lift(mpcf_ctor_str), free); }
+  if (s[0] == '$') { free(s); return mpc_and(2, mpcf_snd, mpc_eoi(), mpc_lift(mpcf_ctor_str), free); }
+  
+  /* Regex Escape */
+  if (s[0] == '\\') {
+    p = mpc_re_escape_char(s[1]);
+    p = (p == NULL) ? mpc_char(s[1]) : p;
+    free(s);
+    return p;
+  }
+  
+  /* Regex Standard */
+  p = mpc_char(s[0]);
+  free(s);
+  return p;
+}
+
+static const char *mpc_re_range_escape_char(char c) {
+  switch (c) {
+    case '-': return "-";
+    case 'a': return "\a";
+    case 'f': return "\f";
+    case 'n': return "\n";
+    case 'r': return "\r";
+    case 't': return "\t";
+    case 'v': return "\v";
+    case 'b': return "\b";
+    case 'd': return "0123456789";
+    case 's': return " \f\n\r\t\v";
+    case 'w': return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+    default: return NULL;
+  }
+}
+
+static mpc_val_t *mpcf_re_range(mpc_val_t *x) {
+  
+  mpc_parser_t *out;
+  size_t i, j;
+  size_t start, end;
+  const char *tmp = NULL;
+  const char *s = x;
+  int comp = s[0] == '^' ? 1 : 0;
+  char *range = calloc(1,1);
+  
+  if (s[0] == '\0') { free(x); return mpc_fail("Invalid Regex Range Expression"); } 
+  if (s[0] == '^' && 
+      s[1] == '\0') { free(x); return mpc_fail("Invalid Regex Range Expression"); }
+  
+  for (i = comp; i < strlen(s); i++){
+    
+    /* Regex Range Escape */
+    if (s[i] == '\\') {
+      tmp = mpc_re_range_escape_char(s[i+1]);
+      if (tmp != NULL) {
+        range = realloc(range, strlen(range) + strlen(tmp) + 1);
+        strcat(range, tmp);
+      } else {
+        range = realloc(range, strlen(range) + 1 + 1);
+        range[strlen(range) + 1] = '\0';
+        range[strlen(range) + 0] = s[i+1];      
+      }
+      i++;
+    }
+    
+    /* Regex Range...Range */
+    else if (s[i] == '-') {
+      if (s[i+1] == '\0' || i == 0) {
+          range = realloc(range, strlen(range) + strlen("-") + 1);
+          strcat(range, "-");
+      } else {
+        start = s[i-1]+1;
+        end = s[i+1]-1;
+        for (j = start; j <= end; j++) {
+          range = realloc(range, strlen(range) + 1 + 1 + 1);
+          range[strlen(range) + 1] = '\0';
+          range[strlen(range) + 0] = (char)j;
+        }        
+      }
+    }
+    
+    /* Regex Range Normal */
+    else {
+      range = realloc(range, strlen(range) + 1 + 1);
+      range[strlen(range) + 1] = '\0';
+      range[strlen(range) + 0] = s[i];
+    }
+  
+  }
+  
+  out = comp == 1 ? mpc_noneof(range) : mpc_oneof(range);
+  
+  free(x);
+  free(range);
+  
+  return out;
+}
+
+static mpc_parser_t *mpc_re_dfa(mpc_parser_t *re);
+
+mpc_parser_t *mpc_re(const char *re) {
+  
+  char *err_msg;
+  mpc_parser_t *err_out;
+  mpc_result_t r;
+  mpc_parser_t *Regex, *Term, *Factor, *Base, *Range, *RegexEnclose; 
+  
+  Regex  = mpc_new("regex");
+  Term   = mpc_new("term");
+  Factor = mpc_new("factor");
+  Base   = mpc_new("base");
+  Range  = mpc_new("range");
+  
+  mpc_define(Regex, mpc_and(2, mpcf_re_or,
+    Term, 
+    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_char('|'), Regex, free)),
+    (mpc_dtor_t)mpc_delete
+  ));
+  
+  mpc_define(Term, mpc_many(mpcf_re_and, Factor));
+  
+  mpc_define(Factor, mpc_and(2, mpcf_re_repeat,
+    Base,
+    mpc_or(5,
+      mpc_char('*'), mpc_char('+'), mpc_char('?'),
+      mpc_brackets(mpc_int(), free),
+      mpc_pass()),
+    (mpc_dtor_t)mpc_delete
+  ));
+  
+  mpc_define(Base, mpc_or(4,
+    mpc_parens(Regex, (mpc_dtor_t)mpc_delete),
+    mpc_squares(Range, (mpc_dtor_t)mpc_delete),
+    mpc_apply(mpc_escape(), mpcf_re_escape),
+    mpc_apply(mpc_noneof(")|"), mpcf_re_escape)
+  ));
+  
+  mpc_define(Range, mpc_apply(
+    mpc_many(mpcf_strfold, mpc_or(2, mpc_escape(), mpc_noneof("]"))),
+    mpcf_re_range
+  ));
+  
+  RegexEnclose = mpc_whole(mpc_predictive(Regex), (mpc_dtor_t)mpc_delete);
+  
+  mpc_optimise(RegexEnclose);
+  mpc_optimise(Regex);
+  mpc_optimise(Term);
+  mpc_optimise(Factor);
+  mpc_optimise(Base);
+  mpc_optimise(Range);
+  
+  if(!mpc_parse("<mpc_re_compiler>", re, RegexEnclose, &r)) {
+    err_msg = mpc_err_string(r.error);
+    err_out = mpc_failf("Invalid Regex: %s", err_msg);
+    mpc_err_delete(r.error);  
+    free(err_msg);
+    r.output = err_out;
+  }
+  
+  mpc_cleanup(6, RegexEnclose, Regex, Term, Factor, Base, Range);
+  
+  mpc_optimise(r.output);
+  
+#ifndef MPC_NO_DFA
+  r.output = mpc_re_dfa(r.output);
+#endif
+  
+  return r.output;
+  
+}
+
+/*
+** Regular Expression DFA
+*/
+
+/*
+** The parser built by `mpc_re` is interpreted
+** one character at a time with marks and
+** backtracking. Where the regex is LL(1), so
+** that every choice, option and repetition is
+** decided by the next character alone, the
+** PEG match it performs is the longest match
+** of the regular language.
+**
+** Such regexes are compiled through a Thompson
+** NFA and the subset construction into a
+** minimal DFA transition table. Anchors,
+** boundaries and the negated classes `\D`,
+** `\S` and `\W` are not covered and keep the
+** interpreted parser.
+*/
+
+enum {
+  MPC_DFA_NFA_MAX    = 4096,
+  MPC_DFA_STATES_MAX = 256
+};
+
+/* The characters a single character parser accepts, 0 for other parsers */
+static int mpc_re_charset(mpc_parser_t *p, unsigned char *set) {
+  switch (p->type) {
+    case MPC_TYPE_ANY:
+      memset(set, 0xFF, sizeof(mpc_charset_t));
+      return 1;
+    case MPC_TYPE_SINGLE:
+      memset(set, 0, sizeof(mpc_charset_t));
+      mpc_charset_add(set, (unsigned char)p->data.single.x);
+      return 1;
+    case MPC_TYPE_RANGE:
+      memcpy(set, p->data.range.set, sizeof(mpc_charset_t));
+      return 1;
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+      memcpy(set, p->data.string.set, sizeof(mpc_charset_t));
+      return 1;
+    default: return 0;
+  }
+}
+
+/*
+** Computes the FIRST set and nullability of
+** `p` given the characters that may follow it.
+** Returns 0 if a decision inside `p` would
+** need more than one character of lookahead.
+*/
+
+static int mpc_re_ll1(mpc_parser_t *p, const unsigned char *follow, unsigned char *first, int *nullable) {
+  
+  mpc_charset_t f, g;
+  int j, n;
+  
+  if (mpc_re_charset(p, first)) { *nullable = 0; return 1; }
+  
+  memset(first, 0, sizeof(mpc_charset_t));
+  *nullable = 1;
+  
+  switch (p->type) {
+    
+    case MPC_TYPE_EXPECT:
+      return mpc_re_ll1(p->data.expect.x, follow, first, nullable);
+    
+    case MPC_TYPE_SPAN:
+      return mpc_re_ll1(p->data.span.x, follow, first, nullable);
+    
+    case MPC_TYPE_LIFT:
+      return p->data.lift.lf == mpcf_ctor_str;
+    
+    case MPC_TYPE_MAYBE:
+      if (p->data.not.lf != mpcf_ctor_str) { return 0; }
+      if (!mpc_re_ll1(p->data.not.x, follow, first, &n)) { return 0; }
+      return mpc_charset_disjoint(first, follow);
+    
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      if (p->data.repeat.f != mpcf_strfold) { return 0; }
+      if (!mpc_re_ll1(p->data.repeat.x, follow, first, &n)) { return 0; }
+      /* Each element may be followed by another */
+      memcpy(f, follow, sizeof(mpc_charset_t));
+      mpc_charset_union(f, first);
+      if (!mpc_re_ll1(p->data.repeat.x, f, first, &n) || n) { return 0; }
+      if (p->type == MPC_TYPE_COUNT) {
+        *nullable = p->data.repeat.n == 0;
+        return 1;
+      }
+      *nullable = p->type == MPC_TYPE_MANY;
+      return mpc_charset_disjoint(first, follow);
+    
+    case MPC_TYPE_OR:
+      *nullable = 0;
+      for (j = 0; j < p->data.or.n; j++) {
+        if (!mpc_re_ll1(p->data.or.xs[j], follow, g, &n)) { return 0; }
+        if (!mpc_charset_disjoint(first, g)) { return 0; }
+        /* An empty match always wins, so only the last choice may have one */
+        if (n && j != p->data.or.n-1) { return 0; }
+        mpc_charset_union(first, g);
+        *nullable = n;
+      }
+      return !*nullable || mpc_charset_disjoint(first, follow);
+    
+    case MPC_TYPE_AND:
+      if (p->data.and.f != mpcf_strfold) { return 0; }
+      memcpy(f, follow, sizeof(mpc_charset_t));
+      for (j = p->data.and.n-1; j >= 0; j--) {
+        if (!mpc_re_ll1(p->data.and.xs[j], f, g, &n)) { return 0; }
+        if (n) {
+          mpc_charset_union(first, g);
+          mpc_charset_union(f, g);
+        } else {
+          memcpy(first, g, sizeof(mpc_charset_t));
+          memcpy(f, g, sizeof(mpc_charset_t));
+          *nullable = 0;
+        }
+      }
+      return 1;
+    
+    default: return 0;
+  }
+  
+}
+
+typedef struct {
+  mpc_charset_t set;
+  int to;
+  int eps[2];
+} mpc_nfa_state_t;
+
+typedef struct {
+  int num;
+  int slots;
+  mpc_nfa_state_t *states;
+} mpc_nfa_t;
+
+static int mpc_nfa_new(mpc_nfa_t *a) {
+  mpc_nfa_state_t *q;
+  if (a->num == a->slots) {
+    a->slots = a->slots ? a->slots * 2 : 64;
+    a->states = realloc(a->states, sizeof(mpc_nfa_state_t) * a->slots);
+  }
+  q = &a->states[a->num];
+  memset(q->set, 0, sizeof(mpc_charset_t));
+  q->to = -1;
+  q->eps[0] = -1;
+  q->eps[1] = -1;
+  return a->num++;
+}
+
+/* Thompson construction, the fragment runs from `s` to `e` and `e` has no edges yet */
+static int mpc_nfa_build(mpc_nfa_t *a, mpc_parser_t *p, int *s, int *e) {
+  
+  int j, n, xs, xe, split, prev;
+  mpc_parser_t *x;
+  mpc_charset_t set;
+  
+  if (a->num > MPC_DFA_NFA_MAX) { return 0; }
+  
+  if (mpc_re_charset(p, set)) {
+    *s = mpc_nfa_new(a);
+    *e = mpc_nfa_new(a);
+    memcpy(a->states[*s].set, set, sizeof(mpc_charset_t));
+    a->states[*s].to = *e;
+    return 1;
+  }
+  
+  switch (p->type) {
+    
+    case MPC_TYPE_EXPECT:
+      return mpc_nfa_build(a, p->data.expect.x, s, e);
+    
+    case MPC_TYPE_SPAN:
+      return mpc_nfa_build(a, p->data.span.x, s, e);
+    
+    case MPC_TYPE_LIFT:
+      *s = mpc_nfa_new(a);
+      *e = mpc_nfa_new(a);
+      a->states[*s].eps[0] = *e;
+      return 1;
+    
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_MANY:
+      x = p->type == MPC_TYPE_MAYBE ? p->data.not.x : p->data.repeat.x;
+      if (!mpc_nfa_build(a, x, &xs, &xe)) { return 0; }
+      *s = mpc_nfa_new(a);
+      *e = mpc_nfa_new(a);
+      a->states[*s].eps[0] = xs;
+      a->states[*s].eps[1] = *e;
+      a->states[xe].eps[0] = p->type == MPC_TYPE_MAYBE ? *e : *s;
+      return 1;
+    
+    case MPC_TYPE_MANY1:
+      if (!mpc_nfa_build(a, p->data.repeat.x, &xs, &xe)) { return 0; }
+      *s = xs;
+      *e = mpc_nfa_new(a);
+      a->states[xe].eps[0] = xs;
+      a->states[xe].eps[1] = *e;
+      return 1;
+    
+    case MPC_TYPE_COUNT:
+    case MPC_TYPE_AND:
+      n = p->type == MPC_TYPE_COUNT ? p->data.repeat.n : p->data.and.n;
+      *s = mpc_nfa_new(a);
+      *e = *s;
+      for (j = 0; j < n; j++) {
+        x = p->type == MPC_TYPE_COUNT ? p->data.repeat.x : p->data.and.xs[j];
+        if (!mpc_nfa_build(a, x, &xs, &xe)) { return 0; }
+        a->states[*e].eps[0] = xs;
+        *e = xe;
+      }
+      return 1;
+    
+    case MPC_TYPE_OR:
+      *e = mpc_nfa_new(a);
+      prev = -1;
+      for (j = 0; j < p->data.or.n; j++) {
+        if (!mpc_nfa_build(a, p->data.or.xs[j], &xs, &xe)) { return 0; }
+        a->states[xe].eps[0] = *e;
+        split = mpc_nfa_new(a);
+        a->states[split].eps[0] = xs;
+        if (prev == -1) { *s = split; } else { a->states[prev].eps[1] = split; }
+        prev = split;
+      }
+      if (prev == -1) { *s = *e; }
+      return 1;
+    
+    default: return 0;
+  }
+  
+}
+
+static void mpc_nfa_closure(mpc_nfa_t *a, unsigned char *set, int *stack) {
+  
+  int j, q, t, top = 0;
+  
+  for (q = 0; q < a->num; q++) {
+    if (set[q >> 3] & (1 << (q & 7))) { stack[top++] = q; }
+  }
+  
+  while (top > 0) {
+    q = stack[--top];
+    for (j = 0; j < 2; j++) {
+      t = a->states[q].eps[j];
+      if (t < 0 || set[t >> 3] & (1 << (t & 7))) { continue; }
+      set[t >> 3] |= 1 << (t & 7);
+      stack[top++] = t;
+    }
+  }
+  
+}
+
+/* Subset construction. Returns the number of DFA states, 0 if there are too many */
+static int mpc_dfa_subsets(mpc_nfa_t *a, int start, int end, int **trans, char **accept) {
+  
+  int n = 1, d, b, q, j, found;
+  size_t width = (a->num + 7) / 8;
+  unsigned char *sets = calloc(MPC_DFA_STATES_MAX, width);
+  unsigned char *next = malloc(width);
+  int *stack = malloc(sizeof(int) * a->num);
+  
+  *trans = malloc(sizeof(int) * 256 * MPC_DFA_STATES_MAX);
+  *accept = malloc(MPC_DFA_STATES_MAX);
+  
+  sets[start >> 3] |= 1 << (start & 7);
+  mpc_nfa_closure(a, sets, stack);
+  
+  for (d = 0; d < n; d++) {
+    
+    (*accept)[d] = (sets[d * width + (end >> 3)] >> (end & 7)) & 1;
+    
+    for (b = 0; b < 256; b++) {
+      
+      found = 0;
+      memset(next, 0, width);
+      for (q = 0; q < a->num; q++) {
+        if ((sets[d * width + (q >> 3)] & (1 << (q & 7)))
+        &&  a->states[q].to >= 0
+        &&  mpc_charset_has(a->states[q].set, b)) {
+          next[a->states[q].to >> 3] |= 1 << (a->states[q].to & 7);
+          found = 1;
+        }
+      }
+      
+      if (!found) { (*trans)[d * 256 + b] = -1; continue; }
+      
+      mpc_nfa_closure(a, next, stack);
+      for (j = 0; j < n; j++) {
+        if (memcmp(sets + j * width, next, width) == 0) { break; }
+      }
+      
+      if (j == n) {
+        if (n == MPC_DFA_STATES_MAX) { n = 0; goto done; }
+        memcpy(sets + n * width, next, width);
+        n++;
+      }
+      (*trans)[d * 256 + b] = j;
+    }
+  }
+  
+done:
+  free(sets);
+  free(next);
+  free(stack);
+  return n;
+}
+
+/*
+** Moore's partition refinement. States are
+** split while their acceptance or the class of
+** any successor differs. The start state keeps
+** the number zero.
+*/
+
+static int mpc_dfa_minimise(int n, int *trans, char *accept) {
+  
+  int *cls = malloc(sizeof(int) * n);
+  int *next = malloc(sizeof(int) * n);
+  int *rep = malloc(sizeof(int) * n);
+  int classes = 0, count, q, r, b, c, same;
+  
+  for (q = 0; q < n; q++) { cls[q] = accept[q]; }
+  
+  while (1) {
+    
+    count = 0;
+    for (q = 0; q < n; q++) {
+      for (c = 0; c < count; c++) {
+        r = rep[c];
+        same = cls[q] == cls[r];
+        for (b = 0; same && b < 256; b++) {
+          same = (trans[q * 256 + b] < 0 ? -1 : cls[trans[q * 256 + b]])
+              == (trans[r * 256 + b] < 0 ? -1 : cls[trans[r * 256 + b]]);
+        }
+        if (same) { break; }
+      }
+      if (c == count) { rep[count++] = q; }
+      next[q] = c;
+    }
+    
+    memcpy(cls, next, sizeof(int) * n);
+    if (count == classes) { break; }
+    classes = count;
+  }
+  
+  /* Representatives are in increasing order, so rows move down in place */
+  for (c = 0; c < classes; c++) {
+    for (b = 0; b < 256; b++) {
+      q = trans[rep[c] * 256 + b];
+      trans[c * 256 + b] = q < 0 ? -1 : cls[q];
+    }
+    accept[c] = accept[rep[c]];
+  }
+  
+  free(cls);
+  free(next);
+  free(rep);
+  return classes;
+}
+
+static mpc_parser_t *mpc_re_dfa(mpc_parser_t *re) {
+  
+  mpc_parser_t *p;
+  mpc_charset_t follow, first;
+  mpc_nfa_t a;
+  int nullable, start, end, n;
+  int *trans;
+  char *accept;
+  
+  memset(follow, 0, sizeof(mpc_charset_t));
+  if (!mpc_re_ll1(re, follow, first, &nullable)) { return re; }
+  
+  a.num = 0;
+  a.slots = 0;
+  a.states = NULL;
+  
+  if (!mpc_nfa_build(&a, re, &start, &end)) {
+    free(a.states);
+    return re;
+  }
+  
+  n = mpc_dfa_subsets(&a, start, end, &trans, &accept);
+  free(a.states);
+  
+  if (n == 0) {
+    free(trans);
+    free(accept);
+    return re;
+  }
+  
+  n = mpc_dfa_minimise(n, trans, accept);
+  
+  p = mpc_undefined();
+  p->type = MPC_TYPE_DFA;
+  p->data.dfa.x = re;
+  p->data.dfa.n = n;
+  p->data.dfa.trans = realloc(trans, sizeof(int) * 256 * n);
+  p->data.dfa.accept = realloc(accept, n);
+  return p;
+}
+
+/*
+** Common Fold Functions
+*/
+
+void mpcf_dtor_null(mpc_val_t *x) { (void) x; return; }
+
+mpc_val_t *mpcf_ctor_null(void) { return NULL; }
+mpc_val_t *mpcf_ctor_str(void) { return calloc(1, 1); }
+mpc_val_t *mpcf_free(mpc_val_t *x) { free(x); return NULL; }
+
+mpc_val_t *mpcf_int(mpc_val_t *x) {
+  int *y = malloc(sizeof(int));
+  *y = strtol(x, NULL, 10);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_hex(mpc_val_t *x) {
+  int *y = malloc(sizeof(int));
+  *y = strtol(x, NULL, 16);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_oct(mpc_val_t *x) {
+  int *y = malloc(sizeof(int));
+  *y = strtol(x, NULL, 8);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_float(mpc_val_t *x) {
+  float *y = malloc(sizeof(float));
+  *y = strtod(x, NULL);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_strtriml(mpc_val_t *x) {
+  char *s = x;
+  while (isspace(*s)) {
+    memmove(s, s+1, strlen(s));
+  }
+  return s;
+}
+
+mpc_val_t *mpcf_strtrimr(mpc_val_t *x) {
+  char *s = x;
+  size_t l = strlen(s);
+  while (isspace(s[l-1])) {
+    s[l-1] = '\0'; l--;
+  }
+  return s;
+}
+
+mpc_val_t *mpcf_strtrim(mpc_val_t *x) {
+  return mpcf_strtriml(mpcf_strtrimr(x));
+}
+
+static const char mpc_escape_input_c[]  = {
+  '\a', '\b', '\f', '\n', '\r',
+  '\t', '\v', '\\', '\'', '\"', '\0'};
+    
+static const char *mpc_escape_output_c[] = {
+  "\\a", "\\b", "\\f", "\\n", "\\r", "\\t", 
+  "\\v", "\\\\", "\\'", "\\\"", "\\0", NULL};
+
+static const char mpc_escape_input_raw_re[] = { '/' };
+static const char *mpc_escape_output_raw_re[] = { "\\/", NULL };
+
+static const char mpc_escape_input_raw_cstr[] = { '"' };
+static const char *mpc_escape_output_raw_cstr[] = { "\\\"", NULL };
+
+static const char mpc_escape_input_raw_cchar[] = { '\'' };
+static const char *mpc_escape_output_raw_cchar[] = { "\\'", NULL };
+
+static mpc_val_t *mpcf_escape_new(mpc_val_t *x, const char *input, const char **output) {
+  
+  int i;
+  int found;
+  char buff[2];
+  char *s = x;
+  char *y = calloc(1, 1);
+  
+  while (*s) {
+    
+    i = 0;
+    found = 0;
+
+    while (output[i]) {
+      if (*s == input[i]) {
+        y = realloc(y, strlen(y) + strlen(output[i]) + 1);
+        strcat(y, output[i]);
+        found = 1;
+        break;
+      }
+      i++;
+    }
+    
+    if (!found) {
+      y = realloc(y, strlen(y) + 2);
+      buff[0] = *s; buff[1] = '\0';
+      strcat(y, buff);
+    }
+    
+    s++;
+  }
+  
+  
+  return y;
+}
+
+static mpc_val_t *mpcf_unescape_new(mpc_val_t *x, const char *input, const char **output) {
+  
+  int i;
+  int found = 0;
+  char buff[2];
+  char *s = x;
+  char *y = calloc(1, 1);
+  
+  while (*s) {
+    
+    i = 0;
+    found = 0;
+    
+    while (output[i]) {
+      if ((*(s+0)) == output[i][0] &&
+          (*(s+1)) == output[i][1]) {
+        y = realloc(y, strlen(y) + 1 + 1);
+        buff[0] = input[i]; buff[1] = '\0';
+        strcat(y, buff);
+        found = 1;
+        s++;
+        break;
+      }
+      i++;
+    }
+    
+    if (!found) {
+      y = realloc(y, strlen(y) + 1 + 1);
+      buff[0] = *s; buff[1] = '\0';
+      strcat(y, buff);
+    }
+    
+    if (*s == '\0') { break; }
+    else { s++; }
+  }
+  
+  return y;
+  
+}
+
+mpc_val_t *mpcf_escape(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_c, mpc_escape_output_c);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_c, mpc_escape_output_c);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_escape_regex(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
+  free(x);
+  return y;  
+}
+
+mpc_val_t *mpcf_unescape_regex(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_re, mpc_escape_output_raw_re);
+  free(x);
+  return y;  
+}
+
+mpc_val_t *mpcf_escape_string_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape_string_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cstr, mpc_escape_output_raw_cstr);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_escape_char_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_escape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_unescape_char_raw(mpc_val_t *x) {
+  mpc_val_t *y = mpcf_unescape_new(x, mpc_escape_input_raw_cchar, mpc_escape_output_raw_cchar);
+  free(x);
+  return y;
+}
+
+mpc_val_t *mpcf_null(int n, mpc_val_t** xs) { (void) n; (void) xs; return NULL; }
+mpc_val_t *mpcf_fst(int n, mpc_val_t **xs) { (void) n; return xs[0]; }
+mpc_val_t *mpcf_snd(int n, mpc_val_t **xs) { (void) n; return xs[1]; }
+mpc_val_t *mpcf_trd(int n, mpc_val_t **xs) { (void) n; return xs[2]; }
+
+static mpc_val_t *mpcf_nth_free(int n, mpc_val_t **xs, int x) {
+  int i;
+  for (i = 0; i < n; i++) {
+    if (i != x) { free(xs[i]); }
+  }
+  return xs[x];
+}
+ 
+mpc_val_t *mpcf_fst_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 0); }
+mpc_val_t *mpcf_snd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 1); }
+mpc_val_t *mpcf_trd_free(int n, mpc_val_t **xs) { return mpcf_nth_free(n, xs, 2); }
+
+mpc_val_t *mpcf_strfold(int n, mpc_val_t **xs) {
+  int i;
+  size_t l = 0;
+  
+  if (n == 0) { return calloc(1, 1); }
+  
+  for (i = 0; i < n; i++) { l += strlen(xs[i]); }
+  
+  xs[0] = realloc(xs[0], l + 1);
+  
+  for (i = 1; i < n; i++) {
+    strcat(xs[0], xs[i]); free(xs[i]);
+  }
+  
+  return xs[0];
+}
+
+mpc_val_t *mpcf_maths(int n, mpc_val_t **xs) {
+  int **vs = (int**)xs;
+  (void) n;
+  
+  switch(((char*)xs[1])[0])
+  {
+    case '*': { *vs[0] *= *vs[2]; }; break;
+    case '/': { *vs[0] /= *vs[2]; }; break;
+    case '%': { *vs[0] %= *vs[2]; }; break;
+    case '+': { *vs[0] += *vs[2]; }; break;
+    case '-': { *vs[0] -= *vs[2]; }; break;
+    default: break;
+  }
+  
+  free(xs[1]); free(xs[2]);
+  
+  return xs[0];
+}
+
+mpc_val_t *mpcf_slice_str(const char *s, long n) {
+  char *x = malloc(n + 1);
+  memcpy(x, s, n);
+  x[n] = '\0';
+  return x;
+}
+
+/*
+** Printing
+*/
+
+static void mpc_print_unretained(mpc_parser_t *p, int force) {
+  
+  /* TODO: Print Everything Escaped */
+  
+  int i;
+  char *s, *e;
+  char buff[2];
+  
+  if (p->retained && !force) {;
+    if (p->name) { printf("<%s>", p->name); }
+    else { printf("<anon>"); }
+    return;
+  }
+  
+  if (p->type == MPC_TYPE_UNDEFINED) { printf("<?>"); }
+  if (p->type == MPC_TYPE_PASS)   { printf("<:>"); }
+  if (p->type == MPC_TYPE_FAIL)   { printf("<!>"); }
+  if (p->type == MPC_TYPE_LIFT)   { printf("<#>"); }
+  if (p->type == MPC_TYPE_STATE)  { printf("<S>"); }
+  if (p->type == MPC_TYPE_ANCHOR) { printf("<@>"); }
+  if (p->type == MPC_TYPE_NATIVE) { printf("<n>"); }
+  if (p->type == MPC_TYPE_EXPECT) {
+    printf("%s", p->data.expect.m);
+    /*mpc_print_unretained(p->data.expect.x, 0);*/
+  }
+  
+  if (p->type == MPC_TYPE_ANY) { printf("<.>"); }
+  if (p->type == MPC_TYPE_SATISFY) { printf("<f>"); }
+
+  if (p->type == MPC_TYPE_SINGLE) {
+    buff[0] = p->data.single.x; buff[1] = '\0';
+    s = mpcf_escape_new(
+      buff,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("'%s'", s);
+    free(s);
+  }
+  
+  if (p->type == MPC_TYPE_RANGE) {
+    buff[0] = p->data.range.x; buff[1] = '\0';
+    s = mpcf_escape_new(
+      buff,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    buff[0] = p->data.range.y; buff[1] = '\0';
+    e = mpcf_escape_new(
+      buff,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("[%s-%s]", s, e);
+    free(s);
+    free(e);
+  }
+  
+  if (p->type == MPC_TYPE_ONEOF) {
+    s = mpcf_escape_new(
+      p->data.string.x,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("[%s]", s);
+    free(s);
+  }
+  
+  if (p->type == MPC_TYPE_NONEOF) {
+    s = mpcf_escape_new(
+      p->data.string.x,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("[^%s]", s);
+    free(s);
+  }
+  
+  if (p->type == MPC_TYPE_STRING) {
+    s = mpcf_escape_new(
+      p->data.string.x,
+      mpc_escape_input_c,
+      mpc_escape_output_c);
+    printf("\"%s\"", s);
+    free(s);
+  }
+  
+  if (p->type == MPC_TYPE_APPLY)    { mpc_print_unretained(p->data.apply.x, 0); }
+  if (p->type == MPC_TYPE_APPLY_TO) { mpc_print_unretained(p->data.apply_to.x, 0); }
+  if (p->type == MPC_TYPE_PREDICT)  { mpc_print_unretained(p->data.predict.x, 0); }
+
+  if (p->type == MPC_TYPE_NOT)   { mpc_print_unretained(p->data.not.x, 0); printf("!"); }
+  if (p->type == MPC_TYPE_MAYBE) { mpc_print_unretained(p->data.not.x, 0); printf("?"); }
+
+  if (p->type == MPC_TYPE_MANY)  { mpc_print_unretained(p->data.repeat.x, 0); printf("*"); }
+  if (p->type == MPC_TYPE_MANY1) { mpc_print_unretained(p->data.repeat.x, 0); printf("+"); }
+  if (p->type == MPC_TYPE_COUNT) { mpc_print_unretained(p->data.repeat.x, 0); printf("{%i}", p->data.repeat.n); }
+  
+  if (p->type == MPC_TYPE_DFA)  { mpc_print_unretained(p->data.dfa.x, 0); }
+  if (p->type == MPC_TYPE_SPAN) { mpc_print_unretained(p->data.span.x, 0); }
+  if (p->type == MPC_TYPE_MEMO) { mpc_print_unretained(p->data.memo.x, 0); }
+  if (p->type == MPC_TYPE_SLICE) { mpc_print_unretained(p->data.slice.x, 0); }
+  
+  if (p->type == MPC_TYPE_OR) {
+    printf("(");
+    for(i = 0; i < p->data.or.n-1; i++) {
+      mpc_print_unretained(p->data.or.xs[i], 0);
+      printf(" | ");
+    }
+    mpc_print_unretained(p->data.or.xs[p->data.or.n-1], 0);
+    printf(")");
+  }
+  
+  if (p->type == MPC_TYPE_AND) {
+    printf("(");
+    for(i = 0; i < p->data.and.n-1; i++) {
+      mpc_print_unretained(p->data.and.xs[i], 0);
+      printf(" ");
+    }
+    mpc_print_unretained(p->data.and.xs[p->data.and.n-1], 0);
+    printf(")");
+  }
+  
+}
+
+void mpc_print(mpc_parser_t *p) {
+  mpc_print_unretained(p, 1);
+  printf("\n");
+}
+
+/*
+** Testing
+*/
+
+/*
+** These functions are slightly unwieldy and
+** also the whole of the testing suite for mpc
+** mpc is pretty shaky.
+**
+** It could do with a lot more tests and more
+** precision. Currently I am only really testing
+** changes off of the examples.
+**
+*/
+
+int mpc_test_fail(mpc_parser_t *p, const char *s, const void *d,
+  int(*tester)(const void*, const void*),
+  mpc_dtor_t destructor,
+  void(*printer)(const void*)) {
+  mpc_result_t r;
+  (void) printer;
+  if (mpc_parse("<test>", s, p, &r)) {
+
+    if (tester(r.output, d)) {
+      destructor(r.output);
+      return 0;
+    } else {
+      destructor(r.output);
+      return 1;
+    }
+  
+  } else {
+    mpc_err_delete(r.error);
+    return 1;
+  }
+  
+}
+
+int mpc_test_pass(mpc_parser_t *p, const char *s, const void *d,
+  int(*tester)(const void*, const void*), 
+  mpc_dtor_t destructor, 
+  void(*printer)(const void*)) {
+
+  mpc_result_t r;  
+  if (mpc_parse("<test>", s, p, &r)) {
+    
+    if (tester(r.output, d)) {
+      destructor(r.output);
+      return 1;
+    } else {
+      printf("Got "); printer(r.output); printf("\n");
+      printf("Expected "); printer(d); printf("\n");
+      destructor(r.output);
+      return 0;
+    }
+    
+  } else {    
+    mpc_err_print(r.error);
+    mpc_err_delete(r.error);
+    return 0;
+    
+  }
+  
+}
+
+
+/*
+** Tags
+**
+** AST tags are interned - nodes with the same
+** tag share one copy of it, and can compare
+** tags by id. A tag made of several names such
+** as "expr|number|regex" also records the ids
+** of the names in it, so testing a node for one
+** of them with `mpc_ast_is` is a bit lookup.
+**
+** The table is global and lasts for the life
+** of the program. Interning and looking up a
+** name take a lock, so threads may build ASTs
+** at once. Entries never change and a grown
+** array is not freed, so reading a tag by id,
+** as `mpc_ast_is` does, needs no lock.
+*/
+
+enum {
+  MPC_TAGS_MIN = 64
+};
+
+#ifdef MPC_USE_PTHREAD
+static pthread_mutex_t mpc_tags_lock = PTHREAD_MUTEX_INITIALIZER;
+#define MPC_TAGS_LOCK() pthread_mutex_lock(&mpc_tags_lock)
+#define MPC_TAGS_UNLOCK() pthread_mutex_unlock(&mpc_tags_lock)
+#else
+#define MPC_TAGS_LOCK()
+#define MPC_TAGS_UNLOCK()
+#endif
+
+typedef struct {
+  char *name;
+  unsigned long hash;
+  int parts_num;
+  unsigned char *parts;
+} mpc_tag_entry_t;
+
+static struct {
+  int num;
+  int slots;
+  mpc_tag_entry_t *tags;
+  int index_slots;
+  int *index;
+} mpc_tags = { 0, 0, NULL, 0, NULL };
+
+static unsigned long mpc_tag_hash(const char *name, size_t len) {
+  unsigned long h = 2166136261u;
+  size_t j;
+  for (j = 0; j < len; j++) { h = (h ^ (unsigned char)name[j]) * 16777619u; }
+  return h;
+}
+
+static int *mpc_tag_slot(const char *name, size_t len, unsigned long h) {
+  int *t;
+  size_t k = h & (mpc_tags.index_slots - 1);
+  for (;; k = (k + 1) & (mpc_tags.index_slots - 1)) {
+    t = &mpc_tags.index[k];
+    if (*t < 0) { return t; }
+    if (mpc_tags.tags[*t].hash == h
+    &&  strncmp(mpc_tags.tags[*t].name, name, len) == 0
+    &&  mpc_tags.tags[*t].name[len] == '\0') { return t; }
+  }
+}
+
+static int mpc_tag_find(const char *name, size_t len) {
+  if (mpc_tags.index == NULL) { return -1; }
+  return *mpc_tag_slot(name, len, mpc_tag_hash(name, len));
+}
+
+static int mpc_tag_intern_n(const char *name, size_t len) {
+  
+  int j, id;
+  unsigned long h = mpc_tag_hash(name, len);
+  mpc_tag_entry_t *e;
+  const char *part, *bar;
+  
+  if (mpc_tags.index && (id = *mpc_tag_slot(name, len, h)) >= 0) { return id; }
+  
+  /* The names making up the tag go in first, so their ids are all smaller */
+  bar = memchr(name, '|', len);
+  for (part = name; bar; part = bar + 1, bar = memchr(part, '|', name + len - part)) {
+    mpc_tag_intern_n(part, bar - part);
+  }
+  if (part != name) { mpc_tag_intern_n(part, name + len - part); }
+  
+  if (mpc_tags.num * 2 >= mpc_tags.index_slots) {
+    mpc_tags.index_slots = mpc_tags.index_slots ? mpc_tags.index_slots * 2 : MPC_TAGS_MIN;
+    free(mpc_tags.index);
+    mpc_tags.index = malloc(sizeof(int) * mpc_tags.index_slots);
+    for (j = 0; j < mpc_tags.index_slots; j++) { mpc_tags.index[j] = -1; }
+    for (j = 0; j < mpc_tags.num; j++) {
+      e = &mpc_tags.tags[j];
+      *mpc_tag_slot(e->name, strlen(e->name), e->hash) = j;
+    }
+  }
+  
+  /* Other threads may still be reading the old array, it is left to them */
+  if (mpc_tags.num == mpc_tags.slots) {
+    mpc_tags.slots = mpc_tags.slots ? mpc_tags.slots * 2 : MPC_TAGS_MIN;
+    e = malloc(sizeof(mpc_tag_entry_t) * mpc_tags.slots);
+    if (mpc_tags.num) { memcpy(e, mpc_tags.tags, sizeof(mpc_tag_entry_t) * mpc_tags.num); }
+    mpc_tags.tags = e;
+  }
+  
+  id = mpc_tags.num;
+  e = &mpc_tags.tags[id];
+  e->name = malloc(len + 1);
+  memcpy(e->name, name, len);
+  e->name[len] = '\0';
+  e->hash = h;
+  e->parts_num = id + 1;
+  e->parts = calloc(id / 8 + 1, 1);
+  e->parts[id / 8] |= 1 << (id % 8);
+  
+  for (part = name; part != name + len && (bar = memchr(part, '|', name + len - part)); part = bar + 1) {
+    j = mpc_tag_find(part, bar - part);
+    e->parts[j / 8] |= 1 << (j % 8);
+  }
+  if (part != name) {
+    j = mpc_tag_find(part, name + len - part);
+    e->parts[j / 8] |= 1 << (j % 8);
+  }
+  
+  mpc_tags.num++;
+  *mpc_tag_slot(name, len, h) = id;
+  return id;
+}
+
+int mpc_tag_intern(const char *name) {
+  int id;
+  MPC_TAGS_LOCK();
+  id = mpc_tag_intern_n(name, strlen(name));
+  MPC_TAGS_UNLOCK();
+  return id;
+}
+
+const char *mpc_tag_name(int tag) {
+  return tag >= 0 && tag < mpc_tags.num ? mpc_tags.tags[tag].name : NULL;
+}
+
+/* Tag `a` followed by `b`, as when a rule name is put in front of a node's tag */
+static int mpc_tag_join(const char *a, size_t alen, const char *b) {
+  
+  int id;
+  char stk[256];
+  size_t blen = strlen(b);
+  char *s = alen + blen + 1 > sizeof(stk) ? malloc(alen + blen + 1) : stk;
+  
+  memcpy(s, a, alen);
+  memcpy(s + alen, b, blen);
+  MPC_TAGS_LOCK();
+  id = mpc_tag_intern_n(s, alen + blen);
+  MPC_TAGS_UNLOCK();
+  if (s != stk) { free(s); }
+  return id;
+}
+
+/*
+** AST
+*/
+
+/*
+** Each node is held in a bigger block telling
+** where it was allocated. A node can also have
+** more than one owner - a packrat memo shares
+** its results - and the functions changing a
+** node first give a shared one a copy of its
+** own, with the children still shared.
+*/
+typedef struct {
+  mpc_ast_t ast;
+  mpc_ast_arena_t *arena;
+  int children_slots;
+  int refs;
+} mpc_ast_node_t;
+
+static void mpc_ast_set_tag(mpc_ast_t *a, int tag) {
+  a->tag_id = tag;
+  a->tag = mpc_tags.tags[tag].name;
+}
+
+static void mpc_ast_free(mpc_ast_t *a) {
+  mpc_ast_node_t *n = (mpc_ast_node_t*)a;
+  if (n->arena) { mpc_ast_arena_release(n->arena); return; }
+  free(a->children);
+  free(a->contents);
+  free(a);
+}
+
+/* The caller has taken the children, if the node is shared its other owners keep them as well */
+static void mpc_ast_delete_no_children(mpc_ast_t *a) {
+  int i;
+  if (--((mpc_ast_node_t*)a)->refs == 0) { mpc_ast_free(a); return; }
+  for (i = 0; i < a->children_num; i++) {
+    if (a->children[i]) { ((mpc_ast_node_t*)a->children[i])->refs++; }
+  }
+}
+
+/* Trees can be as deep as the input nests, so they are walked with a stack of their own */
+void mpc_ast_delete(mpc_ast_t *a) {
+  
+  mpc_ast_t *stk[64];
+  mpc_ast_t **s = stk;
+  int num = 0, slots = 64, i;
+  
+  if (a == NULL) { return; }
+  s[num++] = a;
+  
+  while (num) {
+    a = s[--num];
+    if (--((mpc_ast_node_t*)a)->refs > 0) { continue; }
+    if (num + a->children_num > slots) {
+      while (num + a->children_num > slots) { slots *= 2; }
+      if (s == stk) {
+        s = malloc(sizeof(mpc_ast_t*) * slots);
+        memcpy(s, stk, sizeof(mpc_ast_t*) * num);
+      } else {
+        s = realloc(s, sizeof(mpc_ast_t*) * slots);
+      }
+    }
+    for (i = 0; i < a->children_num; i++) {
+      if (a->children[i]) { s[num++] = a->children[i]; }
+    }
+    mpc_ast_free(a);
+  }
+  
+  if (s != stk) { free(s); }
+}
+
+static mpc_ast_t *mpc_ast_new_id(int tag, const char *contents) {
+  
+  size_t len = strlen(contents) + 1;
+  mpc_ast_arena_t *arena = mpc_ast_arena();
+  mpc_ast_node_t *n;
+  
+  /* In an arena the contents follow the node */
+  if (arena) {
+    n = mpc_ast_arena_alloc(arena, sizeof(mpc_ast_node_t) + len);
+    n->ast.contents = (char*)(n + 1);
+    arena->live++;
+  } else {
+    n = malloc(sizeof(mpc_ast_node_t));
+    n->ast.contents = malloc(len);
+  }
+  memcpy(n->ast.contents, contents, len);
+  
+  n->arena = arena;
+  n->children_slots = 0;
+  n->refs = 1;
+  mpc_ast_set_tag(&n->ast, tag);
+  n->ast.state = mpc_state_new();
+  n->ast.children_num = 0;
+  n->ast.children = NULL;
+  return &n->ast;
+  
+}
+
+mpc_ast_t *mpc_ast_new(const char *tag, const char *contents) {
+  return mpc_ast_new_id(mpc_tag_intern(tag), contents);
+}
+
+static void mpc_ast_reserve(mpc_ast_t *r, int slots) {
+  
+  mpc_ast_node_t *n = (mpc_ast_node_t*)r;
+  mpc_ast_t **children;
+  
+  if (slots <= n->children_slots) { return; }
+  
+  if (n->arena) {
+    children = mpc_ast_arena_alloc(n->arena, sizeof(mpc_ast_t*) * slots);
+    if (r->children_num) { memcpy(children, r->children, sizeof(mpc_ast_t*) * r->children_num); }
+    r->children = children;
+  } else {
+    r->children = realloc(r->children, sizeof(mpc_ast_t*) * slots);
+  }
+  n->children_slots = slots;
+}
+
+mpc_ast_t *mpc_ast_copy(mpc_ast_t *a) {
+  
+  int i;
+  mpc_ast_t *b;
+  
+  if (a == NULL) { return a; }
+  
+  b = mpc_ast_new_id(a->tag_id, a->contents);
+  b->state = a->state;
+  mpc_ast_reserve(b, a->children_num);
+  b->children_num = a->children_num;
+  for (i = 0; i < a->children_num; i++) {
+    b->children[i] = mpc_ast_copy(a->children[i]);
+  }
+  return b;
+  
+}
+
+/* Another owner for the node and everything below it, see `mpc_memo` */
+static mpc_ast_t *mpc_ast_share(mpc_ast_t *a) {
+  if (a) { ((mpc_ast_node_t*)a)->refs++; }
+  return a;
+}
+
+/* A node the caller can change, copied if it is shared */
+static mpc_ast_t *mpc_ast_unshare(mpc_ast_t *a) {
+  
+  int i;
+  mpc_ast_t *b;
+  mpc_ast_node_t *n = (mpc_ast_node_t*)a;
+  
+  if (n->refs == 1) { return a; }
+  
+  b = mpc_ast_new_id(a->tag_id, a->contents);
+  b->state = a->state;
+  mpc_ast_reserve(b, a->children_num);
+  b->children_num = a->children_num;
+  for (i = 0; i < a->children_num; i++) {
+    b->children[i] = mpc_ast_share(a->children[i]);
+  }
+  n->refs--;
+  return b;
+  
+}
+
+mpc_ast_t *mpc_ast_build(int n, const char *tag, ...) {
+  
+  mpc_ast_t *a = mpc_ast_new(tag, "");
+  
+  int i;
+  va_list va;
+  va_start(va, tag);
+  
+  for (i = 0; i < n; i++) {
+    mpc_ast_add_child(a, va_arg(va, mpc_ast_t*));
+  }
+  
+  va_end(va);
+  
+  return a;
+  
+}
+
+mpc_ast_t *mpc_ast_add_root(mpc_ast_t *a) {
+  
+  mpc_ast_t *r;
+  
+  if (a == NULL) { return a; }
+  if (a->children_num == 0) { return a; }
+  if (a->children_num == 1) { return a; }
+  
+  r = mpc_ast_new(">", "");
+  mpc_ast_add_child(r, a);
+  return r;
+}
+
+int mpc_ast_eq(mpc_ast_t *a, mpc_ast_t *b) {
+  
+  int i;
+  
+  if (a->tag_id != b->tag_id) { return 0; }
+  if (strcmp(a->contents, b->contents) != 0) { return 0; }
+  if (a->children_num != b->children_num) { return 0; }
+  
+  for (i = 0; i < a->children_num; i++) {
+    if (!mpc_ast_eq(a->children[i], b->children[i])) { return 0; }
+  }
+  
+  return 1;
+}
+
+int mpc_ast_is(mpc_ast_t *a, int tag) {
+  mpc_tag_entry_t *t = &mpc_tags.tags[a->tag_id];
+  return tag >= 0 && tag < t->parts_num && (t->parts[tag / 8] >> (tag % 8)) & 1;
+}
+
+mpc_ast_t *mpc_ast_add_child(mpc_ast_t *r, mpc_ast_t *a) {
+  mpc_ast_node_t *n = (mpc_ast_node_t*)r;
+  if (r->children_num == n->children_slots) {
+    mpc_ast_reserve(r, n->children_slots ? n->children_slots * 2 : 4);
+  }
+  r->children[r->children_num++] = a;
+  return r;
+}
+
+mpc_ast_t *mpc_ast_add_tag(mpc_ast_t *a, const char *t) {
+  char stk[256];
+  char *s = stk;
+  size_t len = strlen(t);
+  if (a == NULL) { return a; }
+  a = mpc_ast_unshare(a);
+  if (len + 1 > sizeof(stk)) { s = malloc(len + 1); }
+  memcpy(s, t, len);
+  s[len] = '|';
+  mpc_ast_set_tag(a, mpc_tag_join(s, len + 1, a->tag));
+  if (s != stk) { free(s); }
+  return a;
+}
+
+mpc_ast_t *mpc_ast_add_root_tag(mpc_ast_t *a, const char *t) {
+  if (a == NULL) { return a; }
+  a = mpc_ast_unshare(a);
+  mpc_ast_set_tag(a, mpc_tag_join(t, strlen(t)-1, a->tag));
+  return a;
+}
+
+mpc_ast_t *mpc_ast_tag(mpc_ast_t *a, const char *t) {
+  a = mpc_ast_unshare(a);
+  mpc_ast_set_tag(a, mpc_tag_intern(t));
+  return a;
+}
+
+mpc_ast_t *mpc_ast_state(mpc_ast_t *a, mpc_state_t s) {
+  if (a == NULL) { return a; }
+  a = mpc_ast_unshare(a);
+  a->state = s;
+  return a;
+}
+
+static void mpc_ast_print_depth(mpc_ast_t *a, int d, FILE *fp) {
+  
+  int i;
+  
+  if (a == NULL) {
+    fprintf(fp, "NULL\n");
+    return;
+  }
+  
+  for (i = 0; i < d; i++) { fprintf(fp, "  "); }
+  
+  if (strlen(a->contents)) {
+    fprintf(fp, "%s:%lu:%lu '%s'\n", a->tag, 
+      (long unsigned int)(a->state.row+1),
+      (long unsigned int)(a->state.col+1),
+      a->contents);
+  } else {
+    fprintf(fp, "%s \n", a->tag);
+  }
+  
+  for (i = 0; i < a->children_num; i++) {
+    mpc_ast_print_depth(a->children[i], d+1, fp);
+  }
+  
+}
+
+void mpc_ast_print(mpc_ast_t *a) {
+  mpc_ast_print_depth(a, 0, stdout);
+}
+
+void mpc_ast_print_to(mpc_ast_t *a, FILE *fp) {
+  mpc_ast_print_depth(a, 0, fp);
+}
+
+int mpc_ast_get_index(mpc_ast_t *ast, const char *tag) {
+  return mpc_ast_get_index_lb(ast, tag, 0);
+}
+
+int mpc_ast_get_index_lb(mpc_ast_t *ast, const char *tag, int lb) {
+  int i, t;
+  
+  MPC_TAGS_LOCK();
+  t = mpc_tag_find(tag, strlen(tag));
+  MPC_TAGS_UNLOCK();
+
+  for(i=lb; t >= 0 && i<ast->children_num; i++) {
+    if(ast->children[i]->tag_id == t) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+mpc_ast_t *mpc_ast_get_child(mpc_ast_t *ast, const char *tag) {
+  return mpc_ast_get_child_lb(ast, tag, 0);
+}
+
+mpc_ast_t *mpc_ast_get_child_lb(mpc_ast_t *ast, const char *tag, int lb) {
+  int i = mpc_ast_get_index_lb(ast, tag, lb);
+  return i < 0 ? NULL : ast->children[i];
+}
+
+mpc_ast_trav_t *mpc_ast_traverse_start(mpc_ast_t *ast,
+                                       mpc_ast_trav_order_t order)
+{
+  mpc_ast_trav_t *trav, *n_trav;
+  mpc_ast_t *cnode = ast;
+
+  /* Create the traversal structure */
+  trav = malloc(sizeof(mpc_ast_trav_t));
+  trav->curr_node = cnode;
+  trav->parent = NULL;
+  trav->curr_child = 0;
+  trav->order = order;
+
+  /* Get start node */
+  switch(order) {
+    case mpc_ast_trav_order_pre:
+      /* Nothing else is needed for pre order start */
+      break;
+
+    case mpc_ast_trav_order_post:
+      while(cnode->children_num > 0) {
+        cnode = cnode->children[0];
+
+        n_trav = malloc(sizeof(mpc_ast_trav_t));
+        n_trav->curr_node = cnode;
+        n_trav->parent = trav;
+        n_trav->curr_child = 0;
+        n_trav->order = order;
+
+        trav = n_trav;
+      }
+
+      break;
+
+    default:
+      /* Unreachable, but compiler complaints */
+      break;
+  }
+
+  return trav;
+}
+
+mpc_ast_t *mpc_ast_traverse_next(mpc_ast_trav_t **trav) {
+  mpc_ast_trav_t *n_trav, *to_free;
+  mpc_ast_t *ret = NULL;
+  int cchild;
+
+  /* The end of traversal was reached */
+  if(*trav == NULL) return NULL;
+
+  switch((*trav)->order) {
+    case mpc_ast_trav_order_pre:
+      ret = (*trav)->curr_node;
+
+      /* If there aren't any more children, go up */
+      while(*trav != NULL &&
+        (*trav)->curr_child >= (*trav)->curr_node->children_num)
+      {
+        to_free = *trav;
+        *trav = (*trav)->parent;
+        free(to_free);
+      }
+
+      /* If trav is NULL, the end was reached */
+      if(*trav == NULL) {
+        break;
+      }
+
+      /* Go to next child */
+      n_trav = malloc(sizeof(mpc_ast_trav_t));
+
+      cchild = (*trav)->curr_child;
+      n_trav->curr_node = (*trav)->curr_node->children[cchild];
+      n_trav->parent = *trav;
+      n_trav->curr_child = 0;
+      n_trav->order = (*trav)->order;
+
+      (*trav)->curr_child++;
+      *trav = n_trav;
+
+      break;
+
+    case mpc_ast_trav_order_post:
+      ret = (*trav)->curr_node;
+
+      /* Move up tree to the parent If the parent doesn't have any more nodes,
+       * then this is the current node. If it does, move down to its left most
+       * child. Also, free the previous traversal node */
+      to_free = *trav;
+      *trav = (*trav)->parent;
+      free(to_free);
+
+      if(*trav == NULL)
+        break;
+
+      /* Next child */
+      (*trav)->curr_child++;
+
+      /* If there aren't any more children, this is the next node */
+      if((*trav)->curr_child >= (*trav)->curr_node->children_num) {
+        break;
+      }
+
+      /* If there are still more children, find the leftmost child from this
+       * node */
+      while((*trav)->curr_node->children_num > 0) {
+        n_trav = malloc(sizeof(mpc_ast_trav_t));
+
+        cchild = (*trav)->curr_child;
+        n_trav->curr_node = (*trav)->curr_node->children[cchild];
+        n_trav->parent = *trav;
+        n_trav->curr_child = 0;
+        n_trav->order = (*trav)->order;
+
+        *trav = n_trav;
+      }
+
+    default:
+      /* Unreachable, but compiler complaints */
+      break;
+  }
+
+  return ret;
+}
+
+void mpc_ast_traverse_free(mpc_ast_trav_t **trav) {
+  mpc_ast_trav_t *n_trav;
+
+  /* Go through parents until all are free */
+  while(*trav != NULL) {
+      n_trav = (*trav)->parent;
+      free(*trav);
+      *trav = n_trav;
+  }
+}
+
+mpc_val_t *mpcf_fold_ast(int n, mpc_val_t **xs) {
+  
+  int i, j;
+  mpc_ast_t** as = (mpc_ast_t**)xs;
+  mpc_ast_t *r, *a;
+  const char *t;
+  
+  if (n == 0) { return NULL; }
+  if (n == 1) { return xs[0]; }
+  if (n == 2 && xs[1] == NULL) { return xs[0]; }
+  if (n == 2 && xs[0] == NULL) { return xs[1]; }
+  
+  r = mpc_ast_new(">", "");
+  
+  for (i = 0; i < n; i++) {
+    
+    if (as[i] == NULL) { continue; }
+    
+    if        (as[i] && as[i]->children_num == 0) {
+      mpc_ast_add_child(r, as[i]);
+    } else if (as[i] && as[i]->children_num == 1) {
+      /* Let go of the parent first, the child is shared with it if it was */
+      a = as[i]->children[0];
+      t = as[i]->tag;
+      mpc_ast_delete_no_children(as[i]);
+      mpc_ast_add_child(r, mpc_ast_add_root_tag(a, t));
+    } else if (as[i] && as[i]->children_num >= 2) {
+      for (j = 0; j < as[i]->children_num; j++) {
+        mpc_ast_add_child(r, as[i]->children[j]);
+      }
+      mpc_ast_delete_no_children(as[i]);
+    }
+  
+  }
+  
+  if (r->children_num) {
+    r->state = r->children[0]->state;
+  }
+  
+  return r;
+}
+
+mpc_val_t *mpcf_str_ast(mpc_val_t *c) {
+  mpc_ast_t *a = mpc_ast_new("", c);
+  free(c);
+  return a;
+}
+
+mpc_val_t *mpcf_state_ast(int n, mpc_val_t **xs) {
+  mpc_state_t *s = ((mpc_state_t**)xs)[0];
+  mpc_ast_t *a = ((mpc_ast_t**)xs)[1];
+  (void)n;
+  a = mpc_ast_state(a, *s);
+  free(s);
+  return a;
+}
+
+mpc_parser_t *mpca_state(mpc_parser_t *a) {
+  return mpc_and(2, mpcf_state_ast, mpc_state(), a, free);
+}
+
+mpc_parser_t *mpca_tag(mpc_parser_t *a, const char *t) {
+  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_tag, (void*)t);
+}
+
+mpc_parser_t *mpca_add_tag(mpc_parser_t *a, const char *t) {
+  return mpc_apply_to(a, (mpc_apply_to_t)mpc_ast_add_tag, (void*)t);
+}
+
+mpc_parser_t *mpca_root(mpc_parser_t *a) {
+  return mpc_apply(a, (mpc_apply_t)mpc_ast_add_root);
+}
+
+mpc_parser_t *mpca_not(mpc_parser_t *a) { return mpc_not(a, (mpc_dtor_t)mpc_ast_delete); }
+mpc_parser_t *mpca_maybe(mpc_parser_t *a) { return mpc_maybe(a); }
+mpc_parser_t *mpca_many(mpc_parser_t *a) { return mpc_many(mpcf_fold_ast, a); }
+mpc_parser_t *mpca_many1(mpc_parser_t *a) { return mpc_many1(mpcf_fold_ast, a); }
+mpc_parser_t *mpca_count(int n, mpc_parser_t *a) { return mpc_count(n, mpcf_fold_ast, a, (mpc_dtor_t)mpc_ast_delete); }
+
+mpc_parser_t *mpca_or(int n, ...) {
+
+  int i;
+  va_list va;
+
+  mpc_parser_t *p = mpc_undefined();
+  
+  p->type = MPC_TYPE_OR;
+  p->data.or.n = n;
+  p->data.or.xs = malloc(sizeof(mpc_parser_t*) * n);
+  
+  va_start(va, n);  
+  for (i = 0; i < n; i++) {
+    p->data.or.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  va_end(va);
+  
+  return p;
+  
+}
+
+mpc_parser_t *mpca_and(int n, ...) {
+  
+  int i;
+  va_list va;
+  
+  mpc_parser_t *p = mpc_undefined();
+  
+  p->type = MPC_TYPE_AND;
+  p->data.and.n = n;
+  p->data.and.f = mpcf_fold_ast;
+  p->data.and.xs = malloc(sizeof(mpc_parser_t*) * n);
+  p->data.and.dxs = malloc(sizeof(mpc_dtor_t) * (n-1));
+  
+  va_start(va, n);
+  for (i = 0; i < n; i++) {
+    p->data.and.xs[i] = va_arg(va, mpc_parser_t*);
+  }
+  for (i = 0; i < (n-1); i++) {
+    p->data.and.dxs[i] = (mpc_dtor_t)mpc_ast_delete;
+  }    
+  va_end(va);
+  
+  return p;  
+}
+
+mpc_parser_t *mpca_total(mpc_parser_t *a) { return mpc_total(a, (mpc_dtor_t)mpc_ast_delete); }
+
+/*
+** Grammar Parser
+*/
+
+/*
+** This is another interesting bootstrapping.
+**
+** Having a general purpose AST type allows
+** users to specify the grammar alone and
+** let all fold rules be automatically taken
+** care of by existing functions.
+**
+** You don't get to control the type spat
+** out but this means you can make a nice
+** parser to take in some grammar in nice
+** syntax and spit out a parser that works.
+**
+** The grammar for this looks surprisingly
+** like regex but the main difference is that
+** it is now whitespace insensitive and the
+** base type takes literals of some form.
+*/
+
+/*
+**
+**  ### Grammar Grammar
+**
+**      <grammar> : (<term> "|" <grammar>) | <term>
+**     
+**      <term> : <factor>*
+**
+**      <factor> : <base>
+**               | <base> "*"
+**               | <base> "+"
+**               | <base> "?"
+**               | <base> "{" <digits> "}"
+**           
+**      <base> : "<" (<digits> | <ident>) ">"
+**             | <string_lit>
+**             | <char_lit>
+**             | <regex_lit>
+**             | "(" <grammar> ")"
+*/
+
+typedef struct {
+  va_list *va;
+  int parsers_num;
+  mpc_parser_t **parsers;
+  int flags;
+} mpca_grammar_st_t;
+
+static mpc_val_t *mpcaf_grammar_or(int n, mpc_val_t **xs) {
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  else { return mpca_or(2, xs[0], xs[1]); }
+}
+
+static mpc_val_t *mpcaf_grammar_and(int n, mpc_val_t **xs) {
+  int i;
+  mpc_parser_t *p = mpc_pass();  
+  for (i = 0; i < n; i++) {
+    if (xs[i] != NULL) { p = mpca_and(2, p, xs[i]); }
+  }
+  return p;
+}
+
+static mpc_val_t *mpcaf_grammar_repeat(int n, mpc_val_t **xs) { 
+  int num;
+  (void) n;
+  if (xs[1] == NULL) { return xs[0]; }
+  switch(((char*)xs[1])[0])
+  {
+    case '*': { free(xs[1]); return mpca_many(xs[0]); }; break;
+    case '+': { free(xs[1]); return mpca_many1(xs[0]); }; break;
+    case '?': { free(xs[1]); return mpca_maybe(xs[0]); }; break;
+    case '!': { free(xs[1]); return mpca_not(xs[0]); }; break;
+    default:
+      num = *((int*)xs[1]);
+      free(xs[1]);
+  }
+  return mpca_count(num, xs[0]);
+}
+
+static mpc_val_t *mpcaf_grammar_string(mpc_val_t *x, void *s) {
+  mpca_grammar_st_t *st = s;
+  char *y = mpcf_unescape(x);
+  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_string(y) : mpc_tok(mpc_string(y));
+  free(y);
+  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "string"));
+}
+
+static mpc_val_t *mpcaf_grammar_char(mpc_val_t *x, void *s) {
+  mpca_grammar_st_t *st = s;
+  char *y = mpcf_unescape(x);
+  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_char(y[0]) : mpc_tok(mpc_char(y[0]));
+  free(y);
+  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "char"));
+}
+
+static mpc_val_t *mpcaf_grammar_regex(mpc_val_t *x, void *s) {
+  mpca_grammar_st_t *st = s;
+  char *y = mpcf_unescape_regex(x);
+  mpc_parser_t *p = (st->flags & MPCA_LANG_WHITESPACE_SENSITIVE) ? mpc_re(y) : mpc_tok(mpc_re(y));
+  free(y);
+  return mpca_state(mpca_tag(mpc_apply(p, mpcf_str_ast), "regex"));
+}
+
+/* Should this just use `isdigit` instead? */
+static int is_number(const char* s) {
+  size_t i;
+  for (i = 0; i < strlen(s); i++) { if (!strchr("0123456789", s[i])) { return 0; } }
+  return 1;
+}
+
+static mpc_parser_t *mpca_grammar_find_parser(char *x, mpca_grammar_st_t *st) {
+  
+  int i;
+  mpc_parser_t *p;
+  
+  /* Case of Number */
+  if (is_number(x)) {
+
+    i = strtol(x, NULL, 10);
+    
+    while (st->parsers_num <= i) {
+      st->parsers_num++;
+      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
+      st->parsers[st->parsers_num-1] = va_arg(*st->va, mpc_parser_t*);
+      if (st->parsers[st->parsers_num-1] == NULL) {
+        return mpc_failf("No Parser in position %i! Only supplied %i Parsers!", i, st->parsers_num);
+      }
+    }
+    
+    return st->parsers[st->parsers_num-1];
+  
+  /* Case of Identifier */
+  } else {
+    
+    /* Search Existing Parsers */
+    for (i = 0; i < st->parsers_num; i++) {
+      mpc_parser_t *q = st->parsers[i];
+      if (q == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
+      if (q->name && strcmp(q->name, x) == 0) { return q; }
+    }
+    
+    /* Search New Parsers */
+    while (1) {
+    
+      p = va_arg(*st->va, mpc_parser_t*);
+      
+      st->parsers_num++;
+      st->parsers = realloc(st->parsers, sizeof(mpc_parser_t*) * st->parsers_num);
+      st->parsers[st->parsers_num-1] = p;
+      
+      if (p == NULL || p->name == NULL) { return mpc_failf("Unknown Parser '%s'!", x); }
+      if (p->name && strcmp(p->name, x) == 0) { return p; }
+      
+    }
+  
+  }  
+  
+}
+
+static mpc_val_t *mpcaf_grammar_id(mpc_val_t *x, void *s) {
+  
+  mpca_grammar_st_t *st = s;
+  mpc_parser_t *p = mpca_grammar_find_parser(x, st);
+  free(x);
+
+  if (p->name) {
+    return mpca_state(mpca_root(mpca_add_tag(p, p->name)));
+  } else {
+    return mpca_state(mpca_root(p));
+  }
+}
+
+mpc_parser_t *mpca_grammar_st(const char *grammar, mpca_grammar_st_t *st) {
+  
+  char *err_msg;
+  mpc_parser_t *err_out;
+  mpc_result_t r;
+  mpc_parser_t *GrammarTotal, *Grammar, *Term, *Factor, *Base;
+  
+  GrammarTotal = mpc_new("grammar_total");
+  Grammar = mpc_new("grammar");
+  Term = mpc_new("term");
+  Factor = mpc_new("factor");
+  Base = mpc_new("base");
+  
+  mpc_define(GrammarTotal,
+    mpc_predictive(mpc_total(Grammar, mpc_soft_delete))
+  );
+  
+  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
+    Term,
+    mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
+    mpc_soft_delete
+  ));
+  
+  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
+  
+  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
+    Base,
+      mpc_or(6,
+        mpc_sym("*"),
+        mpc_sym("+"),
+        mpc_sym("?"),
+        mpc_sym("!"),
+        mpc_tok_brackets(mpc_int(), free),
+        mpc_pass()),
+    mpc_soft_delete
+  ));
+  
+  mpc_define(Base, mpc_or(5,
+    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
+    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
+    mpc_apply_to(mpc_tok(mpc_regex_lit()),  mpcaf_grammar_regex, st),
+    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
+    mpc_tok_parens(Grammar, mpc_soft_delete)
+  ));
+  
+  mpc_optimise(GrammarTotal);
+  mpc_optimise(Grammar);
+  mpc_optimise(Factor);
+  mpc_optimise(Term);
+  mpc_optimise(Base);
+  
+  if(!mpc_parse("<mpc_grammar_compiler>", grammar, GrammarTotal, &r)) {
+    err_msg = mpc_err_string(r.error);
+    err_out = mpc_failf("Invalid Grammar: %s", err_msg);
+    mpc_err_delete(r.error);
+    free(err_msg);
+    r.output = err_out;
+  }
+  
+  mpc_cleanup(5, GrammarTotal, Grammar, Term, Factor, Base);
+  
+  mpc_optimise(r.output);
+  
+  return (st->flags & MPCA_LANG_PREDICTIVE) ? mpc_predictive(r.output) : r.output;
+  
+}
+
+mpc_parser_t *mpca_grammar(int flags, const char *grammar, ...) {
+  mpca_grammar_st_t st;
+  mpc_parser_t *res;
+  va_list va;
+  va_start(va, grammar);
+  
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+  
+  res = mpca_grammar_st(grammar, &st);  
+  free(st.parsers);
+  va_end(va);
+  return res;
+}
+
+typedef struct {
+  char *ident;
+  char *name;
+  mpc_parser_t *grammar;
+} mpca_stmt_t;
+
+static mpc_val_t *mpca_stmt_afold(int n, mpc_val_t **xs) {
+  mpca_stmt_t *stmt = malloc(sizeof(mpca_stmt_t));
+  stmt->ident = ((char**)xs)[0];
+  stmt->name = ((char**)xs)[1];
+  stmt->grammar = ((mpc_parser_t**)xs)[3];
+  (void) n;
+  free(((char**)xs)[2]);
+  free(((char**)xs)[4]);
+  
+  return stmt;
+}
+
+static mpc_val_t *mpca_stmt_fold(int n, mpc_val_t **xs) {
+  
+  int i;
+  mpca_stmt_t **stmts = malloc(sizeof(mpca_stmt_t*) * (n+1));
+  
+  for (i = 0; i < n; i++) {
+    stmts[i] = xs[i];
+  }
+  stmts[n] = NULL;  
+  
+  return stmts;
+}
+
+static void mpca_stmt_list_delete(mpc_val_t *x) {
+
+  mpca_stmt_t **stmts = x;
+
+  while(*stmts) {
+    mpca_stmt_t *stmt = *stmts; 
+    free(stmt->ident);
+    free(stmt->name);
+    mpc_soft_delete(stmt->grammar);
+    free(stmt);  
+    stmts++;
+  }
+  free(x);
+
+}
+
+static void mpc_predict(mpc_parser_t *p);
+
+static mpc_val_t *mpca_stmt_list_apply_to(mpc_val_t *x, void *s) {
+
+  mpca_grammar_st_t *st = s;
+  mpca_stmt_t *stmt;
+  mpca_stmt_t **stmts = x;
+  mpc_parser_t *left;
+
+  while(*stmts) {
+    stmt = *stmts;
+    left = mpca_grammar_find_parser(stmt->ident, st);
+    if (st->flags & MPCA_LANG_PREDICTIVE) { stmt->grammar = mpc_predictive(stmt->grammar); }
+    if (stmt->name) { stmt->grammar = mpc_expect(stmt->grammar, stmt->name); }
+    if (st->flags & MPCA_LANG_PACKRAT) {
+      stmt->grammar = mpc_memo(stmt->grammar, (mpc_apply_t)mpc_ast_share, (mpc_dtor_t)mpc_ast_delete);
+    }
+    if (!(st->flags & MPCA_LANG_NO_OPTIMISE)) { mpc_optimise(stmt->grammar); }
+    mpc_define(left, stmt->grammar);
+    stmt->grammar = left;
+    stmts++;
+  }
+  
+  /* Predict again once every rule is defined, to see into rules defined later on */
+  for (stmts = x; *stmts; stmts++) {
+    stmt = *stmts;
+    mpc_predict(stmt->grammar);
+    free(stmt->ident);
+    free(stmt->name);
+    free(stmt);
+  }
+  
+  free(x);
+  
+  return NULL;
+}
+
+static mpc_err_t *mpca_lang_st(mpc_input_t *i, mpca_grammar_st_t *st) {
+  
+  mpc_result_t r;
+  mpc_err_t *e;
+  mpc_parser_t *Lang, *Stmt, *Grammar, *Term, *Factor, *Base; 
+  
+  Lang    = mpc_new("lang");
+  Stmt    = mpc_new("stmt");
+  Grammar = mpc_new("grammar");
+  Term    = mpc_new("term");
+  Factor  = mpc_new("factor");
+  Base    = mpc_new("base");
+  
+  mpc_define(Lang, mpc_apply_to(
+    mpc_total(mpc_predictive(mpc_many(mpca_stmt_fold, Stmt)), mpca_stmt_list_delete),
+    mpca_stmt_list_apply_to, st
+  ));
+  
+  mpc_define(Stmt, mpc_and(5, mpca_stmt_afold,
+    mpc_tok(mpc_ident()), mpc_maybe(mpc_tok(mpc_string_lit())), mpc_sym(":"), Grammar, mpc_sym(";"),
+    free, free, free, mpc_soft_delete
+  ));
+  
+  mpc_define(Grammar, mpc_and(2, mpcaf_grammar_or,
+      Term,
+      mpc_maybe(mpc_and(2, mpcf_snd_free, mpc_sym("|"), Grammar, free)),
+      mpc_soft_delete
+  ));
+  
+  mpc_define(Term, mpc_many1(mpcaf_grammar_and, Factor));
+  
+  mpc_define(Factor, mpc_and(2, mpcaf_grammar_repeat,
+    Base,
+      mpc_or(6,
+        mpc_sym("*"),
+        mpc_sym("+"),
+        mpc_sym("?"),
+        mpc_sym("!"),
+        mpc_tok_brackets(mpc_int(), free),
+        mpc_pass()),
+    mpc_soft_delete
+  ));
+  
+  mpc_define(Base, mpc_or(5,
+    mpc_apply_to(mpc_tok(mpc_string_lit()), mpcaf_grammar_string, st),
+    mpc_apply_to(mpc_tok(mpc_char_lit()),   mpcaf_grammar_char, st),
+    mpc_apply_to(mpc_tok(mpc_regex_lit()),  mpcaf_grammar_regex, st),
+    mpc_apply_to(mpc_tok_braces(mpc_or(2, mpc_digits(), mpc_ident()), free), mpcaf_grammar_id, st),
+    mpc_tok_parens(Grammar, mpc_soft_delete)
+  ));
+  
+  mpc_optimise(Lang);
+  mpc_optimise(Stmt);
+  mpc_optimise(Grammar);
+  mpc_optimise(Term);
+  mpc_optimise(Factor);
+  mpc_optimise(Base);
+  
+  if (!mpc_parse_input(i, Lang, &r)) {
+    e = r.error;
+  } else {
+    e = NULL;
+  }
+  
+  mpc_cleanup(6, Lang, Stmt, Grammar, Term, Factor, Base);
+  
+  return e;
+}
+
+mpc_err_t *mpca_lang_file(int flags, FILE *f, ...) {
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+
+  va_list va;  
+  va_start(va, f);
+  
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+  
+  i = mpc_input_new_file("<mpca_lang_file>", f);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+  
+  free(st.parsers);
+  va_end(va);
+  return err;
+}
+
+mpc_err_t *mpca_lang_pipe(int flags, FILE *p, ...) {
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+
+  va_list va;  
+  va_start(va, p);
+  
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+  
+  i = mpc_input_new_pipe("<mpca_lang_pipe>", p);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+  
+  free(st.parsers);
+  va_end(va);
+  return err;
+}
+
+mpc_err_t *mpca_lang(int flags, const char *language, ...) {
+  
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+  
+  va_list va;  
+  va_start(va, language);
+  
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+  
+  i = mpc_input_new_string("<mpca_lang>", language);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+  
+  free(st.parsers);
+  va_end(va);
+  return err;
+}
+
+mpc_err_t *mpca_lang_contents(int flags, const char *filename, ...) {
+  
+  mpca_grammar_st_t st;
+  mpc_input_t *i;
+  mpc_err_t *err;
+  
+  va_list va;
+
+  FILE *f = fopen(filename, "rb");
+  
+  if (f == NULL) {
+    err = mpc_err_file(filename, "Unable to open file!");
+    return err;
+  }
+  
+  va_start(va, filename);
+  
+  st.va = &va;
+  st.parsers_num = 0;
+  st.parsers = NULL;
+  st.flags = flags;
+  
+  i = mpc_input_new_file(filename, f);
+  err = mpca_lang_st(i, &st);
+  mpc_input_delete(i);
+  
+  free(st.parsers);
+  va_end(va);  
+  
+  fclose(f);
+  
+  return err;
+}
+
+static int mpc_nodecount_unretained(mpc_parser_t* p, int force) {
+
+  int i, total;
+
+  if (p->retained && !force) { return 0; }
+
+  if (p->type == MPC_TYPE_EXPECT) { return 1 + mpc_nodecount_unretained(p->data.expect.x, 0); }
+
+  if (p->type == MPC_TYPE_APPLY)    { return 1 + mpc_nodecount_unretained(p->data.apply.x, 0); }
+  if (p->type == MPC_TYPE_APPLY_TO) { return 1 + mpc_nodecount_unretained(p->data.apply_to.x, 0); }
+  if (p->type == MPC_TYPE_PREDICT)  { return 1 + mpc_nodecount_unretained(p->data.predict.x, 0); }
+  if (p->type == MPC_TYPE_MEMO)     { return 1 + mpc_nodecount_unretained(p->data.memo.x, 0); }
+  if (p->type == MPC_TYPE_SLICE)    { return 1 + mpc_nodecount_unretained(p->data.slice.x, 0); }
+
+  if (p->type == MPC_TYPE_NOT)   { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
+  if (p->type == MPC_TYPE_MAYBE) { return 1 + mpc_nodecount_unretained(p->data.not.x, 0); }
+
+  if (p->type == MPC_TYPE_MANY)  { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
+  if (p->type == MPC_TYPE_MANY1) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
+  if (p->type == MPC_TYPE_COUNT) { return 1 + mpc_nodecount_unretained(p->data.repeat.x, 0); }
+
+  if (p->type == MPC_TYPE_OR) { 
+    total = 1;
+    for(i = 0; i < p->data.or.n; i++) {
+      total += mpc_nodecount_unretained(p->data.or.xs[i], 0);
+    }
+    return total;
+  }
+  
+  if (p->type == MPC_TYPE_AND) {
+    total = 1;
+    for(i = 0; i < p->data.and.n; i++) {
+      total += mpc_nodecount_unretained(p->data.and.xs[i], 0);
+    }
+    return total;
+  }
+
+  return 1;
+  
+}
+
+/*
+** The named parsers reachable from a parser.
+** Unretained parsers each have one owner so
+** only named ones can be reached twice.
+*/
+
+#ifdef MPC_PROFILE
+
+typedef struct {
+  int num;
+  int slots;
+  mpc_parser_t **xs;
+} mpc_profile_list_t;
+
+static void mpc_profile_collect(mpc_profile_list_t *l, mpc_parser_t *p) {
+  
+  int j;
+  
+  if (p->name) {
+    for (j = 0; j < l->num; j++) { if (l->xs[j] == p) { return; } }
+    if (l->num == l->slots) {
+      l->slots = l->slots ? l->slots * 2 : 16;
+      l->xs = realloc(l->xs, sizeof(mpc_parser_t*) * l->slots);
+    }
+    l->xs[l->num++] = p;
+  }
+  
+  switch (p->type) {
+    case MPC_TYPE_EXPECT:   mpc_profile_collect(l, p->data.expect.x);   break;
+    case MPC_TYPE_APPLY:    mpc_profile_collect(l, p->data.apply.x);    break;
+    case MPC_TYPE_APPLY_TO: mpc_profile_collect(l, p->data.apply_to.x); break;
+    case MPC_TYPE_PREDICT:  mpc_profile_collect(l, p->data.predict.x);  break;
+    case MPC_TYPE_MEMO:     mpc_profile_collect(l, p->data.memo.x);     break;
+    case MPC_TYPE_SLICE:    mpc_profile_collect(l, p->data.slice.x);    break;
+    case MPC_TYPE_DFA:      mpc_profile_collect(l, p->data.dfa.x);      break;
+    case MPC_TYPE_SPAN:     mpc_profile_collect(l, p->data.span.x);     break;
+    
+    case MPC_TYPE_NOT:
+    case MPC_TYPE_MAYBE:
+      mpc_profile_collect(l, p->data.not.x);
+      break;
+    
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      mpc_profile_collect(l, p->data.repeat.x);
+      break;
+    
+    case MPC_TYPE_OR:
+      for (j = 0; j < p->data.or.n; j++) { mpc_profile_collect(l, p->data.or.xs[j]); }
+      break;
+    
+    case MPC_TYPE_AND:
+      for (j = 0; j < p->data.and.n; j++) { mpc_profile_collect(l, p->data.and.xs[j]); }
+      break;
+    
+    default: break;
+  }
+  
+}
+
+static int mpc_profile_cmp(const void *a, const void *b) {
+  double x = (*(mpc_parser_t**)a)->profile.time;
+  double y = (*(mpc_parser_t**)b)->profile.time;
+  return (x < y) - (x > y);
+}
+
+/* Slowest first, the order of both the table and the JSON */
+static mpc_profile_list_t mpc_profile_list(mpc_parser_t *p) {
+  mpc_profile_list_t l;
+  l.num = 0;
+  l.slots = 0;
+  l.xs = NULL;
+  mpc_profile_collect(&l, p);
+  qsort(l.xs, l.num, sizeof(mpc_parser_t*), mpc_profile_cmp);
+  return l;
+}
+
+static void mpc_profile_print(mpc_parser_t *p) {
+  
+  int j;
+  mpc_profile_t *s;
+  mpc_profile_list_t l = mpc_profile_list(p);
+  
+  printf("Profile:\n");
+  printf("  %-16s %10s %10s %10s %10s %10s %10s\n",
+    "Name", "Calls", "Passes", "Fails", "Consumed", "Rewinds", "Millis");
+  for (j = 0; j < l.num; j++) {
+    s = &l.xs[j]->profile;
+    printf("  %-16s %10li %10li %10li %10li %10li %10.3f\n", l.xs[j]->name,
+      s->calls, s->passes, s->fails, s->consumed, s->rewinds, s->time * 1e3);
+  }
+  
+  free(l.xs);
+}
+
+#endif
+
+void mpc_profile_json(mpc_parser_t *p, FILE *f) {
+#ifdef MPC_PROFILE
+  
+  int j;
+  const char *c;
+  mpc_profile_t *s;
+  mpc_profile_list_t l = mpc_profile_list(p);
+  
+  fprintf(f, "[");
+  for (j = 0; j < l.num; j++) {
+    s = &l.xs[j]->profile;
+    fprintf(f, j ? ",\n {\"name\": \"" : "\n {\"name\": \"");
+    for (c = l.xs[j]->name; *c; c++) {
+      if (*c == '"' || *c == '\\') { fputc('\\', f); }
+      if ((unsigned char)*c < 0x20) { fprintf(f, "\\u%04x", *c); } else { fputc(*c, f); }
+    }
+    fprintf(f, "\", \"calls\": %li, \"passes\": %li, \"fails\": %li, "
+      "\"consumed\": %li, \"rewinds\": %li, \"seconds\": %.6f}",
+      s->calls, s->passes, s->fails, s->consumed, s->rewinds, s->time);
+  }
+  fprintf(f, l.num ? "\n]\n" : "]\n");
+  
+  free(l.xs);
+  
+#else
+  (void)p;
+  fprintf(f, "[]\n");
+#endif
+}
+
+void mpc_profile_reset(mpc_parser_t *p) {
+#ifdef MPC_PROFILE
+  int j;
+  mpc_profile_list_t l = mpc_profile_list(p);
+  for (j = 0; j < l.num; j++) { memset(&l.xs[j]->profile, 0, sizeof(mpc_profile_t)); }
+  free(l.xs);
+#else
+  (void)p;
+#endif
+}
+
+int mpc_nodecount(mpc_parser_t *p) {
+  return mpc_nodecount_unretained(p, 1);
+}
+
+void mpc_stats(mpc_parser_t* p) {
+  printf("Stats\n");
+  printf("=====\n");
+  printf("Node Count: %i\n", mpc_nodecount(p));
+  if (mpc_mem_stats.memo_hits + mpc_mem_stats.memo_misses > 0) {
+    printf("Memo Hits: %li\n", mpc_mem_stats.memo_hits);
+    printf("Memo Misses: %li\n", mpc_mem_stats.memo_misses);
+    printf("Memo Hit Rate: %.1f%%\n",
+      100.0 * mpc_mem_stats.memo_hits / (mpc_mem_stats.memo_hits + mpc_mem_stats.memo_misses));
+  }
+  printf("Inputs: %li\n", mpc_mem_stats.inputs);
+  printf("Small Allocs: %li\n", mpc_mem_stats.small);
+  printf("Large Allocs: %li\n", mpc_mem_stats.large);
+  printf("Chunks: %li\n", mpc_mem_stats.chunks);
+  printf("Peak Blocks: %li\n", mpc_mem_stats.peak);
+#ifdef MPC_PROFILE
+  mpc_profile_print(p);
+#endif
+}
+
+/*
+** Prediction
+**
+** FIRST sets - the chars a parser can start
+** with - and whether it can succeed without
+** consuming anything. Rules refer to each
+** other in cycles so the sets are grown until
+** nothing changes. Parsers that cannot be
+** looked into, such as `satisfy` or undefined
+** rules, can start with anything.
+*/
+
+typedef struct {
+  mpc_parser_t *p;
+  mpc_charset_t first;
+  int nullable;
+  int pass;
+} mpc_first_t;
+
+typedef struct {
+  mpc_first_t *xs;
+  int *table;
+  int num;
+  int slots;
+  int pass;
+  int changed;
+} mpc_first_map_t;
+
+static int mpc_first_find(mpc_first_map_t *m, mpc_parser_t *p) {
+  
+  int j, k;
+  size_t h;
+  
+  if (m->num * 2 >= m->slots) {
+    free(m->table);
+    m->slots = m->slots ? m->slots * 2 : 64;
+    m->table = malloc(sizeof(int) * m->slots);
+    for (j = 0; j < m->slots; j++) { m->table[j] = -1; }
+    for (k = 0; k < m->num; k++) {
+      h = ((size_t)m->xs[k].p >> 4) % m->slots;
+      while (m->table[h] != -1) { h = (h + 1) % m->slots; }
+      m->table[h] = k;
+    }
+    m->xs = realloc(m->xs, sizeof(mpc_first_t) * m->slots);
+  }
+  
+  h = ((size_t)p >> 4) % m->slots;
+  while (m->table[h] != -1) {
+    if (m->xs[m->table[h]].p == p) { return m->table[h]; }
+    h = (h + 1) % m->slots;
+  }
+  
+  m->table[h] = m->num;
+  m->xs[m->num].p = p;
+  memset(m->xs[m->num].first, 0, sizeof(mpc_charset_t));
+  m->xs[m->num].nullable = 0;
+  m->xs[m->num].pass = 0;
+  return m->num++;
+}
+
+static int mpc_first(mpc_first_map_t *m, mpc_parser_t *p, unsigned char *first);
+
+/* FIRST of a sequence, which looks past each part that can be empty */
+static int mpc_first_seq(mpc_first_map_t *m, int n, mpc_parser_t **xs, unsigned char *first) {
+  int j;
+  mpc_charset_t x;
+  for (j = 0; j < n; j++) {
+    if (!mpc_first(m, xs[j], x)) { mpc_charset_union(first, x); return 0; }
+    mpc_charset_union(first, x);
+  }
+  return 1;
+}
+
+static int mpc_first(mpc_first_map_t *m, mpc_parser_t *p, unsigned char *first) {
+  
+  int k = mpc_first_find(m, p), j, nullable = 0;
+  mpc_charset_t x;
+  
+  /* Already seen this pass, perhaps further up a cycle, so use what is known so far */
+  if (m->xs[k].pass == m->pass) {
+    memcpy(first, m->xs[k].first, sizeof(mpc_charset_t));
+    return m->xs[k].nullable;
+  }
+  m->xs[k].pass = m->pass;
+  
+  memset(x, 0, sizeof(mpc_charset_t));
+  
+  switch (p->type) {
+    
+    case MPC_TYPE_FAIL: break;
+    
+    case MPC_TYPE_PASS:
+    case MPC_TYPE_LIFT:
+    case MPC_TYPE_LIFT_VAL:
+    case MPC_TYPE_ANCHOR:
+    case MPC_TYPE_STATE:
+    case MPC_TYPE_NOT:
+      nullable = 1;
+      break;
+    
+    case MPC_TYPE_ANY:
+    case MPC_TYPE_SINGLE:
+    case MPC_TYPE_RANGE:
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:
+      mpc_re_charset(p, x);
+      break;
+    
+    case MPC_TYPE_STRING:
+      if (p->data.string.x[0]) { mpc_charset_add(x, (unsigned char)p->data.string.x[0]); }
+      nullable = !p->data.string.x[0];
+      break;
+    
+    case MPC_TYPE_EXPECT:   nullable = mpc_first(m, p->data.expect.x, x); break;
+    case MPC_TYPE_APPLY:    nullable = mpc_first(m, p->data.apply.x, x); break;
+    case MPC_TYPE_APPLY_TO: nullable = mpc_first(m, p->data.apply_to.x, x); break;
+    case MPC_TYPE_PREDICT:  nullable = mpc_first(m, p->data.predict.x, x); break;
+    case MPC_TYPE_DFA:      nullable = mpc_first(m, p->data.dfa.x, x); break;
+    case MPC_TYPE_SPAN:     nullable = mpc_first(m, p->data.span.x, x); break;
+    case MPC_TYPE_MEMO:     nullable = mpc_first(m, p->data.memo.x, x); break;
+    case MPC_TYPE_SLICE:    nullable = mpc_first(m, p->data.slice.x, x); break;
+    
+    case MPC_TYPE_MAYBE:
+    case MPC_TYPE_MANY:
+      mpc_first(m, p->type == MPC_TYPE_MAYBE ? p->data.not.x : p->data.repeat.x, x);
+      nullable = 1;
+      break;
+    
+    case MPC_TYPE_MANY1: nullable = mpc_first(m, p->data.repeat.x, x); break;
+    case MPC_TYPE_COUNT: nullable = mpc_first(m, p->data.repeat.x, x) || p->data.repeat.n == 0; break;
+    
+    case MPC_TYPE_OR:
+      for (j = 0; j < p->data.or.n; j++) {
+        mpc_charset_t y;
+        nullable |= mpc_first(m, p->data.or.xs[j], y);
+        mpc_charset_union(x, y);
+      }
+      break;
+    
+    case MPC_TYPE_AND: nullable = mpc_first_seq(m, p->data.and.n, p->data.and.xs, x); break;
+    
+    default:
+      memset(x, 0xFF, sizeof(mpc_charset_t));
+      nullable = 1;
+      break;
+  }
+  
+  /* Index again rather than holding a pointer, as the recursion may have moved the entries */
+  for (j = 0; j < (int)sizeof(mpc_charset_t); j++) {
+    if (x[j] & ~m->xs[k].first[j]) { m->changed = 1; }
+  }
+  if (nullable && !m->xs[k].nullable) { m->changed = 1; }
+  mpc_charset_union(m->xs[k].first, x);
+  m->xs[k].nullable |= nullable;
+  
+  memcpy(first, m->xs[k].first, sizeof(mpc_charset_t));
+  return m->xs[k].nullable;
+}
+
+static void mpc_predict_or_free(mpc_pdata_or_t *d) {
+  free(d->first);
+  free(d->nullable);
+  free(d->dispatch);
+  d->first = NULL;
+  d->nullable = NULL;
+  d->dispatch = NULL;
+}
+
+/* Fill in the tables of each `or` in a rule, using the converged sets */
+static void mpc_predict_unretained(mpc_first_map_t *m, mpc_parser_t *p, int force) {
+  
+  int j, k, c;
+  mpc_pdata_or_t *d;
+  
+  if (p->retained && !force) { return; }
+  
+  switch (p->type) {
+    case MPC_TYPE_EXPECT:   mpc_predict_unretained(m, p->data.expect.x, 0); break;
+    case MPC_TYPE_APPLY:    mpc_predict_unretained(m, p->data.apply.x, 0); break;
+    case MPC_TYPE_APPLY_TO: mpc_predict_unretained(m, p->data.apply_to.x, 0); break;
+    case MPC_TYPE_PREDICT:  mpc_predict_unretained(m, p->data.predict.x, 0); break;
+    case MPC_TYPE_MEMO:     mpc_predict_unretained(m, p->data.memo.x, 0); break;
+    case MPC_TYPE_SLICE:    mpc_predict_unretained(m, p->data.slice.x, 0); break;
+    case MPC_TYPE_DFA:      mpc_predict_unretained(m, p->data.dfa.x, 0); break;
+    case MPC_TYPE_SPAN:     mpc_predict_unretained(m, p->data.span.x, 0); break;
+    case MPC_TYPE_NOT:
+    case MPC_TYPE_MAYBE:    mpc_predict_unretained(m, p->data.not.x, 0); break;
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:    mpc_predict_unretained(m, p->data.repeat.x, 0); break;
+    case MPC_TYPE_AND:
+      for (j = 0; j < p->data.and.n; j++) { mpc_predict_unretained(m, p->data.and.xs[j], 0); }
+      break;
+    case MPC_TYPE_OR:
+      for (j = 0; j < p->data.or.n; j++) { mpc_predict_unretained(m, p->data.or.xs[j], 0); }
+      break;
+    default: break;
+  }
+  
+  if (p->type != MPC_TYPE_OR || p->data.or.n == 0) { return; }
+  
+  d = &p->data.or;
+  mpc_predict_or_free(d);
+  d->first = malloc(sizeof(mpc_charset_t) * d->n);
+  d->nullable = malloc(d->n);
+  d->dispatch = malloc(sizeof(int) * 256);
+  for (c = 0; c < 256; c++) { d->dispatch[c] = -1; }
+  
+  for (j = 0; j < d->n; j++) {
+    d->nullable[j] = mpc_first(m, d->xs[j], d->first + j * sizeof(mpc_charset_t));
+    for (c = 0; c < 256; c++) {
+      if (!mpc_charset_has(d->first + j * sizeof(mpc_charset_t), c)) { continue; }
+      k = d->dispatch[c];
+      d->dispatch[c] = k == -1 ? j : -2;
+    }
+  }
+  
+  /* A table only works when no char starts two alternatives and none can be empty */
+  for (j = 0; j < d->n; j++) {
+    if (d->nullable[j]) { free(d->dispatch); d->dispatch = NULL; return; }
+  }
+  for (c = 0; c < 256; c++) {
+    if (d->dispatch[c] == -2) { free(d->dispatch); d->dispatch = NULL; return; }
+  }
+}
+
+static void mpc_predict(mpc_parser_t *p) {
+  
+  mpc_first_map_t m;
+  mpc_charset_t x;
+  
+  m.xs = NULL;
+  m.table = NULL;
+  m.num = 0;
+  m.slots = 0;
+  m.pass = 0;
+  
+  do {
+    m.pass++;
+    m.changed = 0;
+    mpc_first(&m, p, x);
+  } while (m.changed);
+  
+  mpc_predict_unretained(&m, p, 1);
+  
+  free(m.xs);
+  free(m.table);
+}
+
+/*
+** Optimisation
+**
+** Rewrites the unretained part of a parser to
+** one that parses the same input into the same
+** values and errors using fewer nodes. Inside
+** an `expect` or `not` errors are suppressed,
+** so an inner `expect` does nothing there and
+** the chars, strings and classes it leaves bare
+** can be merged. Bare char parsers fail without
+** an error, so those merge anywhere.
+*/
+
+/* Puts `t` in place of `p`, which keeps its name */
+static void mpc_optimise_replace(mpc_parser_t *p, mpc_parser_t *t) {
+  p->type = t->type;
+  p->data = t->data;
+  free(t->name);
+  free(t);
+}
+
+/* Parsers that always parse the same, either can stand in for the other */
+static int mpc_optimise_equal(mpc_parser_t *a, mpc_parser_t *b) {
+  
+  int j;
+  
+  if (a == b) { return 1; }
+  if (a->retained || b->retained || a->type != b->type) { return 0; }
+  
+  switch (a->type) {
+    
+    case MPC_TYPE_ANY:
+    case MPC_TYPE_PASS:
+    case MPC_TYPE_STATE: return 1;
+    
+    case MPC_TYPE_SINGLE:   return a->data.single.x == b->data.single.x;
+    case MPC_TYPE_RANGE:    return memcmp(a->data.range.set, b->data.range.set, sizeof(mpc_charset_t)) == 0;
+    case MPC_TYPE_ONEOF:
+    case MPC_TYPE_NONEOF:   return memcmp(a->data.string.set, b->data.string.set, sizeof(mpc_charset_t)) == 0;
+    case MPC_TYPE_STRING:   return strcmp(a->data.string.x, b->data.string.x) == 0;
+    case MPC_TYPE_SATISFY:  return a->data.satisfy.f == b->data.satisfy.f;
+    case MPC_TYPE_ANCHOR:   return a->data.anchor.f == b->data.anchor.f;
+    case MPC_TYPE_LIFT:     return a->data.lift.lf == b->data.lift.lf;
+    case MPC_TYPE_LIFT_VAL: return a->data.lift.x == b->data.lift.x;
+    
+    case MPC_TYPE_EXPECT:
+      return strcmp(a->data.expect.m, b->data.expect.m) == 0
+        && mpc_optimise_equal(a->data.expect.x, b->data.expect.x);
+    
+    case MPC_TYPE_APPLY:
+      return a->data.apply.f == b->data.apply.f
+        && mpc_optimise_equal(a->data.apply.x, b->data.apply.x);
+    
+    case MPC_TYPE_APPLY_TO:
+      return a->data.apply_to.f == b->data.apply_to.f
+        && a->data.apply_to.d == b->data.apply_to.d
+        && mpc_optimise_equal(a->data.apply_to.x, b->data.apply_to.x);
+    
+    case MPC_TYPE_PREDICT: return mpc_optimise_equal(a->data.predict.x, b->data.predict.x);
+    
+    case MPC_TYPE_SLICE:
+      return a->data.slice.f == b->data.slice.f
+        && mpc_optimise_equal(a->data.slice.x, b->data.slice.x);
+    
+    case MPC_TYPE_NOT:
+    case MPC_TYPE_MAYBE:
+      return a->data.not.dx == b->data.not.dx
+        && a->data.not.lf == b->data.not.lf
+        && mpc_optimise_equal(a->data.not.x, b->data.not.x);
+    
+    case MPC_TYPE_MANY:
+    case MPC_TYPE_MANY1:
+    case MPC_TYPE_COUNT:
+      return a->data.repeat.n == b->data.repeat.n
+        && a->data.repeat.f == b->data.repeat.f
+        && a->data.repeat.dx == b->data.repeat.dx
+        && mpc_optimise_equal(a->data.repeat.x, b->data.repeat.x);
+    
+    case MPC_TYPE_SPAN:
+      return a->data.span.min == b->data.span.min
+        && mpc_optimise_equal(a->data.span.x, b->data.span.x);
+    
+    case MPC_TYPE_OR:
+      if (a->data.or.n != b->data.or.n) { return 0; }
+      for (j = 0; j < a->data.or.n; j++) {
+        if (!mpc_optimise_equal(a->data.or.xs[j], b->data.or.xs[j])) { return 0; }
+      }
+      return 1;
+    
+    case MPC_TYPE_AND:
+      if (a->data.and.n != b->data.and.n || a->data.and.f != b->data.and.f) { return 0; }
+      for (j = 0; j < a->data.and.n; j++) {
+        if (!mpc_optimise_equal(a->data.and.xs[j], b->data.and.xs[j])) { return 0; }
+        if (j > 0 && a->data.and.dxs[j-1] != b->data.and.dxs[j-1]) { return 0; }
+      }
+      return 1;
+    
+    default: return 0;
+  }
+  
+}
+
+/* Parsers whose result is always NULL */
+static int mpc_optimise_null(mpc_parser_t *p) {
+  if (p->retained) { return 0; }
+  switch (p->type) {
+    case MPC_TYPE_PASS:
+    case MPC_TYPE_ANCHOR:   return 1;
+    case MPC_TYPE_LIFT:     return p->data.lift.lf == mpcf_ctor_null;
+    case MPC_TYPE_LIFT_VAL: return p->data.lift.x == NULL;
+    case MPC_TYPE_NOT:      return p->data.not.lf == mpcf_ctor_null;
+    case MPC_TYPE_APPLY:    return p->data.apply.f == mpcf_free;
+    case MPC_TYPE_EXPECT:   return mpc_optimise_null(p->data.expect.x);
+    case MPC_TYPE_PREDICT:  return mpc_optimise_null(p->data.predict.x);
+    default: return 0;
+  }
+}
+
+/* Bare chars and strings, which fail without an error */
+static int mpc_optimise_literal(mpc_parser_t *p) {
+  return !p->retained && (p->type == MPC_TYPE_SINGLE || p->type == MPC_TYPE_STRING);
+}
+
+/* Bare single char parsers, the chars they match go in `set` */
+static int mpc_optimise_class(mpc_parser_t *p, unsigned char *set) {
+  return !p->retained && mpc_re_charset(p, set);
+}
+
+/* Puts `x` in place of the `m` alternatives from `k` on, which are already deleted */
+static void mpc_optimise_or_replace(mpc_parser_t *p, int k, int m, mpc_parser_t *x) {
+  mpc_pdata_or_t *d = &p->data.or;
+  memmove(d->xs + k + 1, d->xs + k + m, (d->n - k - m) * sizeof(mpc_parser_t*));
+  d->xs[k] = x;
+  d->n -= m - 1;
+  mpc_predict_or_free(d);
+}
+
+/* Takes the alternatives of an unretained `or` in place of it */
+static int mpc_optimise_flatten_or(mpc_parser_t *p) {
+  
+  int k, n, m;
+  mpc_parser_t *t;
+  mpc_pdata_or_t *d = &p->data.or;
+  
+  for (k = 0; k < d->n; k++) {
+    t = d->xs[k];
+    /* An empty `or` succeeds, so it has to stay */
+    if (t->type != MPC_TYPE_OR || t->retained || t->data.or.n == 0) { continue; }
+    n = d->n; m = t->data.or.n;
+    d->xs = realloc(d->xs, sizeof(mpc_parser_t*) * (n + m - 1));
+    memmove(d->xs + k + m, d->xs + k + 1, (n - k - 1) * sizeof(mpc_parser_t*));
+    memmove(d->xs + k, t->data.or.xs, m * sizeof(mpc_parser_t*));
+    d->n = n + m - 1;
+    mpc_predict_or_free(d);
+    mpc_predict_or_free(&t->data.or);
+    free(t->data.or.xs); free(t->name); free(t);
+    return 1;
+  }
+  
+  return 0;
+}
+
+/* Takes the parts of an unretained `and` folding the same way in place of it */
+static int mpc_optimise_flatten_and(mpc_parser_t *p) {
+  
+  int j, k, n, m;
+  mpc_parser_t *t;
+  mpc_pdata_and_t *d = &p->data.and;
+  
+  if (d->f != mpcf_fold_ast && d->f != mpcf_strfold) { return 0; }
+  
+  for (k = 0; k < d->n; k++) {
+    t = d->xs[k];
+    if (t->type != MPC_TYPE_AND || t->retained || t->data.and.f != d->f || t->data.and.n == 0) { continue; }
+    n = d->n; m = t->data.and.n;
+    d->xs = realloc(d->xs, sizeof(mpc_parser_t*) * (n + m - 1));
+    d->dxs = realloc(d->dxs, sizeof(mpc_dtor_t) * (n + m - 1));
+    memmove(d->xs + k + m, d->xs + k + 1, (n - k - 1) * sizeof(mpc_parser_t*));
+    memmove(d->xs + k, t->data.and.xs, m * sizeof(mpc_parser_t*));
+    d->n = n + m - 1;
+    for (j = 0; j < d->n - 1; j++) {
+      d->dxs[j] = d->f == mpcf_fold_ast ? (mpc_dtor_t)mpc_ast_delete : free;
+    }
+    free(t->data.and.xs); free(t->data.and.dxs); free(t->name); free(t);
+    return 1;
+  }
+  
+  return 0;
+}
+
+/* Neighbouring bare char alternatives become one class */
+static int mpc_optimise_classes(mpc_parser_t *p) {
+  
+  int c, j, k, m, l;
+  mpc_charset_t set, x;
+  mpc_parser_t *t;
+  mpc_pdata_or_t *d = &p->data.or;
+  
+  for (k = 0; k < d->n; k++) {
+    if (!mpc_optimise_class(d->xs[k], set)) { continue; }
+    for (m = 1; k + m < d->n && mpc_optimise_class(d->xs[k+m], x); m++) {
+      mpc_charset_union(set, x);
+    }
+    if (m == 1) { continue; }
+    
+    t = mpc_undefined();
+    t->type = MPC_TYPE_ONEOF;
+    t->data.string.x = malloc(256);
+    t->data.string.set = malloc(sizeof(mpc_charset_t));
+    memcpy(t->data.string.set, set, sizeof(mpc_charset_t));
+    for (c = 1, l = 0; c < 256; c++) {
+      if (mpc_charset_has(set, c)) { t->data.string.x[l++] = (char)c; }
+    }
+    t->data.string.x[l] = '\0';
+    
+    for (j = k; j < k + m; j++) { mpc_soft_delete(d->xs[j]); }
+    mpc_optimise_or_replace(p, k, m, t);
+    return 1;
+  }
+  
+  return 0;
+}
+
+/* Neighbouring bare chars and strings in a sequence become one string */
+static int mpc_optimise_strings(mpc_parser_t *p) {
+  
+  int j, k, m;
+  size_t l;
+  char *s;
+  mpc_parser_t *t;
+  mpc_pdata_and_t *d = &p->data.and;
+  
+  for (k = 0; k < d->n; k++) {
+    for (m = 0, l = 0; k + m < d->n && mpc_optimise_literal(d->xs[k+m]); m++) {
+      t = d->xs[k+m];
+      l += t->type == MPC_TYPE_SINGLE ? 1 : strlen(t->data.string.x);
+    }
+    if (m < 2) { continue; }
+    
+    s = malloc(l + 1);
+    for (j = k, l = 0; j < k + m; j++) {
+      t = d->xs[j];
+      if (t->type == MPC_TYPE_SINGLE) {
+        s[l++] = t->data.single.x;
+      } else {
+        strcpy(s + l, t->data.string.x);
+        l += strlen(t->data.string.x);
+      }
+      mpc_soft_delete(t);
+    }
+    s[l] = '\0';
+    
+    t = mpc_undefined();
+    t->type = MPC_TYPE_STRING;
+    t->data.string.x = s;
+    
+    memmove(d->xs + k + 1, d->xs + k + m, (d->n - k - m) * sizeof(mpc_parser_t*));
+    d->xs[k] = t;
+    d->n -= m - 1;
+    for (j = 0; j < d->n - 1; j++) { d->dxs[j] = free; }
+    return 1;
+  }
+  
+  return 0;
+}
+
+/* What a string sequence starts with, or the parser itself */
+static mpc_parser_t *mpc_optimise_head(mpc_parser_t *p) {
+  if (p->type == MPC_TYPE_AND && !p->retained
+  &&  p->data.and.f == mpcf_strfold && p->data.and.n > 0) {
+    return p->data.and.xs[0];
+  }
+  return p;
+}
+
+static void mpc_optimise_unretained(mpc_parser_t *p, int force, int quiet);
+
+/*
+** Neighbouring alternatives that start the same
+** - `ab|ac` - parse the start once - `a(b|c)`.
+** Only for string sequences, where splitting
+** a sequence in two folds to the same string.
+** The `or` stays even with one alternative left,
+** as it is the `or` that records the errors.
+*/
+
+static int mpc_optimise_hoist(mpc_parser_t *p, int quiet) {
+  
+  int j, k, m, seqs;
+  mpc_parser_t *h, *x, *r, *t;
+  mpc_pdata_or_t *d = &p->data.or;
+  
+  for (k = 0; k < d->n; k++) {
+    h = mpc_optimise_head(d->xs[k]);
+    seqs = h != d->xs[k];
+    for (m = 1; k + m < d->n && mpc_optimise_equal(h, mpc_optimise_head(d->xs[k+m])); m++) {
+      seqs += mpc_optimise_head(d->xs[k+m]) != d->xs[k+m];
+    }
+    if (m == 1 || seqs == 0) { continue; }
+    
+    /* What is left of each alternative, an empty string where nothing is */
+    r = mpc_undefined();
+    r->type = MPC_TYPE_OR;
+    r->data.or.n = m;
+    r->data.or.xs = malloc(sizeof(mpc_parser_t*) * m);
+    
+    for (j = 0; j < m; j++) {
+      x = d->xs[k+j];
+      if (mpc_optimise_head(x) == x) {
+        if (j > 0) { mpc_soft_delete(x); }
+        r->data.or.xs[j] = mpc_lift(mpcf_ctor_str);
+        continue;
+      }
+      if (j > 0) { mpc_soft_delete(x->data.and.xs[0]); }
+      if (x->data.and.n == 1 || x->data.and.n == 2) {
+        r->data.or.xs[j] = x->data.and.n == 2 ? x->data.and.xs[1] : mpc_lift(mpcf_ctor_str);
+        free(x->data.and.xs); free(x->data.and.dxs); free(x->name); free(x);
+        continue;
+      }
+      memmove(x->data.and.xs, x->data.and.xs + 1, (x->data.and.n - 1) * sizeof(mpc_parser_t*));
+      memmove(x->data.and.dxs, x->data.and.dxs + 1, (x->data.and.n - 2) * sizeof(mpc_dtor_t));
+      x->data.and.n--;
+      r->data.or.xs[j] = x;
+    }
+    
+    mpc_optimise_unretained(r, 0, quiet);
+    
+    t = mpc_undefined();
+    t->type = MPC_TYPE_AND;
+    t->data.and.n = 2;
+    t->data.and.f = mpcf_strfold;
+    t->data.and.xs = malloc(sizeof(mpc_parser_t*) * 2);
+    t->data.and.dxs = malloc(sizeof(mpc_dtor_t));
+    t->data.and.xs[0] = h;
+    t->data.and.xs[1] = r;
+    t->data.and.dxs[0] = free;
+    
+    mpc_optimise_or_replace(p, k, m, t);
+    return 1;
+  }
+  
+  return 0;
+}
+
+static void mpc_optimise_unretained(mpc_parser_t *p, int force, int quiet) {
+  
+  int i;
+  mpc_parser_t *t;
+  mpc_charset_t set;
+  
+  if (p->retained && !force) { return; }
+  
+  /* Optimise Subexpressions */
+  
+  if (p->type == MPC_TYPE_EXPECT)   { mpc_optimise_unretained(p->data.expect.x, 0, 1); }
+  if (p->type == MPC_TYPE_APPLY)    { mpc_optimise_unretained(p->data.apply.x, 0, quiet); }
+  if (p->type == MPC_TYPE_APPLY_TO) { mpc_optimise_unretained(p->data.apply_to.x, 0, quiet); }
+  if (p->type == MPC_TYPE_PREDICT)  { mpc_optimise_unretained(p->data.predict.x, 0, quiet); }
+  if (p->type == MPC_TYPE_MEMO)     { mpc_optimise_unretained(p->data.memo.x, 0, quiet); }
+  if (p->type == MPC_TYPE_SLICE)    { mpc_optimise_unretained(p->data.slice.x, 0, quiet); }
+  if (p->type == MPC_TYPE_NOT)      { mpc_optimise_unretained(p->data.not.x, 0, 1); }
+  if (p->type == MPC_TYPE_MAYBE)    { mpc_optimise_unretained(p->data.not.x, 0, quiet); }
+  if (p->type == MPC_TYPE_MANY)     { mpc_optimise_unretained(p->data.repeat.x, 0, quiet); }
+  if (p->type == MPC_TYPE_MANY1)    { mpc_optimise_unretained(p->data.repeat.x, 0, quiet); }
+  if (p->type == MPC_TYPE_COUNT)    { mpc_optimise_unretained(p->data.repeat.x, 0, quiet); }
+  
+  if (p->type == MPC_TYPE_OR) { 
+    for(i = 0; i < p->data.or.n; i++) {
+      mpc_optimise_unretained(p->data.or.xs[i], 0, quiet);
+    }
+  }
+  
+  if (p->type == MPC_TYPE_AND) {
+    for(i = 0; i < p->data.and.n; i++) {
+      mpc_optimise_unretained(p->data.and.xs[i], 0, quiet);
+    }
+  }  
+  
+  /* Perform optimisations */
+  
+  while (1) {
+    
+    /* Remove `expect` where errors are suppressed anyway */
+    if (quiet
+    &&  p->type == MPC_TYPE_EXPECT
+    && !p->data.expect.x->retained) {
+      free(p->data.expect.m);
+      mpc_optimise_replace(p, p->data.expect.x);
+      continue;
+    }
+    
+    /* Remove `apply` freeing nothing */
+    if (p->type == MPC_TYPE_APPLY
+    &&  p->data.apply.f == mpcf_free
+    &&  mpc_optimise_null(p->data.apply.x)) {
+      mpc_optimise_replace(p, p->data.apply.x);
+      continue;
+    }
+    
+    /* Merge nested `or` */
+    if (p->type == MPC_TYPE_OR && mpc_optimise_flatten_or(p)) { continue; }
+    
+    /* Merge chars into classes */
+    if (p->type == MPC_TYPE_OR && mpc_optimise_classes(p)) { continue; }
+    
+    /* Remove `or` of one class, neither fails with an error */
+    if (p->type == MPC_TYPE_OR
+    &&  p->data.or.n == 1
+    &&  mpc_optimise_class(p->data.or.xs[0], set)) {
+      t = p->data.or.xs[0];
+      mpc_predict_or_free(&p->data.or);
+      free(p->data.or.xs);
+      mpc_optimise_replace(p, t);
+      continue;
+    }
+    
+    /* Hoist common starts of re alternatives */
+    if (p->type == MPC_TYPE_OR && mpc_optimise_hoist(p, quiet)) { continue; }
+    
+    /* Remove ast `pass` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.n == 2
+    &&  p->data.and.xs[0]->type == MPC_TYPE_PASS
+    && !p->data.and.xs[0]->retained
+    &&  p->data.and.f == mpcf_fold_ast) {
+      t = p->data.and.xs[1];
+      mpc_delete(p->data.and.xs[0]);
+      free(p->data.and.xs); free(p->data.and.dxs);
+      mpc_optimise_replace(p, t);
+      continue;
+    }
+    
+    /* Merge nested ast and re `and` */
+    if (p->type == MPC_TYPE_AND && mpc_optimise_flatten_and(p)) { continue; }
+    
+    /* Merge re chars and strings */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.f == mpcf_strfold
+    &&  mpc_optimise_strings(p)) {
+      continue;
+    }
+    
+    /* Remove re `and` of one */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.n == 1
+    &&  p->data.and.f == mpcf_strfold
+    && !p->data.and.xs[0]->retained) {
+      t = p->data.and.xs[0];
+      free(p->data.and.xs); free(p->data.and.dxs);
+      mpc_optimise_replace(p, t);
+      continue;
+    }
+
+    /* Remove re `lift` */
+    if (p->type == MPC_TYPE_AND
+    &&  p->data.and.n == 2
+    &&  p->data.and.xs[0]->type == MPC_TYPE_LIFT
+    &&  p->data.and.xs[0]->data.lift.lf == mpcf_ctor_str
+    && !p->data.and.xs[0]->retained
+    &&  p->data.and.f == mpcf_strfold) {
+      t = p->data.and.xs[1];
+      mpc_delete(p->data.and.xs[0]);
+      free(p->data.and.xs); free(p->data.and.dxs);
+      mpc_optimise_replace(p, t);
+      continue;
+    }
+    
+    /* Fuse re `many` of a class into a `span` */
+    if ((p->type == MPC_TYPE_MANY || p->type == MPC_TYPE_MANY1)
+    &&  p->data.repeat.f == mpcf_strfold
+    &&  mpc_span_class(p->data.repeat.x)) {
+      t = malloc(sizeof(mpc_parser_t));
+      memcpy(t, p, sizeof(mpc_parser_t));
+      t->name = NULL;
+      t->retained = 0;
+      p->data.span.x = t;
+      p->data.span.min = t->type == MPC_TYPE_MANY1 ? 1 : 0;
+      p->data.span.set = mpc_span_class(t->data.repeat.x);
+      mpc_span_ranges(&p->data.span);
+      p->type = MPC_TYPE_SPAN;
+      continue;
+    }
+    
+    return;
+    
+  }
+  
+}
+
+void mpc_optimise(mpc_parser_t *p) {
+  mpc_optimise_unretained(p, 1, 0);
+  mpc_predict(p);
+}
+
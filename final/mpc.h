@@ -1,370 +1,488 @@
-/*
-** mpc - Micro Parser Combinator library for C
-**
-** https://github.com/orangeduck/mpc
-**
-** Daniel Holden - contact@daniel-holden.com
-** Licensed under BSD3
-*/
-
-#ifndef mpc_h
-#define mpc_h
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-#include <stdlib.h>
-#include <stdio.h>
-#include <stdarg.h>
-#include <string.h>
-#include <math.h>
-#include <errno.h>
-#include <ctype.h>
-
-/*
-** State Type
-*/
-
-typedef struct {
-  long pos;
-  long row;
-  long col;
-} mpc_state_t;
-
-/*
-** Error Type
-*/
-
-typedef struct {
-  mpc_state_t state;
-  int expected_num;
-  char *filename;
-  char *failure;
-  char **expected;
-  char recieved;
-} mpc_err_t;
-
-void mpc_err_delete(mpc_err_t *e);
-char *mpc_err_string(mpc_err_t *e);
-void mpc_err_print(mpc_err_t *e);
-void mpc_err_print_to(mpc_err_t *e, FILE *f);
-
-/*
-** Parsing
-*/
-
-typedef void mpc_val_t;
-
-typedef union {
-  mpc_err_t *error;
-  mpc_val_t *output;
-} mpc_result_t;
-
-struct mpc_parser_t;
-typedef struct mpc_parser_t mpc_parser_t;
-
-int mpc_parse(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r);
-int mpc_nparse(const char *filename, const char *string, size_t length, mpc_parser_t *p, mpc_result_t *r);
-int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result_t *r);
-int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r);
-int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r);
-
-/*
-** Function Types
-*/
-
-typedef void(*mpc_dtor_t)(mpc_val_t*);
-typedef mpc_val_t*(*mpc_ctor_t)(void);
-
-typedef mpc_val_t*(*mpc_apply_t)(mpc_val_t*);
-typedef mpc_val_t*(*mpc_apply_to_t)(mpc_val_t*,void*);
-typedef mpc_val_t*(*mpc_fold_t)(int,mpc_val_t**);
-
-/*
-** Building a Parser
-*/
-
-mpc_parser_t *mpc_new(const char *name);
-mpc_parser_t *mpc_copy(mpc_parser_t *a);
-mpc_parser_t *mpc_define(mpc_parser_t *p, mpc_parser_t *a);
-mpc_parser_t *mpc_undefine(mpc_parser_t *p);
-
-void mpc_delete(mpc_parser_t *p);
-void mpc_cleanup(int n, ...);
-
-/*
-** Basic Parsers
-*/
-
-mpc_parser_t *mpc_any(void);
-mpc_parser_t *mpc_char(char c);
-mpc_parser_t *mpc_range(char s, char e);
-mpc_parser_t *mpc_oneof(const char *s);
-mpc_parser_t *mpc_noneof(const char *s);
-mpc_parser_t *mpc_satisfy(int(*f)(char));
-mpc_parser_t *mpc_string(const char *s);
-
-/*
-** Other Parsers
-*/
-
-mpc_parser_t *mpc_pass(void);
-mpc_parser_t *mpc_fail(const char *m);
-mpc_parser_t *mpc_failf(const char *fmt, ...);
-mpc_parser_t *mpc_lift(mpc_ctor_t f);
-mpc_parser_t *mpc_lift_val(mpc_val_t *x);
-mpc_parser_t *mpc_anchor(int(*f)(char,char));
-mpc_parser_t *mpc_state(void);
-
-/*
-** Combinator Parsers
-*/
-
-mpc_parser_t *mpc_expect(mpc_parser_t *a, const char *e);
-mpc_parser_t *mpc_expectf(mpc_parser_t *a, const char *fmt, ...);
-mpc_parser_t *mpc_apply(mpc_parser_t *a, mpc_apply_t f);
-mpc_parser_t *mpc_apply_to(mpc_parser_t *a, mpc_apply_to_t f, void *x);
-
-mpc_parser_t *mpc_not(mpc_parser_t *a, mpc_dtor_t da);
-mpc_parser_t *mpc_not_lift(mpc_parser_t *a, mpc_dtor_t da, mpc_ctor_t lf);
-mpc_parser_t *mpc_maybe(mpc_parser_t *a);
-mpc_parser_t *mpc_maybe_lift(mpc_parser_t *a, mpc_ctor_t lf);
-
-mpc_parser_t *mpc_many(mpc_fold_t f, mpc_parser_t *a);
-mpc_parser_t *mpc_many1(mpc_fold_t f, mpc_parser_t *a);
-mpc_parser_t *mpc_count(int n, mpc_fold_t f, mpc_parser_t *a, mpc_dtor_t da);
-
-mpc_parser_t *mpc_or(int n, ...);
-mpc_parser_t *mpc_and(int n, mpc_fold_t f, ...);
-
-mpc_parser_t *mpc_predictive(mpc_parser_t *a);
-
-/*
-** Common Parsers
-*/
-
-mpc_parser_t *mpc_eoi(void);
-mpc_parser_t *mpc_soi(void);
-
-mpc_parser_t *mpc_boundary(void);
-
-mpc_parser_t *mpc_whitespace(void);
-mpc_parser_t *mpc_whitespaces(void);
-mpc_parser_t *mpc_blank(void);
-
-mpc_parser_t *mpc_newline(void);
-mpc_parser_t *mpc_tab(void);
-mpc_parser_t *mpc_escape(void);
-
-mpc_parser_t *mpc_digit(void);
-mpc_parser_t *mpc_hexdigit(void);
-mpc_parser_t *mpc_octdigit(void);
-mpc_parser_t *mpc_digits(void);
-mpc_parser_t *mpc_hexdigits(void);
-mpc_parser_t *mpc_octdigits(void);
-
-mpc_parser_t *mpc_lower(void);
-mpc_parser_t *mpc_upper(void);
-mpc_parser_t *mpc_alpha(void);
-mpc_parser_t *mpc_underscore(void);
-mpc_parser_t *mpc_alphanum(void);
-
-mpc_parser_t *mpc_int(void);
-mpc_parser_t *mpc_hex(void);
-mpc_parser_t *mpc_oct(void);
-mpc_parser_t *mpc_number(void);
-
-mpc_parser_t *mpc_real(void);
-mpc_parser_t *mpc_float(void);
-
-mpc_parser_t *mpc_char_lit(void);
-mpc_parser_t *mpc_string_lit(void);
-mpc_parser_t *mpc_regex_lit(void);
-
-mpc_parser_t *mpc_ident(void);
-
-/*
-** Useful Parsers
-*/
-
-mpc_parser_t *mpc_startwith(mpc_parser_t *a);
-mpc_parser_t *mpc_endwith(mpc_parser_t *a, mpc_dtor_t da);
-mpc_parser_t *mpc_whole(mpc_parser_t *a, mpc_dtor_t da);
-
-mpc_parser_t *mpc_stripl(mpc_parser_t *a);
-mpc_parser_t *mpc_stripr(mpc_parser_t *a);
-mpc_parser_t *mpc_strip(mpc_parser_t *a);
-mpc_parser_t *mpc_tok(mpc_parser_t *a); 
-mpc_parser_t *mpc_sym(const char *s);
-mpc_parser_t *mpc_total(mpc_parser_t *a, mpc_dtor_t da);
-
-mpc_parser_t *mpc_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c);
-mpc_parser_t *mpc_parens(mpc_parser_t *a, mpc_dtor_t ad);
-mpc_parser_t *mpc_braces(mpc_parser_t *a, mpc_dtor_t ad);
-mpc_parser_t *mpc_brackets(mpc_parser_t *a, mpc_dtor_t ad);
-mpc_parser_t *mpc_squares(mpc_parser_t *a, mpc_dtor_t ad);
-
-mpc_parser_t *mpc_tok_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c);
-mpc_parser_t *mpc_tok_parens(mpc_parser_t *a, mpc_dtor_t ad);
-mpc_parser_t *mpc_tok_braces(mpc_parser_t *a, mpc_dtor_t ad);
-mpc_parser_t *mpc_tok_brackets(mpc_parser_t *a, mpc_dtor_t ad);
-mpc_parser_t *mpc_tok_squares(mpc_parser_t *a, mpc_dtor_t ad);
-
-/*
-** Common Function Parameters
-*/
-
-void mpcf_dtor_null(mpc_val_t *x);
-
-mpc_val_t *mpcf_ctor_null(void);
-mpc_val_t *mpcf_ctor_str(void);
-
-mpc_val_t *mpcf_free(mpc_val_t *x);
-mpc_val_t *mpcf_int(mpc_val_t *x);
-mpc_val_t *mpcf_hex(mpc_val_t *x);
-mpc_val_t *mpcf_oct(mpc_val_t *x);
-mpc_val_t *mpcf_float(mpc_val_t *x);
-mpc_val_t *mpcf_strtriml(mpc_val_t *x);
-mpc_val_t *mpcf_strtrimr(mpc_val_t *x);
-mpc_val_t *mpcf_strtrim(mpc_val_t *x);
-
-mpc_val_t *mpcf_escape(mpc_val_t *x);
-mpc_val_t *mpcf_escape_regex(mpc_val_t *x);
-mpc_val_t *mpcf_escape_string_raw(mpc_val_t *x);
-mpc_val_t *mpcf_escape_char_raw(mpc_val_t *x);
-
-mpc_val_t *mpcf_unescape(mpc_val_t *x);
-mpc_val_t *mpcf_unescape_regex(mpc_val_t *x);
-mpc_val_t *mpcf_unescape_string_raw(mpc_val_t *x);
-mpc_val_t *mpcf_unescape_char_raw(mpc_val_t *x);
-
-mpc_val_t *mpcf_null(int n, mpc_val_t** xs);
-mpc_val_t *mpcf_fst(int n, mpc_val_t** xs);
-mpc_val_t *mpcf_snd(int n, mpc_val_t** xs);
-mpc_val_t *mpcf_trd(int n, mpc_val_t** xs);
-
-mpc_val_t *mpcf_fst_free(int n, mpc_val_t** xs);
-mpc_val_t *mpcf_snd_free(int n, mpc_val_t** xs);
-mpc_val_t *mpcf_trd_free(int n, mpc_val_t** xs);
-
-mpc_val_t *mpcf_strfold(int n, mpc_val_t** xs);
-mpc_val_t *mpcf_maths(int n, mpc_val_t** xs);
-
-/*
-** Regular Expression Parsers
-*/
-
-mpc_parser_t *mpc_re(const char *re);
-  
-/*
-** AST
-*/
-
-typedef struct mpc_ast_t {
-  char *tag;
-  char *contents;
-  mpc_state_t state;
-  int children_num;
-  struct mpc_ast_t** children;
-} mpc_ast_t;
-
-mpc_ast_t *mpc_ast_new(const char *tag, const char *contents);
-mpc_ast_t *mpc_ast_build(int n, const char *tag, ...);
-mpc_ast_t *mpc_ast_add_root(mpc_ast_t *a);
-mpc_ast_t *mpc_ast_add_child(mpc_ast_t *r, mpc_ast_t *a);
-mpc_ast_t *mpc_ast_add_tag(mpc_ast_t *a, const char *t);
-mpc_ast_t *mpc_ast_add_root_tag(mpc_ast_t *a, const char *t);
-mpc_ast_t *mpc_ast_tag(mpc_ast_t *a, const char *t);
-mpc_ast_t *mpc_ast_state(mpc_ast_t *a, mpc_state_t s);
-
-void mpc_ast_delete(mpc_ast_t *a);
-void mpc_ast_print(mpc_ast_t *a);
-void mpc_ast_print_to(mpc_ast_t *a, FILE *fp);
-
-int mpc_ast_get_index(mpc_ast_t *ast, const char *tag);
-int mpc_ast_get_index_lb(mpc_ast_t *ast, const char *tag, int lb);
-mpc_ast_t *mpc_ast_get_child(mpc_ast_t *ast, const char *tag);
-mpc_ast_t *mpc_ast_get_child_lb(mpc_ast_t *ast, const char *tag, int lb);
-
-typedef enum {
-  mpc_ast_trav_order_pre,
-  mpc_ast_trav_order_post
-} mpc_ast_trav_order_t;
-
-typedef struct mpc_ast_trav_t {
-  mpc_ast_t             *curr_node;
-  struct mpc_ast_trav_t *parent;
-  int                    curr_child;
-  mpc_ast_trav_order_t   order;
-} mpc_ast_trav_t;
-
-mpc_ast_trav_t *mpc_ast_traverse_start(mpc_ast_t *ast,
-                                       mpc_ast_trav_order_t order);
-
-mpc_ast_t *mpc_ast_traverse_next(mpc_ast_trav_t **trav);
-
-void mpc_ast_traverse_free(mpc_ast_trav_t **trav);
-
-/*
-** Warning: This function currently doesn't test for equality of the `state` member!
-*/
-int mpc_ast_eq(mpc_ast_t *a, mpc_ast_t *b);
-
-mpc_val_t *mpcf_fold_ast(int n, mpc_val_t **as);
-mpc_val_t *mpcf_str_ast(mpc_val_t *c);
-mpc_val_t *mpcf_state_ast(int n, mpc_val_t **xs);
-
-mpc_parser_t *mpca_tag(mpc_parser_t *a, const char *t);
-mpc_parser_t *mpca_add_tag(mpc_parser_t *a, const char *t);
-mpc_parser_t *mpca_root(mpc_parser_t *a);
-mpc_parser_t *mpca_state(mpc_parser_t *a);
-mpc_parser_t *mpca_total(mpc_parser_t *a);
-
-mpc_parser_t *mpca_not(mpc_parser_t *a);
-mpc_parser_t *mpca_maybe(mpc_parser_t *a);
-
-mpc_parser_t *mpca_many(mpc_parser_t *a);
-mpc_parser_t *mpca_many1(mpc_parser_t *a);
-mpc_parser_t *mpca_count(int n, mpc_parser_t *a);
-
-mpc_parser_t *mpca_or(int n, ...);
-mpc_parser_t *mpca_and(int n, ...);
-
-enum {
-  MPCA_LANG_DEFAULT              = 0,
-  MPCA_LANG_PREDICTIVE           = 1,
-  MPCA_LANG_WHITESPACE_SENSITIVE = 2
-};
-
-mpc_parser_t *mpca_grammar(int flags, const char *grammar, ...);
-
-mpc_err_t *mpca_lang(int flags, const char *language, ...);
-mpc_err_t *mpca_lang_file(int flags, FILE *f, ...);
-mpc_err_t *mpca_lang_pipe(int flags, FILE *f, ...);
-mpc_err_t *mpca_lang_contents(int flags, const char *filename, ...);
-
-/*
-** Misc
-*/
-
-
-void mpc_print(mpc_parser_t *p);
-void mpc_optimise(mpc_parser_t *p);
-void mpc_stats(mpc_parser_t *p);
-
-int mpc_test_pass(mpc_parser_t *p, const char *s, const void *d,
-  int(*tester)(const void*, const void*), 
-  mpc_dtor_t destructor, 
-  void(*printer)(const void*));
-
-int mpc_test_fail(mpc_parser_t *p, const char *s, const void *d,
-  int(*tester)(const void*, const void*),
-  mpc_dtor_t destructor,
-  void(*printer)(const void*));
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif
+/*
+** mpc - Micro Parser Combinator library for C
+**
+** https://github.com/orangeduck/mpc
+**
+** Daniel Holden - contact@daniel-holden.com
+** Licensed under BSD3
+*/
+
+#ifndef mpc_h
+#define mpc_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <ctype.h>
+
+/*
+** State Type
+*/
+
+typedef struct {
+  long pos;
+  long row;
+  long col;
+} mpc_state_t;
+
+/*
+** Error Type
+*/
+
+typedef struct {
+  mpc_state_t state;
+  int expected_num;
+  char *filename;
+  char *failure;
+  char **expected;
+  char recieved;
+} mpc_err_t;
+
+void mpc_err_delete(mpc_err_t *e);
+char *mpc_err_string(mpc_err_t *e);
+void mpc_err_print(mpc_err_t *e);
+void mpc_err_print_to(mpc_err_t *e, FILE *f);
+
+/*
+** Parsing
+*/
+
+typedef void mpc_val_t;
+
+typedef union {
+  mpc_err_t *error;
+  mpc_val_t *output;
+} mpc_result_t;
+
+struct mpc_parser_t;
+typedef struct mpc_parser_t mpc_parser_t;
+
+int mpc_parse(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r);
+int mpc_nparse(const char *filename, const char *string, size_t length, mpc_parser_t *p, mpc_result_t *r);
+int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result_t *r);
+int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r);
+int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r);
+
+/*
+** Allocation
+**
+** Inputs take the chunks they keep small blocks in from an
+** allocator, malloc unless another is set for new inputs.
+*/
+
+typedef struct {
+  void *(*alloc)(void *data, size_t n);
+  void (*release)(void *data, void *p);
+  void *data;
+} mpc_allocator_t;
+
+void mpc_allocator_set(const mpc_allocator_t *a);
+
+/*
+** Function Types
+*/
+
+typedef void(*mpc_dtor_t)(mpc_val_t*);
+typedef mpc_val_t*(*mpc_ctor_t)(void);
+
+typedef mpc_val_t*(*mpc_apply_t)(mpc_val_t*);
+typedef mpc_val_t*(*mpc_apply_to_t)(mpc_val_t*,void*);
+typedef mpc_val_t*(*mpc_fold_t)(int,mpc_val_t**);
+typedef mpc_val_t*(*mpc_slice_t)(const char*,long);
+
+/*
+** Building a Parser
+*/
+
+mpc_parser_t *mpc_new(const char *name);
+mpc_parser_t *mpc_copy(mpc_parser_t *a);
+mpc_parser_t *mpc_define(mpc_parser_t *p, mpc_parser_t *a);
+mpc_parser_t *mpc_undefine(mpc_parser_t *p);
+
+void mpc_delete(mpc_parser_t *p);
+void mpc_cleanup(int n, ...);
+
+/*
+** Basic Parsers
+*/
+
+mpc_parser_t *mpc_any(void);
+mpc_parser_t *mpc_char(char c);
+mpc_parser_t *mpc_range(char s, char e);
+mpc_parser_t *mpc_oneof(const char *s);
+mpc_parser_t *mpc_noneof(const char *s);
+mpc_parser_t *mpc_satisfy(int(*f)(char));
+mpc_parser_t *mpc_string(const char *s);
+
+/*
+** Other Parsers
+*/
+
+mpc_parser_t *mpc_pass(void);
+mpc_parser_t *mpc_fail(const char *m);
+mpc_parser_t *mpc_failf(const char *fmt, ...);
+mpc_parser_t *mpc_lift(mpc_ctor_t f);
+mpc_parser_t *mpc_lift_val(mpc_val_t *x);
+mpc_parser_t *mpc_anchor(int(*f)(char,char));
+mpc_parser_t *mpc_state(void);
+
+/*
+** Native Parsers
+**
+** A parser written in C, such as one generated
+** by `mpcgen`, reading the input straight out
+** of memory. It is called with `pos` at the
+** char to start from and `state` giving the
+** row and column there. On success it leaves
+** `pos` after what it matched. Failures are
+** reported as the farthest position `fail`
+** anything failed at, with what was expected
+** there or a `failure` message. Streams are
+** read to the end before it is called. The
+** result pointer is NULL when nothing is to
+** be built, as inside `mpc_slice`.
+*/
+
+enum { MPC_NATIVE_EXPECTED_MAX = 16 };
+
+typedef struct {
+  const char *string;
+  long length;
+  long pos;
+  mpc_state_t state;
+  char last;
+  long fail;
+  const char *failure;
+  int expected_num;
+  const char *expected[MPC_NATIVE_EXPECTED_MAX];
+} mpc_native_input_t;
+
+typedef int(*mpc_native_t)(mpc_native_input_t*,mpc_val_t**);
+
+mpc_parser_t *mpc_native(mpc_native_t f);
+
+/*
+** Combinator Parsers
+*/
+
+mpc_parser_t *mpc_expect(mpc_parser_t *a, const char *e);
+mpc_parser_t *mpc_expectf(mpc_parser_t *a, const char *fmt, ...);
+mpc_parser_t *mpc_apply(mpc_parser_t *a, mpc_apply_t f);
+mpc_parser_t *mpc_apply_to(mpc_parser_t *a, mpc_apply_to_t f, void *x);
+
+mpc_parser_t *mpc_not(mpc_parser_t *a, mpc_dtor_t da);
+mpc_parser_t *mpc_not_lift(mpc_parser_t *a, mpc_dtor_t da, mpc_ctor_t lf);
+mpc_parser_t *mpc_maybe(mpc_parser_t *a);
+mpc_parser_t *mpc_maybe_lift(mpc_parser_t *a, mpc_ctor_t lf);
+
+mpc_parser_t *mpc_many(mpc_fold_t f, mpc_parser_t *a);
+mpc_parser_t *mpc_many1(mpc_fold_t f, mpc_parser_t *a);
+mpc_parser_t *mpc_count(int n, mpc_fold_t f, mpc_parser_t *a, mpc_dtor_t da);
+
+mpc_parser_t *mpc_or(int n, ...);
+mpc_parser_t *mpc_and(int n, mpc_fold_t f, ...);
+
+mpc_parser_t *mpc_predictive(mpc_parser_t *a);
+mpc_parser_t *mpc_memo(mpc_parser_t *a, mpc_apply_t copy, mpc_dtor_t da);
+
+/*
+** Slices
+**
+** `mpc_slice` runs `a` only to see how far it
+** gets, building none of its results, then calls
+** `f` with the text it matched as a pointer and
+** length. On inputs held in memory that points
+** into the input itself, so nothing is copied
+** unless `f` copies it. The text is not null
+** terminated and is only valid during the call.
+** `mpcf_slice_str` makes it an owned string.
+*/
+
+mpc_parser_t *mpc_slice(mpc_parser_t *a, mpc_slice_t f);
+
+/*
+** Common Parsers
+*/
+
+mpc_parser_t *mpc_eoi(void);
+mpc_parser_t *mpc_soi(void);
+
+mpc_parser_t *mpc_boundary(void);
+
+mpc_parser_t *mpc_whitespace(void);
+mpc_parser_t *mpc_whitespaces(void);
+mpc_parser_t *mpc_blank(void);
+
+mpc_parser_t *mpc_newline(void);
+mpc_parser_t *mpc_tab(void);
+mpc_parser_t *mpc_escape(void);
+
+mpc_parser_t *mpc_digit(void);
+mpc_parser_t *mpc_hexdigit(void);
+mpc_parser_t *mpc_octdigit(void);
+mpc_parser_t *mpc_digits(void);
+mpc_parser_t *mpc_hexdigits(void);
+mpc_parser_t *mpc_octdigits(void);
+
+mpc_parser_t *mpc_lower(void);
+mpc_parser_t *mpc_upper(void);
+mpc_parser_t *mpc_alpha(void);
+mpc_parser_t *mpc_underscore(void);
+mpc_parser_t *mpc_alphanum(void);
+
+mpc_parser_t *mpc_int(void);
+mpc_parser_t *mpc_hex(void);
+mpc_parser_t *mpc_oct(void);
+mpc_parser_t *mpc_number(void);
+
+mpc_parser_t *mpc_real(void);
+mpc_parser_t *mpc_float(void);
+
+mpc_parser_t *mpc_char_lit(void);
+mpc_parser_t *mpc_string_lit(void);
+mpc_parser_t *mpc_regex_lit(void);
+
+mpc_parser_t *mpc_ident(void);
+
+/*
+** Useful Parsers
+*/
+
+mpc_parser_t *mpc_startwith(mpc_parser_t *a);
+mpc_parser_t *mpc_endwith(mpc_parser_t *a, mpc_dtor_t da);
+mpc_parser_t *mpc_whole(mpc_parser_t *a, mpc_dtor_t da);
+
+mpc_parser_t *mpc_stripl(mpc_parser_t *a);
+mpc_parser_t *mpc_stripr(mpc_parser_t *a);
+mpc_parser_t *mpc_strip(mpc_parser_t *a);
+mpc_parser_t *mpc_tok(mpc_parser_t *a); 
+mpc_parser_t *mpc_sym(const char *s);
+mpc_parser_t *mpc_total(mpc_parser_t *a, mpc_dtor_t da);
+
+mpc_parser_t *mpc_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c);
+mpc_parser_t *mpc_parens(mpc_parser_t *a, mpc_dtor_t ad);
+mpc_parser_t *mpc_braces(mpc_parser_t *a, mpc_dtor_t ad);
+mpc_parser_t *mpc_brackets(mpc_parser_t *a, mpc_dtor_t ad);
+mpc_parser_t *mpc_squares(mpc_parser_t *a, mpc_dtor_t ad);
+
+mpc_parser_t *mpc_tok_between(mpc_parser_t *a, mpc_dtor_t ad, const char *o, const char *c);
+mpc_parser_t *mpc_tok_parens(mpc_parser_t *a, mpc_dtor_t ad);
+mpc_parser_t *mpc_tok_braces(mpc_parser_t *a, mpc_dtor_t ad);
+mpc_parser_t *mpc_tok_brackets(mpc_parser_t *a, mpc_dtor_t ad);
+mpc_parser_t *mpc_tok_squares(mpc_parser_t *a, mpc_dtor_t ad);
+
+/*
+** Common Function Parameters
+*/
+
+void mpcf_dtor_null(mpc_val_t *x);
+
+mpc_val_t *mpcf_ctor_null(void);
+mpc_val_t *mpcf_ctor_str(void);
+
+mpc_val_t *mpcf_free(mpc_val_t *x);
+mpc_val_t *mpcf_int(mpc_val_t *x);
+mpc_val_t *mpcf_hex(mpc_val_t *x);
+mpc_val_t *mpcf_oct(mpc_val_t *x);
+mpc_val_t *mpcf_float(mpc_val_t *x);
+mpc_val_t *mpcf_strtriml(mpc_val_t *x);
+mpc_val_t *mpcf_strtrimr(mpc_val_t *x);
+mpc_val_t *mpcf_strtrim(mpc_val_t *x);
+
+mpc_val_t *mpcf_escape(mpc_val_t *x);
+mpc_val_t *mpcf_escape_regex(mpc_val_t *x);
+mpc_val_t *mpcf_escape_string_raw(mpc_val_t *x);
+mpc_val_t *mpcf_escape_char_raw(mpc_val_t *x);
+
+mpc_val_t *mpcf_unescape(mpc_val_t *x);
+mpc_val_t *mpcf_unescape_regex(mpc_val_t *x);
+mpc_val_t *mpcf_unescape_string_raw(mpc_val_t *x);
+mpc_val_t *mpcf_unescape_char_raw(mpc_val_t *x);
+
+mpc_val_t *mpcf_null(int n, mpc_val_t** xs);
+mpc_val_t *mpcf_fst(int n, mpc_val_t** xs);
+mpc_val_t *mpcf_snd(int n, mpc_val_t** xs);
+mpc_val_t *mpcf_trd(int n, mpc_val_t** xs);
+
+mpc_val_t *mpcf_fst_free(int n, mpc_val_t** xs);
+mpc_val_t *mpcf_snd_free(int n, mpc_val_t** xs);
+mpc_val_t *mpcf_trd_free(int n, mpc_val_t** xs);
+
+mpc_val_t *mpcf_strfold(int n, mpc_val_t** xs);
+mpc_val_t *mpcf_maths(int n, mpc_val_t** xs);
+
+mpc_val_t *mpcf_slice_str(const char *s, long n);
+
+/*
+** Regular Expression Parsers
+*/
+
+mpc_parser_t *mpc_re(const char *re);
+  
+/*
+** AST
+**
+** The nodes of a parse result share an arena. Each node is still
+** deleted on its own: `mpc_ast_delete` deletes a node and its
+** children, wherever they were allocated, and the arena is freed
+** with the last of its nodes. A subtree taken out of a result (its
+** slot in the parent cleared or removed) outlives the root and is
+** deleted separately. A tree belongs to one thread at a time.
+** A packrat memo shares nodes between the results it hands out,
+** so the `mpc_ast_*` functions that change a node copy it first
+** if it has other owners.
+**
+** The arena also holds the nodes the parse built and then dropped
+** while backtracking, so a result can take more memory than its
+** nodes until it is deleted. Tags are interned, `tag_id` identifies
+** the tag.
+*/
+
+typedef struct mpc_ast_t {
+  char *tag;
+  int tag_id;
+  char *contents;
+  mpc_state_t state;
+  int children_num;
+  struct mpc_ast_t** children;
+} mpc_ast_t;
+
+mpc_ast_t *mpc_ast_new(const char *tag, const char *contents);
+mpc_ast_t *mpc_ast_copy(mpc_ast_t *a);
+mpc_ast_t *mpc_ast_build(int n, const char *tag, ...);
+mpc_ast_t *mpc_ast_add_root(mpc_ast_t *a);
+mpc_ast_t *mpc_ast_add_child(mpc_ast_t *r, mpc_ast_t *a);
+mpc_ast_t *mpc_ast_add_tag(mpc_ast_t *a, const char *t);
+mpc_ast_t *mpc_ast_add_root_tag(mpc_ast_t *a, const char *t);
+mpc_ast_t *mpc_ast_tag(mpc_ast_t *a, const char *t);
+mpc_ast_t *mpc_ast_state(mpc_ast_t *a, mpc_state_t s);
+
+void mpc_ast_delete(mpc_ast_t *a);
+void mpc_ast_print(mpc_ast_t *a);
+void mpc_ast_print_to(mpc_ast_t *a, FILE *fp);
+
+int mpc_ast_get_index(mpc_ast_t *ast, const char *tag);
+int mpc_ast_get_index_lb(mpc_ast_t *ast, const char *tag, int lb);
+mpc_ast_t *mpc_ast_get_child(mpc_ast_t *ast, const char *tag);
+mpc_ast_t *mpc_ast_get_child_lb(mpc_ast_t *ast, const char *tag, int lb);
+
+int mpc_tag_intern(const char *tag);
+const char *mpc_tag_name(int tag);
+int mpc_ast_is(mpc_ast_t *a, int tag);
+
+typedef enum {
+  mpc_ast_trav_order_pre,
+  mpc_ast_trav_order_post
+} mpc_ast_trav_order_t;
+
+typedef struct mpc_ast_trav_t {
+  mpc_ast_t             *curr_node;
+  struct mpc_ast_trav_t *parent;
+  int                    curr_child;
+  mpc_ast_trav_order_t   order;
+} mpc_ast_trav_t;
+
+mpc_ast_trav_t *mpc_ast_traverse_start(mpc_ast_t *ast,
+                                       mpc_ast_trav_order_t order);
+
+mpc_ast_t *mpc_ast_traverse_next(mpc_ast_trav_t **trav);
+
+void mpc_ast_traverse_free(mpc_ast_trav_t **trav);
+
+/*
+** Warning: This function currently doesn't test for equality of the `state` member!
+*/
+int mpc_ast_eq(mpc_ast_t *a, mpc_ast_t *b);
+
+mpc_val_t *mpcf_fold_ast(int n, mpc_val_t **as);
+mpc_val_t *mpcf_str_ast(mpc_val_t *c);
+mpc_val_t *mpcf_state_ast(int n, mpc_val_t **xs);
+
+mpc_parser_t *mpca_tag(mpc_parser_t *a, const char *t);
+mpc_parser_t *mpca_add_tag(mpc_parser_t *a, const char *t);
+mpc_parser_t *mpca_root(mpc_parser_t *a);
+mpc_parser_t *mpca_state(mpc_parser_t *a);
+mpc_parser_t *mpca_total(mpc_parser_t *a);
+
+mpc_parser_t *mpca_not(mpc_parser_t *a);
+mpc_parser_t *mpca_maybe(mpc_parser_t *a);
+
+mpc_parser_t *mpca_many(mpc_parser_t *a);
+mpc_parser_t *mpca_many1(mpc_parser_t *a);
+mpc_parser_t *mpca_count(int n, mpc_parser_t *a);
+
+mpc_parser_t *mpca_or(int n, ...);
+mpc_parser_t *mpca_and(int n, ...);
+
+enum {
+  MPCA_LANG_DEFAULT              = 0,
+  MPCA_LANG_PREDICTIVE           = 1,
+  MPCA_LANG_WHITESPACE_SENSITIVE = 2,
+  MPCA_LANG_PACKRAT              = 4,
+  MPCA_LANG_NO_OPTIMISE          = 8
+};
+
+mpc_parser_t *mpca_grammar(int flags, const char *grammar, ...);
+
+mpc_err_t *mpca_lang(int flags, const char *language, ...);
+mpc_err_t *mpca_lang_file(int flags, FILE *f, ...);
+mpc_err_t *mpca_lang_pipe(int flags, FILE *f, ...);
+mpc_err_t *mpca_lang_contents(int flags, const char *filename, ...);
+
+/*
+** Misc
+**
+** Parsing only reads a parser, so once built a parser can be used
+** by several threads at once. Building, optimising or undefining it
+** must happen on one thread. `mpc_stats` reports the inputs parsed
+** and deleted on the calling thread, memo hits included. The
+** MPC_PROFILE counters are the exception, see below.
+*/
+
+void mpc_print(mpc_parser_t *p);
+void mpc_optimise(mpc_parser_t *p);
+int mpc_nodecount(mpc_parser_t *p);
+void mpc_stats(mpc_parser_t *p);
+
+/*
+** Profiling
+**
+** When mpc.c is built with MPC_PROFILE every
+** named parser counts its calls, passes and
+** fails, the chars it consumed, the rewinds
+** made while it was the innermost named
+** parser running, and the time spent in it
+** including the rules it calls. A rule that
+** recurses is timed from its outermost call.
+** `mpc_stats` lists these for every named
+** parser reachable from `p`, slowest first.
+** Without MPC_PROFILE nothing is counted and
+** these functions do nothing. The counters
+** are not atomic, profile on one thread.
+*/
+
+void mpc_profile_json(mpc_parser_t *p, FILE *f);
+void mpc_profile_reset(mpc_parser_t *p);
+
+int mpc_test_pass(mpc_parser_t *p, const char *s, const void *d,
+  int(*tester)(const void*, const void*), 
+  mpc_dtor_t destructor, 
+  void(*printer)(const void*));
+
+int mpc_test_fail(mpc_parser_t *p, const char *s, const void *d,
+  int(*tester)(const void*, const void*),
+  mpc_dtor_t destructor,
+  void(*printer)(const void*));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
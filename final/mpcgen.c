@@ -0,0 +1,1261 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpc.h"
+
+/*
+ * Compiles an mpca_lang grammar ahead of time into C:
+ *
+ *   mpcgen [-w] [-p prefix] [-d depth] grammar out.c out.h
+ *
+ * Every rule becomes a parser `<prefix>_<rule>` to hand to mpc_native. It
+ * builds the same AST mpca_lang would, with the same states and tags, and
+ * fails with the same errors. Literals are compared in place, regexes become
+ * straight line character tests and bitmaps, and sequences fold their
+ * children as they go instead of through the combinator stack.
+ *
+ * -w is MPCA_LANG_WHITESPACE_SENSITIVE. Rules recurse in C, so nesting more
+ * than -d rules deep fails the parse instead of running out of stack.
+ *
+ * Ordered choices skip the alternatives that cannot start with the next char.
+ * Only if the parse then fails is it run again trying everything, to find
+ * what was expected, as mpc does with its predictions.
+ *
+ * Differences from mpca_lang: a parser that matches adds nothing to the error
+ * and neither does a regex that matches, as with the regex DFA. Repetitions of
+ * something matching nothing stop instead of looping, and "one or more of"
+ * wrapped around itself too many times is left off.
+ */
+
+enum {
+    /* Grammar */
+    G_STRING, G_CHAR, G_REGEX, G_RULE, G_AND, G_OR, G_MANY, G_MANY1, G_MAYBE, G_NOT, G_COUNT,
+    /* Regex */
+    R_CHAR, R_SET, R_SOI, R_EOI, R_BOUNDARY, R_NOT, R_EMPTY, R_AND, R_OR, R_MANY, R_MANY1, R_MAYBE, R_COUNT
+};
+
+/* Transformed expected strings longer than this are left off, so the table stays finite */
+enum { GEN_EXPECTED_LEN = 256, GEN_DEPTH_DEFAULT = 10000 };
+
+typedef struct node {
+    int type;
+    int id;
+    char *text;             /* literal matched, or name of the rule referenced */
+    size_t len;
+    int n;                  /* times for {n}, rule referenced, or set number */
+    int expected;           /* expected string on failure, or -1 */
+    int num;
+    struct node **xs;
+    int *leaves;            /* expected strings a failure can pass up */
+    int leaves_num;
+    int *map;               /* pairs rewriting a child's expected string, for + and {n} */
+    int map_num;
+    int inlined;            /* tested in place by its parent, so not output */
+    unsigned char first[32];/* chars a match can start with */
+    int nullable;           /* whether it can match without consuming anything */
+} node;
+
+typedef struct {
+    char *ident;
+    char *name;             /* display name, failures inside are reported as it */
+    node *body;
+    int *leaves;
+    int leaves_num;
+} rule;
+
+static struct {
+    const char *file;
+    const char *src;
+    size_t pos;
+    int sensitive;
+    int rules_num;
+    rule *rules;
+    int nodes_num;
+    node **nodes;
+    int expected_num;
+    char **expected;
+    int sets_num;
+    unsigned char (*sets)[32];
+} gen;
+
+static void gen_die(const char *fmt, ...) {
+    long row = 1, col = 1;
+    for (size_t j = 0; j < gen.pos && gen.src[j]; j++) {
+        if (gen.src[j] == '\n') { row++; col = 1; } else { col++; }
+    }
+    fprintf(stderr, "%s:%ld:%ld: ", gen.file, row, col);
+    va_list va;
+    va_start(va, fmt);
+    vfprintf(stderr, fmt, va);
+    va_end(va);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+static int gen_expected(const char *s) {
+    for (int j = 0; j < gen.expected_num; j++) {
+        if (strcmp(gen.expected[j], s) == 0) { return j; }
+    }
+    gen.expected = realloc(gen.expected, sizeof(char *) * (gen.expected_num + 1));
+    gen.expected[gen.expected_num] = strdup(s);
+    return gen.expected_num++;
+}
+
+static int gen_set(const unsigned char *set) {
+    for (int j = 0; j < gen.sets_num; j++) {
+        if (memcmp(gen.sets[j], set, 32) == 0) { return j; }
+    }
+    gen.sets = realloc(gen.sets, sizeof(gen.sets[0]) * (gen.sets_num + 1));
+    memcpy(gen.sets[gen.sets_num], set, 32);
+    return gen.sets_num++;
+}
+
+static node *gen_node(int type, int expected) {
+    node *n = calloc(1, sizeof(node));
+    n->type = type;
+    n->id = gen.nodes_num;
+    n->expected = expected;
+    gen.nodes = realloc(gen.nodes, sizeof(node *) * (gen.nodes_num + 1));
+    gen.nodes[gen.nodes_num++] = n;
+    return n;
+}
+
+static node *gen_add(node *n, node *x) {
+    n->xs = realloc(n->xs, sizeof(node *) * (n->num + 1));
+    n->xs[n->num++] = x;
+    return n;
+}
+
+/* A node folded into its parent, which is not output */
+static node *gen_dead(node *n) {
+    n->type = -1;
+    n->num = 0;
+    return n;
+}
+
+static node *gen_unary(int type, int expected, node *x) {
+    return gen_add(gen_node(type, expected), x);
+}
+
+/* Regexes, parsed as mpc_re does */
+
+/* What mpc_char reports when it fails */
+static int char_expected(char c) {
+    char m[4] = {'\'', c, '\'', '\0'};
+    return gen_expected(m);
+}
+
+static node *re_char(char c) {
+    node *n = gen_node(R_CHAR, char_expected(c));
+    n->n = (unsigned char)c;
+    return n;
+}
+
+static node *re_set(const char *chars, int negate, const char *expected) {
+    unsigned char set[32] = {0};
+    for (const char *s = chars; *s; s++) { set[(unsigned char)*s / 8] |= 1 << ((unsigned char)*s % 8); }
+    if (negate) { for (int j = 0; j < 32; j++) { set[j] = ~set[j]; } }
+    node *n = gen_node(R_SET, gen_expected(expected));
+    n->n = gen_set(set);
+    return n;
+}
+
+static node *re_escape(char c) {
+    switch (c) {
+        case 'a': return re_char('\a');
+        case 'f': return re_char('\f');
+        case 'n': return re_char('\n');
+        case 'r': return re_char('\r');
+        case 't': return re_char('\t');
+        case 'v': return re_char('\v');
+        case 'b': return gen_node(R_BOUNDARY, gen_expected("boundary"));
+        case 'B': return gen_unary(R_NOT, gen_expected("opposite"), gen_node(R_BOUNDARY, gen_expected("boundary")));
+        case 'A': return gen_node(R_SOI, gen_expected("start of input"));
+        case 'Z': return gen_node(R_EOI, gen_expected("end of input"));
+        case 'd': return re_set("0123456789", 0, "digit");
+        case 'D': return gen_unary(R_NOT, gen_expected("opposite"), re_set("0123456789", 0, "digit"));
+        case 's': return re_set(" \f\n\r\t\v", 0, "whitespace");
+        case 'S': return gen_unary(R_NOT, gen_expected("opposite"), re_set(" \f\n\r\t\v", 0, "whitespace"));
+        case 'w': return re_set("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_", 0, "alphanumeric");
+        case 'W': return gen_unary(R_NOT, gen_expected("opposite"),
+                                   re_set("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_", 0, "alphanumeric"));
+        default: return re_char(c);
+    }
+}
+
+static const char *re_range_escape(char c) {
+    switch (c) {
+        case '-': return "-";
+        case 'a': return "\a";
+        case 'f': return "\f";
+        case 'n': return "\n";
+        case 'r': return "\r";
+        case 't': return "\t";
+        case 'v': return "\v";
+        case 'b': return "\b";
+        case 'd': return "0123456789";
+        case 's': return " \f\n\r\t\v";
+        case 'w': return "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+        default: return NULL;
+    }
+}
+
+/* The chars of a [range], expanded exactly as mpcf_re_range does, as they show up in errors */
+static node *re_range(const char *s, size_t len) {
+    char *range = malloc(len * 256 + 64);
+    size_t n = 0;
+    int comp = s[0] == '^';
+
+    if (len == (size_t)comp) { gen_die("invalid regex range expression"); }
+
+    for (size_t i = comp; i < len; i++) {
+        if (s[i] == '\\') {
+            const char *tmp = re_range_escape(s[i + 1]);
+            if (tmp) {
+                memcpy(range + n, tmp, strlen(tmp));
+                n += strlen(tmp);
+            } else {
+                range[n++] = s[i + 1];
+            }
+            i++;
+        } else if (s[i] == '-') {
+            if (i + 1 == len || i == 0) {
+                range[n++] = '-';
+            } else {
+                for (int j = (unsigned char)s[i - 1] + 1; j <= (unsigned char)s[i + 1] - 1; j++) { range[n++] = (char)j; }
+            }
+        } else {
+            range[n++] = s[i];
+        }
+    }
+    range[n] = '\0';
+
+    char *m = malloc(n + 16);
+    sprintf(m, comp ? "none of '%s'" : "one of '%s'", range);
+    node *x = re_set(range, comp, m);
+    free(m);
+    free(range);
+    return x;
+}
+
+static node *re_alt(const char **p);
+
+static node *re_base(const char **p) {
+    const char *s = *p;
+    node *x;
+    switch (*s) {
+        case '(':
+            *p = s + 1;
+            x = re_alt(p);
+            if (**p != ')') { gen_die("regex is missing a ')'"); }
+            (*p)++;
+            return x;
+        case '[':
+            for (s++; *s && *s != ']'; s++) {
+                if (*s == '\\' && s[1]) { s++; }
+            }
+            if (*s != ']') { gen_die("regex is missing a ']'"); }
+            x = re_range(*p + 1, s - (*p + 1));
+            *p = s + 1;
+            return x;
+        case '\\':
+            if (s[1] == '\0') { gen_die("regex ends in a '\\'"); }
+            *p = s + 2;
+            return re_escape(s[1]);
+        case '.':
+            *p = s + 1;
+            return re_set("", 1, "any character");
+        case '^':
+            *p = s + 1;
+            return gen_node(R_SOI, gen_expected("start of input"));
+        case '$':
+            *p = s + 1;
+            return gen_node(R_EOI, gen_expected("end of input"));
+        default:
+            *p = s + 1;
+            return re_char(*s);
+    }
+}
+
+static node *re_factor(const char **p) {
+    node *x = re_base(p);
+    switch (**p) {
+        case '*': (*p)++; return gen_unary(R_MANY, -1, x);
+        case '+': (*p)++; return gen_unary(R_MANY1, -1, x);
+        case '?': (*p)++; return gen_unary(R_MAYBE, -1, x);
+        case '{': {
+            char *end;
+            long n = strtol(*p + 1, &end, 10);
+            if (end == *p + 1 || *end != '}') { gen_die("regex has a bad {count}"); }
+            *p = end + 1;
+            node *c = gen_unary(R_COUNT, -1, x);
+            c->n = (int)n;
+            return c;
+        }
+        default: return x;
+    }
+}
+
+static node *re_alt(const char **p) {
+    node *t = gen_node(R_AND, -1);
+    while (**p && **p != '|' && **p != ')') { gen_add(t, re_factor(p)); }
+    if (t->num == 0) { t->type = R_EMPTY; }
+    if (t->num == 1) { node *x = t->xs[0]; gen_dead(t); t = x; }
+    if (**p != '|') { return t; }
+    (*p)++;
+    node *rest = re_alt(p);
+    node *o = gen_add(gen_node(R_OR, -1), t);
+    if (rest->type == R_OR) {
+        for (int j = 0; j < rest->num; j++) { gen_add(o, rest->xs[j]); }
+        gen_dead(rest);
+    } else {
+        gen_add(o, rest);
+    }
+    return o;
+}
+
+static node *re_compile(const char *re) {
+    const char *p = re;
+    node *x = re_alt(&p);
+    if (*p) { gen_die("regex has an unmatched ')'"); }
+    return x;
+}
+
+/* Grammars, parsed as mpca_lang does */
+
+static void gram_blank(void) {
+    while (gen.src[gen.pos] && strchr(" \f\n\r\t\v", gen.src[gen.pos])) { gen.pos++; }
+}
+
+static int gram_sym(char c) {
+    if (gen.src[gen.pos] != c) { return 0; }
+    gen.pos++;
+    gram_blank();
+    return 1;
+}
+
+static int gram_ident_char(char c, int first) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (!first && c >= '0' && c <= '9');
+}
+
+static char *gram_ident(void) {
+    size_t start = gen.pos;
+    if (!gram_ident_char(gen.src[gen.pos], 1)) { return NULL; }
+    while (gram_ident_char(gen.src[gen.pos], 0)) { gen.pos++; }
+    return strndup(gen.src + start, gen.pos - start);
+}
+
+/* Text up to the closing char with escapes left in, as mpc_string_lit and the others give it */
+static char *gram_lit(char close) {
+    size_t start = ++gen.pos;
+    while (gen.src[gen.pos] != close) {
+        if (gen.src[gen.pos] == '\0') { gen_die("missing closing %c", close); }
+        if (gen.src[gen.pos] == '\\' && gen.src[gen.pos + 1]) { gen.pos++; }
+        gen.pos++;
+    }
+    char *s = strndup(gen.src + start, gen.pos - start);
+    gen.pos++;
+    gram_blank();
+    return s;
+}
+
+static int gram_rule(const char *ident) {
+    for (int j = 0; j < gen.rules_num; j++) {
+        if (strcmp(gen.rules[j].ident, ident) == 0) { return j; }
+    }
+    return -1;
+}
+
+static node *gram_alt(void);
+
+static node *gram_base(void) {
+    node *x;
+    char *s;
+    switch (gen.src[gen.pos]) {
+        case '"':
+            s = mpcf_unescape(gram_lit('"'));
+            x = gen_node(G_STRING, -1);
+            x->text = s;
+            x->len = strlen(s);
+            x->expected = gen_expected(strcat(strcat(strcpy(malloc(x->len + 3), "\""), s), "\""));
+            return x;
+        case '\'':
+            s = mpcf_unescape(gram_lit('\''));
+            x = gen_node(G_CHAR, -1);
+            x->text = s;
+            x->len = 1;
+            x->expected = char_expected(s[0]);
+            return x;
+        case '/':
+            s = mpcf_unescape_regex(gram_lit('/'));
+            x = gen_unary(G_REGEX, -1, re_compile(s));
+            free(s);
+            return x;
+        case '<':
+            gen.pos++;
+            s = gram_ident();
+            if (s == NULL) { gen_die("expected a rule name, positional <n> parsers are not supported"); }
+            if (gen.src[gen.pos] != '>') { gen_die("expected '>'"); }
+            gen.pos++;
+            gram_blank();
+            x = gen_node(G_RULE, -1);
+            x->text = s;
+            return x;
+        case '(':
+            gram_sym('(');
+            x = gram_alt();
+            if (!gram_sym(')')) { gen_die("expected ')'"); }
+            return x;
+        default:
+            return NULL;
+    }
+}
+
+static node *gram_factor(void) {
+    node *x = gram_base();
+    if (x == NULL) { return NULL; }
+    if (gram_sym('*')) { return gen_unary(G_MANY, -1, x); }
+    if (gram_sym('+')) { return gen_unary(G_MANY1, -1, x); }
+    if (gram_sym('?')) { return gen_unary(G_MAYBE, -1, x); }
+    if (gram_sym('!')) { return gen_unary(G_NOT, gen_expected("opposite"), x); }
+    if (gen.src[gen.pos] == '{') {
+        char *end;
+        long n = strtol(gen.src + gen.pos + 1, &end, 10);
+        if (end == gen.src + gen.pos + 1 || *end != '}') { gen_die("expected an integer in {}"); }
+        gen.pos = end + 1 - gen.src;
+        gram_blank();
+        node *c = gen_unary(G_COUNT, -1, x);
+        c->n = (int)n;
+        return c;
+    }
+    return x;
+}
+
+static node *gram_alt(void) {
+    node *t = gen_node(G_AND, -1), *x;
+    while ((x = gram_factor())) { gen_add(t, x); }
+    if (t->num == 0) { gen_die("expected a literal, regex, <rule> or '('"); }
+    if (t->num == 1) { node *x = t->xs[0]; gen_dead(t); t = x; }
+    if (!gram_sym('|')) { return t; }
+    node *rest = gram_alt();
+    node *o = gen_add(gen_node(G_OR, -1), t);
+    if (rest->type == G_OR) {
+        for (int j = 0; j < rest->num; j++) { gen_add(o, rest->xs[j]); }
+        gen_dead(rest);
+    } else {
+        gen_add(o, rest);
+    }
+    return o;
+}
+
+static void gram_parse(void) {
+    gram_blank();
+    while (gen.src[gen.pos]) {
+        rule r = {0};
+        r.ident = gram_ident();
+        if (r.ident == NULL) { gen_die("expected a rule name"); }
+        if (gram_rule(r.ident) >= 0) { gen_die("rule '%s' is defined twice", r.ident); }
+        gram_blank();
+        if (gen.src[gen.pos] == '"') { r.name = gram_lit('"'); }
+        if (!gram_sym(':')) { gen_die("expected ':'"); }
+        r.body = gram_alt();
+        if (!gram_sym(';')) { gen_die("expected ';'"); }
+        gen.rules = realloc(gen.rules, sizeof(rule) * (gen.rules_num + 1));
+        gen.rules[gen.rules_num++] = r;
+    }
+    if (gen.rules_num == 0) { gen_die("no rules"); }
+    for (int j = 0; j < gen.nodes_num; j++) {
+        node *x = gen.nodes[j];
+        if (x->type != G_RULE) { continue; }
+        x->n = gram_rule(x->text);
+        if (x->n < 0) { gen_die("unknown rule '%s'", x->text); }
+    }
+}
+
+/*
+ * Which expected strings a failure of each node can pass up to its parent.
+ * "one or more of" and "n of" rewrite the ones of their child, and the
+ * generated code needs the rewritten strings in its table up front.
+ */
+
+static int leaves_add(int **xs, int *num, int e) {
+    for (int j = 0; j < *num; j++) { if ((*xs)[j] == e) { return 0; } }
+    *xs = realloc(*xs, sizeof(int) * (*num + 1));
+    (*xs)[(*num)++] = e;
+    return 1;
+}
+
+static int leaves_rewrite(node *n, const int *from, int from_num, const char *prefix) {
+    int changed = 0;
+    for (int j = 0; j < from_num; j++) {
+        const char *e = gen.expected[from[j]];
+        int known = 0;
+        for (int k = 0; k < n->map_num; k++) { if (n->map[k * 2] == from[j]) { known = 1; } }
+        if (known || strlen(prefix) + strlen(e) >= GEN_EXPECTED_LEN) { continue; }
+        char *m = malloc(strlen(prefix) + strlen(e) + 1);
+        int to = gen_expected(strcat(strcpy(m, prefix), e));
+        free(m);
+        n->map = realloc(n->map, sizeof(int) * 2 * (n->map_num + 1));
+        n->map[n->map_num * 2] = from[j];
+        n->map[n->map_num * 2 + 1] = to;
+        n->map_num++;
+        changed |= leaves_add(&n->leaves, &n->leaves_num, to);
+    }
+    return changed;
+}
+
+static int leaves_update(node *n) {
+    int changed = 0;
+    char prefix[32];
+    for (int j = 0; j < n->num; j++) { changed |= leaves_update(n->xs[j]); }
+    switch (n->type) {
+        case G_RULE: {
+            rule *r = &gen.rules[n->n];
+            for (int j = 0; j < r->leaves_num; j++) { changed |= leaves_add(&n->leaves, &n->leaves_num, r->leaves[j]); }
+            break;
+        }
+        case G_REGEX: case G_AND: case R_AND:
+            for (int j = 0; j < n->num; j++) {
+                for (int k = 0; k < n->xs[j]->leaves_num; k++) {
+                    changed |= leaves_add(&n->leaves, &n->leaves_num, n->xs[j]->leaves[k]);
+                }
+            }
+            break;
+        case G_MANY1: case R_MANY1:
+            changed |= leaves_rewrite(n, n->xs[0]->leaves, n->xs[0]->leaves_num, "one or more of ");
+            break;
+        case G_COUNT: case R_COUNT:
+            sprintf(prefix, "%i of ", n->n);
+            changed |= leaves_rewrite(n, n->xs[0]->leaves, n->xs[0]->leaves_num, prefix);
+            break;
+        case G_OR: case G_MANY: case G_MAYBE: case R_OR: case R_MANY: case R_MAYBE: case R_EMPTY:
+            break;
+        default:
+            changed |= leaves_add(&n->leaves, &n->leaves_num, n->expected);
+            break;
+    }
+    return changed;
+}
+
+static void leaves_solve(void) {
+    for (int j = 0; j < gen.rules_num; j++) {
+        rule *r = &gen.rules[j];
+        if (r->name) { leaves_add(&r->leaves, &r->leaves_num, gen_expected(r->name)); }
+    }
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int j = 0; j < gen.rules_num; j++) {
+            rule *r = &gen.rules[j];
+            changed |= leaves_update(r->body);
+            if (r->name) { continue; }
+            for (int k = 0; k < r->body->leaves_num; k++) { changed |= leaves_add(&r->leaves, &r->leaves_num, r->body->leaves[k]); }
+        }
+    }
+}
+
+/*
+ * The chars each node can start with, so an ordered choice can skip the
+ * alternatives that cannot match the next char.
+ */
+
+static int first_merge(node *n, const unsigned char *first, int nullable) {
+    int changed = 0;
+    for (int j = 0; j < 32; j++) {
+        if ((n->first[j] | first[j]) != n->first[j]) { n->first[j] |= first[j]; changed = 1; }
+    }
+    if (nullable && !n->nullable) { n->nullable = 1; changed = 1; }
+    return changed;
+}
+
+static int first_char(node *n, char c) {
+    unsigned char first[32] = {0};
+    first[(unsigned char)c / 8] |= 1 << ((unsigned char)c % 8);
+    return first_merge(n, first, 0);
+}
+
+static int first_update(node *n) {
+    int changed = 0;
+    for (int j = 0; j < n->num; j++) { changed |= first_update(n->xs[j]); }
+    switch (n->type) {
+        case G_STRING:
+            return n->len ? first_char(n, n->text[0]) : first_merge(n, n->first, 1);
+        case G_CHAR:
+        case R_CHAR:
+            return first_char(n, n->type == G_CHAR ? n->text[0] : (char)n->n);
+        case R_SET:
+            return first_merge(n, gen.sets[n->n], 0);
+        case G_RULE:
+            return changed | first_merge(n, gen.rules[n->n].body->first, gen.rules[n->n].body->nullable);
+        case G_AND: case R_AND: {
+            int nullable = 1;
+            for (int j = 0; j < n->num && nullable; j++) {
+                changed |= first_merge(n, n->xs[j]->first, 0);
+                nullable = n->xs[j]->nullable;
+            }
+            return changed | first_merge(n, n->first, nullable);
+        }
+        case G_OR: case R_OR:
+            for (int j = 0; j < n->num; j++) { changed |= first_merge(n, n->xs[j]->first, n->xs[j]->nullable); }
+            return changed;
+        case G_REGEX: case G_MANY1: case R_MANY1:
+            return changed | first_merge(n, n->xs[0]->first, n->xs[0]->nullable);
+        case G_COUNT: case R_COUNT:
+            return changed | first_merge(n, n->xs[0]->first, n->xs[0]->nullable || n->n == 0);
+        case G_MANY: case G_MAYBE: case R_MANY: case R_MAYBE:
+            return changed | first_merge(n, n->xs[0]->first, 1);
+        default:
+            /* Anchors and lookaheads match nothing */
+            return changed | first_merge(n, n->first, 1);
+    }
+}
+
+static void first_solve(void) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int j = 0; j < gen.rules_num; j++) { changed |= first_update(gen.rules[j].body); }
+    }
+}
+
+/* Output */
+
+static void out_cstr(FILE *f, const char *s, size_t len) {
+    fputc('"', f);
+    for (size_t j = 0; j < len; j++) {
+        unsigned char c = s[j];
+        if (c == '"' || c == '\\' || (c == '?' && j + 1 < len && s[j + 1] == '?')) { fprintf(f, "\\%c", c); }
+        else if (c == '\n') { fprintf(f, "\\n"); }
+        else if (c == '\t') { fprintf(f, "\\t"); }
+        else if (c == '\r') { fprintf(f, "\\r"); }
+        else if (c >= 32 && c < 127) { fputc(c, f); }
+        else { fprintf(f, "\\%03o", c); }
+    }
+    fputc('"', f);
+}
+
+static void out_char(FILE *f, char c) {
+    fputc('\'', f);
+    if (c == '\'' || c == '\\') { fprintf(f, "\\%c", c); }
+    else if (c >= 32 && c < 127) { fputc(c, f); }
+    else { fprintf(f, "\\%03o", (unsigned char)c); }
+    fputc('\'', f);
+}
+
+static const char *gen_prelude =
+    "typedef struct {\n"
+    "  const char *s;\n"
+    "  long len;\n"
+    "  long pos;\n"
+    "  long start;\n"
+    "  mpc_native_input_t *in;\n"
+    "  int suppress;\n"
+    "  int depth;\n"
+    "  int rec;\n"
+    "  int leaf;\n"
+    "  long leaf_pos;\n"
+    "  int vals_num;\n"
+    "  int vals_slots;\n"
+    "  mpc_val_t **vals;\n"
+    "  int lines_num;\n"
+    "  int lines_slots;\n"
+    "  long *lines;\n"
+    "  long scanned;\n"
+    "  jmp_buf abort;\n"
+    "} gen_ctx;\n"
+    "\n"
+    "#if defined(GEN_SETS) || defined(GEN_BLANK)\n"
+    "static int gen_in(const unsigned char *set, char c) {\n"
+    "  return (set[(unsigned char)c >> 3] >> ((unsigned char)c & 7)) & 1;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "/* A failure passes what was expected up to the parent, which reports it or rewrites it */\n"
+    "static int gen_fail(gen_ctx *c, long pos, int e) {\n"
+    "  c->leaf = c->suppress ? -1 : e;\n"
+    "  c->leaf_pos = pos;\n"
+    "  return 0;\n"
+    "}\n"
+    "\n"
+    "/* Only the farthest failures are kept, as mpc does, and only once the parse has failed */\n"
+    "static void gen_merge(gen_ctx *c) {\n"
+    "  mpc_native_input_t *in = c->in;\n"
+    "  const char *e;\n"
+    "  int j;\n"
+    "  if (c->leaf < 0 || !c->rec) { return; }\n"
+    "  e = gen_expected[c->leaf];\n"
+    "  c->leaf = -1;\n"
+    "  if (c->leaf_pos < in->fail) { return; }\n"
+    "  if (c->leaf_pos > in->fail) { in->fail = c->leaf_pos; in->expected_num = 0; }\n"
+    "  for (j = 0; j < in->expected_num; j++) { if (in->expected[j] == e) { return; } }\n"
+    "  if (in->expected_num < MPC_NATIVE_EXPECTED_MAX) { in->expected[in->expected_num++] = e; }\n"
+    "}\n"
+    "\n"
+    "static void gen_enter(gen_ctx *c) {\n"
+    "  if (++c->depth <= GEN_DEPTH_MAX) { return; }\n"
+    "  c->in->fail = c->pos;\n"
+    "  c->in->failure = \"Input nested too deeply\";\n"
+    "  c->in->expected_num = 0;\n"
+    "  longjmp(c->abort, 1);\n"
+    "}\n"
+    "\n"
+    "#if defined(GEN_REPEATS)\n"
+    "static void gen_push(gen_ctx *c, mpc_val_t *x) {\n"
+    "  if (c->vals_num == c->vals_slots) {\n"
+    "    c->vals_slots = c->vals_slots ? c->vals_slots * 2 : 64;\n"
+    "    c->vals = realloc(c->vals, sizeof(mpc_val_t*) * c->vals_slots);\n"
+    "  }\n"
+    "  c->vals[c->vals_num++] = x;\n"
+    "}\n"
+    "\n"
+    "static mpc_val_t *gen_fold(gen_ctx *c, int base) {\n"
+    "  mpc_val_t *x = mpcf_fold_ast(c->vals_num - base, c->vals + base);\n"
+    "  c->vals_num = base;\n"
+    "  return x;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "static void gen_drop(gen_ctx *c, int base) {\n"
+    "  while (c->vals_num > base) { mpc_ast_delete(c->vals[--c->vals_num]); }\n"
+    "}\n"
+    "\n"
+    "/* Rows are found from the newlines seen so far, which are only looked for once */\n"
+    "static mpc_state_t gen_state(gen_ctx *c, long pos) {\n"
+    "  mpc_state_t s;\n"
+    "  const char *nl;\n"
+    "  long lo = 0, hi, mid;\n"
+    "  while (c->scanned < pos && (nl = memchr(c->s + c->scanned, '\\n', pos - c->scanned))) {\n"
+    "    if (c->lines_num == c->lines_slots) {\n"
+    "      c->lines_slots = c->lines_slots ? c->lines_slots * 2 : 64;\n"
+    "      c->lines = realloc(c->lines, sizeof(long) * c->lines_slots);\n"
+    "    }\n"
+    "    c->lines[c->lines_num++] = nl - c->s;\n"
+    "    c->scanned = nl - c->s + 1;\n"
+    "  }\n"
+    "  if (c->scanned < pos) { c->scanned = pos; }\n"
+    "  hi = c->lines_num;\n"
+    "  if (hi == 0 || c->lines[hi - 1] < pos) {\n"
+    "    lo = hi;\n"
+    "  } else {\n"
+    "    while (lo < hi) {\n"
+    "      mid = (lo + hi) / 2;\n"
+    "      if (c->lines[mid] < pos) { lo = mid + 1; } else { hi = mid; }\n"
+    "    }\n"
+    "  }\n"
+    "  s.pos = c->in->state.pos + (pos - c->start);\n"
+    "  s.row = c->in->state.row + lo;\n"
+    "  s.col = lo ? pos - c->lines[lo - 1] - 1 : c->in->state.col + (pos - c->start);\n"
+    "  return s;\n"
+    "}\n"
+    "\n"
+    "#if defined(GEN_REGEX)\n"
+    "static mpc_val_t *gen_token(gen_ctx *c, const char *tag, long start) {\n"
+    "  char stk[256];\n"
+    "  long n = c->pos - start;\n"
+    "  char *t = n + 1 > (long)sizeof(stk) ? malloc(n + 1) : stk;\n"
+    "  mpc_ast_t *a;\n"
+    "  memcpy(t, c->s + start, n);\n"
+    "  t[n] = '\\0';\n"
+    "  a = mpc_ast_state(mpc_ast_new(tag, t), gen_state(c, start));\n"
+    "  if (t != stk) { free(t); }\n"
+    "  return a;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "#if defined(GEN_BLANK)\n"
+    "static void gen_blank(gen_ctx *c) {\n"
+    "  while (c->pos < c->len && gen_in(gen_space, c->s[c->pos])) { c->pos++; }\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "#if defined(GEN_ANCHORS)\n"
+    "static char gen_prev(gen_ctx *c) { return c->pos > c->start ? c->s[c->pos - 1] : c->in->last; }\n"
+    "static char gen_next(gen_ctx *c) { return c->pos < c->len ? c->s[c->pos] : '\\0'; }\n"
+    "#endif\n"
+    "\n"
+    "#if defined(GEN_BOUNDARY)\n"
+    "static int gen_word(char c) {\n"
+    "  return c == '\\0' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';\n"
+    "}\n"
+    "\n"
+    "/* Same as mpc_boundary_anchor, where the end of the string counts as part of a word */\n"
+    "static int gen_boundary(char prev, char next) {\n"
+    "  if ( gen_word(next) &&  prev == '\\0') { return 1; }\n"
+    "  if ( gen_word(prev) &&  next == '\\0') { return 1; }\n"
+    "  if ( gen_word(next) && !gen_word(prev)) { return 1; }\n"
+    "  if (!gen_word(next) &&  gen_word(prev)) { return 1; }\n"
+    "  return 0;\n"
+    "}\n"
+    "#endif\n"
+    "\n"
+    "static int gen_run(mpc_native_input_t *in, mpc_val_t **o, int(*rule)(gen_ctx*,mpc_val_t**)) {\n"
+    "  int x;\n"
+    "  mpc_val_t *v = NULL;\n"
+    "  gen_ctx *c = malloc(sizeof(gen_ctx));\n"
+    "  c->s = in->string;\n"
+    "  c->len = in->length;\n"
+    "  c->pos = c->start = c->scanned = in->pos;\n"
+    "  c->in = in;\n"
+    "  c->suppress = c->depth = 0;\n"
+    "  c->leaf = -1;\n"
+    "  c->leaf_pos = 0;\n"
+    "  c->vals_num = c->vals_slots = 0;\n"
+    "  c->vals = NULL;\n"
+    "  c->lines_num = c->lines_slots = 0;\n"
+    "  c->lines = NULL;\n"
+    "  c->rec = 0;\n"
+    "  if (setjmp(c->abort)) {\n"
+    "    gen_drop(c, 0);\n"
+    "    x = 0;\n"
+    "  } else {\n"
+    "    x = rule(c, &v);\n"
+    "    /* Failing, parse again trying everything to see what was expected */\n"
+    "    if (!x) {\n"
+    "      c->pos = c->start;\n"
+    "      c->rec = 1;\n"
+    "      x = rule(c, &v);\n"
+    "      gen_merge(c);\n"
+    "    }\n"
+    "    if (x) { in->pos = c->pos; }\n"
+    "    /* No result is wanted inside an mpc_slice */\n"
+    "    if (x && o) { *o = v; } else if (x && v) { mpc_ast_delete(v); }\n"
+    "  }\n"
+    "  free(c->vals);\n"
+    "  free(c->lines);\n"
+    "  free(c);\n"
+    "  return x;\n"
+    "}\n";
+
+/* How many chars an alternative can start with, all of them if it can match nothing */
+static int first_count(node *x, char *only) {
+    int count = 0;
+    if (x->nullable) { return 256; }
+    for (int k = 0; k < 256; k++) {
+        if ((x->first[k / 8] >> (k % 8)) & 1) { count++; *only = (char)k; }
+    }
+    return count;
+}
+
+static void out_map(FILE *f, node *n, const char *indent) {
+    if (n->map_num == 0) { return; }
+    fprintf(f, "%sswitch (c->leaf) {\n", indent);
+    for (int k = 0; k < n->map_num; k++) {
+        fprintf(f, "%s  case %d: c->leaf = %d; break;\n", indent, n->map[k * 2], n->map[k * 2 + 1]);
+    }
+    fprintf(f, "%s}\n", indent);
+}
+
+/* A test of the char at c->pos, for sets and single chars */
+static void out_test(FILE *f, node *n, const char *pos) {
+    if (n->type == R_CHAR) {
+        fprintf(f, "c->s[%s] == ", pos);
+        out_char(f, (char)n->n);
+    } else {
+        fprintf(f, "gen_in(gen_set%d, c->s[%s])", n->n, pos);
+    }
+}
+
+static void out_regex(FILE *f, node *n) {
+    fprintf(f, "static int r%d(gen_ctx *c, int rec) {\n", n->id);
+    switch (n->type) {
+        case R_CHAR:
+        case R_SET:
+            fprintf(f, "  if (c->pos < c->len && ");
+            out_test(f, n, "c->pos");
+            fprintf(f, ") { c->pos++; return 1; }\n");
+            fprintf(f, "  return rec ? gen_fail(c, c->pos, %d) : 0;\n", n->expected);
+            break;
+        case R_SOI:
+        case R_EOI:
+        case R_BOUNDARY:
+            fprintf(f, "  if (%s) { return 1; }\n",
+                    n->type == R_SOI ? "gen_prev(c) == '\\0'" :
+                    n->type == R_EOI ? "gen_next(c) == '\\0'" : "gen_boundary(gen_prev(c), gen_next(c))");
+            fprintf(f, "  return rec ? gen_fail(c, c->pos, %d) : 0;\n", n->expected);
+            break;
+        case R_NOT:
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  int x;\n");
+            fprintf(f, "  c->suppress++;\n");
+            fprintf(f, "  x = r%d(c, 0);\n", n->xs[0]->id);
+            fprintf(f, "  c->suppress--;\n");
+            fprintf(f, "  if (!x) { return 1; }\n");
+            fprintf(f, "  c->pos = s;\n");
+            fprintf(f, "  return rec ? gen_fail(c, s, %d) : 0;\n", n->expected);
+            break;
+        case R_EMPTY:
+            fprintf(f, "  (void) c;\n  (void) rec;\n  return 1;\n");
+            break;
+        case R_AND:
+            fprintf(f, "  long s = c->pos;\n");
+            for (int j = 0; j < n->num; j++) {
+                fprintf(f, "  if (!r%d(c, rec)) { c->pos = s; return 0; }\n", n->xs[j]->id);
+            }
+            fprintf(f, "  return 1;\n");
+            break;
+        case R_OR:
+            for (int j = 0; j < n->num; j++) {
+                fprintf(f, "  if (r%d(c, rec)) { return 1; }\n", n->xs[j]->id);
+                fprintf(f, "  if (rec) { gen_merge(c); }\n");
+            }
+            fprintf(f, "  return 0;\n");
+            break;
+        case R_MANY:
+        case R_MANY1: {
+            node *x = n->xs[0];
+            if (x->inlined) {
+                /* Runs of chars are the hot loop of most tokens */
+                if (n->type == R_MANY1) {
+                    fprintf(f, "  if (!(c->pos < c->len && ");
+                    out_test(f, x, "c->pos");
+                    fprintf(f, ")) {\n");
+                    fprintf(f, "    if (!rec) { return 0; }\n");
+                    fprintf(f, "    gen_fail(c, c->pos, %d);\n", x->expected);
+                    out_map(f, n, "    ");
+                    fprintf(f, "    return 0;\n");
+                    fprintf(f, "  }\n");
+                }
+                fprintf(f, "  while (c->pos < c->len && ");
+                out_test(f, x, "c->pos");
+                fprintf(f, ") { c->pos++; }\n");
+                fprintf(f, "  if (rec) { gen_fail(c, c->pos, %d); gen_merge(c); }\n", x->expected);
+                fprintf(f, "  return 1;\n");
+                break;
+            }
+            fprintf(f, "  long p;\n");
+            fprintf(f, "  int x;\n");
+            if (n->type == R_MANY1) {
+                fprintf(f, "  if (!r%d(c, rec)) {\n", x->id);
+                fprintf(f, "    if (!rec) { return 0; }\n");
+                out_map(f, n, "    ");
+                fprintf(f, "    return 0;\n");
+                fprintf(f, "  }\n");
+            }
+            fprintf(f, "  do { p = c->pos; x = r%d(c, rec); } while (x && c->pos != p);\n", x->id);
+            fprintf(f, "  if (rec && !x) { gen_merge(c); }\n");
+            fprintf(f, "  return 1;\n");
+            break;
+        }
+        case R_MAYBE:
+            fprintf(f, "  if (!r%d(c, rec) && rec) { gen_merge(c); }\n", n->xs[0]->id);
+            fprintf(f, "  return 1;\n");
+            break;
+        case R_COUNT:
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  int j;\n");
+            fprintf(f, "  for (j = 0; j < %d; j++) {\n", n->n);
+            fprintf(f, "    if (r%d(c, rec)) { continue; }\n", n->xs[0]->id);
+            fprintf(f, "    c->pos = s;\n");
+            fprintf(f, "    if (rec) {\n");
+            out_map(f, n, "      ");
+            fprintf(f, "    }\n");
+            fprintf(f, "    return 0;\n");
+            fprintf(f, "  }\n");
+            fprintf(f, "  return 1;\n");
+            break;
+    }
+    fprintf(f, "}\n\n");
+}
+
+static void out_grammar(FILE *f, node *n) {
+    fprintf(f, "static int g%d(gen_ctx *c, mpc_val_t **o) {\n", n->id);
+    switch (n->type) {
+        case G_STRING:
+        case G_CHAR:
+            fprintf(f, "  long s = c->pos;\n");
+            if (n->type == G_STRING) {
+                fprintf(f, "  if (c->len - s < %zu || memcmp(c->s + s, ", n->len);
+                out_cstr(f, n->text, n->len);
+                fprintf(f, ", %zu) != 0) { return gen_fail(c, s, %d); }\n", n->len, n->expected);
+            } else {
+                fprintf(f, "  if (c->len - s < 1 || c->s[s] != ");
+                out_char(f, n->text[0]);
+                fprintf(f, ") { return gen_fail(c, s, %d); }\n", n->expected);
+            }
+            fprintf(f, "  c->pos += %zu;\n", n->len);
+            fprintf(f, "  *o = mpc_ast_state(mpc_ast_new(\"%s\", ", n->type == G_STRING ? "string" : "char");
+            out_cstr(f, n->text, n->len);
+            fprintf(f, "), gen_state(c, s));\n");
+            if (!gen.sensitive) { fprintf(f, "  gen_blank(c);\n"); }
+            fprintf(f, "  return 1;\n");
+            break;
+        case G_REGEX:
+            /* Matching again to collect what was expected only happens when it fails, like the DFA */
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  if (!r%d(c, 0)) {\n", n->xs[0]->id);
+            fprintf(f, "    if (c->rec) { r%d(c, 1); }\n", n->xs[0]->id);
+            fprintf(f, "    c->pos = s;\n");
+            fprintf(f, "    return 0;\n");
+            fprintf(f, "  }\n");
+            fprintf(f, "  *o = gen_token(c, \"regex\", s);\n");
+            if (!gen.sensitive) { fprintf(f, "  gen_blank(c);\n"); }
+            fprintf(f, "  return 1;\n");
+            break;
+        case G_RULE:
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  if (!rule_%s(c, o)) { return 0; }\n", n->text);
+            fprintf(f, "  *o = mpc_ast_state(mpc_ast_add_root(mpc_ast_add_tag(*o, \"%s\")), gen_state(c, s));\n", n->text);
+            fprintf(f, "  return 1;\n");
+            break;
+        case G_AND:
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  mpc_val_t *xs[2];\n");
+            fprintf(f, "  if (!g%d(c, &xs[0])) { c->pos = s; return 0; }\n", n->xs[0]->id);
+            for (int j = 1; j < n->num; j++) {
+                fprintf(f, "  if (!g%d(c, &xs[1])) { mpc_ast_delete(xs[0]); c->pos = s; return 0; }\n", n->xs[j]->id);
+                fprintf(f, "  xs[0] = mpcf_fold_ast(2, xs);\n");
+            }
+            fprintf(f, "  *o = xs[0];\n");
+            fprintf(f, "  return 1;\n");
+            break;
+        case G_OR:
+            /* Until something fails the alternatives that cannot start with the next char are skipped */
+            for (int j = 0; j < n->num; j++) {
+                node *x = n->xs[j];
+                char only = 0;
+                int count = first_count(x, &only);
+                if (count == 256) {
+                    fprintf(f, "  if (g%d(c, o)) { return 1; }\n", x->id);
+                } else if (count == 1) {
+                    fprintf(f, "  if ((c->rec || (c->pos < c->len && c->s[c->pos] == ");
+                    out_char(f, only);
+                    fprintf(f, ")) && g%d(c, o)) { return 1; }\n", x->id);
+                } else {
+                    fprintf(f, "  if ((c->rec || (c->pos < c->len && gen_in(gen_set%d, c->s[c->pos]))) && g%d(c, o)) { return 1; }\n",
+                            gen_set(x->first), x->id);
+                }
+                fprintf(f, "  gen_merge(c);\n");
+            }
+            fprintf(f, "  return 0;\n");
+            break;
+        case G_MANY:
+        case G_MANY1:
+            fprintf(f, "  int base = c->vals_num;\n");
+            fprintf(f, "  long p;\n");
+            fprintf(f, "  mpc_val_t *x;\n");
+            fprintf(f, "  while (p = c->pos, g%d(c, &x)) {\n", n->xs[0]->id);
+            fprintf(f, "    gen_push(c, x);\n");
+            fprintf(f, "    if (c->pos == p) { *o = gen_fold(c, base); return 1; }\n");
+            fprintf(f, "  }\n");
+            if (n->type == G_MANY1) {
+                fprintf(f, "  if (c->vals_num == base) {\n");
+                out_map(f, n, "    ");
+                fprintf(f, "    return 0;\n");
+                fprintf(f, "  }\n");
+            }
+            fprintf(f, "  gen_merge(c);\n");
+            fprintf(f, "  *o = gen_fold(c, base);\n");
+            fprintf(f, "  return 1;\n");
+            break;
+        case G_MAYBE:
+            fprintf(f, "  if (g%d(c, o)) { return 1; }\n", n->xs[0]->id);
+            fprintf(f, "  gen_merge(c);\n");
+            fprintf(f, "  *o = NULL;\n");
+            fprintf(f, "  return 1;\n");
+            break;
+        case G_NOT:
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  int x;\n");
+            fprintf(f, "  c->suppress++;\n");
+            fprintf(f, "  x = g%d(c, o);\n", n->xs[0]->id);
+            fprintf(f, "  c->suppress--;\n");
+            fprintf(f, "  if (!x) { *o = NULL; return 1; }\n");
+            fprintf(f, "  mpc_ast_delete(*o);\n");
+            fprintf(f, "  c->pos = s;\n");
+            fprintf(f, "  return gen_fail(c, s, %d);\n", n->expected);
+            break;
+        case G_COUNT:
+            fprintf(f, "  long s = c->pos;\n");
+            fprintf(f, "  int base = c->vals_num, j;\n");
+            fprintf(f, "  mpc_val_t *x;\n");
+            fprintf(f, "  for (j = 0; j < %d; j++) {\n", n->n);
+            fprintf(f, "    if (g%d(c, &x)) { gen_push(c, x); continue; }\n", n->xs[0]->id);
+            fprintf(f, "    gen_drop(c, base);\n");
+            fprintf(f, "    c->pos = s;\n");
+            out_map(f, n, "    ");
+            fprintf(f, "    return 0;\n");
+            fprintf(f, "  }\n");
+            fprintf(f, "  *o = gen_fold(c, base);\n");
+            fprintf(f, "  return 1;\n");
+            break;
+    }
+    fprintf(f, "}\n\n");
+}
+
+static void out_source(FILE *f, const char *prefix, const char *header, int depth) {
+    fprintf(f, "/* Generated by mpcgen from %s, do not edit */\n\n", gen.file);
+    fprintf(f, "#include <setjmp.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+    fprintf(f, "#include \"%s\"\n\n", header);
+    fprintf(f, "enum { GEN_DEPTH_MAX = %d };\n\n", depth);
+
+    for (int j = 0; j < gen.nodes_num; j++) {
+        node *n = gen.nodes[j];
+        if ((n->type == R_MANY || n->type == R_MANY1) && (n->xs[0]->type == R_CHAR || n->xs[0]->type == R_SET)) {
+            n->xs[0]->inlined = 1;
+        }
+        /* Sets the alternatives are predicted with go in the table too */
+        if (n->type == G_OR) {
+            for (int k = 0; k < n->num; k++) {
+                char only = 0;
+                int count = first_count(n->xs[k], &only);
+                if (count > 1 && count < 256) { gen_set(n->xs[k]->first); }
+            }
+        }
+    }
+
+    /* Which of the helpers below are used */
+    int uses[R_COUNT + 1] = {0};
+    for (int j = 0; j < gen.nodes_num; j++) { if (gen.nodes[j]->type >= 0) { uses[gen.nodes[j]->type] = 1; } }
+    if (uses[R_SET] || uses[R_CHAR]) { fprintf(f, "#define GEN_SETS\n"); }
+    if (uses[G_MANY] || uses[G_MANY1] || uses[G_COUNT]) { fprintf(f, "#define GEN_REPEATS\n"); }
+    if (uses[G_REGEX]) { fprintf(f, "#define GEN_REGEX\n"); }
+    if (!gen.sensitive) { fprintf(f, "#define GEN_BLANK\n"); }
+    if (uses[R_SOI] || uses[R_EOI] || uses[R_BOUNDARY]) { fprintf(f, "#define GEN_ANCHORS\n"); }
+    if (uses[R_BOUNDARY]) { fprintf(f, "#define GEN_BOUNDARY\n"); }
+    fprintf(f, "\n");
+
+    fprintf(f, "const char *const %s_grammar =\n  ", prefix);
+    for (const char *s = gen.src, *nl; *s; s = nl) {
+        nl = strchr(s, '\n');
+        nl = nl ? nl + 1 : s + strlen(s);
+        if (s != gen.src) { fprintf(f, "\n  "); }
+        out_cstr(f, s, nl - s);
+    }
+    fprintf(f, ";\n\n");
+
+    fprintf(f, "static const char *const gen_expected[] = {\n");
+    for (int j = 0; j < gen.expected_num; j++) {
+        fprintf(f, "  ");
+        out_cstr(f, gen.expected[j], strlen(gen.expected[j]));
+        fprintf(f, ",\n");
+    }
+    fprintf(f, "};\n\n");
+
+    unsigned char space[32] = {0};
+    for (const char *s = " \f\n\r\t\v"; *s; s++) { space[*s / 8] |= 1 << (*s % 8); }
+    for (int j = gen.sensitive ? 0 : -1; j < gen.sets_num; j++) {
+        const unsigned char *set = j < 0 ? space : gen.sets[j];
+        if (j < 0) { fprintf(f, "static const unsigned char gen_space[32] = {"); }
+        else { fprintf(f, "static const unsigned char gen_set%d[32] = {", j); }
+        for (int k = 0; k < 32; k++) { fprintf(f, "%s0x%02x", k ? "," : "", set[k]); }
+        fprintf(f, "};\n");
+    }
+    fprintf(f, "\n%s\n", gen_prelude);
+
+    for (int j = 0; j < gen.rules_num; j++) {
+        fprintf(f, "static int rule_%s(gen_ctx *c, mpc_val_t **o);\n", gen.rules[j].ident);
+    }
+    for (int j = 0; j < gen.nodes_num; j++) {
+        node *n = gen.nodes[j];
+        if (n->type < 0 || n->inlined) { continue; }
+        if (n->type < R_CHAR) {
+            fprintf(f, "static int g%d(gen_ctx *c, mpc_val_t **o);\n", n->id);
+        } else {
+            fprintf(f, "static int r%d(gen_ctx *c, int rec);\n", n->id);
+        }
+    }
+    fprintf(f, "\n");
+
+    for (int j = 0; j < gen.nodes_num; j++) {
+        if (gen.nodes[j]->type < 0 || gen.nodes[j]->inlined) { continue; }
+        if (gen.nodes[j]->type < R_CHAR) { out_grammar(f, gen.nodes[j]); } else { out_regex(f, gen.nodes[j]); }
+    }
+
+    for (int j = 0; j < gen.rules_num; j++) {
+        rule *r = &gen.rules[j];
+        fprintf(f, "static int rule_%s(gen_ctx *c, mpc_val_t **o) {\n", r->ident);
+        fprintf(f, "  int x;\n");
+        fprintf(f, "  gen_enter(c);\n");
+        if (r->name) {
+            fprintf(f, "  c->suppress++;\n");
+            fprintf(f, "  x = g%d(c, o);\n", r->body->id);
+            fprintf(f, "  c->suppress--;\n");
+            fprintf(f, "  if (!x) { gen_fail(c, c->pos, %d); }\n", r->leaves[0]);
+        } else {
+            fprintf(f, "  x = g%d(c, o);\n", r->body->id);
+        }
+        fprintf(f, "  c->depth--;\n");
+        fprintf(f, "  return x;\n");
+        fprintf(f, "}\n\n");
+    }
+
+    for (int j = 0; j < gen.rules_num; j++) {
+        fprintf(f, "int %s_%s(mpc_native_input_t *in, mpc_val_t **out) {\n", prefix, gen.rules[j].ident);
+        fprintf(f, "  return gen_run(in, out, rule_%s);\n", gen.rules[j].ident);
+        fprintf(f, "}\n\n");
+    }
+}
+
+static void out_header(FILE *f, const char *prefix) {
+    char guard[64];
+    size_t j;
+    for (j = 0; prefix[j] && j < sizeof(guard) - 3; j++) {
+        guard[j] = prefix[j] >= 'a' && prefix[j] <= 'z' ? prefix[j] - 'a' + 'A' : prefix[j];
+    }
+    strcpy(guard + j, "_H");
+
+    fprintf(f, "/* Generated by mpcgen from %s, do not edit */\n\n", gen.file);
+    fprintf(f, "#ifndef %s\n#define %s\n\n#include \"mpc.h\"\n\n", guard, guard);
+    fprintf(f, "/* The grammar these were generated from, as mpca_lang takes it */\n");
+    fprintf(f, "extern const char *const %s_grammar;\n\n", prefix);
+    fprintf(f, "/* Native parsers for each rule, see mpc_native, yielding the AST mpca_lang would */\n");
+    for (int k = 0; k < gen.rules_num; k++) {
+        fprintf(f, "int %s_%s(mpc_native_input_t *in, mpc_val_t **out);\n", prefix, gen.rules[k].ident);
+    }
+    fprintf(f, "\n#endif\n");
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) { perror(path); exit(1); }
+    size_t n = 0, slots = 4096;
+    char *s = malloc(slots);
+    size_t r;
+    while ((r = fread(s + n, 1, slots - n - 1, f)) > 0) {
+        n += r;
+        if (n + 1 == slots) { s = realloc(s, slots *= 2); }
+    }
+    fclose(f);
+    s[n] = '\0';
+    return s;
+}
+
+static const char *base_name(const char *path) {
+    const char *s = strrchr(path, '/');
+    return s ? s + 1 : path;
+}
+
+int main(int argc, char **argv) {
+    const char *prefix = "gen";
+    int depth = GEN_DEPTH_DEFAULT;
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-w") == 0) { gen.sensitive = 1; }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) { prefix = argv[++i]; }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) { depth = atoi(argv[++i]); }
+        else { break; }
+    }
+    if (argc - i != 3) {
+        fprintf(stderr, "usage: mpcgen [-w] [-p prefix] [-d depth] grammar out.c out.h\n");
+        return 1;
+    }
+
+    gen.file = base_name(argv[i]);
+    gen.src = read_file(argv[i]);
+    gen_expected("opposite");
+    gram_parse();
+    leaves_solve();
+    first_solve();
+
+    FILE *c = fopen(argv[i + 1], "w");
+    FILE *h = c ? fopen(argv[i + 2], "w") : NULL;
+    if (c == NULL || h == NULL) { perror("mpcgen"); return 1; }
+    out_source(c, prefix, base_name(argv[i + 2]), depth);
+    out_header(h, prefix);
+    fclose(c);
+    fclose(h);
+    return 0;
+}
@@ -1,83 +1,50 @@
 #include <stdio.h>
-#include <assert.h>
+#include <stdlib.h>
 #include <editline/readline.h>
 
-#include "parser.h"
-#include "lval.h"
-#include "builtins.h"
+#include "byol.h"
 
-int main (int argc, char** argv) {
-    /* maybe get rid of expr and represent everything as sexpr*/
-    mpc_parser_t* Number = mpc_new("number");
-    mpc_parser_t* Symbol = mpc_new("symbol");
-    mpc_parser_t* String = mpc_new("string");
-    mpc_parser_t* Comment = mpc_new("comment");
-    mpc_parser_t* Sexpr = mpc_new("sexpr");
-    mpc_parser_t* Qexpr = mpc_new("qexpr");
-    mpc_parser_t* Expr = mpc_new("expr");
-    mpc_parser_t* Lispy = mpc_new("lispy");
-
-    /* Define them with the following Language*/
-    mpca_lang(MPCA_LANG_DEFAULT,
-			  "                                                  \
-              number: /-?[0-9]+/ ;								 \
-              symbol: /[a-zA-Z0-9_+\\-*\\/\\\\=<>!&]+/ ;		 \
-              string: /\"(\\\\.|[^\"])*\"/ ;                     \
-              comment: /;[^\\r\\n]*/ ;                           \
-              sexpr: '(' <expr>* ')' ;                           \
-              qexpr: '{' <expr>* '}' ;                           \
-              expr: <number> | <symbol> | <sexpr>                \
-                    | <qexpr> | <string> | <comment> ;           \
-              lispy: /^/ <expr>* /$/ ;							 \
-              ",
-			  Number, Symbol, String, Comment, Sexpr, Qexpr, Expr, Lispy);
+static void repl_write(void *ctx, const char *s, size_t n) {
+    fwrite(s, 1, n, ctx);
+}
 
-	lenv* e = lenv_new();
-	lenv_add_builtins(e);
-	lenv_load_stdlib(e, Lispy);
+int main (int argc, char** argv) {
+	byol* b = byol_new();
+	byol_set_output(b, repl_write, stdout);
+
+	byol_value* x = byol_require(b, "../stdlib.txt");
+	if (byol_value_type(x) == BYOL_ERROR) {
+	    char* s = byol_value_repr(x);
+	    fputs(s, stdout);
+	    free(s);
+	}
+	byol_value_del(x);
 
 	/* If we got some files to evaluate */
-	if (argc > 2) {
-	    for (int i = 1; i < argc; i++) {
-	        lenv_load_lib(e, argv[i], Lispy);
-	    }
+	if (argc > 1) {
+	    byol_require_all(b, argc - 1, argv + 1);
 	}
   
     puts ("Lispy version 0.8");
     puts ("Exit with Ctrl-c or Ctrl-d");
 
-    while (1) {
-    	char* input = readline ("lispy> ");
+    /* Lines are collected until every paren, brace and string is closed */
+    int pending = 0;
+
+    while (!byol_exited(b)) {
+    	char* input = readline (pending ? "  ...> " : "lispy> ");
     	if (input == NULL) {
     	    break;
     	}
     
     	add_history (input);
 
-    	mpc_result_t r;
-
-    	/* Attempt to parser user input*/
-    	if (mpc_parse("<stdin>", input, Lispy, &r)) {
-			lval* in = lval_read (r.output);
-			int in_count = in->count;
-			for (int i = 0; i < in_count; i++) {
-				lval* result = lval_eval (e, lval_pop(in, 0));
-				lval_println (result);
-				lval_del(1, result);
-			}
-    	    lval_del (1, in);
-    	    mpc_ast_delete(r.output);
-    	} else {
-    	    mpc_err_print(r.error);
-    	    mpc_err_delete(r.error);
-    	}
-
+    	/* Evaluated and printed once complete */
+    	pending = byol_feed_line(b, input);
     	free (input);
     }
 
-    mpc_cleanup(8, Number, Symbol, String, Comment, Sexpr, Qexpr, Expr, Lispy);
+    byol_del(b);
     putchar('\n');
     return 0;
 }
-
-   
@@ -7,13 +7,18 @@
 #ifndef BYOL_PARSER_H
 #define BYOL_PARSER_H
 
-mpc_parser_t* Number;
-mpc_parser_t* Symbol;
-mpc_parser_t* String;
-mpc_parser_t* Comment;
-mpc_parser_t* Sexpr;
-mpc_parser_t* Qexpr;
-mpc_parser_t* Expr;
-mpc_parser_t* Lispy;
+extern mpc_parser_t* Number;
+extern mpc_parser_t* Symbol;
+extern mpc_parser_t* String;
+extern mpc_parser_t* Comment;
+extern mpc_parser_t* Sexpr;
+extern mpc_parser_t* Qexpr;
+extern mpc_parser_t* Expr;
+extern mpc_parser_t* Lispy;
+
+/* Build the grammar, parsing with Lispy yields an sexpr of lvals */
+void lgrammar_new(void);
+
+void lgrammar_del(void);
 
 #endif //BYOL_PARSER_H
@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+/* The pool the current thread works for and its deque, callers from outside have none */
+static _Thread_local lpool *lpool_self_pool;
+static _Thread_local int lpool_self_index;
+
+int lpool_cores(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+}
+
+static void lpool_deque_init(lpool_deque *d) {
+    pthread_mutex_init(&d->lock, NULL);
+    d->slots = 16;
+    d->ranges = malloc(sizeof(lpool_range) * d->slots);
+    d->tail = 0;
+    d->count = 0;
+}
+
+static void lpool_deque_free(lpool_deque *d) {
+    pthread_mutex_destroy(&d->lock);
+    free(d->ranges);
+}
+
+/* Wake a thread waiting for work, if there is one */
+static void lpool_signal(lpool *p) {
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void lpool_push(lpool *p, int self, lpool_range r) {
+    lpool_deque *d = &p->deques[self];
+    pthread_mutex_lock(&d->lock);
+    if (d->count == d->slots) {
+        /* Unroll the ring into a buffer twice the size */
+        lpool_range *ranges = malloc(sizeof(lpool_range) * d->slots * 2);
+        for (int i = 0; i < d->count; i++) {
+            ranges[i] = d->ranges[(d->tail + i) % d->slots];
+        }
+        free(d->ranges);
+        d->ranges = ranges;
+        d->slots *= 2;
+        d->tail = 0;
+    }
+    d->ranges[(d->tail + d->count) % d->slots] = r;
+    d->count++;
+    pthread_mutex_unlock(&d->lock);
+
+    /* A sleeper either sees pending go up or is seen here, so none sleeps through the push */
+    atomic_fetch_add(&p->pending, 1);
+    if (atomic_load(&p->sleepers) > 0) { lpool_signal(p); }
+}
+
+/* Take the newest range of the deque if from_head, else the oldest */
+static int lpool_take(lpool *p, int i, int from_head, lpool_range *r) {
+    lpool_deque *d = &p->deques[i];
+    pthread_mutex_lock(&d->lock);
+    if (d->count == 0) {
+        pthread_mutex_unlock(&d->lock);
+        return 0;
+    }
+    if (from_head) {
+        *r = d->ranges[(d->tail + d->count - 1) % d->slots];
+    } else {
+        *r = d->ranges[d->tail];
+        d->tail = (d->tail + 1) % d->slots;
+    }
+    d->count--;
+    pthread_mutex_unlock(&d->lock);
+
+    atomic_fetch_sub(&p->pending, 1);
+    return 1;
+}
+
+/* Pop from our own deque, else steal, starting after ourselves so thieves spread out */
+static int lpool_find(lpool *p, int self, lpool_range *r) {
+    if (lpool_take(p, self, 1, r)) { return 1; }
+
+    int n = p->workers + 1;
+    for (int k = 1; k < n; k++) {
+        if (lpool_take(p, (self + k) % n, 0, r)) { return 1; }
+    }
+    return 0;
+}
+
+static void lpool_run(lpool *p, int self, lpool_range r) {
+    lpool_job *job = r.job;
+
+    /* Leave the upper halves for others until what is left is one grain */
+    while (r.hi - r.lo > job->grain) {
+        int mid = r.lo + (r.hi - r.lo) / 2;
+        lpool_range upper = {job, mid, r.hi};
+        lpool_push(p, self, upper);
+        r.hi = mid;
+    }
+
+    for (int i = r.lo; i < r.hi; i++) {
+        job->task(job->ctx, i);
+    }
+
+    if (atomic_fetch_sub(&job->remaining, r.hi - r.lo) == r.hi - r.lo) {
+        lpool_signal(p);
+    }
+}
+
+/* Sleep until a range is pushed, done says so, or the pool shuts down */
+static void lpool_wait(lpool *p, lpool_job *done) {
+    pthread_mutex_lock(&p->lock);
+    atomic_fetch_add(&p->sleepers, 1);
+    while (atomic_load(&p->pending) == 0 && !p->shutdown
+           && !(done && atomic_load(&done->remaining) == 0)) {
+        pthread_cond_wait(&p->wake, &p->lock);
+    }
+    atomic_fetch_sub(&p->sleepers, 1);
+    pthread_mutex_unlock(&p->lock);
+}
+
+typedef struct {
+    lpool *pool;
+    int index;
+} lpool_worker_arg;
+
+static void *lpool_worker(void *arg) {
+    lpool_worker_arg *a = arg;
+    lpool *p = a->pool;
+    lpool_self_pool = p;
+    lpool_self_index = a->index;
+    free(a);
+
+    while (1) {
+        lpool_range r;
+        if (lpool_find(p, lpool_self_index, &r)) {
+            lpool_run(p, lpool_self_index, r);
+            continue;
+        }
+
+        pthread_mutex_lock(&p->lock);
+        int shutdown = p->shutdown;
+        pthread_mutex_unlock(&p->lock);
+        if (shutdown) { break; }
+
+        lpool_wait(p, NULL);
+    }
+
+    return NULL;
+}
+
+lpool *lpool_new(int workers) {
+    lpool *p = calloc(1, sizeof(lpool));
+    p->workers = workers > 0 ? workers : lpool_cores();
+    p->threads = malloc(sizeof(pthread_t) * p->workers);
+    p->deques = malloc(sizeof(lpool_deque) * (p->workers + 1));
+    for (int i = 0; i <= p->workers; i++) {
+        lpool_deque_init(&p->deques[i]);
+    }
+
+    atomic_init(&p->pending, 0);
+    atomic_init(&p->sleepers, 0);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+
+    for (int i = 0; i < p->workers; i++) {
+        lpool_worker_arg *a = malloc(sizeof(lpool_worker_arg));
+        a->pool = p;
+        a->index = i;
+        pthread_create(&p->threads[i], NULL, lpool_worker, a);
+    }
+
+    return p;
+}
+
+void lpool_for(lpool *p, int n, lpool_task task, void *ctx) {
+    if (n <= 0) { return; }
+
+    lpool_job job;
+    job.task = task;
+    job.ctx = ctx;
+    /* Enough ranges for every thread to steal a few, fewer pushes than indices */
+    job.grain = n / ((p->workers + 1) * 8);
+    if (job.grain < 1) { job.grain = 1; }
+    atomic_init(&job.remaining, n);
+
+    int self = lpool_self_pool == p ? lpool_self_index : p->workers;
+    lpool_range all = {&job, 0, n};
+    lpool_push(p, self, all);
+
+    /* The caller helps out, with this job or any other, until this one is done */
+    while (atomic_load(&job.remaining) > 0) {
+        lpool_range r;
+        if (lpool_find(p, self, &r)) {
+            lpool_run(p, self, r);
+        } else {
+            lpool_wait(p, &job);
+        }
+    }
+}
+
+void lpool_del(lpool *p) {
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->workers; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+
+    for (int i = 0; i <= p->workers; i++) {
+        lpool_deque_free(&p->deques[i]);
+    }
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->wake);
+    free(p->deques);
+    free(p->threads);
+    free(p);
+}
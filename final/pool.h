@@ -0,0 +1,76 @@
+#ifndef BYOL_POOL_H
+#define BYOL_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* Body of a parallel loop, called once for every index */
+typedef void (*lpool_task)(void *ctx, int i);
+
+/* One lpool_for call, its indices are handed out in ranges */
+typedef struct {
+    lpool_task task;
+    void *ctx;
+    /* ranges are split until they are no longer than this */
+    int grain;
+    /* indices not run yet */
+    atomic_int remaining;
+} lpool_job;
+
+typedef struct {
+    lpool_job *job;
+    int lo;
+    int hi;
+} lpool_range;
+
+/* Ranges waiting to run. The owner pushes and pops at the head, thieves take from the tail */
+typedef struct {
+    pthread_mutex_t lock;
+    lpool_range *ranges;
+    /* a ring of slots, tail is the index of the oldest range */
+    int slots;
+    int tail;
+    int count;
+} lpool_deque;
+
+/*
+ * A work stealing pool. Every worker has a deque, and so do the threads
+ * that call lpool_for, which share one. A thread runs ranges from its own
+ * deque, splitting them and pushing the halves back, and when it has
+ * none it steals the oldest, largest, range of another.
+ *
+ * There is no allocator per worker, tasks use plain malloc. Workers only
+ * avoid contending for the heap because glibc gives each thread a malloc
+ * arena of its own; with a C library that does not, they share one lock.
+ */
+typedef struct lpool {
+    int workers;
+    pthread_t *threads;
+    /* one per worker, then the one of callers from outside the pool */
+    lpool_deque *deques;
+
+    /* ranges in all deques, and threads waiting for some */
+    atomic_int pending;
+    atomic_int sleepers;
+
+    /* wake is broadcast when a range is pushed to a sleeper or a job is done */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int shutdown;
+} lpool;
+
+/* Create a pool with the given number of worker threads, 0 means one per core */
+lpool *lpool_new(int workers);
+
+/*
+ * Run task for every index in [0, n) and wait for all of them to finish.
+ * The caller runs tasks too while it waits, so a task may itself call
+ * lpool_for on the same pool.
+ */
+void lpool_for(lpool *p, int n, lpool_task task, void *ctx);
+
+void lpool_del(lpool *p);
+
+int lpool_cores(void);
+
+#endif //BYOL_POOL_H
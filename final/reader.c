@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "reader.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void lreader_state_init(lreader_state *s) {
+    s->depth = 0;
+    s->in_string = 0;
+    s->in_comment = 0;
+    s->escape = 0;
+    s->rows = 0;
+    s->line_start = 0;
+}
+
+static int lreader_special(char c) {
+    switch (c) {
+        case '(': case ')': case '{': case '}':
+        case '"': case ';': case '\\': case '\n':
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#if defined(__SSE2__)
+/* Bit i is set if p[i] is a character the state machine has to look at */
+static unsigned lreader_special_mask(const char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('('));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(')')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('{')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    return (unsigned) _mm_movemask_epi8(m);
+}
+#endif
+
+static void lreader_newline(lreader_state *s, size_t q) {
+    s->rows++;
+    s->line_start = q + 1;
+}
+
+/*
+ * Feed the special character at buf[q] to the state machine.
+ * Returns 1 if a top-level form ends right after it.
+ */
+static int lreader_step(lreader_state *s, const char *buf, size_t q, size_t to, size_t *skip) {
+    char c = buf[q];
+
+    if (s->in_comment) {
+        if (c != '\n') { return 0; }
+        s->in_comment = 0;
+        lreader_newline(s, q);
+        return s->depth == 0;
+    }
+
+    if (s->in_string) {
+        if (c == '\\') {
+            /* The escaped character is consumed with the backslash */
+            if (q + 1 < to) {
+                if (buf[q + 1] == '\n') { lreader_newline(s, q + 1); }
+                *skip = q + 2;
+            } else {
+                s->escape = 1;
+            }
+        } else if (c == '"') {
+            s->in_string = 0;
+        } else if (c == '\n') {
+            lreader_newline(s, q);
+        }
+        return 0;
+    }
+
+    switch (c) {
+        case '(':
+        case '{':
+            s->depth++;
+            return 0;
+        case ')':
+        case '}':
+            s->depth--;
+            return s->depth == 0;
+        case '"':
+            s->in_string = 1;
+            return 0;
+        case ';':
+            s->in_comment = 1;
+            return 0;
+        case '\n':
+            lreader_newline(s, q);
+            return s->depth == 0;
+        default:
+            return 0;
+    }
+}
+
+size_t lreader_scan(lreader_state *s, const char *buf, size_t from, size_t to, size_t stop) {
+    size_t p = from;
+    size_t skip = 0;
+
+    /* Finish an escape sequence split across two scans */
+    if (s->escape && p < to) {
+        s->escape = 0;
+        if (buf[p] == '\n') { lreader_newline(s, p); }
+        p++;
+    }
+
+#if defined(__SSE2__)
+    for (; p + 16 <= to; p += 16) {
+        unsigned mask = lreader_special_mask(buf + p);
+        while (mask) {
+            size_t q = p + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (q < skip) { continue; }
+            if (lreader_step(s, buf, q, to, &skip) && q + 1 >= stop) { return q + 1; }
+        }
+    }
+#endif
+
+    for (; p < to; p++) {
+        if (p < skip || !lreader_special(buf[p])) { continue; }
+        if (lreader_step(s, buf, p, to, &skip) && p + 1 >= stop) { return p + 1; }
+    }
+
+    return to;
+}
+
+int lreader_split(const char *buf, size_t len, size_t target, lreader_chunk **chunks) {
+    lreader_state s;
+    lreader_state_init(&s);
+
+    int n = 0;
+    int slots = 16;
+    *chunks = malloc(sizeof(lreader_chunk) * slots);
+
+    size_t pos = 0;
+    while (pos < len) {
+        if (n == slots) {
+            slots *= 2;
+            *chunks = realloc(*chunks, sizeof(lreader_chunk) * slots);
+        }
+
+        lreader_chunk *c = &(*chunks)[n++];
+        c->start = pos;
+        c->row = s.rows;
+        c->col = (long) (pos - s.line_start);
+        c->end = lreader_scan(&s, buf, pos, len, pos + target);
+        pos = c->end;
+    }
+
+    return n;
+}
+
+size_t lreader_form_start(const char *buf, size_t from, size_t fail) {
+    lreader_state s;
+    lreader_state_init(&s);
+
+    size_t start = from;
+    size_t skip = 0;
+    for (size_t p = from; p < fail; p++) {
+        if (p < skip || !lreader_special(buf[p])) { continue; }
+        if (lreader_step(&s, buf, p, fail, &skip)) { start = p + 1; }
+    }
+
+    while (start < fail && (buf[start] == ' ' || buf[start] == '\t' || buf[start] == '\r')) { start++; }
+    return start;
+}
+
+size_t lreader_resync(const char *buf, size_t len, size_t start, size_t fail) {
+    size_t from = fail;
+
+    /* A form whose brackets balance is skipped whole */
+    if (start < len && (buf[start] == '(' || buf[start] == '{')) {
+        lreader_state s;
+        lreader_state_init(&s);
+        size_t end = lreader_scan(&s, buf, start, len, start + 1);
+        if (s.depth == 0 && end > fail) { return end; }
+        from = start;
+    }
+
+    /* Otherwise go on at the next line that starts something at the top level */
+    for (size_t p = from; p < len; p++) {
+        if (buf[p] != '\n' || p + 1 == len) { continue; }
+        char c = buf[p + 1];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != ')' && c != '}') { return p + 1; }
+    }
+    return len;
+}
+
+void lreader_init(lreader *r) {
+    lreader_state_init(&r->state);
+    r->slots = 256;
+    r->buf = malloc(r->slots);
+    r->buf[0] = '\0';
+    r->len = 0;
+}
+
+int lreader_feed(lreader *r, const char *line) {
+    size_t n = strlen(line);
+
+    /* Grow geometrically so a long paste stays linear */
+    if (r->len + n + 2 > r->slots) {
+        while (r->len + n + 2 > r->slots) { r->slots *= 2; }
+        r->buf = realloc(r->buf, r->slots);
+    }
+
+    size_t from = r->len;
+    memcpy(r->buf + r->len, line, n);
+    r->len += n;
+    r->buf[r->len++] = '\n';
+    r->buf[r->len] = '\0';
+
+    lreader_scan(&r->state, r->buf, from, r->len, r->len);
+
+    /* Unbalanced closing brackets are complete too, so the parser can report them */
+    return r->state.depth <= 0 && !r->state.in_string && !r->state.escape;
+}
+
+int lreader_pending(lreader *r) {
+    return r->len > 0;
+}
+
+void lreader_reset(lreader *r) {
+    lreader_state_init(&r->state);
+    r->len = 0;
+    r->buf[0] = '\0';
+}
+
+void lreader_free(lreader *r) {
+    free(r->buf);
+}
@@ -0,0 +1,70 @@
+#ifndef BYOL_READER_H
+#define BYOL_READER_H
+
+#include <stddef.h>
+
+/* Lexical state carried across a scan of lispy source */
+typedef struct {
+    /* paren and brace nesting */
+    long depth;
+    int in_string;
+    int in_comment;
+    /* last character was a backslash inside a string */
+    int escape;
+    /* newlines seen so far */
+    long rows;
+    /* offset of the character after the last newline */
+    size_t line_start;
+} lreader_state;
+
+/* A run of complete top-level forms inside a larger buffer */
+typedef struct {
+    size_t start;
+    size_t end;
+    /* row and column of start, zero based */
+    long row;
+    long col;
+} lreader_chunk;
+
+/* Accumulates REPL lines until they hold only complete forms */
+typedef struct {
+    lreader_state state;
+    char *buf;
+    size_t len;
+    size_t slots;
+} lreader;
+
+void lreader_state_init(lreader_state *s);
+
+/* Scan buf[from, to) updating s, returns the first top-level boundary at or after stop (or to) */
+size_t lreader_scan(lreader_state *s, const char *buf, size_t from, size_t to, size_t stop);
+
+/*
+ * Split buf into chunks of roughly target bytes that start and end on
+ * top-level form boundaries. Returns the number of chunks written to *chunks.
+ */
+int lreader_split(const char *buf, size_t len, size_t target, lreader_chunk **chunks);
+
+/* Start of the top-level form that buf[fail] is part of, scanning from a boundary at from */
+size_t lreader_form_start(const char *buf, size_t from, size_t fail);
+
+/*
+ * Where to carry on after the form at start failed to parse at fail: just past
+ * it if its brackets balance, else the next line starting with something other
+ * than blanks or closing brackets. Always past start unless that is len.
+ */
+size_t lreader_resync(const char *buf, size_t len, size_t start, size_t fail);
+
+void lreader_init(lreader *r);
+
+/* Append a line, only scanning the new text. Returns 1 once every form is closed */
+int lreader_feed(lreader *r, const char *line);
+
+/* True if some input is waiting for more lines */
+int lreader_pending(lreader *r);
+
+void lreader_reset(lreader *r);
+
+void lreader_free(lreader *r);
+
+#endif //BYOL_READER_H
@@ -0,0 +1,185 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "interp.h"
+#include "mpc.h"
+#include "parser.h"
+
+/*
+ * Regression tests, run by ctest. Run all of them or name the ones to run:
+ *
+ *   tests [name ...]
+ */
+
+enum { TEST_STRING, TEST_FILE, TEST_PIPE };
+
+static const char *test_kinds[] = {"string", "file", "pipe"};
+
+/* Parse text from the given kind of input, returns the AST or the error as text */
+static char *test_parse(int kind, const char *text, mpc_parser_t *p) {
+    mpc_result_t r;
+    int ok = 0;
+
+    if (kind == TEST_STRING) {
+        ok = mpc_parse("<test>", text, p, &r);
+    } else if (kind == TEST_FILE) {
+        /* A regular file, which mpc maps into memory */
+        FILE *f = tmpfile();
+        fputs(text, f);
+        rewind(f);
+        ok = mpc_parse_file("<test>", f, p, &r);
+        fclose(f);
+    } else {
+        int fds[2];
+        if (pipe(fds) != 0) { return strdup("no pipe"); }
+        if (write(fds[1], text, strlen(text)) != (ssize_t) strlen(text)) { return strdup("short write"); }
+        close(fds[1]);
+        FILE *f = fdopen(fds[0], "r");
+        ok = mpc_parse_pipe("<test>", f, p, &r);
+        fclose(f);
+    }
+
+    char *out;
+    size_t len;
+    FILE *s = open_memstream(&out, &len);
+    if (ok) {
+        fputs("ok ", s);
+        mpc_ast_print_to(r.output, s);
+        mpc_ast_delete(r.output);
+    } else {
+        fputs("error ", s);
+        mpc_err_print_to(r.error, s);
+        mpc_err_delete(r.error);
+    }
+    fclose(s);
+    return out;
+}
+
+/* Every kind of input should give what the string gives, and expect should match it if given */
+static int test_same(mpc_parser_t *p, const char *text, const char *expect) {
+    int failed = 0;
+    char *want = test_parse(TEST_STRING, text, p);
+
+    if (expect && strncmp(want, expect, strlen(expect)) != 0) {
+        printf("  '%s' from a string: expected %s, got %s", text, expect, want);
+        failed++;
+    }
+    for (int k = TEST_FILE; k <= TEST_PIPE; k++) {
+        char *got = test_parse(k, text, p);
+        if (strcmp(want, got) != 0) {
+            printf("  '%s' from a %s: %s  from a string: %s", text, test_kinds[k], got, want);
+            failed++;
+        }
+        free(got);
+    }
+    free(want);
+    return failed;
+}
+
+/* Without backtracking a literal that matches only in part leaves every input at the same place */
+static int test_literal(void) {
+    int failed = 0;
+
+    mpc_parser_t *c = mpc_new("c");
+    mpc_err_t *err = mpca_lang(MPCA_LANG_PREDICTIVE, " c : \"let\" | \"lex\" ; ", c, NULL);
+    if (err) { mpc_err_print(err); mpc_err_delete(err); return 1; }
+
+    /* "let" eats the "le", so "lex" cannot match any more */
+    failed += test_same(c, "lex", "error <test>:1:3:");
+    failed += test_same(c, "let", "ok");
+    failed += test_same(c, "le", "error <test>:1:3:");
+    failed += test_same(c, "lxt", "error <test>:1:2:");
+    failed += test_same(c, "", "error <test>:1:1:");
+    mpc_cleanup(1, c);
+    return failed;
+}
+
+/* A regex run as a DFA reports what the regex parser itself reports where it stops */
+static int test_regex(void) {
+    int failed = 0;
+
+    mpc_parser_t *w = mpc_new("w");
+    mpc_err_t *err = mpca_lang(MPCA_LANG_DEFAULT, " w : /[a-c]+/ ';' ; ", w, NULL);
+    if (err) { mpc_err_print(err); mpc_err_delete(err); return 1; }
+
+    /* The stop char is expected by both the regex and the ';' */
+    failed += test_same(w, "abd", "error <test>:1:3: error: expected one of 'abc' or ';' at 'd'");
+    failed += test_same(w, "ab;", "ok");
+    failed += test_same(w, "d", "error <test>:1:1:");
+    mpc_cleanup(1, w);
+    return failed;
+}
+
+static void test_write(void *ctx, const char *s, size_t n) {
+    fwrite(s, 1, n, ctx);
+}
+
+/* A recovering load reports a form that never closes on the line it opens */
+static int test_recover(void) {
+    static const char *src = "(def {a} 1)\n"
+                             "(def {b} 2)\n"
+                             "  (def {c} (+ a\n"
+                             "  b)\n"
+                             "(def {d} 4)\n";
+    int failed = 0;
+
+    char path[] = "/tmp/byol-test-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, src, strlen(src)) != (ssize_t) strlen(src)) { return 1; }
+    close(fd);
+
+    char *out;
+    size_t len;
+    FILE *s = open_memstream(&out, &len);
+    linterp *in = linterp_new(Lispy);
+    linterp_set_output(in, test_write, s);
+
+    char load[64], expect[64];
+    snprintf(load, sizeof(load), "(load \"%s\" \"recover\")", path);
+    snprintf(expect, sizeof(expect), "%s:3:3: error: unterminated form", path);
+    linterp_eval(in, "<test>", load, strlen(load), 0);
+    linterp_del(in);
+    fclose(s);
+    unlink(path);
+
+    if (strstr(out, expect) == NULL) {
+        printf("  expected %s in:\n%s", expect, out);
+        failed++;
+    }
+    free(out);
+    return failed;
+}
+
+typedef struct {
+    char *name;
+    int (*run)(void);
+} test;
+
+static test tests[] = {
+    {"literal", test_literal},
+    {"regex", test_regex},
+    {"recover", test_recover},
+};
+
+int main(int argc, char **argv) {
+    int failed = 0;
+    lgrammar_new();
+
+    int n = sizeof(tests) / sizeof(tests[0]);
+    for (int i = 0; i < n; i++) {
+        int selected = argc < 2;
+        for (int j = 1; j < argc; j++) {
+            if (strcmp(argv[j], tests[i].name) == 0) { selected = 1; }
+        }
+        if (!selected) { continue; }
+        int f = tests[i].run();
+        printf("%s: %s\n", tests[i].name, f ? "FAILED" : "ok");
+        failed += f;
+    }
+
+    lgrammar_del();
+    return failed != 0;
+}